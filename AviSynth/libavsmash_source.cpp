@@ -59,9 +59,7 @@ uint32_t LSMASHVideoSource::open_file
     lhp->priv     = env;
     lhp->show_log = throw_error;
     lsmash_movie_parameters_t movie_param;
-    AVFormatContext *format_ctx = nullptr;
-    lsmash_root_t *root = libavsmash_open_file( &format_ctx, source, &file_param, &movie_param, lhp );
-    this->format_ctx.reset( format_ctx );
+    lsmash_root_t *root = libavsmash_open_file( source, &movie_param, lhp );
     libavsmash_video_set_root( vdhp, root );
     return movie_param.number_of_tracks;
 }
@@ -85,7 +83,7 @@ static void prepare_video_decoding
 (
     libavsmash_video_decode_handler_t *vdhp,
     libavsmash_video_output_handler_t *vohp,
-    AVFormatContext                   *format_ctx,
+    const char                        *source,
     int                                threads,
     int                                direct_rendering,
     int                                stacked_format,
@@ -95,7 +93,7 @@ static void prepare_video_decoding
 )
 {
     /* Initialize the video decoder configuration. */
-    if( libavsmash_video_initialize_decoder_configuration( vdhp, format_ctx, threads ) < 0 )
+    if( libavsmash_video_initialize_decoder_configuration( vdhp, source, threads ) < 0 )
         env->ThrowError( "LSMASHVideoSource: failed to initialize the decoder configuration." );
     /* Set up output format. */
     AVCodecContext *ctx = libavsmash_video_get_codec_context( vdhp );
@@ -140,6 +138,8 @@ LSMASHVideoSource::LSMASHVideoSource
     int                 stacked_format,
     enum AVPixelFormat  pixel_format,
     const char         *preferred_decoder_names,
+    int                 tonemap,
+    int                 prefetch,
     IScriptEnvironment *env
 ) : LSMASHVideoSource{}
 {
@@ -150,9 +150,11 @@ LSMASHVideoSource::LSMASHVideoSource
     libavsmash_video_set_seek_mode              ( vdhp, seek_mode );
     libavsmash_video_set_forward_seek_threshold ( vdhp, forward_seek_threshold );
     libavsmash_video_set_preferred_decoder_names( vdhp, tokenize_preferred_decoder_names() );
+    libavsmash_video_set_prefetch               ( vdhp, prefetch );
     vohp->vfr2cfr = (fps_num > 0 && fps_den > 0);
     vohp->cfr_num = (uint32_t)fps_num;
     vohp->cfr_den = (uint32_t)fps_den;
+    vohp->scaler.tonemap = tonemap;
     as_video_output_handler_t *as_vohp = (as_video_output_handler_t *)lw_malloc_zero( sizeof(as_video_output_handler_t) );
     if( as_vohp == nullptr )
         env->ThrowError( "LSMASHVideoSource: failed to allocate the AviSynth video output handler." );
@@ -161,8 +163,7 @@ LSMASHVideoSource::LSMASHVideoSource
     vohp->private_handler      = as_vohp;
     vohp->free_private_handler = as_free_video_output_handler;
     get_video_track( source, track_number, env );
-    prepare_video_decoding( vdhp, vohp, format_ctx.get(), threads, direct_rendering, stacked_format, pixel_format, vi, env );
-    lsmash_discard_boxes( libavsmash_video_get_root( vdhp ) );
+    prepare_video_decoding( vdhp, vohp, source, threads, direct_rendering, stacked_format, pixel_format, vi, env );
 }
 
 LSMASHVideoSource::~LSMASHVideoSource()
@@ -170,8 +171,7 @@ LSMASHVideoSource::~LSMASHVideoSource()
     libavsmash_video_decode_handler_t *vdhp = this->vdhp.get();
     lsmash_root_t *root = libavsmash_video_get_root( vdhp );
     lw_free( libavsmash_video_get_preferred_decoder_names( vdhp ) );
-    lsmash_close_file( &file_param );
-    lsmash_destroy_root( root );
+    libavsmash_close_file( root );
 }
 
 PVideoFrame __stdcall LSMASHVideoSource::GetFrame( int n, IScriptEnvironment *env )
@@ -181,6 +181,7 @@ PVideoFrame __stdcall LSMASHVideoSource::GetFrame( int n, IScriptEnvironment *en
     libavsmash_video_output_handler_t *vohp = this->vohp.get();
     lw_log_handler_t *lhp = libavsmash_video_get_log_handler( vdhp );
     lhp->priv = env;
+    discard_boxes( libavsmash_video_get_root( vdhp ) );
     if( libavsmash_video_get_error( vdhp )
      || libavsmash_video_get_frame( vdhp, vohp, sample_number ) < 0 )
         return env->NewVideoFrame( vi );
@@ -200,9 +201,7 @@ uint32_t LSMASHAudioSource::open_file( const char *source, IScriptEnvironment *e
     lhp->priv     = env;
     lhp->show_log = throw_error;
     lsmash_movie_parameters_t movie_param;
-    AVFormatContext *format_ctx = nullptr;
-    lsmash_root_t *root = libavsmash_open_file( &format_ctx, source, &file_param, &movie_param, lhp );
-    this->format_ctx.reset( format_ctx );
+    lsmash_root_t *root = libavsmash_open_file( source, &movie_param, lhp );
     libavsmash_audio_set_root( adhp, root );
     return movie_param.number_of_tracks;
 }
@@ -244,7 +243,9 @@ void LSMASHAudioSource::get_audio_track( const char *source, uint32_t track_numb
     (void)libavsmash_audio_get_track( adhp, track_number );
     lsmash_root_t *root = libavsmash_audio_get_root( adhp );
     uint32_t track_id = libavsmash_audio_get_track_id( adhp );
+    libavsmash_lock_root( root );
     vi.num_audio_samples = lsmash_get_media_duration_from_media_timeline( root, track_id );
+    libavsmash_unlock_root( root );
     if( skip_priming )
     {
         libavsmash_audio_output_handler_t *aohp = this->aohp.get();
@@ -298,7 +299,10 @@ void LSMASHAudioSource::get_audio_track( const char *source, uint32_t track_numb
         if( aohp->skip_decoded_samples == 0 )
         {
             uint32_t ctd_shift;
-            if( lsmash_get_composition_to_decode_shift_from_media_timeline( root, track_id, &ctd_shift ) )
+            libavsmash_lock_root( root );
+            int err = lsmash_get_composition_to_decode_shift_from_media_timeline( root, track_id, &ctd_shift );
+            libavsmash_unlock_root( root );
+            if( err )
                 env->ThrowError( "LSMASHAudioSource: failed to get the timeline shift." );
             aohp->skip_decoded_samples = ctd_shift + get_start_time( root, track_id );
         }
@@ -309,7 +313,7 @@ static void prepare_audio_decoding
 (
     libavsmash_audio_decode_handler_t *adhp,
     libavsmash_audio_output_handler_t *aohp,
-    AVFormatContext                   *format_ctx,
+    const char                        *source,
     uint64_t                           channel_layout,
     int                                sample_rate,
     VideoInfo                         &vi,
@@ -317,7 +321,7 @@ static void prepare_audio_decoding
 )
 {
     /* Initialize the audio decoder configuration. */
-    if( libavsmash_audio_initialize_decoder_configuration( adhp, format_ctx, 0 ) < 0 )
+    if( libavsmash_audio_initialize_decoder_configuration( adhp, source, 0 ) < 0 )
         env->ThrowError( "LSMASHAudioSource: failed to initialize the decoder configuration." );
     aohp->output_channel_layout  = libavsmash_audio_get_best_used_channel_layout ( adhp );
     aohp->output_sample_format   = libavsmash_audio_get_best_used_sample_format  ( adhp );
@@ -341,6 +345,7 @@ LSMASHAudioSource::LSMASHAudioSource
     uint64_t            channel_layout,
     int                 sample_rate,
     const char         *preferred_decoder_names,
+    int                 prefetch,
     IScriptEnvironment *env
 ) : LSMASHAudioSource{}
 {
@@ -349,9 +354,9 @@ LSMASHAudioSource::LSMASHAudioSource
     libavsmash_audio_output_handler_t *aohp = this->aohp.get();
     set_preferred_decoder_names( preferred_decoder_names );
     libavsmash_audio_set_preferred_decoder_names( adhp, tokenize_preferred_decoder_names() );
+    libavsmash_audio_set_prefetch               ( adhp, prefetch );
     get_audio_track( source, track_number, skip_priming, env );
-    prepare_audio_decoding( adhp, aohp, format_ctx.get(), channel_layout, sample_rate, vi, env );
-    lsmash_discard_boxes( libavsmash_audio_get_root( adhp ) );
+    prepare_audio_decoding( adhp, aohp, source, channel_layout, sample_rate, vi, env );
 }
 
 LSMASHAudioSource::~LSMASHAudioSource()
@@ -359,8 +364,7 @@ LSMASHAudioSource::~LSMASHAudioSource()
     libavsmash_audio_decode_handler_t *adhp = this->adhp.get();
     lsmash_root_t *root = libavsmash_audio_get_root( adhp );
     lw_free( libavsmash_audio_get_preferred_decoder_names( adhp ) );
-    lsmash_close_file( &file_param );
-    lsmash_destroy_root( root );
+    libavsmash_close_file( root );
 }
 
 void __stdcall LSMASHAudioSource::GetAudio( void *buf, __int64 start, __int64 wanted_length, IScriptEnvironment *env )
@@ -369,6 +373,7 @@ void __stdcall LSMASHAudioSource::GetAudio( void *buf, __int64 start, __int64 wa
     libavsmash_audio_output_handler_t *aohp = this->aohp.get();
     lw_log_handler_t *lhp = libavsmash_audio_get_log_handler( adhp );
     lhp->priv = env;
+    discard_boxes( libavsmash_audio_get_root( adhp ) );
     return (void)libavsmash_audio_get_pcm_samples( adhp, aohp, buf, start, wanted_length );
 }
 
@@ -388,12 +393,14 @@ AVSValue __cdecl CreateLSMASHVideoSource( AVSValue args, void *user_data, IScrip
     int         stacked_format          = args[8].AsBool( false ) ? 1 : 0;
     enum AVPixelFormat pixel_format     = get_av_output_pixel_format( args[9].AsString( nullptr ) );
     const char *preferred_decoder_names = args[10].AsString( nullptr );
+    int         tonemap                 = args[11].AsBool( false ) ? 1 : 0;
+    int         prefetch                = args[12].AsBool( false ) ? 1 : 0;
     threads                = threads >= 0 ? threads : 0;
     seek_mode              = CLIP_VALUE( seek_mode, 0, 2 );
     forward_seek_threshold = CLIP_VALUE( forward_seek_threshold, 1, 999 );
-    direct_rendering      &= (pixel_format == AV_PIX_FMT_NONE);
     return new LSMASHVideoSource( source, track_number, threads, seek_mode, forward_seek_threshold,
-                                  direct_rendering, fps_num, fps_den, stacked_format, pixel_format, preferred_decoder_names, env );
+                                  direct_rendering, fps_num, fps_den, stacked_format, pixel_format, preferred_decoder_names,
+                                  tonemap, prefetch, env );
 }
 
 AVSValue __cdecl CreateLSMASHAudioSource( AVSValue args, void *user_data, IScriptEnvironment *env )
@@ -407,7 +414,8 @@ AVSValue __cdecl CreateLSMASHAudioSource( AVSValue args, void *user_data, IScrip
     const char *layout_string           = args[3].AsString( nullptr );
     int         sample_rate             = args[4].AsInt( 0 );
     const char *preferred_decoder_names = args[5].AsString( nullptr );
+    int         prefetch                = args[6].AsBool( false ) ? 1 : 0;
     uint64_t channel_layout = layout_string ? av_get_channel_layout( layout_string ) : 0;
     return new LSMASHAudioSource( source, track_number, skip_priming,
-                                  channel_layout, sample_rate, preferred_decoder_names, env );
+                                  channel_layout, sample_rate, preferred_decoder_names, prefetch, env );
 }
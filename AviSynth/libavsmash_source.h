@@ -28,12 +28,22 @@
 class LibavSMASHSource : public LSMASHSource
 {
 private:
-    void (*free_format_ctx)( AVFormatContext *p )
-        = []( AVFormatContext *p ){ avformat_close_input( &p ); };
+    bool boxes_discarded = false;
 protected:
-    lsmash_file_parameters_t file_param;
-    std::unique_ptr< AVFormatContext, decltype( free_format_ctx ) > format_ctx;
-    LibavSMASHSource() : format_ctx{ nullptr, free_format_ctx } {}
+    /* The other sources of the same file may still need the shared boxes until the script is evaluated.
+     * So, tell that this source no longer needs them on the first request of a frame or audio samples.
+     * They are discarded under the lock of the shared ROOT once none of the sources sharing it needs them. */
+    inline void discard_boxes
+    (
+        lsmash_root_t *root
+    )
+    {
+        if( boxes_discarded )
+            return;
+        libavsmash_discard_boxes( root );
+        boxes_discarded = true;
+    }
+    LibavSMASHSource() = default;
     ~LibavSMASHSource() = default;
     LibavSMASHSource( const LibavSMASHSource & ) = delete;
     LibavSMASHSource & operator= ( const LibavSMASHSource & ) = delete;
@@ -73,6 +83,8 @@ public:
         int                 stacked_format,
         enum AVPixelFormat  pixel_format,
         const char         *preferred_decoder_names,
+        int                 tonemap,
+        int                 prefetch,
         IScriptEnvironment *env
     );
     ~LSMASHVideoSource();
@@ -111,6 +123,7 @@ public:
         uint64_t            channel_layout,
         int                 sample_rate,
         const char         *preferred_decoder_names,
+        int                 prefetch,
         IScriptEnvironment *env
     );
     ~LSMASHAudioSource();
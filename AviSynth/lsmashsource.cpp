@@ -40,6 +40,7 @@ extern AVSValue __cdecl CreateLSMASHVideoSource( AVSValue args, void *user_data,
 extern AVSValue __cdecl CreateLSMASHAudioSource( AVSValue args, void *user_data, IScriptEnvironment *env );
 extern AVSValue __cdecl CreateLWLibavVideoSource( AVSValue args, void *user_data, IScriptEnvironment *env );
 extern AVSValue __cdecl CreateLWLibavAudioSource( AVSValue args, void *user_data, IScriptEnvironment *env );
+extern AVSValue __cdecl CreateLWLibavMultiAudioSource( AVSValue args, void *user_data, IScriptEnvironment *env );
 
 extern "C" __declspec(dllexport) const char * __stdcall AvisynthPluginInit2( IScriptEnvironment *env )
 {
@@ -47,7 +48,7 @@ extern "C" __declspec(dllexport) const char * __stdcall AvisynthPluginInit2( ISc
     env->AddFunction
     (
         "LSMASHVideoSource",
-        "[source]s[track]i[threads]i[seek_mode]i[seek_threshold]i[dr]b[fpsnum]i[fpsden]i[stacked]b[format]s[decoder]s",
+        "[source]s[track]i[threads]i[seek_mode]i[seek_threshold]i[dr]b[fpsnum]i[fpsden]i[stacked]b[format]s[decoder]s[tonemap]b[prefetch]b",
         CreateLSMASHVideoSource,
         0
     );
@@ -55,7 +56,7 @@ extern "C" __declspec(dllexport) const char * __stdcall AvisynthPluginInit2( ISc
     env->AddFunction
     (
         "LSMASHAudioSource",
-        "[source]s[track]i[skip_priming]b[layout]s[rate]i[decoder]s",
+        "[source]s[track]i[skip_priming]b[layout]s[rate]i[decoder]s[prefetch]b",
         CreateLSMASHAudioSource,
         0
     );
@@ -63,7 +64,7 @@ extern "C" __declspec(dllexport) const char * __stdcall AvisynthPluginInit2( ISc
     env->AddFunction
     (
         "LWLibavVideoSource",
-        "[source]s[stream_index]i[threads]i[cache]b[seek_mode]i[seek_threshold]i[dr]b[fpsnum]i[fpsden]i[repeat]b[dominance]i[stacked]b[format]s[decoder]s",
+        "[source]s[stream_index]i[threads]i[cache]b[seek_mode]i[seek_threshold]i[dr]b[fpsnum]i[fpsden]i[repeat]b[dominance]i[stacked]b[format]s[decoder]s[tonemap]b",
         CreateLWLibavVideoSource,
         0
     );
@@ -71,9 +72,17 @@ extern "C" __declspec(dllexport) const char * __stdcall AvisynthPluginInit2( ISc
     env->AddFunction
     (
         "LWLibavAudioSource",
-        "[source]s[stream_index]i[cache]b[av_sync]b[layout]s[rate]i[decoder]s",
+        "[source]s[stream_index]i[cache]b[av_sync]b[layout]s[rate]i[decoder]s[prefetch]b[threads]i",
         CreateLWLibavAudioSource,
         0
     );
+    /* LWLibavMultiAudioSource */
+    env->AddFunction
+    (
+        "LWLibavMultiAudioSource",
+        "[source]s[stream_indices]s[cache]b[rate]i[decoder]s[threads]i",
+        CreateLWLibavMultiAudioSource,
+        0
+    );
     return "LSMASHSource";
 }
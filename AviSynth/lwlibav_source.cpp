@@ -36,6 +36,9 @@ extern "C"
 #include <libavutil/opt.h>
 }
 
+#include <algorithm>
+#include <vector>
+
 #include "video_output.h"
 #include "audio_output.h"
 #include "lwlibav_source.h"
@@ -80,6 +83,7 @@ LWLibavVideoSource::LWLibavVideoSource
     int                 stacked_format,
     enum AVPixelFormat  pixel_format,
     const char         *preferred_decoder_names,
+    int                 tonemap,
     IScriptEnvironment *env
 ) : LWLibavVideoSource{}
 {
@@ -91,6 +95,7 @@ LWLibavVideoSource::LWLibavVideoSource
     lwlibav_video_set_seek_mode              ( vdhp, seek_mode );
     lwlibav_video_set_forward_seek_threshold ( vdhp, forward_seek_threshold );
     lwlibav_video_set_preferred_decoder_names( vdhp, tokenize_preferred_decoder_names() );
+    vohp->scaler.tonemap = tonemap;
     as_video_output_handler_t *as_vohp = (as_video_output_handler_t *)lw_malloc_zero( sizeof(as_video_output_handler_t) );
     if( !as_vohp )
         env->ThrowError( "LWLibavVideoSource: failed to allocate the AviSynth video output handler." );
@@ -193,12 +198,50 @@ static void prepare_audio_decoding
     lwlibav_audio_force_seek( adhp );
 }
 
+void LWLibavAudioSource::set_log_handler( IScriptEnvironment *env )
+{
+    lw_log_handler_t *lhp = lwlibav_audio_get_log_handler( adhp.get() );
+    lhp->level    = LW_LOG_FATAL; /* Ignore other than fatal error. */
+    lhp->priv     = env;
+    lhp->show_log = throw_error;
+}
+
+void LWLibavAudioSource::start_audio_decoding
+(
+    uint64_t            channel_layout,
+    int                 sample_rate,
+    int                 prefetch,
+    int                 threads,
+    LWLibavAudioSource *master,
+    IScriptEnvironment *env
+)
+{
+    lwlibav_audio_decode_handler_t *adhp = this->adhp.get();
+    lwlibav_audio_output_handler_t *aohp = this->aohp.get();
+    /* Share the demuxer with the track of the same file if requested. */
+    if( master && lwlibav_audio_share_demuxer( adhp, master->adhp.get() ) < 0 )
+        env->ThrowError( "LWLibavAudioSource: failed to share the demuxer." );
+    /* Get the desired video track. */
+    if( lwlibav_audio_get_desired_track( lwh.file_path, adhp, lwh.threads ) < 0 )
+        env->ThrowError( "LWLibavAudioSource: failed to get the audio track." );
+    prepare_audio_decoding( adhp, aohp, channel_layout, sample_rate, lwh, vi, env );
+    /* Decode independent audio frames in parallel if requested. */
+    if( lwlibav_audio_start_parallel_decoding( adhp, threads ) < 0 )
+        env->ThrowError( "LWLibavAudioSource: failed to start the parallel audio decoding." );
+    /* Start decoding ahead if requested. */
+    if( prefetch && lwlibav_audio_start_prefetch( adhp, aohp, 4096, 16 ) < 0 )
+        env->ThrowError( "LWLibavAudioSource: failed to start the audio decode-ahead worker." );
+}
+
 LWLibavAudioSource::LWLibavAudioSource
 (
     lwlibav_option_t   *opt,
     uint64_t            channel_layout,
     int                 sample_rate,
     const char         *preferred_decoder_names,
+    int                 prefetch,
+    int                 threads,
+    LWLibavAudioSource *master,
     IScriptEnvironment *env
 ) : LWLibavAudioSource{}
 {
@@ -209,10 +252,8 @@ LWLibavAudioSource::LWLibavAudioSource
     set_preferred_decoder_names( preferred_decoder_names );
     lwlibav_audio_set_preferred_decoder_names( adhp, tokenize_preferred_decoder_names() );
     /* Set up error handler. */
+    set_log_handler( env );
     lw_log_handler_t *lhp = lwlibav_audio_get_log_handler( adhp );
-    lhp->level    = LW_LOG_FATAL; /* Ignore other than fatal error. */
-    lhp->priv     = env;
-    lhp->show_log = throw_error;
     /* Set up progress indicator. */
     progress_indicator_t indicator;
     indicator.open   = NULL;
@@ -223,15 +264,43 @@ LWLibavAudioSource::LWLibavAudioSource
         env->ThrowError( "LWLibavAudioSource: failed to get construct index." );
     free_video_decode_handler();
     free_video_output_handler();
-    /* Get the desired video track. */
-    if( lwlibav_audio_get_desired_track( lwh.file_path, adhp, lwh.threads ) < 0 )
-        env->ThrowError( "LWLibavAudioSource: failed to get the audio track." );
-    prepare_audio_decoding( adhp, aohp, channel_layout, sample_rate, lwh, vi, env );
+    start_audio_decoding( channel_layout, sample_rate, prefetch, threads, master, env );
+}
+
+LWLibavAudioSource::LWLibavAudioSource
+(
+    lwlibav_file_handler_t *lwhp,
+    lwlibav_audio_track_t  *track,
+    int                     sample_rate,
+    const char             *preferred_decoder_names,
+    int                     threads,
+    LWLibavAudioSource     *master,
+    IScriptEnvironment     *env
+) : LWLibavAudioSource{}
+{
+    memset( &vi, 0, sizeof(VideoInfo) );
+    adhp.reset( track->adhp );
+    aohp.reset( track->aohp );
+    track->adhp = nullptr;
+    track->aohp = nullptr;
+    free_video_decode_handler();
+    free_video_output_handler();
+    lwh = *lwhp;
+    lwh.file_path = (char *)lw_memdup( lwhp->file_path, strlen( lwhp->file_path ) + 1 );
+    if( !lwh.file_path )
+        env->ThrowError( "LWLibavAudioSource: failed to allocate the file path." );
+    set_preferred_decoder_names( preferred_decoder_names );
+    lwlibav_audio_set_preferred_decoder_names( adhp.get(), tokenize_preferred_decoder_names() );
+    set_log_handler( env );
+    start_audio_decoding( 0, sample_rate, 0, threads, master, env );
 }
 
 LWLibavAudioSource::~LWLibavAudioSource()
 {
     lwlibav_audio_decode_handler_t *adhp = this->adhp.get();
+    /* The worker uses the output handler, which is freed before the decode handler. */
+    lwlibav_audio_stop_prefetch( adhp );
+    lwlibav_audio_stop_parallel_decoding( adhp );
     lw_free( lwlibav_audio_get_preferred_decoder_names( adhp ) );
     lw_free( lwh.file_path );
 }
@@ -281,6 +350,7 @@ AVSValue __cdecl CreateLWLibavVideoSource( AVSValue args, void *user_data, IScri
     int         stacked_format          = args[11].AsBool( false ) ? 1 : 0;
     enum AVPixelFormat pixel_format     = get_av_output_pixel_format( args[12].AsString( NULL ) );
     const char *preferred_decoder_names = args[13].AsString( NULL );
+    int         tonemap                 = args[14].AsBool( false ) ? 1 : 0;
     /* Set LW-Libav options. */
     lwlibav_option_t opt;
     opt.file_path         = source;
@@ -291,6 +361,7 @@ AVSValue __cdecl CreateLWLibavVideoSource( AVSValue args, void *user_data, IScri
     opt.force_video_index = stream_index >= 0 ? stream_index : -1;
     opt.force_audio       = 0;
     opt.force_audio_index = -1;
+    opt.audio_only        = 0;
     opt.apply_repeat_flag = apply_repeat_flag;
     opt.field_dominance   = CLIP_VALUE( field_dominance, 0, 2 );    /* 0: Obey source flags, 1: TFF, 2: BFF */
     opt.vfr2cfr.active    = fps_num > 0 && fps_den > 0 ? 1 : 0;
@@ -298,9 +369,8 @@ AVSValue __cdecl CreateLWLibavVideoSource( AVSValue args, void *user_data, IScri
     opt.vfr2cfr.fps_den   = fps_den;
     seek_mode              = CLIP_VALUE( seek_mode, 0, 2 );
     forward_seek_threshold = CLIP_VALUE( forward_seek_threshold, 1, 999 );
-    direct_rendering      &= (pixel_format == AV_PIX_FMT_NONE);
     return new LWLibavVideoSource( &opt, seek_mode, forward_seek_threshold,
-                                   direct_rendering, stacked_format, pixel_format, preferred_decoder_names, env );
+                                   direct_rendering, stacked_format, pixel_format, preferred_decoder_names, tonemap, env );
 }
 
 AVSValue __cdecl CreateLWLibavAudioSource( AVSValue args, void *user_data, IScriptEnvironment *env )
@@ -315,6 +385,8 @@ AVSValue __cdecl CreateLWLibavAudioSource( AVSValue args, void *user_data, IScri
     const char *layout_string           = args[4].AsString( NULL );
     uint32_t    sample_rate             = args[5].AsInt( 0 );
     const char *preferred_decoder_names = args[6].AsString( NULL );
+    int         prefetch                = args[7].AsBool( false ) ? 1 : 0;
+    int         threads                 = args[8].AsInt( 1 );
     /* Set LW-Libav options. */
     lwlibav_option_t opt;
     opt.file_path         = source;
@@ -325,11 +397,121 @@ AVSValue __cdecl CreateLWLibavAudioSource( AVSValue args, void *user_data, IScri
     opt.force_video_index = -1;
     opt.force_audio       = (stream_index >= 0);
     opt.force_audio_index = stream_index >= 0 ? stream_index : -1;
+    opt.audio_only        = !av_sync;
     opt.apply_repeat_flag = 0;
     opt.field_dominance   = 0;
     opt.vfr2cfr.active    = 0;
     opt.vfr2cfr.fps_num   = 0;
     opt.vfr2cfr.fps_den   = 0;
     uint64_t channel_layout = layout_string ? av_get_channel_layout( layout_string ) : 0;
-    return new LWLibavAudioSource( &opt, channel_layout, sample_rate, preferred_decoder_names, env );
+    return new LWLibavAudioSource( &opt, channel_layout, sample_rate, preferred_decoder_names, prefetch, threads, nullptr, env );
+}
+
+AVSValue __cdecl CreateLWLibavMultiAudioSource( AVSValue args, void *user_data, IScriptEnvironment *env )
+{
+#ifdef NDEBUG
+    av_log_set_level( AV_LOG_QUIET );
+#endif
+    const char *source                  = args[0].AsString();
+    const char *stream_indices          = args[1].AsString( NULL );
+    int         no_create_index         = args[2].AsBool( true ) ? 0 : 1;
+    uint32_t    sample_rate             = args[3].AsInt( 0 );
+    const char *preferred_decoder_names = args[4].AsString( NULL );
+    int         threads                 = args[5].AsInt( 1 );
+    /* Get the stream indexes to open. */
+    std::vector< int > indexes;
+    if( stream_indices && stream_indices[0] )
+    {
+        for( const char *p = stream_indices; *p; )
+        {
+            char *end;
+            long index = strtol( p, &end, 10 );
+            if( end == p || index < 0 || std::find( indexes.begin(), indexes.end(), (int)index ) != indexes.end() )
+                env->ThrowError( "LWLibavMultiAudioSource: invalid stream_indices \"%s\".", stream_indices );
+            indexes.push_back( (int)index );
+            p = *end == ',' ? end + 1 : end;
+        }
+    }
+    /* Set LW-Libav options. */
+    lwlibav_option_t opt;
+    opt.file_path         = source;
+    opt.threads           = 0;
+    opt.av_sync           = 0;
+    opt.no_create_index   = no_create_index;
+    opt.force_video       = 0;
+    opt.force_video_index = -1;
+    opt.force_audio       = 1;
+    opt.force_audio_index = -1;
+    opt.audio_only        = 1;
+    opt.apply_repeat_flag = 0;
+    opt.field_dominance   = 0;
+    opt.vfr2cfr.active    = 0;
+    opt.vfr2cfr.fps_num   = 0;
+    opt.vfr2cfr.fps_den   = 0;
+    /* Set up error handler. */
+    lw_log_handler_t lh;
+    lh.name     = NULL;
+    lh.level    = LW_LOG_FATAL; /* Ignore other than fatal error. */
+    lh.priv     = env;
+    lh.show_log = throw_error;
+    /* Set up progress indicator. */
+    progress_indicator_t indicator;
+    indicator.open   = NULL;
+    indicator.update = NULL;
+    indicator.close  = NULL;
+    /* Construct the indexes of all the tracks by parsing the index file once.
+     * Without stream_indices, every audio stream is taken from the index or from the demuxer indexing the file. */
+    lwlibav_file_handler_t lwh;
+    memset( &lwh, 0, sizeof(lwlibav_file_handler_t) );
+    lwlibav_audio_track_t *tracks = nullptr;
+    int track_count = lwlibav_construct_audio_indexes( &lwh, &tracks, indexes.data(), (int)indexes.size(), &lh, &opt, &indicator, NULL );
+    if( track_count <= 0 )
+    {
+        lw_free( tracks );
+        lw_free( lwh.file_path );
+        env->ThrowError( "LWLibavMultiAudioSource: no audio stream to open." );
+    }
+    /* All tracks read packets through the demuxer of the first track. */
+    std::vector< AVSValue > clips;
+    try
+    {
+        LWLibavAudioSource *master = nullptr;
+        for( int i = 0; i < track_count; i++ )
+        {
+            LWLibavAudioSource *track = new LWLibavAudioSource( &lwh, &tracks[i], sample_rate, preferred_decoder_names, threads, master, env );
+            clips.push_back( AVSValue( PClip( track ) ) );
+            if( !master )
+            {
+                /* Resample the other tracks to the sample rate of the first one. */
+                master      = track;
+                sample_rate = clips.back().AsClip()->GetVideoInfo().audio_samples_per_second;
+            }
+        }
+    }
+    catch( ... )
+    {
+        /* Free the handlers not taken over yet. */
+        for( int i = 0; i < track_count; i++ )
+        {
+            lwlibav_audio_free_decode_handler( tracks[i].adhp );
+            lwlibav_audio_free_output_handler( tracks[i].aohp );
+        }
+        lw_free( tracks );
+        lw_free( lwh.file_path );
+        throw;
+    }
+    lw_free( tracks );
+    lw_free( lwh.file_path );
+    if( clips.size() == 1 )
+        return clips[0];
+    /* MergeChannels requires the same sample type. */
+    int sample_type = clips[0].AsClip()->GetVideoInfo().SampleType();
+    for( size_t i = 1; i < clips.size(); i++ )
+        if( clips[i].AsClip()->GetVideoInfo().SampleType() != sample_type )
+        {
+            for( size_t j = 0; j < clips.size(); j++ )
+                clips[j] = env->Invoke( "ConvertAudioToFloat", clips[j] );
+            break;
+        }
+    return env->Invoke( "MergeChannels", AVSValue( clips.data(), (int)clips.size() ) );
 }
@@ -65,6 +65,7 @@ public:
         int                 stacked_format,
         enum AVPixelFormat  pixel_format,
         const char         *preferred_decoder_names,
+        int                 tonemap,
         IScriptEnvironment *env
     );
     ~LWLibavVideoSource();
@@ -78,6 +79,16 @@ class LWLibavAudioSource : public LWLibavSource
 private:
     LWLibavAudioSource() = default;
     int delay_audio( int64_t *start, int64_t wanted_length );
+    void set_log_handler( IScriptEnvironment *env );
+    void start_audio_decoding
+    (
+        uint64_t            channel_layout,
+        int                 sample_rate,
+        int                 prefetch,
+        int                 threads,
+        LWLibavAudioSource *master,
+        IScriptEnvironment *env
+    );
 public:
     LWLibavAudioSource
     (
@@ -85,8 +96,22 @@ public:
         uint64_t            channel_layout,
         int                 sample_rate,
         const char         *preferred_decoder_names,
+        int                 prefetch,
+        int                 threads,
+        LWLibavAudioSource *master,
         IScriptEnvironment *env
     );
+    /* Take over the handlers of the track constructed by lwlibav_construct_audio_indexes(). */
+    LWLibavAudioSource
+    (
+        lwlibav_file_handler_t *lwhp,
+        lwlibav_audio_track_t  *track,
+        int                     sample_rate,
+        const char             *preferred_decoder_names,
+        int                     threads,
+        LWLibavAudioSource     *master,
+        IScriptEnvironment     *env
+    );
     ~LWLibavAudioSource();
     PVideoFrame __stdcall GetFrame( int n, IScriptEnvironment *env ) { return NULL; }
     bool __stdcall GetParity( int n ) { return false; }
@@ -23,17 +23,6 @@
 
 #include "lsmashsource.h"
 
-#if _MSC_VER >= 1700
-#define VC_HAS_AVX2 1
-#else
-#define VC_HAS_AVX2 0
-#endif
-
-#include <emmintrin.h>  /* SSE2 */
-#if VC_HAS_AVX2
-#include <immintrin.h>  /* AVX, AVX2 */
-#endif
-
 extern "C"
 {
 #include <libavcodec/avcodec.h>
@@ -42,7 +31,7 @@ extern "C"
 #include <libavutil/mem.h>
 }
 
-#include "../common/lwsimd.h"
+#include "../common/video_repack.h"
 
 #include "video_output.h"
 
@@ -52,61 +41,110 @@ extern "C"
 #define FFMPEG_HIGH_DEPTH_SUPPORT 0
 #endif
 
-static const int sse2_available = lw_check_sse2();
-static const int avx2_available = VC_HAS_AVX2 && lw_check_avx2();
+static int setup_background_planar_yuv
+(
+    lw_video_background_t *bgp,
+    const VideoInfo       *vi,
+    int                    sub_width,
+    int                    sub_height,
+    int                    bitdepth_minus_8
+)
+{
+    /* The stacked format also has 0x00 for the LSBs of black. */
+    for( int i = 0; i < 3; i++ )
+    {
+        const uint8_t black = i ? 0x80 : 0x00;
+        const int     sub_w = i ? sub_width  : 0;
+        const int     sub_h = i ? sub_height : 0;
+        if( lw_setup_video_background_plane( bgp, i, vi->width >> sub_w, vi->height >> sub_h,
+                                             sub_w, sub_h, 1, &black, 1 ) < 0 )
+            return -1;
+    }
+    return 0;
+}
 
-static void make_black_background_planar_yuv
+static int setup_background_planar_yuv_interleaved
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    lw_video_background_t *bgp,
+    const VideoInfo       *vi,
+    int                    sub_width,
+    int                    sub_height,
+    int                    bitdepth_minus_8
 )
 {
-    memset( frame->GetWritePtr( PLANAR_Y ), 0x00, frame->GetPitch( PLANAR_Y ) * frame->GetHeight( PLANAR_Y ) );
-    memset( frame->GetWritePtr( PLANAR_U ), 0x80, frame->GetPitch( PLANAR_U ) * frame->GetHeight( PLANAR_U ) );
-    memset( frame->GetWritePtr( PLANAR_V ), 0x80, frame->GetPitch( PLANAR_V ) * frame->GetHeight( PLANAR_V ) );
+    /* The width of the frame is counted in bytes i.e. twice the number of samples. */
+    const uint8_t msb = (uint8_t)((0x80U << bitdepth_minus_8) >> 8);
+    for( int i = 0; i < 3; i++ )
+    {
+        const uint8_t black[2] = { 0x00, (uint8_t)(i ? msb : 0x00) };
+        const int     sub_w    = i ? sub_width  : 0;
+        const int     sub_h    = i ? sub_height : 0;
+        if( lw_setup_video_background_plane( bgp, i, vi->width >> sub_w, vi->height >> sub_h,
+                                             sub_w, sub_h, 1, black, 2 ) < 0 )
+            return -1;
+    }
+    return 0;
 }
 
-static void make_black_background_planar_yuv_interleaved
+static int setup_background_packed_yuv422
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    lw_video_background_t *bgp,
+    const VideoInfo       *vi,
+    int                    sub_width,
+    int                    sub_height,
+    int                    bitdepth_minus_8
 )
 {
-    memset( frame->GetWritePtr( PLANAR_Y ), 0x00, frame->GetPitch( PLANAR_Y ) * frame->GetHeight( PLANAR_Y ) );
-    uint8_t msb  = (uint8_t)((0x80U << bitdepth_minus_8) >> 8);
-    int     size = frame->GetPitch( PLANAR_U ) * frame->GetHeight( PLANAR_U );
-    for( int i = 0; i < size; i++ )
-        if( i & 1 )
-        {
-            *(frame->GetWritePtr( PLANAR_U ) + i) = msb;
-            *(frame->GetWritePtr( PLANAR_V ) + i) = msb;
-        }
-        else
-        {
-            *(frame->GetWritePtr( PLANAR_U ) + i) = 0x00;
-            *(frame->GetWritePtr( PLANAR_V ) + i) = 0x00;
-        }
+    /* Y0 Cb Y1 Cr */
+    static const uint8_t black[2] = { 0x00, 0x80 };
+    return lw_setup_video_background_plane( bgp, 0, vi->RowSize(), vi->height, 0, 0, 2, black, 2 );
 }
 
-static void make_black_background_packed_yuv422
+static int setup_background_packed_all_zero
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    lw_video_background_t *bgp,
+    const VideoInfo       *vi,
+    int                    sub_width,
+    int                    sub_height,
+    int                    bitdepth_minus_8
 )
 {
-    uint32_t *dst = (uint32_t *)frame->GetWritePtr();
-    int num_loops = frame->GetPitch() * frame->GetHeight() / 4;
-    for( int i = 0; i < num_loops; i++ )
-        *dst++ = 0x00800080;
+    static const uint8_t black = 0x00;
+    return lw_setup_video_background_plane( bgp, 0, vi->RowSize(), vi->height, 0, 0, vi->BytesFromPixels( 1 ), &black, 1 );
 }
 
-static void make_black_background_packed_all_zero
+/* Fill the area outside the picture of 'picture_width' x 'picture_height' in the units of VideoInfo.
+ * Packed RGB is bottom-up, so it is filled through the view of negative pitch the picture is written into. */
+static void fill_background
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    as_video_output_handler_t *as_vohp,
+    PVideoFrame               &as_frame,
+    int                        picture_width,
+    int                        picture_height
 )
 {
-    memset( frame->GetWritePtr(), 0x00, frame->GetPitch() * frame->GetHeight() );
+    uint8_t *data    [4] = { NULL };
+    int      linesize[4] = { 0 };
+    if( as_vohp->vi->pixel_type & VideoInfo::CS_INTERLEAVED )
+    {
+        data    [0] = as_frame->GetWritePtr();
+        linesize[0] = as_frame->GetPitch();
+        if( as_vohp->vi->IsRGB() )
+        {
+            data    [0] += linesize[0] * (as_frame->GetHeight() - 1);
+            linesize[0]  = -linesize[0];
+        }
+    }
+    else
+    {
+        static const int as_plane[3] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+        for( int i = 0; i < 3; i++ )
+        {
+            data    [i] = as_frame->GetWritePtr( as_plane[i] );
+            linesize[i] = as_frame->GetPitch   ( as_plane[i] );
+        }
+    }
+    lw_fill_video_background( &as_vohp->background, data, linesize, picture_width, picture_height );
 }
 
 /* This source filter always uses lines aligned to an address dividable by 32.
@@ -114,17 +152,16 @@ static void make_black_background_packed_all_zero
  * So, I think it's OK that we always use swscale instead. */
 static inline int convert_av_pixel_format
 (
-    struct SwsContext *sws_ctx,
-    int                height,
-    AVFrame           *av_frame,
-    as_picture_t      *as_picture
+    lw_video_scaler_handler_t *vshp,
+    int                        height,
+    AVFrame                   *av_frame,
+    as_picture_t              *as_picture
 )
 {
-    int ret = sws_scale( sws_ctx,
-                         (const uint8_t * const *)av_frame->data, av_frame->linesize,
-                         0, height,
-                         as_picture->data, as_picture->linesize );
-    return ret > 0 ? ret : -1;
+    return lw_video_scale_picture( vshp,
+                                   (const uint8_t * const *)av_frame->data, av_frame->linesize,
+                                   height,
+                                   as_picture->data, as_picture->linesize );
 }
 
 static inline void as_assign_planar_yuv
@@ -151,7 +188,7 @@ static int make_frame_planar_yuv
 {
     as_picture_t as_picture = { { { NULL } } };
     as_assign_planar_yuv( as_frame, &as_picture );
-    return convert_av_pixel_format( vohp->scaler.sws_ctx, height, av_frame, &as_picture );
+    return convert_av_pixel_format( &vohp->scaler, height, av_frame, &as_picture );
 }
 
 static int make_frame_planar_yuv_stacked
@@ -175,7 +212,7 @@ static int make_frame_planar_yuv_stacked
         }
     else
     {
-        if( convert_av_pixel_format( vshp->sws_ctx, height, av_frame, &as_vohp->scaled ) < 0 )
+        if( convert_av_pixel_format( vshp, height, av_frame, &as_vohp->scaled ) < 0 )
             return -1;
         src_picture = as_vohp->scaled;
     }
@@ -183,54 +220,9 @@ static int make_frame_planar_yuv_stacked
     {
         const int src_height = height >> (i ? as_vohp->sub_height : 0);
         const int width      = vshp->input_width >> (i ? as_vohp->sub_width : 0);
-        const int width16    = sse2_available > 0 ? (width & ~15) : 0;
-        const int width32    = avx2_available > 0 ? (width & ~31) : 0;
         const int lsb_offset = src_height * dst_picture.linesize[i];
-        for( int j = 0; j < src_height; j++ )
-        {
-            /* Here, if available, use SIMD instructions.
-             * Note: There is assumption that the address of a given data can be divided by 32 or 16.
-             *       The destination is always 32 byte alignment unless AviSynth legacy alignment is used.
-             *       The source is not always 32 or 16 byte alignment if the frame buffer is from libavcodec directly. */
-            static const uint8_t LW_ALIGN(32) sp16[32] =
-                {
-                    /* saturation protector
-                     * For setting all upper 8 bits to zero so that saturation won't make sense. */
-                    0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00 ,0xFF, 0x00, 0xFF, 0x00,
-                    0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00 ,0xFF, 0x00, 0xFF, 0x00
-                };
-                  uint8_t *dst     = dst_picture.data[i] + j * dst_picture.linesize[i];     /* MSB: dst +     k,     LSB: dst +     k + lsb_offset */
-            const uint8_t *src     = src_picture.data[i] + j * src_picture.linesize[i];     /* MSB: src + 2 * k + 1, LSB: src + 2 * k */
-            const int     _width16 = ((intptr_t)src & 15) == 0 ? width16 : 0;               /* Don't use SSE2 instructions if set to 0. */
-            const int     _width32 = ((intptr_t)src & 31) == 0 ? width32 : 0;               /* Don't use AVX(2) instructions if set to 0. */
-#if VC_HAS_AVX2
-            /* AVX, AVX2 */
-            for( int k = 0; k < _width32; k += 32 )
-            {
-                __m256i ymm0 = _mm256_load_si256( (__m256i *)(src + 2 * k     ) );
-                __m256i ymm1 = _mm256_load_si256( (__m256i *)(src + 2 * k + 32) );
-                __m256i mask = _mm256_load_si256( (__m256i *)sp16 );
-                __m256i ymm2 = _mm256_packus_epi16( _mm256_and_si256 ( ymm0, mask ), _mm256_and_si256 ( ymm1, mask ) );
-                __m256i ymm3 = _mm256_packus_epi16( _mm256_srli_epi16( ymm0,    8 ), _mm256_srli_epi16( ymm1,    8 ) );
-                _mm256_store_si256( (__m256i *)(dst + k + lsb_offset), _mm256_permute4x64_epi64( ymm2, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
-                _mm256_store_si256( (__m256i *)(dst + k             ), _mm256_permute4x64_epi64( ymm3, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
-            }
-#endif
-            /* SSE2 */
-            for( int k = _width32; k < _width16; k += 16 )
-            {
-                __m128i xmm0 = _mm_load_si128( (__m128i *)(src + 2 * k     ) );
-                __m128i xmm1 = _mm_load_si128( (__m128i *)(src + 2 * k + 16) );
-                __m128i mask = _mm_load_si128( (__m128i *)sp16 );
-                _mm_store_si128( (__m128i *)(dst + k + lsb_offset), _mm_packus_epi16( _mm_and_si128 ( xmm0, mask ), _mm_and_si128 ( xmm1, mask ) ) );
-                _mm_store_si128( (__m128i *)(dst + k             ), _mm_packus_epi16( _mm_srli_epi16( xmm0,    8 ), _mm_srli_epi16( xmm1,    8 ) ) );
-            }
-            for( int k = _width16; k < width; k++ )
-            {
-                *(dst + k + lsb_offset) = *(src + 2 * k    );
-                *(dst + k             ) = *(src + 2 * k + 1);
-            }
-        }
+        lw_video_split_16bit( dst_picture.data[i], dst_picture.data[i] + lsb_offset, dst_picture.linesize[i],
+                              src_picture.data[i], src_picture.linesize[i], width, src_height );
     }
     return 0;
 }
@@ -246,7 +238,7 @@ static int make_frame_packed_yuv
     as_picture_t as_picture = { { { NULL } } };
     as_picture.data    [0] = as_frame->GetWritePtr();
     as_picture.linesize[0] = as_frame->GetPitch   ();
-    return convert_av_pixel_format( vohp->scaler.sws_ctx, height, av_frame, &as_picture );
+    return convert_av_pixel_format( &vohp->scaler, height, av_frame, &as_picture );
 }
 
 static int make_frame_packed_rgb
@@ -260,7 +252,7 @@ static int make_frame_packed_rgb
     as_picture_t as_picture = { { { NULL } } };
     as_picture.data    [0] = as_frame->GetWritePtr() + as_frame->GetPitch() * (as_frame->GetHeight() - 1);
     as_picture.linesize[0] = -as_frame->GetPitch();
-    return convert_av_pixel_format( vohp->scaler.sws_ctx, height, av_frame, &as_picture );
+    return convert_av_pixel_format( &vohp->scaler, height, av_frame, &as_picture );
 }
 
 enum AVPixelFormat get_av_output_pixel_format
@@ -335,6 +327,9 @@ static int determine_colorspace_conversion
             { AV_PIX_FMT_NV21,        AV_PIX_FMT_YUV420P,     VideoInfo::CS_I420,    0, 1, 1 },
             { AV_PIX_FMT_YUV420P9LE,  AV_PIX_FMT_YUV420P9LE,  VideoInfo::CS_I420,    1, 1, 1 },
             { AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_YUV420P10LE, VideoInfo::CS_I420,    2, 1, 1 },
+#ifdef AV_PIX_FMT_P010
+            { AV_PIX_FMT_P010LE,      AV_PIX_FMT_YUV420P10LE, VideoInfo::CS_I420,    2, 1, 1 },
+#endif
             { AV_PIX_FMT_YUV420P16LE, AV_PIX_FMT_YUV420P16LE, VideoInfo::CS_I420,    8, 1, 1 },
             { AV_PIX_FMT_YUYV422,     AV_PIX_FMT_YUYV422,     VideoInfo::CS_YUY2,    0, 1, 0 },
             { AV_PIX_FMT_YUV422P,     AV_PIX_FMT_YUYV422,     VideoInfo::CS_YUY2,    0, 1, 0 },
@@ -397,12 +392,12 @@ static int determine_colorspace_conversion
         case AV_PIX_FMT_YUV444P     :   /* planar YUV 4:4:4, 24bpp, (1 Cr & Cb sample per 1x1 Y samples) */
         case AV_PIX_FMT_YUV410P     :   /* planar YUV 4:1:0,  9bpp, (1 Cr & Cb sample per 4x4 Y samples) */
         case AV_PIX_FMT_YUV411P     :   /* planar YUV 4:1:1, 12bpp, (1 Cr & Cb sample per 4x1 Y samples) */
-            as_vohp->make_black_background = make_black_background_planar_yuv;
-            as_vohp->make_frame            = make_frame_planar_yuv;
+            as_vohp->setup_background = setup_background_planar_yuv;
+            as_vohp->make_frame       = make_frame_planar_yuv;
             return 0;
         case AV_PIX_FMT_YUYV422     :   /* packed YUV 4:2:2, 16bpp */
-            as_vohp->make_black_background = make_black_background_packed_yuv422;
-            as_vohp->make_frame            = make_frame_packed_yuv;
+            as_vohp->setup_background = setup_background_packed_yuv422;
+            as_vohp->make_frame       = make_frame_packed_yuv;
             return 0;
         case AV_PIX_FMT_YUV420P9LE  :   /* planar YUV 4:2:0, 13.5bpp, (1 Cr & Cb sample per 2x2 Y samples), little-endian */
         case AV_PIX_FMT_YUV420P10LE :   /* planar YUV 4:2:0, 15bpp, (1 Cr & Cb sample per 2x2 Y samples), little-endian */
@@ -423,27 +418,27 @@ static int determine_colorspace_conversion
 #endif
             if( as_vohp->stacked_format )
             {
-                as_vohp->make_black_background = make_black_background_planar_yuv;
-                as_vohp->make_frame            = make_frame_planar_yuv_stacked;
+                as_vohp->setup_background = setup_background_planar_yuv;
+                as_vohp->make_frame       = make_frame_planar_yuv_stacked;
             }
             else
             {
-                as_vohp->make_black_background = make_black_background_planar_yuv_interleaved;
-                as_vohp->make_frame            = make_frame_planar_yuv;
+                as_vohp->setup_background = setup_background_planar_yuv_interleaved;
+                as_vohp->make_frame       = make_frame_planar_yuv;
             }
             return 0;
         case AV_PIX_FMT_GRAY8 :     /* Y, 8bpp */
-            as_vohp->make_black_background = make_black_background_packed_all_zero;
-            as_vohp->make_frame            = make_frame_packed_yuv;
+            as_vohp->setup_background = setup_background_packed_all_zero;
+            as_vohp->make_frame       = make_frame_packed_yuv;
             return 0;
         case AV_PIX_FMT_BGR24 :     /* packed RGB 8:8:8, 24bpp, BGRBGR... */
         case AV_PIX_FMT_BGRA  :     /* packed BGRA 8:8:8:8, 32bpp, BGRABGRA... */
-            as_vohp->make_black_background = make_black_background_packed_all_zero;
-            as_vohp->make_frame            = make_frame_packed_rgb;
+            as_vohp->setup_background = setup_background_packed_all_zero;
+            as_vohp->make_frame       = make_frame_packed_rgb;
             return 0;
         default :
-            as_vohp->make_black_background = NULL;
-            as_vohp->make_frame            = NULL;
+            as_vohp->setup_background = NULL;
+            as_vohp->make_frame       = NULL;
             return -1;
     }
 }
@@ -457,20 +452,24 @@ int make_frame
 )
 {
     lw_video_scaler_handler_t *vshp = &vohp->scaler;
-    if( !vshp->enabled && av_frame->opaque )
+    if( av_frame->opaque )
     {
-        /* Render a video frame from the decoder directly. */
+        /* Render a video frame from the decoder directly, or take the picture converted band by band while decoding.
+         * If the latter is incomplete, e.g. by errors, convert the whole picture as usual. */
         as_video_buffer_handler_t *as_vbhp = (as_video_buffer_handler_t *)av_frame->opaque;
-        as_frame = as_vbhp->as_frame_buffer;
-        return 0;
+        if( as_vbhp->band.active ? lw_video_band_frame_is_complete( &as_vbhp->band, vshp ) : !vshp->enabled )
+        {
+            as_frame = as_vbhp->as_frame_buffer;
+            return 0;
+        }
     }
     /* Render a video frame through the scaler from the decoder.
      * We don't change the presentation resolution. */
     as_video_output_handler_t *as_vohp = (as_video_output_handler_t *)vohp->private_handler;
     as_frame = env->NewVideoFrame( *as_vohp->vi, 32 );
-    if( vohp->output_width  != (av_frame->width  << (as_vohp->bitdepth_minus_8 && !as_vohp->stacked_format ? 1 : 0))
-     || vohp->output_height != (av_frame->height << (as_vohp->bitdepth_minus_8 &&  as_vohp->stacked_format ? 1 : 0)) )
-        as_vohp->make_black_background( as_frame, as_vohp->bitdepth_minus_8 );
+    fill_background( as_vohp, as_frame,
+                     av_frame->width  << (as_vohp->bitdepth_minus_8 && !as_vohp->stacked_format ? 1 : 0),
+                     av_frame->height << (as_vohp->bitdepth_minus_8 &&  as_vohp->stacked_format ? 1 : 0) );
     return as_vohp->make_frame( vohp, av_frame->height, av_frame, as_frame );
 }
 
@@ -545,6 +544,80 @@ static void as_video_unref_buffer_handler
     av_buffer_unref( &as_buffer_ref );
 }
 
+static void as_video_draw_horiz_band
+(
+    AVCodecContext *ctx,
+    const AVFrame  *src,
+    int            *offset,
+    int             y,
+    int             type,
+    int             height
+)
+{
+    as_video_buffer_handler_t *as_vbhp = (as_video_buffer_handler_t *)src->opaque;
+    if( !as_vbhp || !as_vbhp->band.active )
+        return;
+    lw_video_output_handler_t *lw_vohp = (lw_video_output_handler_t *)ctx->opaque;
+    lw_video_scale_band( &lw_vohp->scaler, &as_vbhp->band, src, offset, y, height );
+}
+
+/* Allocate the decoder's buffers as usual together with the AviSynth frame the picture is converted into band by band.
+ * The AviSynth frame is released together with the last reference to the decoder's buffers. */
+static int as_video_get_band_buffer
+(
+    AVCodecContext *ctx,
+    AVFrame        *av_frame,
+    int             flags
+)
+{
+    lw_video_output_handler_t *lw_vohp = (lw_video_output_handler_t *)ctx->opaque;
+    as_video_output_handler_t *as_vohp = (as_video_output_handler_t *)lw_vohp->private_handler;
+    int ret = avcodec_default_get_buffer2( ctx, av_frame, flags );
+    if( ret < 0
+     || !lw_video_band_frame_available( &lw_vohp->scaler, ctx, av_frame ) )
+        return ret;
+    int free_buf = 0;
+    while( free_buf < AV_NUM_DATA_POINTERS && av_frame->buf[free_buf] )
+        ++free_buf;
+    if( free_buf == AV_NUM_DATA_POINTERS )
+        return ret;
+    as_video_buffer_handler_t *as_vbhp = new as_video_buffer_handler_t;
+    if( !as_vbhp )
+        return ret;
+    as_vbhp->as_frame_buffer = as_vohp->env->NewVideoFrame( *as_vohp->vi, 32 );
+    /* The same layouts as the ones the frame makers write. */
+    as_picture_t as_picture = { { { NULL } } };
+    PVideoFrame &as_frame = as_vbhp->as_frame_buffer;
+    if( as_vohp->make_frame == make_frame_planar_yuv )
+        as_assign_planar_yuv( as_frame, &as_picture );
+    else if( as_vohp->make_frame == make_frame_packed_yuv )
+    {
+        as_picture.data    [0] = as_frame->GetWritePtr();
+        as_picture.linesize[0] = as_frame->GetPitch   ();
+    }
+    else if( as_vohp->make_frame == make_frame_packed_rgb )
+    {
+        as_picture.data    [0] = as_frame->GetWritePtr() + as_frame->GetPitch() * (as_frame->GetHeight() - 1);
+        as_picture.linesize[0] = -as_frame->GetPitch();
+    }
+    if( as_picture.data[0] )
+        lw_video_band_frame_init( &as_vbhp->band, &lw_vohp->scaler, ctx, av_frame, as_picture.data, as_picture.linesize );
+    else
+        as_vbhp->band.active = 0;
+    AVBufferRef *as_buffer_handler = as_vbhp->band.active
+                                   ? av_buffer_create( NULL, 0, as_video_release_buffer_handler, as_vbhp, 0 )
+                                   : NULL;
+    if( !as_buffer_handler )
+    {
+        delete as_vbhp;
+        return ret;
+    }
+    fill_background( as_vohp, as_frame, ctx->width << (as_vohp->bitdepth_minus_8 ? 1 : 0), ctx->height );
+    av_frame->buf[free_buf] = as_buffer_handler;
+    av_frame->opaque        = as_vbhp;
+    return ret;
+}
+
 static int as_video_get_buffer
 (
     AVCodecContext *ctx,
@@ -555,6 +628,8 @@ static int as_video_get_buffer
     lw_video_output_handler_t *lw_vohp = (lw_video_output_handler_t *)ctx->opaque;
     as_video_output_handler_t *as_vohp = (as_video_output_handler_t *)lw_vohp->private_handler;
     lw_video_scaler_handler_t *vshp    = &lw_vohp->scaler;
+    if( as_vohp->band_conversion )
+        return as_video_get_band_buffer( ctx, av_frame, flags );
     vshp->enabled = 0;
     enum AVPixelFormat pix_fmt = ctx->pix_fmt;
     avoid_yuv_scale_conversion( &pix_fmt );
@@ -572,11 +647,11 @@ static int as_video_get_buffer
     }
     av_frame->opaque = as_vbhp;
     as_vbhp->as_frame_buffer = as_vohp->env->NewVideoFrame( *as_vohp->vi, 32 );
+    as_vbhp->band.active     = 0;
     int aligned_width  = ctx->width << (as_vohp->bitdepth_minus_8 ? 1 : 0);
     int aligned_height = ctx->height;
     avcodec_align_dimensions2( ctx, &aligned_width, &aligned_height, av_frame->linesize );
-    if( lw_vohp->output_width != aligned_width || lw_vohp->output_height != aligned_height )
-        as_vohp->make_black_background( as_vbhp->as_frame_buffer, as_vohp->bitdepth_minus_8 );
+    fill_background( as_vohp, as_vbhp->as_frame_buffer, aligned_width, aligned_height );
     /* Create frame buffers for the decoder.
      * The callback as_video_release_buffer_handler() shall be called when no reference to the video buffer handler is present.
      * The callback as_video_unref_buffer_handler() decrements the reference-counter by 1. */
@@ -640,6 +715,7 @@ void as_free_video_output_handler
     if( !as_vohp )
         return;
     av_freep( &as_vohp->scaled.data[0] );
+    lw_cleanup_video_background( &as_vohp->background );
     lw_free( as_vohp );
 }
 
@@ -671,12 +747,28 @@ void as_setup_video_rendering
         env->ThrowError( "%s: failed to allocate temporally scaled image.", filter_name );
     enum AVPixelFormat input_pixel_format = ctx->pix_fmt;
     avoid_yuv_scale_conversion( &input_pixel_format );
-    direct_rendering &= as_check_dr_available( ctx, input_pixel_format, as_vohp->stacked_format );
+    /* Direct rendering exports the decoder's buffers as they are, so enable it only if no conversion is required.
+     * Tone mapping is a conversion as well. */
+    int dr_requested = direct_rendering;
+    direct_rendering &= as_check_dr_available( ctx, input_pixel_format, as_vohp->stacked_format )
+                     && vshp->output_pixel_format == input_pixel_format
+                     && !vshp->tonemap;
+    /* Otherwise, convert the picture band by band while decoding if the decoder can report the bands.
+     * The stacked format is excluded since it is split from an intermediate picture. */
+    as_vohp->band_conversion = dr_requested
+                            && !direct_rendering
+                            && !as_vohp->stacked_format
+                            && !vshp->tonemap
+                            && lw_video_band_conversion_available( ctx );
     int (*dr_get_buffer)( struct AVCodecContext *, AVFrame *, int ) = direct_rendering ? as_video_get_buffer : NULL;
     setup_video_rendering( vohp, !direct_rendering, SWS_FAST_BILINEAR,
                            width, height, vshp->output_pixel_format,
                            ctx, dr_get_buffer );
+    if( as_vohp->band_conversion )
+        lw_video_setup_band_conversion( vohp, ctx, as_video_get_buffer, as_video_draw_horiz_band );
     /* Set the dimensions of AviSynth frame buffer. */
     vi->width  = vohp->output_width;
     vi->height = vohp->output_height;
+    if( as_vohp->setup_background( &as_vohp->background, vi, as_vohp->sub_width, as_vohp->sub_height, as_vohp->bitdepth_minus_8 ) < 0 )
+        env->ThrowError( "%s: failed to allocate memory for the background black frame data.", filter_name );
 }
@@ -29,10 +29,13 @@ typedef struct
     int      linesize[4];
 } as_picture_t;
 
-typedef void func_make_black_background
+typedef int func_setup_background
 (
-    PVideoFrame &frame,
-    int          bitdepth_minus_8
+    lw_video_background_t *bgp,
+    const VideoInfo       *vi,
+    int                    sub_width,
+    int                    sub_height,
+    int                    bitdepth_minus_8
 );
 
 typedef int func_make_frame
@@ -45,21 +48,24 @@ typedef int func_make_frame
 
 typedef struct
 {
-    func_make_black_background *make_black_background;
+    func_setup_background      *setup_background;
     func_make_frame            *make_frame;
     IScriptEnvironment         *env;
     VideoInfo                  *vi;
     int                         bitdepth_minus_8;
+    int                         band_conversion;
     /* for stacked format */
     int                         stacked_format;
     int                         sub_width;
     int                         sub_height;
     as_picture_t                scaled;
+    lw_video_background_t       background;
 } as_video_output_handler_t;
 
 typedef struct
 {
-    PVideoFrame as_frame_buffer;
+    PVideoFrame           as_frame_buffer;
+    lw_video_band_frame_t band;     /* inactive for direct rendering */
 } as_video_buffer_handler_t;
 
 enum AVPixelFormat get_av_output_pixel_format
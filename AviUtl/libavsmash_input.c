@@ -59,10 +59,9 @@ typedef struct libavsmash_handler_tag
     /* Global stuff */
     UINT                              uType;
     lsmash_root_t                    *root;
-    lsmash_file_parameters_t          file_param;
     lsmash_movie_parameters_t         movie_param;
     uint32_t                          number_of_tracks;
-    AVFormatContext                  *format_ctx;
+    char                             *file_name;
     int                               threads;
     /* Video stuff */
     libavsmash_video_info_handler_t    vih;
@@ -195,7 +194,7 @@ static int prepare_video_decoding( lsmash_handler_t *h, video_option_t *opt )
     libavsmash_handler_t *hp = (libavsmash_handler_t *)h->video_private;
     libavsmash_video_decode_handler_t *vdhp = hp->vdhp;
     /* Initialize the video decoder configuration. */
-    if( libavsmash_video_initialize_decoder_configuration( vdhp, hp->format_ctx, hp->threads ) < 0 )
+    if( libavsmash_video_initialize_decoder_configuration( vdhp, hp->file_name, hp->threads ) < 0 )
     {
         DEBUG_VIDEO_MESSAGE_BOX_DESKTOP( MB_ICONERROR | MB_OK, "Failed to initialize the decoder configuration." );
         return -1;
@@ -260,7 +259,7 @@ static int prepare_audio_decoding( lsmash_handler_t *h, audio_option_t *opt )
     libavsmash_handler_t *hp = (libavsmash_handler_t *)h->audio_private;
     libavsmash_audio_decode_handler_t *adhp = hp->adhp;
     /* Initialize the audio decoder configuration. */
-    if( libavsmash_audio_initialize_decoder_configuration( adhp, hp->format_ctx, hp->threads ) < 0 )
+    if( libavsmash_audio_initialize_decoder_configuration( adhp, hp->file_name, hp->threads ) < 0 )
     {
         DEBUG_VIDEO_MESSAGE_BOX_DESKTOP( MB_ICONERROR | MB_OK, "Failed to initialize the decoder configuration." );
         return -1;
@@ -337,12 +336,22 @@ static void *open_file( char *file_name, reader_option_t *opt )
     vlhp->show_log = au_message_box_desktop;
     *alhp = *vlhp;
     /* Open file. */
-    hp->root = libavsmash_open_file( &hp->format_ctx, file_name, &hp->file_param, &hp->movie_param, vlhp );
+    hp->root = libavsmash_open_file( file_name, &hp->movie_param, vlhp );
     if( !hp->root )
     {
         free_handler( &hp );
         return NULL;
     }
+    /* Keep the file name since libavformat may open the file when the decoder configuration is initialized. */
+    size_t file_name_length = strlen( file_name );
+    hp->file_name = (char *)lw_malloc_zero( file_name_length + 1 );
+    if( !hp->file_name )
+    {
+        libavsmash_close_file( hp->root );
+        free_handler( &hp );
+        return NULL;
+    }
+    memcpy( hp->file_name, file_name, file_name_length );
     hp->number_of_tracks = hp->movie_param.number_of_tracks;
     hp->threads          = opt->threads;
     hp->av_sync          = opt->av_sync;
@@ -358,8 +367,7 @@ static int get_first_video_track( lsmash_handler_t *h, video_option_t *opt )
     libavsmash_handler_t *hp = (libavsmash_handler_t *)h->video_private;
     if( get_first_track_of_type( h, ISOM_MEDIA_HANDLER_TYPE_VIDEO_TRACK ) != 0 )
     {
-        uint32_t track_id = libavsmash_video_get_track_id( hp->vdhp );
-        lsmash_destruct_timeline( hp->root, track_id );
+        /* The timeline may be shared with another handler of the same file, so it is left until the file is closed. */
         libavsmash_video_close_codec_context( hp->vdhp );
         return -1;
     }
@@ -380,8 +388,7 @@ static int get_first_audio_track( lsmash_handler_t *h, audio_option_t *opt )
     libavsmash_handler_t *hp = (libavsmash_handler_t *)h->audio_private;
     if( get_first_track_of_type( h, ISOM_MEDIA_HANDLER_TYPE_AUDIO_TRACK ) != 0 )
     {
-        uint32_t track_id = libavsmash_audio_get_track_id( hp->adhp );
-        lsmash_destruct_timeline( hp->root, track_id );
+        /* The timeline may be shared with another handler of the same file, so it is left until the file is closed. */
         libavsmash_audio_close_codec_context( hp->adhp );
         return -1;
     }
@@ -391,7 +398,7 @@ static int get_first_audio_track( lsmash_handler_t *h, audio_option_t *opt )
 static void destroy_disposable( void *private_stuff )
 {
     libavsmash_handler_t *hp = (libavsmash_handler_t *)private_stuff;
-    lsmash_discard_boxes( hp->root );
+    libavsmash_discard_boxes( hp->root );
 }
 
 static int read_video( lsmash_handler_t *h, int sample_number, void *buf )
@@ -469,9 +476,8 @@ static void close_file( void *private_stuff )
     libavsmash_handler_t *hp = (libavsmash_handler_t *)private_stuff;
     if( !hp )
         return;
-    avformat_close_input( &hp->format_ctx );
-    lsmash_close_file( &hp->file_param );
-    lsmash_destroy_root( hp->root );
+    lw_free( hp->file_name );
+    libavsmash_close_file( hp->root );
     lw_free( hp );
 }
 
@@ -207,6 +207,7 @@ static void *open_file( char *file_path, reader_option_t *opt )
     lwlibav_opt.force_video_index = opt->force_video_index;
     lwlibav_opt.force_audio       = opt->force_audio;
     lwlibav_opt.force_audio_index = opt->force_audio_index;
+    lwlibav_opt.audio_only        = 0;
     lwlibav_opt.apply_repeat_flag = opt->video_opt.apply_repeat_flag;
     lwlibav_opt.field_dominance   = opt->video_opt.field_dominance;
     lwlibav_opt.vfr2cfr.active    = opt->video_opt.vfr2cfr.active;
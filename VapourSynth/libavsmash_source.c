@@ -33,17 +33,33 @@
 #include "lsmashsource.h"
 #include "video_output.h"
 
+#include "../common/lwthread.h"
 #include "../common/libavsmash.h"
 #include "../common/libavsmash_video.h"
 
+#define MAX_DECODER_COUNT 64    /* arbitrary */
+
+typedef struct
+{
+    libavsmash_video_decode_handler_t *vdhp;
+    libavsmash_video_output_handler_t *vohp;
+    int                                busy;
+} lsmas_decoder_t;
+
 typedef struct
 {
     VSVideoInfo                        vi;
     libavsmash_video_decode_handler_t *vdhp;
     libavsmash_video_output_handler_t *vohp;
-    lsmash_file_parameters_t           file_param;
-    AVFormatContext                   *format_ctx;
+    int                                boxes_discarded;
     char preferred_decoder_names_buf[PREFERRED_DECODER_NAMES_BUFSIZE];
+    /* Decoders serving frame requests in parallel. The first one is 'vdhp' and 'vohp' above.
+     * The others refer to the ROOT of the first one and are set up from its state without investigating the track again. */
+    int                                decoder_count;
+    lsmas_decoder_t                   *decoders;
+    int                                pool_initialized;
+    lw_mutex_t                         pool_mutex;
+    lw_cond_t                          pool_cond;
 } lsmas_handler_t;
 
 /* Deallocate the handler of this plugin. */
@@ -55,13 +71,28 @@ static void free_handler
     if( !hpp || !*hpp )
         return;
     lsmas_handler_t *hp = *hpp;
+    if( hp->decoders )
+    {
+        /* The additional decoders share the preferred decoder names with the first one. */
+        for( int i = 1; i < hp->decoder_count; i++ )
+        {
+            lsmash_root_t *root = libavsmash_video_get_root( hp->decoders[i].vdhp );
+            libavsmash_video_free_decode_handler( hp->decoders[i].vdhp );
+            libavsmash_video_free_output_handler( hp->decoders[i].vohp );
+            libavsmash_close_file( root );
+        }
+        lw_free( hp->decoders );
+    }
+    if( hp->pool_initialized )
+    {
+        lw_cond_destroy( &hp->pool_cond );
+        lw_mutex_destroy( &hp->pool_mutex );
+    }
     lsmash_root_t *root = libavsmash_video_get_root( hp->vdhp );
     lw_free( libavsmash_video_get_preferred_decoder_names( hp->vdhp ) );
     libavsmash_video_free_decode_handler( hp->vdhp );
     libavsmash_video_free_output_handler( hp->vohp );
-    avformat_close_input( &hp->format_ctx );
-    lsmash_close_file( &hp->file_param );
-    lsmash_destroy_root( root );
+    libavsmash_close_file( root );
     lw_free( hp );
 }
 
@@ -183,18 +214,18 @@ static void set_frame_properties
 
 static int prepare_video_decoding
 (
-    lsmas_handler_t *hp,
-    int              threads,
-    VSMap           *out,
-    VSCore          *core,
-    const VSAPI     *vsapi
+    libavsmash_video_decode_handler_t *vdhp,
+    libavsmash_video_output_handler_t *vohp,
+    VSVideoInfo                       *vi,
+    const char                        *file_name,
+    int                                threads,
+    VSMap                             *out,
+    VSCore                            *core,
+    const VSAPI                       *vsapi
 )
 {
-    libavsmash_video_decode_handler_t *vdhp = hp->vdhp;
-    libavsmash_video_output_handler_t *vohp = hp->vohp;
-    VSVideoInfo                       *vi   = &hp->vi;
     /* Initialize the video decoder configuration. */
-    if( libavsmash_video_initialize_decoder_configuration( vdhp, hp->format_ctx, threads ) < 0 )
+    if( libavsmash_video_initialize_decoder_configuration( vdhp, file_name, threads ) < 0 )
     {
         set_error_on_init( out, vsapi, "lsmas: failed to initialize the decoder configuration." );
         return -1;
@@ -231,23 +262,119 @@ static int prepare_video_decoding
         return -1;
     }
     /* Setup filter specific info. */
-    hp->vi.fpsNum    = fps_num;
-    hp->vi.fpsDen    = fps_den;
-    hp->vi.numFrames = vohp->frame_count;
+    vi->fpsNum    = fps_num;
+    vi->fpsDen    = fps_den;
+    vi->numFrames = vohp->frame_count;
     /* Force seeking at the first reading. */
     libavsmash_video_force_seek( vdhp );
     return 0;
 }
 
-static const VSFrameRef *VS_CC vs_filter_get_frame( int n, int activation_reason, void **instance_data, void **frame_data, VSFrameContext *frame_ctx, VSCore *core, const VSAPI *vsapi )
+/* Set up an additional decoder from the first one prepared by prepare_video_decoding(). */
+static int prepare_additional_video_decoding
+(
+    lsmas_handler_t                   *hp,
+    libavsmash_video_decode_handler_t *vdhp,
+    libavsmash_video_output_handler_t *vohp,
+    const char                        *file_name,
+    int                                threads,
+    VSMap                             *out,
+    VSCore                            *core,
+    const VSAPI                       *vsapi
+)
 {
-    if( activation_reason != arInitial )
-        return NULL;
-    lsmas_handler_t *hp = (lsmas_handler_t *)*instance_data;
-    VSVideoInfo     *vi = &hp->vi;
-    uint32_t sample_number = MIN( n + 1, vi->numFrames );   /* For L-SMASH, sample_number is 1-origin. */
-    libavsmash_video_decode_handler_t *vdhp = hp->vdhp;
-    libavsmash_video_output_handler_t *vohp = hp->vohp;
+    if( libavsmash_video_duplicate_decoder_configuration( vdhp, hp->vdhp, file_name, threads ) < 0 )
+    {
+        set_error_on_init( out, vsapi, "lsmas: failed to initialize the decoder configuration." );
+        return -1;
+    }
+    /* Set up output format. */
+    AVCodecContext *ctx = libavsmash_video_get_codec_context( vdhp );
+    vs_video_output_handler_t *vs_vohp = (vs_video_output_handler_t *)vohp->private_handler;
+    vs_vohp->frame_ctx = NULL;
+    vs_vohp->core      = core;
+    vs_vohp->vsapi     = vsapi;
+    int max_width  = libavsmash_video_get_max_width ( vdhp );
+    int max_height = libavsmash_video_get_max_height( vdhp );
+    VSVideoInfo vi = { 0 };
+    if( vs_setup_video_rendering( vohp, ctx, &vi, out, max_width, max_height ) < 0 )
+        return -1;
+    libavsmash_video_set_get_buffer_func( vdhp );
+    vohp->frame_count = hp->vohp->frame_count;
+    /* Force seeking at the first reading. */
+    libavsmash_video_force_seek( vdhp );
+    return 0;
+}
+
+/* Get the idle decoder which can output the requested frame with the least decoding, waiting for any if all are busy. */
+static lsmas_decoder_t *acquire_decoder
+(
+    lsmas_handler_t *hp,
+    uint32_t         sample_number
+)
+{
+    /* The random accessible sample for the requested frame is the same for every decoder,
+     * and is needed only to choose one of them. */
+    uint32_t rap_number = hp->decoder_count > 1
+                        ? libavsmash_video_get_closest_random_accessible_point( hp->vdhp, sample_number )
+                        : 0;
+    lw_mutex_lock( &hp->pool_mutex );
+    if( !hp->boxes_discarded )
+    {
+        /* The other sources of the same file may still need the shared boxes until the script is evaluated. */
+        for( int i = 0; i < hp->decoder_count; i++ )
+            libavsmash_discard_boxes( libavsmash_video_get_root( hp->decoders[i].vdhp ) );
+        hp->boxes_discarded = 1;
+    }
+    lsmas_decoder_t *decoder = NULL;
+    while( 1 )
+    {
+        uint32_t min_cost = UINT32_MAX;
+        for( int i = 0; i < hp->decoder_count; i++ )
+        {
+            if( hp->decoders[i].busy )
+                continue;
+            uint32_t cost = libavsmash_video_estimate_decoding_cost( hp->decoders[i].vdhp, sample_number, rap_number );
+            if( !decoder || cost < min_cost )
+            {
+                decoder  = &hp->decoders[i];
+                min_cost = cost;
+            }
+        }
+        if( decoder )
+            break;
+        lw_cond_wait( &hp->pool_cond, &hp->pool_mutex );
+    }
+    decoder->busy = 1;
+    lw_mutex_unlock( &hp->pool_mutex );
+    return decoder;
+}
+
+static void release_decoder
+(
+    lsmas_handler_t *hp,
+    lsmas_decoder_t *decoder
+)
+{
+    lw_mutex_lock( &hp->pool_mutex );
+    decoder->busy = 0;
+    lw_cond_signal( &hp->pool_cond );
+    lw_mutex_unlock( &hp->pool_mutex );
+}
+
+static const VSFrameRef *get_frame
+(
+    lsmas_handler_t   *hp,
+    lsmas_decoder_t   *decoder,
+    uint32_t           sample_number,
+    VSFrameContext    *frame_ctx,
+    VSCore            *core,
+    const VSAPI       *vsapi
+)
+{
+    VSVideoInfo                       *vi   = &hp->vi;
+    libavsmash_video_decode_handler_t *vdhp = decoder->vdhp;
+    libavsmash_video_output_handler_t *vohp = decoder->vohp;
     if( libavsmash_video_get_error( vdhp ) )
     {
         vsapi->setFilterError( "lsmas: failed to output a video frame.", frame_ctx );
@@ -280,6 +407,19 @@ static const VSFrameRef *VS_CC vs_filter_get_frame( int n, int activation_reason
         return NULL;
     }
     set_frame_properties( vdhp, vi, av_frame, vs_frame, sample_number, vsapi );
+    vs_set_tonemapped_frame_properties( vohp, vs_frame, vsapi );
+    return vs_frame;
+}
+
+static const VSFrameRef *VS_CC vs_filter_get_frame( int n, int activation_reason, void **instance_data, void **frame_data, VSFrameContext *frame_ctx, VSCore *core, const VSAPI *vsapi )
+{
+    if( activation_reason != arInitial )
+        return NULL;
+    lsmas_handler_t *hp = (lsmas_handler_t *)*instance_data;
+    uint32_t sample_number = MIN( n + 1, hp->vi.numFrames );    /* For L-SMASH, sample_number is 1-origin. */
+    lsmas_decoder_t  *decoder  = acquire_decoder( hp, sample_number );
+    const VSFrameRef *vs_frame = get_frame( hp, decoder, sample_number, frame_ctx, core, vsapi );
+    release_decoder( hp, decoder );
     return vs_frame;
 }
 
@@ -296,13 +436,90 @@ static uint32_t open_file
 )
 {
     lsmash_movie_parameters_t movie_param;
-    lsmash_root_t *root = libavsmash_open_file( &hp->format_ctx, source, &hp->file_param, &movie_param, lhp );
+    lsmash_root_t *root = libavsmash_open_file( source, &movie_param, lhp );
     if( !root )
         return 0;
     libavsmash_video_set_root( hp->vdhp, root );
     return movie_param.number_of_tracks;
 }
 
+/* Set up the additional decoders in the same way as the first one. */
+static int setup_decoder_pool
+(
+    lsmas_handler_t  *hp,
+    const char       *file_name,
+    int               threads,
+    int               decoder_count,
+    int               prefetch,
+    lw_log_handler_t *lhp,
+    VSMap            *out,
+    VSCore           *core,
+    const VSAPI      *vsapi
+)
+{
+    if( lw_mutex_init( &hp->pool_mutex ) < 0 )
+        goto fail;
+    if( lw_cond_init( &hp->pool_cond ) < 0 )
+    {
+        lw_mutex_destroy( &hp->pool_mutex );
+        goto fail;
+    }
+    hp->pool_initialized = 1;
+    hp->decoders = (lsmas_decoder_t *)lw_malloc_zero( decoder_count * sizeof(lsmas_decoder_t) );
+    if( !hp->decoders )
+        goto fail;
+    hp->decoders[0].vdhp = hp->vdhp;
+    hp->decoders[0].vohp = hp->vohp;
+    hp->decoder_count    = 1;
+    vs_video_output_handler_t *first_vs_vohp = (vs_video_output_handler_t *)hp->vohp->private_handler;
+    while( hp->decoder_count < decoder_count )
+    {
+        lsmas_decoder_t *decoder = &hp->decoders[ hp->decoder_count ];
+        decoder->vdhp = libavsmash_video_alloc_decode_handler();
+        decoder->vohp = libavsmash_video_alloc_output_handler();
+        if( !decoder->vdhp || !decoder->vohp )
+        {
+            libavsmash_video_free_decode_handler( decoder->vdhp );
+            libavsmash_video_free_output_handler( decoder->vohp );
+            goto fail;
+        }
+        /* From here, this decoder is freed by free_handler() even if failed. */
+        ++ hp->decoder_count;
+        libavsmash_video_decode_handler_t *vdhp = decoder->vdhp;
+        libavsmash_video_output_handler_t *vohp = decoder->vohp;
+        vs_video_output_handler_t *vs_vohp = vs_allocate_video_output_handler( vohp );
+        if( !vs_vohp )
+            goto fail;
+        vohp->private_handler      = vs_vohp;
+        vohp->free_private_handler = lw_free;
+        lsmash_root_t *root = libavsmash_ref_file( libavsmash_video_get_root( hp->vdhp ) );
+        if( !root )
+        {
+            set_error_on_init( out, vsapi, "lsmas: failed to open the source file for the decoder pool." );
+            return -1;
+        }
+        libavsmash_video_set_root( vdhp, root );
+        libavsmash_video_set_seek_mode              ( vdhp, libavsmash_video_get_seek_mode( hp->vdhp ) );
+        libavsmash_video_set_forward_seek_threshold ( vdhp, libavsmash_video_get_forward_seek_threshold( hp->vdhp ) );
+        libavsmash_video_set_preferred_decoder_names( vdhp, libavsmash_video_get_preferred_decoder_names( hp->vdhp ) );
+        libavsmash_video_set_prefetch               ( vdhp, prefetch );
+        vohp->vfr2cfr        = hp->vohp->vfr2cfr;
+        vohp->cfr_num        = hp->vohp->cfr_num;
+        vohp->cfr_den        = hp->vohp->cfr_den;
+        vohp->scaler.tonemap = hp->vohp->scaler.tonemap;
+        vs_vohp->variable_info          = first_vs_vohp->variable_info;
+        vs_vohp->direct_rendering       = first_vs_vohp->direct_rendering;
+        vs_vohp->vs_output_pixel_format = first_vs_vohp->vs_output_pixel_format;
+        libavsmash_video_set_log_handler( vdhp, lhp );
+        if( prepare_additional_video_decoding( hp, vdhp, vohp, file_name, threads, out, core, vsapi ) < 0 )
+            return -1;
+    }
+    return 0;
+fail:
+    set_error_on_init( out, vsapi, "lsmas: failed to allocate the decoder pool." );
+    return -1;
+}
+
 void VS_CC vs_libavsmashsource_create( const VSMap *in, VSMap *out, void *user_data, VSCore *core, const VSAPI *vsapi )
 {
     /* Get file name. */
@@ -356,6 +573,9 @@ void VS_CC vs_libavsmashsource_create( const VSMap *in, VSMap *out, void *user_d
     int64_t direct_rendering;
     int64_t fps_num;
     int64_t fps_den;
+    int64_t tonemap;
+    int64_t decoder_count;
+    int64_t prefetch;
     const char *format;
     const char *preferred_decoder_names;
     set_option_int64 ( &track_number,            0,    "track",          in, vsapi );
@@ -366,17 +586,22 @@ void VS_CC vs_libavsmashsource_create( const VSMap *in, VSMap *out, void *user_d
     set_option_int64 ( &direct_rendering,        0,    "dr",             in, vsapi );
     set_option_int64 ( &fps_num,                 0,    "fpsnum",         in, vsapi );
     set_option_int64 ( &fps_den,                 1,    "fpsden",         in, vsapi );
+    set_option_int64 ( &tonemap,                 0,    "tonemap",        in, vsapi );
+    set_option_int64 ( &decoder_count,           1,    "decoders",       in, vsapi );
+    set_option_int64 ( &prefetch,                0,    "prefetch",       in, vsapi );
     set_option_string( &format,                  NULL, "format",         in, vsapi );
     set_option_string( &preferred_decoder_names, NULL, "decoder",        in, vsapi );
     set_preferred_decoder_names_on_buf( hp->preferred_decoder_names_buf, preferred_decoder_names );
     libavsmash_video_set_seek_mode              ( vdhp, CLIP_VALUE( seek_mode,      0, 2 ) );
     libavsmash_video_set_forward_seek_threshold ( vdhp, CLIP_VALUE( seek_threshold, 1, 999 ) );
     libavsmash_video_set_preferred_decoder_names( vdhp, tokenize_preferred_decoder_names( hp->preferred_decoder_names_buf ) );
+    libavsmash_video_set_prefetch               ( vdhp, CLIP_VALUE( prefetch, 0, 1 ) );
     vohp->vfr2cfr = (fps_num > 0 && fps_den > 0);
     vohp->cfr_num = (uint32_t)fps_num;
     vohp->cfr_den = (uint32_t)fps_den;
+    vohp->scaler.tonemap = CLIP_VALUE( tonemap, 0, 1 );
     vs_vohp->variable_info               = CLIP_VALUE( variable_info,  0, 1 );
-    vs_vohp->direct_rendering            = CLIP_VALUE( direct_rendering,  0, 1 ) && !format;
+    vs_vohp->direct_rendering            = CLIP_VALUE( direct_rendering,  0, 1 );
     vs_vohp->vs_output_pixel_format = vs_vohp->variable_info ? pfNone : get_vs_output_pixel_format( format );
     if( track_number && track_number > number_of_tracks )
     {
@@ -391,14 +616,27 @@ void VS_CC vs_libavsmashsource_create( const VSMap *in, VSMap *out, void *user_d
         vs_filter_free( hp, core, vsapi );
         return;
     }
-    /* Set up decoders for this track. */
+    /* Set up decoders for this track.
+     * The threads are shared by all the decoders rather than given to each of them. */
+    decoder_count = CLIP_VALUE( decoder_count, 1, MAX_DECODER_COUNT );
     threads = threads >= 0 ? threads : 0;
-    if( prepare_video_decoding( hp, threads, out, core, vsapi ) < 0 )
+    if( decoder_count > 1 )
+    {
+        int64_t total_threads = threads > 0 ? threads : MIN( lw_get_cpu_count(), 16 );
+        threads = MAX( total_threads / decoder_count, 1 );
+    }
+    if( prepare_video_decoding( vdhp, vohp, &hp->vi, file_name, threads, out, core, vsapi ) < 0 )
+    {
+        vs_filter_free( hp, core, vsapi );
+        return;
+    }
+    /* Set up additional decoders serving frame requests in parallel if required. */
+    if( setup_decoder_pool( hp, file_name, threads, decoder_count, CLIP_VALUE( prefetch, 0, 1 ), &lh, out, core, vsapi ) < 0 )
     {
         vs_filter_free( hp, core, vsapi );
         return;
     }
-    lsmash_discard_boxes( libavsmash_video_get_root( vdhp ) );
-    vsapi->createFilter( in, out, "LibavSMASHSource", vs_filter_init, vs_filter_get_frame, vs_filter_free, fmUnordered, nfMakeLinear, hp, core );
+    vsapi->createFilter( in, out, "LibavSMASHSource", vs_filter_init, vs_filter_get_frame, vs_filter_free,
+                         decoder_count > 1 ? fmParallel : fmUnordered, nfMakeLinear, hp, core );
     return;
 }
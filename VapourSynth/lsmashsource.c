@@ -73,11 +73,11 @@ VS_EXTERNAL_API(void) VapourSynthPluginInit( VSConfigPlugin config_func, VSRegis
         1,
         plugin
     );
-#define COMMON_OPTS "threads:int:opt;seek_mode:int:opt;seek_threshold:int:opt;dr:int:opt;fpsnum:int:opt;fpsden:int:opt;variable:int:opt;format:data:opt;decoder:data:opt;"
+#define COMMON_OPTS "threads:int:opt;seek_mode:int:opt;seek_threshold:int:opt;dr:int:opt;fpsnum:int:opt;fpsden:int:opt;variable:int:opt;format:data:opt;decoder:data:opt;tonemap:int:opt;"
     register_func
     (
         "LibavSMASHSource",
-        "source:data;track:int:opt;" COMMON_OPTS,
+        "source:data;track:int:opt;decoders:int:opt;prefetch:int:opt;" COMMON_OPTS,
         vs_libavsmashsource_create,
         NULL,
         plugin
@@ -64,6 +64,18 @@ uint64_t output_pcm_samples_from_packet
     return 0;
 }
 
+uint64_t output_pcm_samples_from_frame
+(
+    lw_audio_output_handler_t *aohp,
+    AVCodecContext            *ctx,
+    AVFrame                   *frame_buffer,
+    uint8_t                  **output_buffer,
+    enum audio_output_flag    *output_flags
+)
+{
+    return 0;
+}
+
 void lw_cleanup_audio_output_handler( lw_audio_output_handler_t *aohp ){ }
 
 #include "lsmashsource.h"
@@ -246,6 +258,7 @@ static const VSFrameRef *VS_CC vs_filter_get_frame( int n, int activation_reason
         return NULL;
     }
     set_frame_properties( vdhp, vi, av_frame, vs_frame, vsapi );
+    vs_set_tonemapped_frame_properties( vohp, vs_frame, vsapi );
     return vs_frame;
 }
 
@@ -304,6 +317,7 @@ void VS_CC vs_lwlibavsource_create( const VSMap *in, VSMap *out, void *user_data
     int64_t fps_den;
     int64_t apply_repeat_flag;
     int64_t field_dominance;
+    int64_t tonemap;
     const char *format;
     const char *preferred_decoder_names;
     set_option_int64 ( &stream_index,           -1,    "stream_index",   in, vsapi );
@@ -317,6 +331,7 @@ void VS_CC vs_lwlibavsource_create( const VSMap *in, VSMap *out, void *user_data
     set_option_int64 ( &fps_den,                 1,    "fpsden",         in, vsapi );
     set_option_int64 ( &apply_repeat_flag,       0,    "repeat",         in, vsapi );
     set_option_int64 ( &field_dominance,         0,    "dominance",      in, vsapi );
+    set_option_int64 ( &tonemap,                 0,    "tonemap",        in, vsapi );
     set_option_string( &format,                  NULL, "format",         in, vsapi );
     set_option_string( &preferred_decoder_names, NULL, "decoder",        in, vsapi );
     set_preferred_decoder_names_on_buf( hp->preferred_decoder_names_buf, preferred_decoder_names );
@@ -330,6 +345,7 @@ void VS_CC vs_lwlibavsource_create( const VSMap *in, VSMap *out, void *user_data
     opt.force_video_index = stream_index >= 0 ? stream_index : -1;
     opt.force_audio       = 0;
     opt.force_audio_index = -1;
+    opt.audio_only        = 0;
     opt.apply_repeat_flag = apply_repeat_flag;
     opt.field_dominance   = CLIP_VALUE( field_dominance, 0, 2 );    /* 0: Obey source flags, 1: TFF, 2: BFF */
     opt.vfr2cfr.active    = fps_num > 0 && fps_den > 0 ? 1 : 0;
@@ -338,8 +354,9 @@ void VS_CC vs_lwlibavsource_create( const VSMap *in, VSMap *out, void *user_data
     lwlibav_video_set_seek_mode              ( vdhp, CLIP_VALUE( seek_mode,      0, 2 ) );
     lwlibav_video_set_forward_seek_threshold ( vdhp, CLIP_VALUE( seek_threshold, 1, 999 ) );
     lwlibav_video_set_preferred_decoder_names( vdhp, tokenize_preferred_decoder_names( hp->preferred_decoder_names_buf ) );
+    vohp->scaler.tonemap            = CLIP_VALUE( tonemap,           0, 1 );
     vs_vohp->variable_info          = CLIP_VALUE( variable_info,     0, 1 );
-    vs_vohp->direct_rendering       = CLIP_VALUE( direct_rendering,  0, 1 ) && !format;
+    vs_vohp->direct_rendering       = CLIP_VALUE( direct_rendering,  0, 1 );
     vs_vohp->vs_output_pixel_format = vs_vohp->variable_info ? pfNone : get_vs_output_pixel_format( format );
     /* Set up progress indicator. */
     progress_indicator_t indicator;
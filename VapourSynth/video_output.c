@@ -37,48 +37,6 @@ typedef struct
     int      linesize[4];
 } vs_picture_t;
 
-static void make_black_background_planar_yuv8
-(
-    VSFrameRef  *vs_frame,
-    const VSAPI *vsapi
-)
-{
-    for( int i = 0; i < 3; i++ )
-        memset( vsapi->getWritePtr( vs_frame, i ), i ? 0x80 : 0x00, vsapi->getStride( vs_frame, i ) * vsapi->getFrameHeight( vs_frame, i ) );
-}
-
-static void make_black_background_planar_yuv16
-(
-    VSFrameRef  *vs_frame,
-    const VSAPI *vsapi
-)
-{
-    int shift = vsapi->getFrameFormat( vs_frame )->bitsPerSample - 8;
-    for( int i = 0; i < 3; i++ )
-    {
-        int v = i ? 0x00000080 << shift : 0x00000000;
-        uint8_t *data = vsapi->getWritePtr( vs_frame, i );
-        uint8_t *end  = data + vsapi->getStride( vs_frame, i ) * vsapi->getFrameHeight( vs_frame, i );
-        while( data < end )
-        {
-            /* Assume little endianess. */
-            data[0] = v;
-            data[1] = v >> 8;
-            data += 2;
-        }
-    }
-}
-
-static void make_black_background_planar_rgb
-(
-    VSFrameRef  *vs_frame,
-    const VSAPI *vsapi
-)
-{
-    for( int i = 0; i < 3; i++ )
-        memset( vsapi->getWritePtr( vs_frame, i ), 0x00, vsapi->getStride( vs_frame, i ) * vsapi->getFrameHeight( vs_frame, i ) );
-}
-
 static void make_frame_planar_yuv
 (
     lw_video_scaler_handler_t *vshp,
@@ -106,7 +64,7 @@ static void make_frame_planar_yuv
             0
         }
     };
-    sws_scale( vshp->sws_ctx, (const uint8_t* const*)av_picture->data, av_picture->linesize, 0, av_picture->height, vs_picture.data, vs_picture.linesize );
+    lw_video_scale_picture( vshp, (const uint8_t* const*)av_picture->data, av_picture->linesize, av_picture->height, vs_picture.data, vs_picture.linesize );
 }
 
 static void make_frame_planar_rgb
@@ -137,7 +95,43 @@ static void make_frame_planar_rgb
         }
 
     };
-    sws_scale( vshp->sws_ctx, (const uint8_t* const*)av_picture->data, av_picture->linesize, 0, av_picture->height, vs_picture.data, vs_picture.linesize );
+    lw_video_scale_picture( vshp, (const uint8_t* const*)av_picture->data, av_picture->linesize, av_picture->height, vs_picture.data, vs_picture.linesize );
+}
+
+/* Unpack packed RGB by the SIMD kernels if supported. Return 0 on success, otherwise -1. */
+static int repack_planar_rgb
+(
+    AVFrame           *av_picture,
+    enum AVPixelFormat av_planar_rgb_format,
+    VSFrameRef        *vs_frame,
+    const VSAPI       *vsapi
+)
+{
+    const lw_video_repack_t *repack = lw_get_video_repack( av_picture->format, av_planar_rgb_format );
+    if( !repack )
+        return -1;
+    /* Planar RGB of libav* is stored in the order of G, B and R. */
+    vs_picture_t vs_picture =
+    {
+        /* data */
+        {
+            vsapi->getWritePtr( vs_frame, 1 ),
+            vsapi->getWritePtr( vs_frame, 2 ),
+            vsapi->getWritePtr( vs_frame, 0 ),
+            NULL
+        },
+        /* linesize */
+        {
+            vsapi->getStride( vs_frame, 1 ),
+            vsapi->getStride( vs_frame, 2 ),
+            vsapi->getStride( vs_frame, 0 ),
+            0
+        }
+    };
+    lw_video_repack( repack, vs_picture.data, vs_picture.linesize,
+                     (const uint8_t * const *)av_picture->data, av_picture->linesize,
+                     av_picture->width, av_picture->height );
+    return 0;
 }
 
 static void make_frame_planar_rgb8
@@ -150,6 +144,8 @@ static void make_frame_planar_rgb8
     const VSAPI               *vsapi
 )
 {
+    if( repack_planar_rgb( av_picture, AV_PIX_FMT_GBRP, vs_frame, vsapi ) == 0 )
+        return;
     uint8_t *vs_frame_data[3] =
         {
             vsapi->getWritePtr( vs_frame, 0 ),
@@ -194,6 +190,8 @@ static void make_frame_planar_rgb16
     const VSAPI               *vsapi
 )
 {
+    if( repack_planar_rgb( av_picture, AV_PIX_FMT_GBRP16LE, vs_frame, vsapi ) == 0 )
+        return;
     uint8_t *vs_frame_data[3] =
         {
             vsapi->getWritePtr( vs_frame, 0 ),
@@ -355,45 +353,42 @@ static inline int set_frame_maker
 {
     static const struct
     {
-        VSPresetFormat              vs_output_pixel_format;
-        int                         av_output_is_planar_rgb;
-        func_make_black_background *func_make_black_background;
-        func_make_frame            *func_make_frame;
+        VSPresetFormat   vs_output_pixel_format;
+        int              av_output_is_planar_rgb;
+        func_make_frame *func_make_frame;
     } frame_maker_table[] =
         {
-            { pfYUV420P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv   },
-            { pfYUV422P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv   },
-            { pfYUV444P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv   },
-            { pfYUV410P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv   },
-            { pfYUV411P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv   },
-            { pfYUV440P8,  0, make_black_background_planar_yuv8,  make_frame_planar_yuv   },
-            { pfYUV420P9,  0, make_black_background_planar_yuv16, make_frame_planar_yuv   },
-            { pfYUV422P9,  0, make_black_background_planar_yuv16, make_frame_planar_yuv   },
-            { pfYUV444P9,  0, make_black_background_planar_yuv16, make_frame_planar_yuv   },
-            { pfYUV420P10, 0, make_black_background_planar_yuv16, make_frame_planar_yuv   },
-            { pfYUV422P10, 0, make_black_background_planar_yuv16, make_frame_planar_yuv   },
-            { pfYUV444P10, 0, make_black_background_planar_yuv16, make_frame_planar_yuv   },
-            { pfYUV420P16, 0, make_black_background_planar_yuv16, make_frame_planar_yuv   },
-            { pfYUV422P16, 0, make_black_background_planar_yuv16, make_frame_planar_yuv   },
-            { pfYUV444P16, 0, make_black_background_planar_yuv16, make_frame_planar_yuv   },
-            { pfRGB24,     1, make_black_background_planar_rgb,   make_frame_planar_rgb   },
-            { pfRGB27,     1, make_black_background_planar_rgb,   make_frame_planar_rgb   },
-            { pfRGB30,     1, make_black_background_planar_rgb,   make_frame_planar_rgb   },
-            { pfRGB48,     1, make_black_background_planar_rgb,   make_frame_planar_rgb   },
-            { pfRGB24,     0, make_black_background_planar_rgb,   make_frame_planar_rgb8  },
-            { pfRGB48,     0, make_black_background_planar_rgb,   make_frame_planar_rgb16 },
-            { pfNone,      0, NULL,                               NULL                    }
+            { pfYUV420P8,  0, make_frame_planar_yuv   },
+            { pfYUV422P8,  0, make_frame_planar_yuv   },
+            { pfYUV444P8,  0, make_frame_planar_yuv   },
+            { pfYUV410P8,  0, make_frame_planar_yuv   },
+            { pfYUV411P8,  0, make_frame_planar_yuv   },
+            { pfYUV440P8,  0, make_frame_planar_yuv   },
+            { pfYUV420P9,  0, make_frame_planar_yuv   },
+            { pfYUV422P9,  0, make_frame_planar_yuv   },
+            { pfYUV444P9,  0, make_frame_planar_yuv   },
+            { pfYUV420P10, 0, make_frame_planar_yuv   },
+            { pfYUV422P10, 0, make_frame_planar_yuv   },
+            { pfYUV444P10, 0, make_frame_planar_yuv   },
+            { pfYUV420P16, 0, make_frame_planar_yuv   },
+            { pfYUV422P16, 0, make_frame_planar_yuv   },
+            { pfYUV444P16, 0, make_frame_planar_yuv   },
+            { pfRGB24,     1, make_frame_planar_rgb   },
+            { pfRGB27,     1, make_frame_planar_rgb   },
+            { pfRGB30,     1, make_frame_planar_rgb   },
+            { pfRGB48,     1, make_frame_planar_rgb   },
+            { pfRGB24,     0, make_frame_planar_rgb8  },
+            { pfRGB48,     0, make_frame_planar_rgb16 },
+            { pfNone,      0, NULL                    }
         };
     for( int i = 0; frame_maker_table[i].vs_output_pixel_format != pfNone; i++ )
         if( vs_vohp->vs_output_pixel_format == frame_maker_table[i].vs_output_pixel_format
          && av_output_is_planar_rgb         == frame_maker_table[i].av_output_is_planar_rgb )
         {
-            vs_vohp->make_black_background = frame_maker_table[i].func_make_black_background;
-            vs_vohp->make_frame            = frame_maker_table[i].func_make_frame;
+            vs_vohp->make_frame = frame_maker_table[i].func_make_frame;
             return 0;
         }
-    vs_vohp->make_black_background = NULL;
-    vs_vohp->make_frame            = NULL;
+    vs_vohp->make_frame = NULL;
     return -1;
 }
 
@@ -433,6 +428,9 @@ static int determine_colorspace_conversion
             { AV_PIX_FMT_YUV444P9BE,  pfYUV444P9,  1 },
             { AV_PIX_FMT_YUV420P10LE, pfYUV420P10, 0 },
             { AV_PIX_FMT_YUV420P10BE, pfYUV420P10, 1 },
+#ifdef AV_PIX_FMT_P010
+            { AV_PIX_FMT_P010LE,      pfYUV420P10, 1 },
+#endif
             { AV_PIX_FMT_YUV422P10LE, pfYUV422P10, 0 },
             { AV_PIX_FMT_YUV422P10BE, pfYUV422P10, 1 },
             { AV_PIX_FMT_YUV444P10LE, pfYUV444P10, 0 },
@@ -456,6 +454,7 @@ static int determine_colorspace_conversion
             { AV_PIX_FMT_RGBA,        pfRGB24,     0 },
             { AV_PIX_FMT_ABGR,        pfRGB24,     0 },
             { AV_PIX_FMT_BGRA,        pfRGB24,     0 },
+            { AV_PIX_FMT_RGB48LE,     pfRGB48,     0 },
             { AV_PIX_FMT_BGR48LE,     pfRGB48,     0 },
             { AV_PIX_FMT_BGR48BE,     pfRGB48,     1 },
             { AV_PIX_FMT_NONE,        pfNone,      1 }
@@ -494,10 +493,64 @@ static int determine_colorspace_conversion
 
 typedef struct
 {
-    VSFrameRef  *vs_frame_buffer;
-    const VSAPI *vsapi;
+    VSFrameRef           *vs_frame_buffer;
+    const VSAPI          *vsapi;
+    lw_video_band_frame_t band;     /* inactive for direct rendering */
 } vs_video_buffer_handler_t;
 
+/* Return 1 if the frame was rendered by the decoder directly into a VapourSynth frame buffer. */
+static inline int is_direct_rendered
+(
+    const AVFrame *av_frame
+)
+{
+    vs_video_buffer_handler_t *vs_vbhp = (vs_video_buffer_handler_t *)av_frame->opaque;
+    return vs_vbhp && !vs_vbhp->band.active;
+}
+
+static int setup_background
+(
+    vs_video_output_handler_t *vs_vohp,
+    const VSFormat            *vs_format,
+    int                        width,
+    int                        height
+)
+{
+    for( int i = 0; i < vs_format->numPlanes; i++ )
+    {
+        int sub_width  = i ? vs_format->subSamplingW : 0;
+        int sub_height = i ? vs_format->subSamplingH : 0;
+        /* Black is zero except for the chroma of YUV. Assume little endianess. */
+        uint32_t black = (vs_format->colorFamily == cmYUV && i) ? 1U << (vs_format->bitsPerSample - 1) : 0;
+        uint8_t  pattern[4] = { (uint8_t)black, (uint8_t)(black >> 8), (uint8_t)(black >> 16), (uint8_t)(black >> 24) };
+        if( lw_setup_video_background_plane( &vs_vohp->background, i,
+                                             (width >> sub_width) * vs_format->bytesPerSample, height >> sub_height,
+                                             sub_width, sub_height, vs_format->bytesPerSample,
+                                             pattern, vs_format->bytesPerSample ) < 0 )
+            return -1;
+    }
+    return 0;
+}
+
+static void fill_background
+(
+    vs_video_output_handler_t *vs_vohp,
+    VSFrameRef                *vs_frame,
+    int                        picture_width,
+    int                        picture_height,
+    const VSAPI               *vsapi
+)
+{
+    uint8_t *data    [4] = { NULL };
+    int      linesize[4] = { 0 };
+    for( int i = 0; i < vs_vohp->background.plane_count; i++ )
+    {
+        data    [i] = vsapi->getWritePtr( vs_frame, i );
+        linesize[i] = vsapi->getStride( vs_frame, i );
+    }
+    lw_fill_video_background( &vs_vohp->background, data, linesize, picture_width, picture_height );
+}
+
 static VSFrameRef *new_output_video_frame
 (
     vs_video_output_handler_t *vs_vohp,
@@ -512,7 +565,7 @@ static VSFrameRef *new_output_video_frame
 {
     if( vs_vohp->variable_info )
     {
-        if( !av_frame->opaque
+        if( !is_direct_rendered( av_frame )
          && determine_colorspace_conversion( vs_vohp, av_frame->format, output_pixel_format, enable_scaler ) < 0 )
             goto fail;
         const VSFormat *vs_format = vsapi->getFormatPreset( vs_vohp->vs_output_pixel_format, core );
@@ -520,11 +573,16 @@ static VSFrameRef *new_output_video_frame
     }
     else
     {
-        if( !av_frame->opaque
+        if( !is_direct_rendered( av_frame )
          && input_pix_fmt_change
          && determine_colorspace_conversion( vs_vohp, av_frame->format, output_pixel_format, enable_scaler ) < 0 )
             goto fail;
-        return vsapi->copyFrame( vs_vohp->background_frame, core );
+        /* Only the area outside the picture is filled here since the rest is overwritten by the picture. */
+        VSFrameRef *vs_frame = vsapi->newVideoFrame( vsapi->getFormatPreset( vs_vohp->vs_output_pixel_format, core ),
+                                                     vs_vohp->output_width, vs_vohp->output_height, NULL, core );
+        if( vs_frame )
+            fill_background( vs_vohp, vs_frame, av_frame->width, av_frame->height, vsapi );
+        return vs_frame;
     }
 fail:
     if( frame_ctx )
@@ -545,9 +603,11 @@ VSFrameRef *make_frame
     const VSAPI    *vsapi     = vs_vohp->vsapi;
     if( av_frame->opaque )
     {
-        /* Render from the decoder directly. */
+        /* Render from the decoder directly, or take the picture converted band by band while decoding.
+         * If the latter is incomplete, e.g. by errors, convert the whole picture as usual. */
         vs_video_buffer_handler_t *vs_vbhp = (vs_video_buffer_handler_t *)av_frame->opaque;
-        return vs_vbhp ? (VSFrameRef *)vs_vbhp->vsapi->cloneFrameRef( vs_vbhp->vs_frame_buffer ) : NULL;
+        if( !vs_vbhp->band.active || lw_video_band_frame_is_complete( &vs_vbhp->band, vshp ) )
+            return (VSFrameRef *)vs_vbhp->vsapi->cloneFrameRef( vs_vbhp->vs_frame_buffer );
     }
     if( !vs_vohp->make_frame )
         return NULL;
@@ -564,6 +624,24 @@ VSFrameRef *make_frame
     return vs_frame;
 }
 
+void vs_set_tonemapped_frame_properties
+(
+    lw_video_output_handler_t *vohp,
+    VSFrameRef                *vs_frame,
+    const VSAPI               *vsapi
+)
+{
+    if( !vohp->scaler.tonemapper )
+        return;
+    VSMap *props = vsapi->getFramePropsRW( vs_frame );
+    int    rgb   = vsapi->getFrameFormat( vs_frame )->colorFamily == cmRGB;
+    /* The tone mapped YUV is limited range, while RGB is always full range. */
+    vsapi->propSetInt( props, "_ColorRange", rgb ? 0 : 1, paReplace );
+    vsapi->propSetInt( props, "_Primaries",  AVCOL_PRI_BT709, paReplace );
+    vsapi->propSetInt( props, "_Transfer",   AVCOL_TRC_BT709, paReplace );
+    vsapi->propSetInt( props, "_Matrix",     rgb ? AVCOL_SPC_RGB : AVCOL_SPC_BT709, paReplace );
+}
+
 static int vs_check_dr_available
 (
     AVCodecContext    *ctx,
@@ -656,6 +734,78 @@ static inline int vs_create_plane_buffer
     return 0;
 }
 
+static void vs_video_draw_horiz_band
+(
+    AVCodecContext *ctx,
+    const AVFrame  *src,
+    int            *offset,
+    int             y,
+    int             type,
+    int             height
+)
+{
+    vs_video_buffer_handler_t *vs_vbhp = (vs_video_buffer_handler_t *)src->opaque;
+    if( !vs_vbhp || !vs_vbhp->band.active )
+        return;
+    lw_video_output_handler_t *lw_vohp = (lw_video_output_handler_t *)ctx->opaque;
+    lw_video_scale_band( &lw_vohp->scaler, &vs_vbhp->band, src, offset, y, height );
+}
+
+/* Allocate the decoder's buffers as usual together with the VapourSynth frame the picture is converted into band by band.
+ * The VapourSynth frame is released together with the last reference to the decoder's buffers. */
+static int vs_video_get_band_buffer
+(
+    AVCodecContext *ctx,
+    AVFrame        *av_frame,
+    int             flags
+)
+{
+    lw_video_output_handler_t *lw_vohp = (lw_video_output_handler_t *)ctx->opaque;
+    vs_video_output_handler_t *vs_vohp = (vs_video_output_handler_t *)lw_vohp->private_handler;
+    int ret = avcodec_default_get_buffer2( ctx, av_frame, flags );
+    if( ret < 0
+     || (vs_vohp->make_frame != make_frame_planar_yuv && vs_vohp->make_frame != make_frame_planar_rgb)
+     || !lw_video_band_frame_available( &lw_vohp->scaler, ctx, av_frame ) )
+        return ret;
+    int free_buf = 0;
+    while( free_buf < AV_NUM_DATA_POINTERS && av_frame->buf[free_buf] )
+        ++free_buf;
+    if( free_buf == AV_NUM_DATA_POINTERS )
+        return ret;
+    const VSAPI *vsapi = vs_vohp->vsapi;
+    vs_video_buffer_handler_t *vs_vbhp = lw_malloc_zero( sizeof(vs_video_buffer_handler_t) );
+    if( !vs_vbhp )
+        return ret;
+    vs_vbhp->vsapi           = vsapi;
+    vs_vbhp->vs_frame_buffer = vsapi->newVideoFrame( vsapi->getFormatPreset( vs_vohp->vs_output_pixel_format, vs_vohp->core ),
+                                                     vs_vohp->output_width, vs_vohp->output_height, NULL, vs_vohp->core );
+    if( !vs_vbhp->vs_frame_buffer )
+    {
+        free( vs_vbhp );
+        return ret;
+    }
+    uint8_t *data    [4] = { NULL };
+    int      linesize[4] = { 0 };
+    for( int i = 0; i < 3; i++ )
+    {
+        data    [i] = vsapi->getWritePtr( vs_vbhp->vs_frame_buffer, vs_vohp->component_reorder[i] );
+        linesize[i] = vsapi->getStride  ( vs_vbhp->vs_frame_buffer, vs_vohp->component_reorder[i] );
+    }
+    lw_video_band_frame_init( &vs_vbhp->band, &lw_vohp->scaler, ctx, av_frame, data, linesize );
+    AVBufferRef *vs_buffer_handler = vs_vbhp->band.active
+                                   ? av_buffer_create( NULL, 0, vs_video_release_buffer_handler, vs_vbhp, 0 )
+                                   : NULL;
+    if( !vs_buffer_handler )
+    {
+        vs_video_release_buffer_handler( vs_vbhp, NULL );
+        return ret;
+    }
+    fill_background( vs_vohp, vs_vbhp->vs_frame_buffer, ctx->width, ctx->height, vsapi );
+    av_frame->buf[free_buf] = vs_buffer_handler;
+    av_frame->opaque        = vs_vbhp;
+    return ret;
+}
+
 static int vs_video_get_buffer
 (
     AVCodecContext *ctx,
@@ -666,6 +816,8 @@ static int vs_video_get_buffer
     av_frame->opaque = NULL;
     lw_video_output_handler_t *lw_vohp = (lw_video_output_handler_t *)ctx->opaque;
     vs_video_output_handler_t *vs_vohp = (vs_video_output_handler_t *)lw_vohp->private_handler;
+    if( vs_vohp->band_conversion )
+        return vs_video_get_band_buffer( ctx, av_frame, flags );
     enum AVPixelFormat pix_fmt = av_frame->format;
     avoid_yuv_scale_conversion( &pix_fmt );
     av_frame->format = pix_fmt; /* Don't use AV_PIX_FMT_YUVJ*. */
@@ -673,7 +825,7 @@ static int vs_video_get_buffer
      || !vs_check_dr_available( ctx, pix_fmt ) )
         return avcodec_default_get_buffer2( ctx, av_frame, flags );
     /* New VapourSynth video frame buffer. */
-    vs_video_buffer_handler_t *vs_vbhp = malloc( sizeof(vs_video_buffer_handler_t) );
+    vs_video_buffer_handler_t *vs_vbhp = lw_malloc_zero( sizeof(vs_video_buffer_handler_t) );
     if( !vs_vbhp )
     {
         av_frame_unref( av_frame );
@@ -738,11 +890,27 @@ int vs_setup_video_rendering
         set_error_on_init( out, vsapi, "lsmas: %s is not supported", av_get_pix_fmt_name( ctx->pix_fmt ) );
         return -1;
     }
-    vs_vohp->direct_rendering &= vs_check_dr_available( ctx, ctx->pix_fmt );
+    /* Direct rendering exports the decoder's buffers as they are, so enable it only if no conversion is required.
+     * This also holds when the output format is given explicitly and matches the decoder's.
+     * Tone mapping is a conversion as well. */
+    enum AVPixelFormat input_pixel_format = ctx->pix_fmt;
+    avoid_yuv_scale_conversion( &input_pixel_format );
+    int dr_requested = vs_vohp->direct_rendering;
+    vs_vohp->direct_rendering &= vs_check_dr_available( ctx, input_pixel_format )
+                              && (vs_vohp->variable_info || output_pixel_format == input_pixel_format)
+                              && !lw_vohp->scaler.tonemap;
+    /* Otherwise, convert the picture band by band while decoding if the decoder can report the bands. */
+    vs_vohp->band_conversion = dr_requested
+                            && !vs_vohp->direct_rendering
+                            && !vs_vohp->variable_info
+                            && !lw_vohp->scaler.tonemap
+                            && lw_video_band_conversion_available( ctx );
     int (*dr_get_buffer)( struct AVCodecContext *, AVFrame *, int ) = vs_vohp->direct_rendering ? vs_video_get_buffer : NULL;
     setup_video_rendering( lw_vohp, enable_scaler, SWS_FAST_BILINEAR,
                            width, height, output_pixel_format,
                            ctx, dr_get_buffer );
+    if( vs_vohp->band_conversion )
+        lw_video_setup_band_conversion( lw_vohp, ctx, vs_video_get_buffer, vs_video_draw_horiz_band );
     if( vs_vohp->variable_info )
     {
         vi->format = NULL;
@@ -757,13 +925,13 @@ int vs_setup_video_rendering
         vi->format = vsapi->getFormatPreset( vs_vohp->vs_output_pixel_format, vs_vohp->core );
         vi->width  = lw_vohp->output_width;
         vi->height = lw_vohp->output_height;
-        vs_vohp->background_frame = vsapi->newVideoFrame( vi->format, vi->width, vi->height, NULL, vs_vohp->core );
-        if( !vs_vohp->background_frame )
+        vs_vohp->output_width  = vi->width;
+        vs_vohp->output_height = vi->height;
+        if( setup_background( vs_vohp, vi->format, vi->width, vi->height ) < 0 )
         {
             set_error_on_init( out, vsapi, "lsmas: failed to allocate memory for the background black frame data." );
             return -1;
         }
-        vs_vohp->make_black_background( vs_vohp->background_frame, vsapi );
     }
     return 0;
 }
@@ -776,8 +944,7 @@ static void vs_free_video_output_handler
     vs_video_output_handler_t *vs_vohp = (vs_video_output_handler_t *)private_handler;
     if( !vs_vohp )
         return;
-    if( vs_vohp->vsapi && vs_vohp->vsapi->freeFrame && vs_vohp->background_frame )
-        vs_vohp->vsapi->freeFrame( vs_vohp->background_frame );
+    lw_cleanup_video_background( &vs_vohp->background );
     lw_free( vs_vohp );
 }
 
@@ -24,12 +24,6 @@
 
 typedef int component_reorder_t;
 
-typedef void func_make_black_background
-(
-    VSFrameRef  *vs_frame,
-    const VSAPI *vsapi
-);
-
 typedef void func_make_frame
 (
     lw_video_scaler_handler_t *vshp,
@@ -44,10 +38,12 @@ typedef struct
 {
     int                         variable_info;
     int                         direct_rendering;
+    int                         band_conversion;
     const component_reorder_t  *component_reorder;
     VSPresetFormat              vs_output_pixel_format;
-    VSFrameRef                 *background_frame;
-    func_make_black_background *make_black_background;
+    int                         output_width;
+    int                         output_height;
+    lw_video_background_t       background;
     func_make_frame            *make_frame;
     VSFrameContext             *frame_ctx;
     VSCore                     *core;
@@ -62,6 +58,14 @@ VSFrameRef *make_frame
     AVFrame                   *av_frame
 );
 
+/* Replace the color properties of 'vs_frame' by the ones of SDR BT.709 if it has been tone-mapped. */
+void vs_set_tonemapped_frame_properties
+(
+    lw_video_output_handler_t *vohp,
+    VSFrameRef                *vs_frame,
+    const VSAPI               *vsapi
+);
+
 int vs_setup_video_rendering
 (
     lw_video_output_handler_t *lw_vohp,
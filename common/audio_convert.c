@@ -0,0 +1,200 @@
+/*****************************************************************************
+ * audio_convert.c / audio_convert.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#include <stddef.h>
+#include <math.h>
+
+#include "lwsimd.h"
+#include "lwthread.h"
+#include "audio_convert.h"
+#include "audio_convert_simd.h"
+
+#define DEFINE_INTERLEAVE_C( type, bits )               \
+static void interleave_##bits##bit_c                    \
+(                                                       \
+    uint8_t        *dst,                                \
+    uint8_t *const *src,                                \
+    int             channels,                           \
+    int             sample_count                        \
+)                                                       \
+{                                                       \
+    type *out = (type *)dst;                            \
+    for( int i = 0; i < sample_count; i++ )             \
+        for( int ch = 0; ch < channels; ch++ )          \
+            *out++ = ((const type *)src[ch])[i];        \
+}
+
+DEFINE_INTERLEAVE_C( uint8_t,   8 )
+DEFINE_INTERLEAVE_C( uint16_t, 16 )
+DEFINE_INTERLEAVE_C( uint32_t, 32 )
+DEFINE_INTERLEAVE_C( uint64_t, 64 )
+#undef DEFINE_INTERLEAVE_C
+
+static void s32_to_s24_c
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            count
+)
+{
+    /* Assume little endianess here.
+     *   in[0]  in[1]  in[2]  in[3]  in[4]  in[5]   in[6]  in[7] ...
+     *      X  out[0] out[1] out[2]     X  out[3]  out[4] out[5] ... */
+    for( int i = 0; i < count; i++ )
+    {
+        *dst++ = src[4 * i + 1];
+        *dst++ = src[4 * i + 2];
+        *dst++ = src[4 * i + 3];
+    }
+}
+
+static void flt_to_s16_c
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            count
+)
+{
+    const float *in  = (const float *)src;
+    int16_t     *out = (int16_t *)dst;
+    for( int i = 0; i < count; i++ )
+    {
+        float value = in[i] * 32768.0f;
+        if( value >= 32767.0f )
+            out[i] = 32767;
+        else if( value <= -32768.0f )
+            out[i] = -32768;
+        else
+            out[i] = (int16_t)lrintf( value );
+    }
+}
+
+/* The kernels picked for the running CPU.
+ * The table is rebuilt at the next use after lw_set_cpu_flags_mask() changes the usable instruction sets. */
+typedef struct
+{
+    lw_audio_interleave_func_t interleave[4][9];   /* [log2 of sample size][channels], [][0] for any other channels */
+    lw_audio_pack_func_t       s32_to_s24;
+    lw_audio_pack_func_t       flt_to_s16;
+} audio_kernels_t;
+
+static audio_kernels_t   kernels;
+static volatile uint32_t kernels_revision;
+static lw_static_mutex_t kernels_mutex = LW_STATIC_MUTEX_INITIALIZER;
+
+static void build_kernels( void )
+{
+    audio_kernels_t table;
+    uint32_t flags = lw_get_cpu_flags();
+    static const lw_audio_interleave_func_t interleave_c[4] =
+        {
+            interleave_8bit_c,
+            interleave_16bit_c,
+            interleave_32bit_c,
+            interleave_64bit_c
+        };
+    for( int i = 0; i < 4; i++ )
+        for( int channels = 0; channels < 9; channels++ )
+            table.interleave[i][channels] = interleave_c[i];
+    if( flags & LW_CPU_SSE2 )
+    {
+        table.interleave[1][2] = interleave_2ch_16bit_sse2;
+        table.interleave[1][6] = interleave_6ch_16bit_sse2;
+        table.interleave[1][8] = interleave_8ch_16bit_sse2;
+        table.interleave[2][2] = interleave_2ch_32bit_sse2;
+        table.interleave[2][6] = interleave_6ch_32bit_sse2;
+        table.interleave[2][8] = interleave_8ch_32bit_sse2;
+    }
+    if( flags & LW_CPU_AVX2 )
+    {
+        table.interleave[1][2] = interleave_2ch_16bit_avx2;
+        table.interleave[2][2] = interleave_2ch_32bit_avx2;
+    }
+#if LW_HAVE_AVX512BW
+    if( flags & LW_CPU_AVX512BW )
+    {
+        table.interleave[1][2] = interleave_2ch_16bit_avx512bw;
+        table.interleave[2][2] = interleave_2ch_32bit_avx512bw;
+    }
+#endif
+    /* Byte shuffling needs SSSE3. */
+    table.s32_to_s24 = (flags & LW_CPU_SSSE3) ? s32_to_s24_ssse3 : s32_to_s24_c;
+    table.flt_to_s16 = (flags & LW_CPU_AVX2) ? flt_to_s16_avx2
+                     : (flags & LW_CPU_SSE2) ? flt_to_s16_sse2
+                     :                         flt_to_s16_c;
+#if LW_HAVE_AVX512BW
+    if( flags & LW_CPU_AVX512BW )
+        table.flt_to_s16 = flt_to_s16_avx512bw;
+#endif
+    kernels = table;
+    lw_atomic_store( &kernels_revision, lw_get_cpu_flags_revision() );
+}
+
+static inline void update_kernels( void )
+{
+    /* Only a stale table takes the lock, so the conversion of every packet is not serialized.
+     * A reading racing with a rebuild might get an entry of the old table, which is still usable on the running CPU. */
+    if( lw_atomic_load( &kernels_revision ) == lw_get_cpu_flags_revision() )
+        return;
+    lw_static_mutex_lock( &kernels_mutex );
+    if( kernels_revision != lw_get_cpu_flags_revision() )
+        build_kernels();
+    lw_static_mutex_unlock( &kernels_mutex );
+}
+
+lw_audio_interleave_func_t lw_get_audio_interleave_func
+(
+    int sample_size,
+    int channels
+)
+{
+    int size_index;
+    switch( sample_size )
+    {
+        case 1 : size_index = 0; break;
+        case 2 : size_index = 1; break;
+        case 4 : size_index = 2; break;
+        case 8 : size_index = 3; break;
+        default :
+            return NULL;
+    }
+    update_kernels();
+    return kernels.interleave[size_index][channels > 0 && channels < 9 ? channels : 0];
+}
+
+lw_audio_pack_func_t lw_get_audio_s32_to_s24_func
+(
+    void
+)
+{
+    update_kernels();
+    return kernels.s32_to_s24;
+}
+
+lw_audio_pack_func_t lw_get_audio_flt_to_s16_func
+(
+    void
+)
+{
+    update_kernels();
+    return kernels.flt_to_s16;
+}
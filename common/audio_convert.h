@@ -0,0 +1,62 @@
+/*****************************************************************************
+ * audio_convert.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#ifndef LW_AUDIO_CONVERT_H
+#define LW_AUDIO_CONVERT_H
+
+#include <stdint.h>
+
+/* Interleave 'sample_count' samples of each plane in 'src' into 'dst'. */
+typedef void (*lw_audio_interleave_func_t)
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+);
+
+/* Convert 'count' values, not samples, of packed audio from 'src' into 'dst'. */
+typedef void (*lw_audio_pack_func_t)
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            count
+);
+
+/* The following functions return the fastest implementation available on the running CPU. */
+lw_audio_interleave_func_t lw_get_audio_interleave_func
+(
+    int sample_size,    /* the number of bytes per value: 1, 2, 4 or 8 */
+    int channels
+);
+
+/* Pack signed 32-bit integers into signed 24-bit integers by dropping the least significant byte. */
+lw_audio_pack_func_t lw_get_audio_s32_to_s24_func
+(
+    void
+);
+
+/* Convert IEEE single precision floating points into signed 16-bit integers with clipping. */
+lw_audio_pack_func_t lw_get_audio_flt_to_s16_func
+(
+    void
+);
+
+#endif  /* LW_AUDIO_CONVERT_H */
@@ -0,0 +1,497 @@
+/*****************************************************************************
+ * audio_convert_simd.c / audio_convert_simd.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include <stdint.h>
+
+#include "lwsimd.h"
+#include "audio_convert_simd.h"
+
+/* Planar samples not fitting in a vector are handled by these. */
+static inline void interleave_16bit_tail
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             i,
+    int             sample_count
+)
+{
+    uint16_t *out = (uint16_t *)dst + i * channels;
+    for( ; i < sample_count; i++ )
+        for( int ch = 0; ch < channels; ch++ )
+            *out++ = ((const uint16_t *)src[ch])[i];
+}
+
+static inline void interleave_32bit_tail
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             i,
+    int             sample_count
+)
+{
+    uint32_t *out = (uint32_t *)dst + i * channels;
+    for( ; i < sample_count; i++ )
+        for( int ch = 0; ch < channels; ch++ )
+            *out++ = ((const uint32_t *)src[ch])[i];
+}
+
+#ifdef __GNUC__
+#pragma GCC target ("sse2")
+#endif
+#include <emmintrin.h>
+
+/* Interleave three vectors of 32-bit elements a[0..3], b[0..3] and c[0..3]
+ * into a0 b0 c0 a1 | b1 c1 a2 b2 | c2 a3 b3 c3. */
+static LW_FORCEINLINE void interleave_3x32bit_sse2
+(
+    uint8_t *dst,
+    __m128i  a,
+    __m128i  b,
+    __m128i  c
+)
+{
+    __m128 ab_lo = _mm_castsi128_ps( _mm_unpacklo_epi32( a, b ) );   /* a0 b0 a1 b1 */
+    __m128 ab_hi = _mm_castsi128_ps( _mm_unpackhi_epi32( a, b ) );   /* a2 b2 a3 b3 */
+    __m128 bc_lo = _mm_castsi128_ps( _mm_unpacklo_epi32( b, c ) );   /* b0 c0 b1 c1 */
+    __m128 bc_hi = _mm_castsi128_ps( _mm_unpackhi_epi32( b, c ) );   /* b2 c2 b3 c3 */
+    __m128 ca_lo = _mm_castsi128_ps( _mm_unpacklo_epi32( c, a ) );   /* c0 a0 c1 a1 */
+    __m128 ca_hi = _mm_castsi128_ps( _mm_unpackhi_epi32( c, a ) );   /* c2 a2 c3 a3 */
+    _mm_storeu_ps( (float *)(dst +  0), _mm_shuffle_ps( ab_lo, ca_lo, _MM_SHUFFLE( 3, 0, 1, 0 ) ) );
+    _mm_storeu_ps( (float *)(dst + 16), _mm_shuffle_ps( bc_lo, ab_hi, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+    _mm_storeu_ps( (float *)(dst + 32), _mm_shuffle_ps( ca_hi, bc_hi, _MM_SHUFFLE( 3, 2, 3, 0 ) ) );
+}
+
+void LW_FUNC_ALIGN interleave_2ch_16bit_sse2
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+)
+{
+    int i = 0;
+    for( ; i <= sample_count - 8; i += 8 )
+    {
+        __m128i x0 = _mm_loadu_si128( (const __m128i *)(src[0] + 2 * i) );
+        __m128i x1 = _mm_loadu_si128( (const __m128i *)(src[1] + 2 * i) );
+        _mm_storeu_si128( (__m128i *)(dst + 4 * i     ), _mm_unpacklo_epi16( x0, x1 ) );
+        _mm_storeu_si128( (__m128i *)(dst + 4 * i + 16), _mm_unpackhi_epi16( x0, x1 ) );
+    }
+    interleave_16bit_tail( dst, src, 2, i, sample_count );
+}
+
+void LW_FUNC_ALIGN interleave_6ch_16bit_sse2
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+)
+{
+    /* Pair the channels so that the six 16-bit channels are treated as three 32-bit ones. */
+    int i = 0;
+    for( ; i <= sample_count - 8; i += 8 )
+    {
+        __m128i x0 = _mm_loadu_si128( (const __m128i *)(src[0] + 2 * i) );
+        __m128i x1 = _mm_loadu_si128( (const __m128i *)(src[1] + 2 * i) );
+        __m128i x2 = _mm_loadu_si128( (const __m128i *)(src[2] + 2 * i) );
+        __m128i x3 = _mm_loadu_si128( (const __m128i *)(src[3] + 2 * i) );
+        __m128i x4 = _mm_loadu_si128( (const __m128i *)(src[4] + 2 * i) );
+        __m128i x5 = _mm_loadu_si128( (const __m128i *)(src[5] + 2 * i) );
+        uint8_t *out = dst + 12 * i;
+        interleave_3x32bit_sse2( out,      _mm_unpacklo_epi16( x0, x1 ), _mm_unpacklo_epi16( x2, x3 ), _mm_unpacklo_epi16( x4, x5 ) );
+        interleave_3x32bit_sse2( out + 48, _mm_unpackhi_epi16( x0, x1 ), _mm_unpackhi_epi16( x2, x3 ), _mm_unpackhi_epi16( x4, x5 ) );
+    }
+    interleave_16bit_tail( dst, src, 6, i, sample_count );
+}
+
+void LW_FUNC_ALIGN interleave_8ch_16bit_sse2
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+)
+{
+    /* 8x8 transposition of 16-bit elements */
+    int i = 0;
+    for( ; i <= sample_count - 8; i += 8 )
+    {
+        __m128i x0 = _mm_loadu_si128( (const __m128i *)(src[0] + 2 * i) );
+        __m128i x1 = _mm_loadu_si128( (const __m128i *)(src[1] + 2 * i) );
+        __m128i x2 = _mm_loadu_si128( (const __m128i *)(src[2] + 2 * i) );
+        __m128i x3 = _mm_loadu_si128( (const __m128i *)(src[3] + 2 * i) );
+        __m128i x4 = _mm_loadu_si128( (const __m128i *)(src[4] + 2 * i) );
+        __m128i x5 = _mm_loadu_si128( (const __m128i *)(src[5] + 2 * i) );
+        __m128i x6 = _mm_loadu_si128( (const __m128i *)(src[6] + 2 * i) );
+        __m128i x7 = _mm_loadu_si128( (const __m128i *)(src[7] + 2 * i) );
+        __m128i y0 = _mm_unpacklo_epi16( x0, x1 );
+        __m128i y1 = _mm_unpackhi_epi16( x0, x1 );
+        __m128i y2 = _mm_unpacklo_epi16( x2, x3 );
+        __m128i y3 = _mm_unpackhi_epi16( x2, x3 );
+        __m128i y4 = _mm_unpacklo_epi16( x4, x5 );
+        __m128i y5 = _mm_unpackhi_epi16( x4, x5 );
+        __m128i y6 = _mm_unpacklo_epi16( x6, x7 );
+        __m128i y7 = _mm_unpackhi_epi16( x6, x7 );
+        x0 = _mm_unpacklo_epi32( y0, y2 );
+        x1 = _mm_unpackhi_epi32( y0, y2 );
+        x2 = _mm_unpacklo_epi32( y1, y3 );
+        x3 = _mm_unpackhi_epi32( y1, y3 );
+        x4 = _mm_unpacklo_epi32( y4, y6 );
+        x5 = _mm_unpackhi_epi32( y4, y6 );
+        x6 = _mm_unpacklo_epi32( y5, y7 );
+        x7 = _mm_unpackhi_epi32( y5, y7 );
+        __m128i *out = (__m128i *)(dst + 16 * i);
+        _mm_storeu_si128( out + 0, _mm_unpacklo_epi64( x0, x4 ) );
+        _mm_storeu_si128( out + 1, _mm_unpackhi_epi64( x0, x4 ) );
+        _mm_storeu_si128( out + 2, _mm_unpacklo_epi64( x1, x5 ) );
+        _mm_storeu_si128( out + 3, _mm_unpackhi_epi64( x1, x5 ) );
+        _mm_storeu_si128( out + 4, _mm_unpacklo_epi64( x2, x6 ) );
+        _mm_storeu_si128( out + 5, _mm_unpackhi_epi64( x2, x6 ) );
+        _mm_storeu_si128( out + 6, _mm_unpacklo_epi64( x3, x7 ) );
+        _mm_storeu_si128( out + 7, _mm_unpackhi_epi64( x3, x7 ) );
+    }
+    interleave_16bit_tail( dst, src, 8, i, sample_count );
+}
+
+void LW_FUNC_ALIGN interleave_2ch_32bit_sse2
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+)
+{
+    int i = 0;
+    for( ; i <= sample_count - 4; i += 4 )
+    {
+        __m128i x0 = _mm_loadu_si128( (const __m128i *)(src[0] + 4 * i) );
+        __m128i x1 = _mm_loadu_si128( (const __m128i *)(src[1] + 4 * i) );
+        _mm_storeu_si128( (__m128i *)(dst + 8 * i     ), _mm_unpacklo_epi32( x0, x1 ) );
+        _mm_storeu_si128( (__m128i *)(dst + 8 * i + 16), _mm_unpackhi_epi32( x0, x1 ) );
+    }
+    interleave_32bit_tail( dst, src, 2, i, sample_count );
+}
+
+void LW_FUNC_ALIGN interleave_6ch_32bit_sse2
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+)
+{
+    /* Pair the channels so that the six 32-bit channels are treated as three 64-bit ones. */
+    int i = 0;
+    for( ; i <= sample_count - 4; i += 4 )
+    {
+        __m128i x0 = _mm_loadu_si128( (const __m128i *)(src[0] + 4 * i) );
+        __m128i x1 = _mm_loadu_si128( (const __m128i *)(src[1] + 4 * i) );
+        __m128i x2 = _mm_loadu_si128( (const __m128i *)(src[2] + 4 * i) );
+        __m128i x3 = _mm_loadu_si128( (const __m128i *)(src[3] + 4 * i) );
+        __m128i x4 = _mm_loadu_si128( (const __m128i *)(src[4] + 4 * i) );
+        __m128i x5 = _mm_loadu_si128( (const __m128i *)(src[5] + 4 * i) );
+        __m128i a0 = _mm_unpacklo_epi32( x0, x1 );  /* samples 0 and 1 of channel 0 and 1 */
+        __m128i a1 = _mm_unpackhi_epi32( x0, x1 );  /* samples 2 and 3 of channel 0 and 1 */
+        __m128i b0 = _mm_unpacklo_epi32( x2, x3 );
+        __m128i b1 = _mm_unpackhi_epi32( x2, x3 );
+        __m128i c0 = _mm_unpacklo_epi32( x4, x5 );
+        __m128i c1 = _mm_unpackhi_epi32( x4, x5 );
+        __m128i *out = (__m128i *)(dst + 24 * i);
+        _mm_storeu_si128( out + 0, _mm_unpacklo_epi64( a0, b0 ) );
+        _mm_storeu_si128( out + 1, _mm_unpacklo_epi64( c0, _mm_srli_si128( a0, 8 ) ) );
+        _mm_storeu_si128( out + 2, _mm_unpackhi_epi64( b0, c0 ) );
+        _mm_storeu_si128( out + 3, _mm_unpacklo_epi64( a1, b1 ) );
+        _mm_storeu_si128( out + 4, _mm_unpacklo_epi64( c1, _mm_srli_si128( a1, 8 ) ) );
+        _mm_storeu_si128( out + 5, _mm_unpackhi_epi64( b1, c1 ) );
+    }
+    interleave_32bit_tail( dst, src, 6, i, sample_count );
+}
+
+void LW_FUNC_ALIGN interleave_8ch_32bit_sse2
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+)
+{
+    /* Two 4x4 transpositions of 32-bit elements */
+    int i = 0;
+    for( ; i <= sample_count - 4; i += 4 )
+    {
+        __m128i x0 = _mm_loadu_si128( (const __m128i *)(src[0] + 4 * i) );
+        __m128i x1 = _mm_loadu_si128( (const __m128i *)(src[1] + 4 * i) );
+        __m128i x2 = _mm_loadu_si128( (const __m128i *)(src[2] + 4 * i) );
+        __m128i x3 = _mm_loadu_si128( (const __m128i *)(src[3] + 4 * i) );
+        __m128i x4 = _mm_loadu_si128( (const __m128i *)(src[4] + 4 * i) );
+        __m128i x5 = _mm_loadu_si128( (const __m128i *)(src[5] + 4 * i) );
+        __m128i x6 = _mm_loadu_si128( (const __m128i *)(src[6] + 4 * i) );
+        __m128i x7 = _mm_loadu_si128( (const __m128i *)(src[7] + 4 * i) );
+        __m128i y0 = _mm_unpacklo_epi32( x0, x1 );
+        __m128i y1 = _mm_unpackhi_epi32( x0, x1 );
+        __m128i y2 = _mm_unpacklo_epi32( x2, x3 );
+        __m128i y3 = _mm_unpackhi_epi32( x2, x3 );
+        __m128i y4 = _mm_unpacklo_epi32( x4, x5 );
+        __m128i y5 = _mm_unpackhi_epi32( x4, x5 );
+        __m128i y6 = _mm_unpacklo_epi32( x6, x7 );
+        __m128i y7 = _mm_unpackhi_epi32( x6, x7 );
+        __m128i *out = (__m128i *)(dst + 32 * i);
+        _mm_storeu_si128( out + 0, _mm_unpacklo_epi64( y0, y2 ) );
+        _mm_storeu_si128( out + 1, _mm_unpacklo_epi64( y4, y6 ) );
+        _mm_storeu_si128( out + 2, _mm_unpackhi_epi64( y0, y2 ) );
+        _mm_storeu_si128( out + 3, _mm_unpackhi_epi64( y4, y6 ) );
+        _mm_storeu_si128( out + 4, _mm_unpacklo_epi64( y1, y3 ) );
+        _mm_storeu_si128( out + 5, _mm_unpacklo_epi64( y5, y7 ) );
+        _mm_storeu_si128( out + 6, _mm_unpackhi_epi64( y1, y3 ) );
+        _mm_storeu_si128( out + 7, _mm_unpackhi_epi64( y5, y7 ) );
+    }
+    interleave_32bit_tail( dst, src, 8, i, sample_count );
+}
+
+static inline int16_t flt_to_s16( float value )
+{
+    value *= 32768.0f;
+    if( value >= 32767.0f )
+        return 32767;
+    if( value <= -32768.0f )
+        return -32768;
+    return (int16_t)_mm_cvtss_si32( _mm_set_ss( value ) );
+}
+
+void LW_FUNC_ALIGN flt_to_s16_sse2
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            count
+)
+{
+    /* Clip before conversion since out-of-range values are converted into INT32_MIN. */
+    const float *in  = (const float *)src;
+    int16_t     *out = (int16_t *)dst;
+    const __m128 scale = _mm_set1_ps( 32768.0f );
+    const __m128 max   = _mm_set1_ps( 32767.0f );
+    const __m128 min   = _mm_set1_ps( -32768.0f );
+    int i = 0;
+    for( ; i <= count - 8; i += 8 )
+    {
+        __m128 x0 = _mm_mul_ps( _mm_loadu_ps( in + i     ), scale );
+        __m128 x1 = _mm_mul_ps( _mm_loadu_ps( in + i + 4 ), scale );
+        x0 = _mm_max_ps( _mm_min_ps( x0, max ), min );
+        x1 = _mm_max_ps( _mm_min_ps( x1, max ), min );
+        _mm_storeu_si128( (__m128i *)(out + i), _mm_packs_epi32( _mm_cvtps_epi32( x0 ), _mm_cvtps_epi32( x1 ) ) );
+    }
+    for( ; i < count; i++ )
+        out[i] = flt_to_s16( in[i] );
+}
+
+#ifdef __GNUC__
+#pragma GCC target ("ssse3")
+#endif
+#include <tmmintrin.h>
+
+void LW_FUNC_ALIGN s32_to_s24_ssse3
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            count
+)
+{
+    /* Drop the least significant byte of each value and concatenate four vectors of 12 valid bytes into three. */
+    const __m128i shuffle = _mm_setr_epi8( 1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, -1, -1, -1, -1 );
+    int i = 0;
+    for( ; i <= count - 16; i += 16 )
+    {
+        __m128i x0 = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *)(src + 4 * i     ) ), shuffle );
+        __m128i x1 = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *)(src + 4 * i + 16) ), shuffle );
+        __m128i x2 = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *)(src + 4 * i + 32) ), shuffle );
+        __m128i x3 = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *)(src + 4 * i + 48) ), shuffle );
+        __m128i *out = (__m128i *)(dst + 3 * i);
+        _mm_storeu_si128( out + 0, _mm_or_si128( x0, _mm_slli_si128( x1, 12 ) ) );
+        _mm_storeu_si128( out + 1, _mm_or_si128( _mm_srli_si128( x1, 4 ), _mm_slli_si128( x2, 8 ) ) );
+        _mm_storeu_si128( out + 2, _mm_or_si128( _mm_srli_si128( x2, 8 ), _mm_slli_si128( x3, 4 ) ) );
+    }
+    for( ; i < count; i++ )
+    {
+        dst[3 * i    ] = src[4 * i + 1];
+        dst[3 * i + 1] = src[4 * i + 2];
+        dst[3 * i + 2] = src[4 * i + 3];
+    }
+}
+
+#ifdef __GNUC__
+#pragma GCC target ("avx2")
+#endif
+#include <immintrin.h>
+
+void LW_FUNC_ALIGN interleave_2ch_16bit_avx2
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+)
+{
+    /* Unpacking works within each 128-bit lane, so swap the middle lanes afterwards. */
+    int i = 0;
+    for( ; i <= sample_count - 16; i += 16 )
+    {
+        __m256i x0 = _mm256_loadu_si256( (const __m256i *)(src[0] + 2 * i) );
+        __m256i x1 = _mm256_loadu_si256( (const __m256i *)(src[1] + 2 * i) );
+        __m256i lo = _mm256_unpacklo_epi16( x0, x1 );
+        __m256i hi = _mm256_unpackhi_epi16( x0, x1 );
+        _mm256_storeu_si256( (__m256i *)(dst + 4 * i     ), _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+        _mm256_storeu_si256( (__m256i *)(dst + 4 * i + 32), _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+    }
+    _mm256_zeroupper();
+    interleave_16bit_tail( dst, src, 2, i, sample_count );
+}
+
+void LW_FUNC_ALIGN interleave_2ch_32bit_avx2
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+)
+{
+    int i = 0;
+    for( ; i <= sample_count - 8; i += 8 )
+    {
+        __m256i x0 = _mm256_loadu_si256( (const __m256i *)(src[0] + 4 * i) );
+        __m256i x1 = _mm256_loadu_si256( (const __m256i *)(src[1] + 4 * i) );
+        __m256i lo = _mm256_unpacklo_epi32( x0, x1 );
+        __m256i hi = _mm256_unpackhi_epi32( x0, x1 );
+        _mm256_storeu_si256( (__m256i *)(dst + 8 * i     ), _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+        _mm256_storeu_si256( (__m256i *)(dst + 8 * i + 32), _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+    }
+    _mm256_zeroupper();
+    interleave_32bit_tail( dst, src, 2, i, sample_count );
+}
+
+void LW_FUNC_ALIGN flt_to_s16_avx2
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            count
+)
+{
+    const float *in  = (const float *)src;
+    int16_t     *out = (int16_t *)dst;
+    const __m256 scale = _mm256_set1_ps( 32768.0f );
+    const __m256 max   = _mm256_set1_ps( 32767.0f );
+    const __m256 min   = _mm256_set1_ps( -32768.0f );
+    int i = 0;
+    for( ; i <= count - 16; i += 16 )
+    {
+        __m256 x0 = _mm256_mul_ps( _mm256_loadu_ps( in + i     ), scale );
+        __m256 x1 = _mm256_mul_ps( _mm256_loadu_ps( in + i + 8 ), scale );
+        x0 = _mm256_max_ps( _mm256_min_ps( x0, max ), min );
+        x1 = _mm256_max_ps( _mm256_min_ps( x1, max ), min );
+        __m256i y = _mm256_packs_epi32( _mm256_cvtps_epi32( x0 ), _mm256_cvtps_epi32( x1 ) );
+        _mm256_storeu_si256( (__m256i *)(out + i), _mm256_permute4x64_epi64( y, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+    }
+    _mm256_zeroupper();
+    for( ; i < count; i++ )
+        out[i] = flt_to_s16( in[i] );
+}
+
+#if LW_HAVE_AVX512BW
+#ifdef __GNUC__
+#pragma GCC target ("avx512bw")
+#endif
+#include <immintrin.h>
+
+void LW_FUNC_ALIGN interleave_2ch_16bit_avx512bw
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+)
+{
+    /* Pick samples alternately from both channels across the whole register. */
+    const __m512i index_lo = _mm512_set_epi16( 47, 15, 46, 14, 45, 13, 44, 12, 43, 11, 42, 10, 41,  9, 40,  8,
+                                               39,  7, 38,  6, 37,  5, 36,  4, 35,  3, 34,  2, 33,  1, 32,  0 );
+    const __m512i index_hi = _mm512_add_epi16( index_lo, _mm512_set1_epi16( 16 ) );
+    int i = 0;
+    for( ; i <= sample_count - 32; i += 32 )
+    {
+        __m512i x0 = _mm512_loadu_si512( (const void *)(src[0] + 2 * i) );
+        __m512i x1 = _mm512_loadu_si512( (const void *)(src[1] + 2 * i) );
+        _mm512_storeu_si512( (void *)(dst + 4 * i     ), _mm512_permutex2var_epi16( x0, index_lo, x1 ) );
+        _mm512_storeu_si512( (void *)(dst + 4 * i + 64), _mm512_permutex2var_epi16( x0, index_hi, x1 ) );
+    }
+    _mm256_zeroupper();
+    interleave_16bit_tail( dst, src, 2, i, sample_count );
+}
+
+void LW_FUNC_ALIGN interleave_2ch_32bit_avx512bw
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+)
+{
+    const __m512i index_lo = _mm512_set_epi32( 23, 7, 22, 6, 21, 5, 20, 4, 19, 3, 18, 2, 17, 1, 16, 0 );
+    const __m512i index_hi = _mm512_add_epi32( index_lo, _mm512_set1_epi32( 8 ) );
+    int i = 0;
+    for( ; i <= sample_count - 16; i += 16 )
+    {
+        __m512i x0 = _mm512_loadu_si512( (const void *)(src[0] + 4 * i) );
+        __m512i x1 = _mm512_loadu_si512( (const void *)(src[1] + 4 * i) );
+        _mm512_storeu_si512( (void *)(dst + 8 * i     ), _mm512_permutex2var_epi32( x0, index_lo, x1 ) );
+        _mm512_storeu_si512( (void *)(dst + 8 * i + 64), _mm512_permutex2var_epi32( x0, index_hi, x1 ) );
+    }
+    _mm256_zeroupper();
+    interleave_32bit_tail( dst, src, 2, i, sample_count );
+}
+
+void LW_FUNC_ALIGN flt_to_s16_avx512bw
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            count
+)
+{
+    const float *in  = (const float *)src;
+    int16_t     *out = (int16_t *)dst;
+    const __m512 scale = _mm512_set1_ps( 32768.0f );
+    const __m512 max   = _mm512_set1_ps( 32767.0f );
+    const __m512 min   = _mm512_set1_ps( -32768.0f );
+    int i = 0;
+    for( ; i <= count - 32; i += 32 )
+    {
+        __m512 x0 = _mm512_mul_ps( _mm512_loadu_ps( in + i      ), scale );
+        __m512 x1 = _mm512_mul_ps( _mm512_loadu_ps( in + i + 16 ), scale );
+        x0 = _mm512_max_ps( _mm512_min_ps( x0, max ), min );
+        x1 = _mm512_max_ps( _mm512_min_ps( x1, max ), min );
+        /* Narrowing keeps the order of elements unlike packing within lanes. */
+        _mm256_storeu_si256( (__m256i *)(out + i     ), _mm512_cvtsepi32_epi16( _mm512_cvtps_epi32( x0 ) ) );
+        _mm256_storeu_si256( (__m256i *)(out + i + 16), _mm512_cvtsepi32_epi16( _mm512_cvtps_epi32( x1 ) ) );
+    }
+    _mm256_zeroupper();
+    for( ; i < count; i++ )
+        out[i] = flt_to_s16( in[i] );
+}
+#endif
@@ -0,0 +1,54 @@
+/*****************************************************************************
+ * audio_convert_simd.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+typedef void func_audio_interleave
+(
+    uint8_t        *dst,
+    uint8_t *const *src,
+    int             channels,
+    int             sample_count
+);
+
+typedef void func_audio_pack
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            count
+);
+
+func_audio_interleave interleave_2ch_16bit_sse2;
+func_audio_interleave interleave_6ch_16bit_sse2;
+func_audio_interleave interleave_8ch_16bit_sse2;
+func_audio_interleave interleave_2ch_32bit_sse2;
+func_audio_interleave interleave_6ch_32bit_sse2;
+func_audio_interleave interleave_8ch_32bit_sse2;
+func_audio_interleave interleave_2ch_16bit_avx2;
+func_audio_interleave interleave_2ch_32bit_avx2;
+#if LW_HAVE_AVX512BW
+func_audio_interleave interleave_2ch_16bit_avx512bw;
+func_audio_interleave interleave_2ch_32bit_avx512bw;
+#endif
+
+func_audio_pack s32_to_s24_ssse3;
+func_audio_pack flt_to_s16_sse2;
+func_audio_pack flt_to_s16_avx2;
+#if LW_HAVE_AVX512BW
+func_audio_pack flt_to_s16_avx512bw;
+#endif
@@ -0,0 +1,256 @@
+/*****************************************************************************
+ * audio_decode_pool.c / audio_decode_pool.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  /* __cplusplus */
+#include <libavcodec/avcodec.h>         /* Decoder */
+#include <libavutil/mem.h>
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#include "utils.h"
+#include "lwthread.h"
+#include "audio_decode_pool.h"
+
+typedef struct
+{
+    lw_audio_decode_pool_t *pool;
+    lw_thread_t             thread;
+    AVCodecContext         *ctx;
+} decode_worker_t;
+
+struct lw_audio_decode_pool_tag
+{
+    int              thread_count;
+    int              started_count;
+    decode_worker_t *workers;
+    int              config_id;
+    /* protected by the mutex */
+    lw_mutex_t       mutex;
+    lw_cond_t        worker_cond;
+    lw_cond_t        caller_cond;
+    int              quit;
+    uint32_t         generation;    /* incremented every time a new batch is posted */
+    AVPacket        *packets;
+    AVFrame        **frames;
+    int             *results;
+    int              job_count;
+    int              next_job;
+    int              done_count;
+};
+
+static int decode_packet
+(
+    AVCodecContext *ctx,
+    AVPacket       *packet,
+    AVFrame        *frame
+)
+{
+    /* Use a shallow copy since the decoder might touch the packet. */
+    AVPacket pkt = *packet;
+    int got_frame = 0;
+    av_frame_unref( frame );
+    int consumed_bytes = avcodec_decode_audio4( ctx, frame, &got_frame, &pkt );
+    /* Let the caller decode the packet by itself if it is not simple. */
+    return consumed_bytes == packet->size && got_frame ? 0 : -1;
+}
+
+static void *decode_worker( void *arg )
+{
+    decode_worker_t        *worker = (decode_worker_t *)arg;
+    lw_audio_decode_pool_t *pool   = worker->pool;
+    uint32_t generation = 0;
+    lw_mutex_lock( &pool->mutex );
+    while( 1 )
+    {
+        while( !pool->quit && generation == pool->generation )
+            lw_cond_wait( &pool->worker_cond, &pool->mutex );
+        if( pool->quit )
+            break;
+        generation = pool->generation;
+        while( pool->next_job < pool->job_count )
+        {
+            int i = pool->next_job++;
+            lw_mutex_unlock( &pool->mutex );
+            int result = decode_packet( worker->ctx, &pool->packets[i], pool->frames[i] );
+            lw_mutex_lock( &pool->mutex );
+            pool->results[i] = result;
+            if( ++ pool->done_count == pool->job_count )
+                lw_cond_signal( &pool->caller_cond );
+        }
+    }
+    lw_mutex_unlock( &pool->mutex );
+    return NULL;
+}
+
+static void close_worker_decoders
+(
+    lw_audio_decode_pool_t *pool
+)
+{
+    for( int i = 0; i < pool->thread_count; i++ )
+    {
+        if( pool->workers[i].ctx )
+            avcodec_free_context( &pool->workers[i].ctx );
+    }
+}
+
+static int open_worker_decoders
+(
+    lw_audio_decode_pool_t *pool,
+    AVCodecContext         *config
+)
+{
+    close_worker_decoders( pool );
+    for( int i = 0; i < pool->thread_count; i++ )
+    {
+        AVCodecContext *ctx = avcodec_alloc_context3( NULL );
+        if( !ctx )
+            goto fail;
+        pool->workers[i].ctx = ctx;
+        if( avcodec_copy_context( ctx, config ) < 0 )
+            goto fail;
+        /* Each worker decodes in a single thread. The frames outlive the next decoding. */
+        ctx->thread_count      = 1;
+        ctx->refcounted_frames = 1;
+        ctx->get_buffer2       = avcodec_default_get_buffer2;
+        ctx->opaque            = NULL;
+        if( avcodec_open2( ctx, config->codec, NULL ) < 0 )
+            goto fail;
+    }
+    return 0;
+fail:
+    close_worker_decoders( pool );
+    return -1;
+}
+
+lw_audio_decode_pool_t *lw_audio_decode_pool_create
+(
+    int thread_count
+)
+{
+    if( thread_count <= 0 )
+        thread_count = lw_get_cpu_count();
+    lw_audio_decode_pool_t *pool = (lw_audio_decode_pool_t *)lw_malloc_zero( sizeof(lw_audio_decode_pool_t) );
+    if( !pool )
+        return NULL;
+    pool->thread_count = thread_count;
+    pool->config_id    = -1;
+    pool->workers      = (decode_worker_t *)lw_malloc_zero( thread_count * sizeof(decode_worker_t) );
+    if( !pool->workers )
+        goto fail_workers;
+    if( lw_mutex_init( &pool->mutex ) < 0 )
+        goto fail_mutex;
+    if( lw_cond_init( &pool->worker_cond ) < 0 )
+        goto fail_worker_cond;
+    if( lw_cond_init( &pool->caller_cond ) < 0 )
+        goto fail_caller_cond;
+    for( ; pool->started_count < thread_count; pool->started_count++ )
+    {
+        decode_worker_t *worker = &pool->workers[ pool->started_count ];
+        worker->pool = pool;
+        if( lw_thread_create( &worker->thread, decode_worker, worker ) < 0 )
+        {
+            lw_audio_decode_pool_destroy( pool );
+            return NULL;
+        }
+    }
+    return pool;
+fail_caller_cond:
+    lw_cond_destroy( &pool->worker_cond );
+fail_worker_cond:
+    lw_mutex_destroy( &pool->mutex );
+fail_mutex:
+    lw_free( pool->workers );
+fail_workers:
+    lw_free( pool );
+    return NULL;
+}
+
+void lw_audio_decode_pool_destroy
+(
+    lw_audio_decode_pool_t *pool
+)
+{
+    if( !pool )
+        return;
+    lw_mutex_lock( &pool->mutex );
+    pool->quit = 1;
+    lw_cond_broadcast( &pool->worker_cond );
+    lw_mutex_unlock( &pool->mutex );
+    for( int i = 0; i < pool->started_count; i++ )
+        lw_thread_join( pool->workers[i].thread );
+    close_worker_decoders( pool );
+    lw_cond_destroy( &pool->caller_cond );
+    lw_cond_destroy( &pool->worker_cond );
+    lw_mutex_destroy( &pool->mutex );
+    lw_free( pool->workers );
+    lw_free( pool );
+}
+
+int lw_audio_decode_pool_get_thread_count
+(
+    lw_audio_decode_pool_t *pool
+)
+{
+    return pool ? pool->thread_count : 0;
+}
+
+int lw_audio_decode_pool_run
+(
+    lw_audio_decode_pool_t *pool,
+    AVCodecContext         *config,
+    int                     config_id,
+    AVPacket               *packets,
+    AVFrame               **frames,
+    int                    *results,
+    int                     count
+)
+{
+    if( count <= 0 )
+        return 0;
+    if( config_id != pool->config_id )
+    {
+        /* The workers are idle here, so their decoders can be touched safely. */
+        pool->config_id = -1;
+        if( open_worker_decoders( pool, config ) < 0 )
+            return -1;
+        pool->config_id = config_id;
+    }
+    lw_mutex_lock( &pool->mutex );
+    pool->packets    = packets;
+    pool->frames     = frames;
+    pool->results    = results;
+    pool->job_count  = count;
+    pool->next_job   = 0;
+    pool->done_count = 0;
+    ++ pool->generation;
+    lw_cond_broadcast( &pool->worker_cond );
+    while( pool->done_count < pool->job_count )
+        lw_cond_wait( &pool->caller_cond, &pool->mutex );
+    pool->job_count = 0;
+    lw_mutex_unlock( &pool->mutex );
+    return 0;
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ * audio_decode_pool.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+/* A pool of worker threads decoding audio packets independently of each other.
+ * This is useful only for codecs whose every frame is decodable without any preceding frame. */
+typedef struct lw_audio_decode_pool_tag lw_audio_decode_pool_t;
+
+lw_audio_decode_pool_t *lw_audio_decode_pool_create
+(
+    int thread_count
+);
+
+void lw_audio_decode_pool_destroy
+(
+    lw_audio_decode_pool_t *pool
+);
+
+int lw_audio_decode_pool_get_thread_count
+(
+    lw_audio_decode_pool_t *pool
+);
+
+/* Decode 'packets[i]' into 'frames[i]' for each i in [0, 'count') in parallel.
+ * 'results[i]' is set to 0 if the packet is decoded into exactly one frame, otherwise a negative value.
+ * The decoders of the workers are copies of 'config' and are recreated when 'config_id' changes.
+ * Return 0 on success, a negative value if the decoders of the workers cannot be opened. */
+int lw_audio_decode_pool_run
+(
+    lw_audio_decode_pool_t *pool,
+    AVCodecContext         *config,
+    int                     config_id,
+    AVPacket               *packets,
+    AVFrame               **frames,
+    int                    *results,
+    int                     count
+);
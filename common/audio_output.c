@@ -22,6 +22,8 @@
 
 #include "cpp_compat.h"
 
+#include <string.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -36,6 +38,125 @@ extern "C"
 #include "audio_output.h"
 #include "resample.h"
 
+static uint8_t *get_resampled_buffer
+(
+    lw_audio_output_handler_t *aohp,
+    int                        size
+)
+{
+    if( !aohp->resampled_buffer || size > aohp->resampled_buffer_size )
+    {
+        uint8_t *temp = (uint8_t *)av_realloc( aohp->resampled_buffer, size );
+        if( !temp )
+            return NULL;
+        aohp->resampled_buffer_size = size;
+        aohp->resampled_buffer      = temp;
+    }
+    return aohp->resampled_buffer;
+}
+
+static int is_native_pcm
+(
+    enum AVCodecID      codec_id,
+    enum AVSampleFormat sample_format
+)
+{
+    /* The decoders of these codecs just copy packet payloads into frames.
+     * Assume little endianess here. */
+    switch( codec_id )
+    {
+        case AV_CODEC_ID_PCM_U8    : return sample_format == AV_SAMPLE_FMT_U8;
+        case AV_CODEC_ID_PCM_S16LE : return sample_format == AV_SAMPLE_FMT_S16;
+        case AV_CODEC_ID_PCM_S32LE : return sample_format == AV_SAMPLE_FMT_S32;
+        case AV_CODEC_ID_PCM_F32LE : return sample_format == AV_SAMPLE_FMT_FLT;
+        case AV_CODEC_ID_PCM_F64LE : return sample_format == AV_SAMPLE_FMT_DBL;
+        default                    : return 0;
+    }
+}
+
+static void setup_direct_conversion
+(
+    lw_audio_output_handler_t *aohp,
+    enum AVCodecID             codec_id
+)
+{
+    aohp->direct_output     = 0;
+    aohp->pcm_passthrough   = 0;
+    aohp->direct_interleave = NULL;
+    aohp->direct_pack       = NULL;
+    if( aohp->input_channel_layout != aohp->output_channel_layout
+     || aohp->input_sample_rate    != aohp->output_sample_rate )
+        return;
+    enum AVSampleFormat packed_format = av_get_packed_sample_fmt( aohp->input_sample_format );
+    lw_audio_pack_func_t pack;
+    if( packed_format == AV_SAMPLE_FMT_S32 && aohp->output_sample_format == AV_SAMPLE_FMT_S32 && aohp->s24_output )
+        pack = lw_get_audio_s32_to_s24_func();
+    else if( packed_format == AV_SAMPLE_FMT_FLT && aohp->output_sample_format == AV_SAMPLE_FMT_S16 )
+        pack = lw_get_audio_flt_to_s16_func();
+    else if( packed_format == aohp->output_sample_format )
+        pack = NULL;    /* Copy or interleave only. */
+    else
+        return;
+    lw_audio_interleave_func_t interleave = NULL;
+    if( av_sample_fmt_is_planar( aohp->input_sample_format ) )
+    {
+        interleave = lw_get_audio_interleave_func( av_get_bytes_per_sample( aohp->input_sample_format ),
+                                                   get_channel_layout_nb_channels( aohp->input_channel_layout ) );
+        if( !interleave )
+            return;
+    }
+    aohp->direct_output     = 1;
+    aohp->pcm_passthrough   = !interleave && !pack && is_native_pcm( codec_id, aohp->input_sample_format );
+    aohp->direct_interleave = interleave;
+    aohp->direct_pack       = pack;
+}
+
+static int convert_decoded_audio_samples
+(
+    lw_audio_output_handler_t *aohp,
+    uint8_t                  **in_data,
+    int                        input_sample_count,
+    int                        wanted_sample_count,
+    uint8_t                  **out_data
+)
+{
+    int channels = get_channel_layout_nb_channels( aohp->output_channel_layout );
+    int count    = input_sample_count < wanted_sample_count ? input_sample_count : wanted_sample_count;
+    if( count > 0 )
+    {
+        if( aohp->direct_interleave && aohp->direct_pack )
+        {
+            int sample_size = av_get_bytes_per_sample( aohp->input_sample_format );
+            uint8_t *interleaved = get_resampled_buffer( aohp, count * channels * sample_size );
+            if( !interleaved )
+                return 0;
+            aohp->direct_interleave( interleaved, in_data, channels, count );
+            aohp->direct_pack( *out_data, interleaved, count * channels );
+        }
+        else if( aohp->direct_interleave )
+            aohp->direct_interleave( *out_data, in_data, channels, count );
+        else if( aohp->direct_pack )
+            aohp->direct_pack( *out_data, in_data[0], count * channels );
+        else
+            /* The decoded samples are already in the output format. */
+            memcpy( *out_data, in_data[0], count * aohp->output_block_align );
+        *out_data += count * aohp->output_block_align;
+    }
+    if( input_sample_count > count )
+    {
+        /* Keep the rest in the resampler's FIFO buffer. It is output at the next request. */
+        uint8_t *rest_data[AVRESAMPLE_MAX_CHANNELS];
+        int rest_offset = count * aohp->input_block_align;
+        for( int i = 0; i < aohp->input_planes; i++ )
+            rest_data[i] = in_data[i] + rest_offset;
+        int rest_count = input_sample_count - count;
+        if( avresample_convert( aohp->avr_ctx, NULL, 0, 0,
+                                rest_data, get_linesize( channels, rest_count, aohp->input_sample_format ), rest_count ) < 0 )
+            return 0;
+    }
+    return count;
+}
+
 static int consume_decoded_audio_samples
 (
     lw_audio_output_handler_t *aohp,
@@ -51,6 +172,10 @@ static int consume_decoded_audio_samples
     int decoded_data_offset = sample_offset * aohp->input_block_align;
     for( int i = 0; i < aohp->input_planes; i++ )
         in_data[i] = frame->extended_data[i] + decoded_data_offset;
+    if( aohp->direct_output
+     && avresample_available( aohp->avr_ctx ) == 0 )
+        /* Nothing is left in the resampler, so bypass it. */
+        return convert_decoded_audio_samples( aohp, in_data, input_sample_count, wanted_sample_count, out_data );
     audio_samples_t in;
     in.channel_layout = frame->channel_layout;
     in.sample_count   = input_sample_count;
@@ -62,15 +187,9 @@ static int consume_decoded_audio_samples
     {
         int out_channels = get_channel_layout_nb_channels( aohp->output_channel_layout );
         int out_linesize = get_linesize( out_channels, wanted_sample_count, aohp->output_sample_format );
-        if( !aohp->resampled_buffer || out_linesize > aohp->resampled_buffer_size )
-        {
-            uint8_t *temp = (uint8_t *)av_realloc( aohp->resampled_buffer, out_linesize );
-            if( !temp )
-                return 0;
-            aohp->resampled_buffer_size = out_linesize;
-            aohp->resampled_buffer      = temp;
-        }
-        resampled_buffer = aohp->resampled_buffer;
+        resampled_buffer = get_resampled_buffer( aohp, out_linesize );
+        if( !resampled_buffer )
+            return 0;
     }
     audio_samples_t out;
     out.channel_layout = aohp->output_channel_layout;
@@ -84,6 +203,45 @@ static int consume_decoded_audio_samples
     return resampled_size > 0 ? resampled_size / aohp->output_block_align : 0;
 }
 
+static int decode_audio_packet
+(
+    lw_audio_output_handler_t *aohp,
+    AVCodecContext            *ctx,
+    AVFrame                   *frame,
+    int                       *got_frame,
+    AVPacket                  *pkt
+)
+{
+    if( !aohp->pcm_passthrough
+     || !pkt->data
+     || pkt->size <= 0
+     || pkt->size % aohp->input_block_align )
+        return avcodec_decode_audio4( ctx, frame, got_frame, pkt );
+    /* Let the frame refer to the packet payload instead of decoding it.
+     * The samples left in the frame are output after the packet is freed or reused,
+     * so the frame holds a reference to the payload, or a copy of it if the packet is not reference-counted. */
+    av_frame_unref( frame );
+    if( pkt->buf )
+        frame->buf[0] = av_buffer_ref( pkt->buf );
+    else
+    {
+        frame->buf[0] = av_buffer_alloc( pkt->size );
+        if( frame->buf[0] )
+            memcpy( frame->buf[0]->data, pkt->data, pkt->size );
+    }
+    if( !frame->buf[0] )
+        return AVERROR( ENOMEM );
+    frame->data[0]        = pkt->buf ? pkt->data : frame->buf[0]->data;
+    frame->linesize[0]    = pkt->size;
+    frame->extended_data  = frame->data;
+    frame->nb_samples     = pkt->size / aohp->input_block_align;
+    frame->format         = aohp->input_sample_format;
+    frame->channel_layout = aohp->input_channel_layout;
+    frame->sample_rate    = aohp->input_sample_rate;
+    *got_frame = 1;
+    return pkt->size;
+}
+
 uint64_t output_pcm_samples_from_buffer
 (
     lw_audio_output_handler_t *aohp,
@@ -108,6 +266,64 @@ uint64_t output_pcm_samples_from_buffer
     return output_length;
 }
 
+static uint64_t output_decoded_audio_frame
+(
+    lw_audio_output_handler_t *aohp,
+    AVCodecContext            *ctx,
+    AVFrame                   *frame_buffer,
+    uint8_t                  **output_buffer,
+    enum audio_output_flag    *output_flags
+)
+{
+    /* Check channel layout, sample rate and sample format of decoded audio samples. */
+    if( frame_buffer->channel_layout == 0 )
+        frame_buffer->channel_layout = av_get_default_channel_layout( ctx->channels );
+    enum AVSampleFormat input_sample_format = (enum AVSampleFormat)frame_buffer->format;
+    if( aohp->input_channel_layout != frame_buffer->channel_layout
+     || aohp->input_sample_rate    != frame_buffer->sample_rate
+     || aohp->input_sample_format  != input_sample_format )
+    {
+        /* Detected a change of channel layout, sample rate or sample format.
+         * Reconfigure audio resampler. */
+        if( update_resampler_configuration( aohp->avr_ctx,
+                                            aohp->output_channel_layout,
+                                            aohp->output_sample_rate,
+                                            aohp->output_sample_format,
+                                            frame_buffer->channel_layout,
+                                            frame_buffer->sample_rate,
+                                            input_sample_format,
+                                            &aohp->input_planes,
+                                            &aohp->input_block_align ) < 0 )
+        {
+            *output_flags |= AUDIO_RECONFIG_FAILURE;
+            return 0;
+        }
+        aohp->input_channel_layout = frame_buffer->channel_layout;
+        aohp->input_sample_rate    = frame_buffer->sample_rate;
+        aohp->input_sample_format  = input_sample_format;
+        setup_direct_conversion( aohp, ctx->codec_id );
+    }
+    /* Process decoded audio samples. */
+    uint64_t output_length  = 0;
+    int      decoded_length = frame_buffer->nb_samples;
+    if( decoded_length > aohp->output_sample_offset )
+    {
+        /* Send decoded audio data to resampler and get desired resampled audio as you want as much as possible. */
+        int useful_length = (int)(decoded_length - aohp->output_sample_offset);
+        int resampled_length = consume_decoded_audio_samples( aohp, frame_buffer,
+                                                              useful_length, (int)aohp->request_length,
+                                                              output_buffer, (int)aohp->output_sample_offset );
+        output_length        += resampled_length;
+        aohp->request_length -= resampled_length;
+        aohp->output_sample_offset = 0;
+        if( aohp->request_length <= 0 )
+            *output_flags |= AUDIO_OUTPUT_ENOUGH;
+    }
+    else
+        aohp->output_sample_offset -= decoded_length;
+    return output_length;
+}
+
 uint64_t output_pcm_samples_from_packet
 (
     lw_audio_output_handler_t *aohp,
@@ -123,7 +339,7 @@ uint64_t output_pcm_samples_from_packet
     do
     {
         int decode_complete;
-        int consumed_data_length = avcodec_decode_audio4( ctx, frame_buffer, &decode_complete, pkt );
+        int consumed_data_length = decode_audio_packet( aohp, ctx, frame_buffer, &decode_complete, pkt );
         if( consumed_data_length < 0 )
         {
             /* Force to request the next sample. */
@@ -147,53 +363,9 @@ uint64_t output_pcm_samples_from_packet
          && frame_buffer->extended_data
          && frame_buffer->extended_data[0] )
         {
-            /* Check channel layout, sample rate and sample format of decoded audio samples. */
-            if( frame_buffer->channel_layout == 0 )
-                frame_buffer->channel_layout = av_get_default_channel_layout( ctx->channels );
-            enum AVSampleFormat input_sample_format = (enum AVSampleFormat)frame_buffer->format;
-            if( aohp->input_channel_layout != frame_buffer->channel_layout
-             || aohp->input_sample_rate    != frame_buffer->sample_rate
-             || aohp->input_sample_format  != input_sample_format )
-            {
-                /* Detected a change of channel layout, sample rate or sample format.
-                 * Reconfigure audio resampler. */
-                if( update_resampler_configuration( aohp->avr_ctx,
-                                                    aohp->output_channel_layout,
-                                                    aohp->output_sample_rate,
-                                                    aohp->output_sample_format,
-                                                    frame_buffer->channel_layout,
-                                                    frame_buffer->sample_rate,
-                                                    input_sample_format,
-                                                    &aohp->input_planes,
-                                                    &aohp->input_block_align ) < 0 )
-                {
-                    *output_flags |= AUDIO_RECONFIG_FAILURE;
-                    break;
-                }
-                aohp->input_channel_layout = frame_buffer->channel_layout;
-                aohp->input_sample_rate    = frame_buffer->sample_rate;
-                aohp->input_sample_format  = input_sample_format;
-            }
-            /* Process decoded audio samples. */
-            int decoded_length = frame_buffer->nb_samples;
-            if( decoded_length > aohp->output_sample_offset )
-            {
-                /* Send decoded audio data to resampler and get desired resampled audio as you want as much as possible. */
-                int useful_length = (int)(decoded_length - aohp->output_sample_offset);
-                int resampled_length = consume_decoded_audio_samples( aohp, frame_buffer,
-                                                                      useful_length, (int)aohp->request_length,
-                                                                      output_buffer, (int)aohp->output_sample_offset );
-                output_length        += resampled_length;
-                aohp->request_length -= resampled_length;
-                aohp->output_sample_offset = 0;
-                if( aohp->request_length <= 0 )
-                {
-                    *output_flags |= AUDIO_OUTPUT_ENOUGH;
-                    break;
-                }
-            }
-            else
-                aohp->output_sample_offset -= decoded_length;
+            output_length += output_decoded_audio_frame( aohp, ctx, frame_buffer, output_buffer, output_flags );
+            if( *output_flags & (AUDIO_OUTPUT_ENOUGH | AUDIO_RECONFIG_FAILURE) )
+                break;
         }
     } while( pkt->size > 0 );
     if( !output_audio && pkt->data )
@@ -202,6 +374,21 @@ uint64_t output_pcm_samples_from_packet
     return output_length;
 }
 
+uint64_t output_pcm_samples_from_frame
+(
+    lw_audio_output_handler_t *aohp,
+    AVCodecContext            *ctx,
+    AVFrame                   *frame_buffer,
+    uint8_t                  **output_buffer,
+    enum audio_output_flag    *output_flags
+)
+{
+    if( !frame_buffer->extended_data
+     || !frame_buffer->extended_data[0] )
+        return 0;
+    return output_decoded_audio_frame( aohp, ctx, frame_buffer, output_buffer, output_flags );
+}
+
 void lw_cleanup_audio_output_handler
 (
     lw_audio_output_handler_t *aohp
@@ -21,6 +21,7 @@
 /* This file is available under an ISC license. */
 
 #include "cpp_compat.h"
+#include "audio_convert.h"
 
 typedef struct
 {
@@ -41,6 +42,11 @@ typedef struct
     uint64_t                request_length;
     uint64_t                skip_decoded_samples;   /* Upsampling by the decoder is considered. */
     uint64_t                output_sample_offset;
+    /* Conversions done without the resampler when only the sample layout or format differs. */
+    int                        direct_output;
+    int                        pcm_passthrough;     /* Packet payloads are output without decoding. */
+    lw_audio_interleave_func_t direct_interleave;
+    lw_audio_pack_func_t       direct_pack;
 } lw_audio_output_handler_t;
 
 enum audio_output_flag
@@ -71,6 +77,16 @@ uint64_t output_pcm_samples_from_packet
     enum audio_output_flag    *output_flags
 );
 
+/* Output audio samples already decoded into 'frame_buffer', e.g. by another decoder instance. */
+uint64_t output_pcm_samples_from_frame
+(
+    lw_audio_output_handler_t *aohp,
+    AVCodecContext            *ctx,
+    AVFrame                   *frame_buffer,
+    uint8_t                  **output_buffer,
+    enum audio_output_flag    *output_flags
+);
+
 void lw_cleanup_audio_output_handler
 (
     lw_audio_output_handler_t *aohp
@@ -0,0 +1,333 @@
+/*****************************************************************************
+ * audio_prefetch.c / audio_prefetch.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "utils.h"
+#include "lwthread.h"
+#include "audio_prefetch.h"
+
+#define MAX_DEFERRED_LOG_COUNT 8     /* arbitrary */
+
+typedef struct
+{
+    lw_log_level level;
+    char         message[512];
+} deferred_log_t;
+
+/* The ring buffer is a single-producer/single-consumer queue.
+ * The worker is the only writer of 'write_count' and the caller is the only writer of 'read_count',
+ * so transferring samples needs no lock. The mutex is used only for sleeping and reseeding. */
+struct lw_audio_prefetcher_tag
+{
+    lw_audio_fetch_func_t fetch;
+    void                 *priv;
+    uint8_t              *ring;
+    int                   block_align;
+    uint32_t              chunk_length;     /* in units of samples */
+    uint32_t              capacity;         /* in units of samples; power of 2 */
+    /* lock-free */
+    volatile uint32_t     write_count;      /* the number of samples produced since the last reseed */
+    volatile uint32_t     read_count;       /* the number of samples consumed since the last reseed */
+    volatile uint32_t     worker_sleeping;
+    /* protected by the mutex */
+    lw_thread_t           thread;
+    lw_mutex_t            mutex;
+    lw_cond_t             worker_cond;
+    lw_cond_t             caller_cond;
+    int                   quit;
+    int                   cancel;
+    int                   seeded;
+    int                   busy;
+    int                   end_of_stream;
+    int64_t               fetch_start;
+    deferred_log_t        deferred_logs[MAX_DEFERRED_LOG_COUNT];
+    int                   deferred_log_count;
+    uint32_t              dropped_log_count;    /* the number of the logs not kept due to no room */
+    /* owned by the caller */
+    int                   valid;
+    int64_t               next_sample;
+};
+
+static inline uint32_t round_up_to_power_of_2( uint32_t x )
+{
+    uint32_t y = 1;
+    while( y < x )
+        y <<= 1;
+    return y;
+}
+
+static inline int worker_can_produce( lw_audio_prefetcher_t *app )
+{
+    uint32_t filled = lw_atomic_load( &app->write_count ) - lw_atomic_load( &app->read_count );
+    return !app->cancel
+        && app->seeded
+        && !app->end_of_stream
+        && app->capacity - filled >= app->chunk_length;
+}
+
+static void *prefetch_worker( void *arg )
+{
+    lw_audio_prefetcher_t *app = (lw_audio_prefetcher_t *)arg;
+    lw_mutex_lock( &app->mutex );
+    while( !app->quit )
+    {
+        if( !worker_can_produce( app ) )
+        {
+            app->busy = 0;
+            lw_cond_broadcast( &app->caller_cond );
+            /* Check the free space again after announcing sleep
+             * since the caller doesn't take the lock unless the worker is sleeping. */
+            lw_atomic_store( &app->worker_sleeping, 1 );
+            if( !app->quit && !worker_can_produce( app ) )
+                lw_cond_wait( &app->worker_cond, &app->mutex );
+            lw_atomic_store( &app->worker_sleeping, 0 );
+            continue;
+        }
+        app->busy = 1;
+        int64_t  start = app->fetch_start;
+        uint8_t *dst   = app->ring + (size_t)(app->write_count & (app->capacity - 1)) * app->block_align;
+        lw_mutex_unlock( &app->mutex );
+        uint64_t fetched = app->fetch( app->priv, dst, start, app->chunk_length );
+        lw_mutex_lock( &app->mutex );
+        app->busy = 0;
+        if( app->cancel )
+            /* Discard the fetched samples. The caller is waiting for the worker idling. */
+            continue;
+        app->fetch_start += fetched;
+        lw_atomic_add( &app->write_count, (uint32_t)fetched );
+        if( fetched < app->chunk_length )
+            app->end_of_stream = 1;
+        lw_cond_broadcast( &app->caller_cond );
+    }
+    app->busy = 0;
+    lw_cond_broadcast( &app->caller_cond );
+    lw_mutex_unlock( &app->mutex );
+    return NULL;
+}
+
+lw_audio_prefetcher_t *lw_audio_prefetcher_create
+(
+    lw_audio_fetch_func_t fetch,
+    void                 *priv,
+    int                   block_align,
+    uint32_t              chunk_length,
+    uint32_t              chunk_count
+)
+{
+    if( !fetch || block_align <= 0 || chunk_length == 0 || chunk_count < 2 )
+        return NULL;
+    lw_audio_prefetcher_t *app = (lw_audio_prefetcher_t *)lw_malloc_zero( sizeof(lw_audio_prefetcher_t) );
+    if( !app )
+        return NULL;
+    app->fetch        = fetch;
+    app->priv         = priv;
+    app->block_align  = block_align;
+    app->chunk_length = round_up_to_power_of_2( chunk_length );
+    app->capacity     = app->chunk_length * round_up_to_power_of_2( chunk_count );
+    app->ring         = (uint8_t *)lw_malloc_zero( (size_t)app->capacity * block_align );
+    if( !app->ring )
+        goto fail_ring;
+    if( lw_mutex_init( &app->mutex ) < 0 )
+        goto fail_mutex;
+    if( lw_cond_init( &app->worker_cond ) < 0 )
+        goto fail_worker_cond;
+    if( lw_cond_init( &app->caller_cond ) < 0 )
+        goto fail_caller_cond;
+    if( lw_thread_create( &app->thread, prefetch_worker, app ) < 0 )
+        goto fail_thread;
+    return app;
+fail_thread:
+    lw_cond_destroy( &app->caller_cond );
+fail_caller_cond:
+    lw_cond_destroy( &app->worker_cond );
+fail_worker_cond:
+    lw_mutex_destroy( &app->mutex );
+fail_mutex:
+    lw_free( app->ring );
+fail_ring:
+    lw_free( app );
+    return NULL;
+}
+
+void lw_audio_prefetcher_destroy
+(
+    lw_audio_prefetcher_t *app
+)
+{
+    if( !app )
+        return;
+    lw_mutex_lock( &app->mutex );
+    app->quit = 1;
+    lw_cond_signal( &app->worker_cond );
+    lw_mutex_unlock( &app->mutex );
+    lw_thread_join( app->thread );
+    lw_cond_destroy( &app->caller_cond );
+    lw_cond_destroy( &app->worker_cond );
+    lw_mutex_destroy( &app->mutex );
+    lw_free( app->ring );
+    lw_free( app );
+}
+
+void lw_audio_prefetcher_invalidate
+(
+    lw_audio_prefetcher_t *app,
+    lw_audio_reset_func_t  reset
+)
+{
+    lw_mutex_lock( &app->mutex );
+    /* Cancel the ongoing fetch and keep the worker idle until the next reseed. */
+    app->cancel = 1;
+    lw_cond_signal( &app->worker_cond );
+    while( app->busy )
+        lw_cond_wait( &app->caller_cond, &app->mutex );
+    app->seeded = 0;
+    app->cancel = 0;
+    if( reset )
+        reset( app->priv );
+    lw_mutex_unlock( &app->mutex );
+    app->valid = 0;
+}
+
+static void reseed_worker
+(
+    lw_audio_prefetcher_t *app,
+    int64_t                start
+)
+{
+    lw_mutex_lock( &app->mutex );
+    /* Cancel the ongoing fetch and wait for the worker idling. */
+    app->cancel = 1;
+    lw_cond_signal( &app->worker_cond );
+    while( app->busy )
+        lw_cond_wait( &app->caller_cond, &app->mutex );
+    lw_atomic_store( &app->write_count, 0 );
+    lw_atomic_store( &app->read_count,  0 );
+    app->fetch_start   = start;
+    app->end_of_stream = 0;
+    app->seeded        = 1;
+    app->cancel        = 0;
+    lw_cond_signal( &app->worker_cond );
+    lw_mutex_unlock( &app->mutex );
+    app->valid       = 1;
+    app->next_sample = start;
+}
+
+uint64_t lw_audio_prefetcher_read
+(
+    lw_audio_prefetcher_t *app,
+    void                  *buf,
+    int64_t                start,
+    int64_t                wanted_length
+)
+{
+    if( !app->valid || start != app->next_sample )
+        reseed_worker( app, start );
+    uint8_t *out           = (uint8_t *)buf;
+    uint64_t output_length = 0;
+    while( output_length < (uint64_t)wanted_length )
+    {
+        uint32_t read_count = app->read_count;
+        uint32_t available  = lw_atomic_load( &app->write_count ) - read_count;
+        if( available == 0 )
+        {
+            lw_mutex_lock( &app->mutex );
+            while( lw_atomic_load( &app->write_count ) == read_count && !app->end_of_stream )
+                lw_cond_wait( &app->caller_cond, &app->mutex );
+            int end_of_stream = lw_atomic_load( &app->write_count ) == read_count;
+            lw_mutex_unlock( &app->mutex );
+            if( end_of_stream )
+                break;
+            continue;
+        }
+        uint32_t length = (uint32_t)MIN( (uint64_t)available, (uint64_t)wanted_length - output_length );
+        uint32_t offset = read_count & (app->capacity - 1);
+        uint32_t first  = MIN( length, app->capacity - offset );
+        memcpy( out, app->ring + (size_t)offset * app->block_align, (size_t)first * app->block_align );
+        if( first < length )
+            memcpy( out + (size_t)first * app->block_align, app->ring, (size_t)(length - first) * app->block_align );
+        out           += (size_t)length * app->block_align;
+        output_length += length;
+        lw_atomic_store( &app->read_count, read_count + length );
+        if( lw_atomic_load( &app->worker_sleeping ) )
+        {
+            lw_mutex_lock( &app->mutex );
+            lw_cond_signal( &app->worker_cond );
+            lw_mutex_unlock( &app->mutex );
+        }
+    }
+    app->next_sample = start + output_length;
+    return output_length;
+}
+
+void lw_audio_prefetcher_defer_log
+(
+    lw_audio_prefetcher_t *app,
+    lw_log_level           level,
+    const char            *message
+)
+{
+    lw_mutex_lock( &app->mutex );
+    if( app->deferred_log_count < MAX_DEFERRED_LOG_COUNT )
+    {
+        deferred_log_t *log = &app->deferred_logs[ app->deferred_log_count ++ ];
+        log->level = level;
+        strncpy( log->message, message, sizeof(log->message) - 1 );
+        log->message[ sizeof(log->message) - 1 ] = '\0';
+    }
+    else
+        ++ app->dropped_log_count;
+    lw_mutex_unlock( &app->mutex );
+}
+
+void lw_audio_prefetcher_show_deferred_logs
+(
+    lw_audio_prefetcher_t *app,
+    lw_log_handler_t      *lhp
+)
+{
+    if( !app->deferred_log_count && !app->dropped_log_count )
+        /* A racy check just to avoid locking in the common case. A log kept now is shown at the next call. */
+        return;
+    /* Take the logs out before showing them since showing might not return. */
+    deferred_log_t logs[MAX_DEFERRED_LOG_COUNT];
+    lw_mutex_lock( &app->mutex );
+    int      count   = app->deferred_log_count;
+    uint32_t dropped = app->dropped_log_count;
+    memcpy( logs, app->deferred_logs, count * sizeof(deferred_log_t) );
+    app->deferred_log_count = 0;
+    app->dropped_log_count  = 0;
+    lw_mutex_unlock( &app->mutex );
+    if( !lhp->show_log )
+        return;
+    for( int i = 0; i < count; i++ )
+        if( logs[i].level >= lhp->level )
+            lhp->show_log( lhp, logs[i].level, logs[i].message );
+    if( dropped && LW_LOG_WARNING >= lhp->level )
+    {
+        char message[64];
+        sprintf( message, "%"PRIu32" more message(s) of decoding ahead were dropped.", dropped );
+        lhp->show_log( lhp, LW_LOG_WARNING, message );
+    }
+}
@@ -0,0 +1,85 @@
+/*****************************************************************************
+ * audio_prefetch.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+/* The decode-ahead worker calls this function on its own thread.
+ * It shall write PCM samples from 'start' into 'buf' and return the number of written samples.
+ * Returning less than 'wanted_length' is treated as the end of the stream. */
+typedef uint64_t (*lw_audio_fetch_func_t)
+(
+    void    *priv,
+    void    *buf,
+    int64_t  start,
+    int64_t  wanted_length
+);
+
+/* The caller thread calls this function under the lock of the prefetcher while the worker is idle.
+ * It shall reset the decoder state the fetch function relies on. */
+typedef void (*lw_audio_reset_func_t)
+(
+    void *priv
+);
+
+typedef struct lw_audio_prefetcher_tag lw_audio_prefetcher_t;
+
+lw_audio_prefetcher_t *lw_audio_prefetcher_create
+(
+    lw_audio_fetch_func_t fetch,
+    void                 *priv,
+    int                   block_align,
+    uint32_t              chunk_length,     /* the number of samples fetched at a time */
+    uint32_t              chunk_count       /* the number of chunks the ring buffer can hold */
+);
+
+void lw_audio_prefetcher_destroy
+(
+    lw_audio_prefetcher_t *app
+);
+
+/* Make the next reading reseed the worker even if the reading is contiguous.
+ * 'reset' may be NULL. */
+void lw_audio_prefetcher_invalidate
+(
+    lw_audio_prefetcher_t *app,
+    lw_audio_reset_func_t  reset
+);
+
+uint64_t lw_audio_prefetcher_read
+(
+    lw_audio_prefetcher_t *app,
+    void                  *buf,
+    int64_t                start,
+    int64_t                wanted_length
+);
+
+/* Keep a log of the fetch function on the worker thread to show it on the caller thread later
+ * since showing a log might throw an exception or touch the host. */
+void lw_audio_prefetcher_defer_log
+(
+    lw_audio_prefetcher_t *app,
+    lw_log_level           level,
+    const char            *message
+);
+
+/* Show the logs kept since the last call through 'lhp' on the caller thread. */
+void lw_audio_prefetcher_show_deferred_logs
+(
+    lw_audio_prefetcher_t *app,
+    lw_log_handler_t      *lhp
+);
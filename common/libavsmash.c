@@ -22,8 +22,11 @@
 
 #include "cpp_compat.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -38,6 +41,8 @@ extern "C"
 #endif  /* __cplusplus */
 
 #include "utils.h"
+#include "lwthread.h"
+#include "read_ahead.h"
 #include "libavsmash.h"
 #include "qsv.h"
 
@@ -77,66 +82,414 @@ static int open_decoder
     return ret;
 }
 
-lsmash_root_t *libavsmash_open_file
+typedef struct
+{
+    uint64_t device;
+    uint64_t serial_number;     /* unavailable on Windows */
+    uint64_t size;
+    int64_t  modification_time;
+} file_identity_t;
+
+/* A per-sample timeline cache of a track, shared read-only by all the sources of the track in the same ROOT. */
+typedef struct shared_timeline_tag shared_timeline_t;
+struct shared_timeline_tag
+{
+    shared_timeline_t  *next;
+    uint32_t            track_ID;
+    uint32_t            sample_count;
+    timeline_sample_t  *timeline;
+};
+
+/* A ROOT opened by libavsmash_open_file(). */
+struct shared_root_tag
+{
+    shared_root_t           *next;
+    char                    *file_name;
+    file_identity_t          identity;
+    int                      shareable;         /* 0 if the file is not identified, failed to be opened or the boxes are discarded */
+    int                      opened;            /* whether the file is read; the others wait for it under 'lock' */
+    uint32_t                 ref_count;
+    uint32_t                 box_user_count;    /* the number of the sources which may still need the boxes */
+    lsmash_root_t           *root;
+    lsmash_file_parameters_t file_param;
+    shared_timeline_t       *timelines;
+    uint32_t                 track_count;
+    uint8_t                 *constructed;       /* whether the timeline of each track is constructed, indexed by the track number - 1 */
+    lw_mutex_t               lock;
+};
+
+/* 'shared_roots_lock' protects the list and the reference counts, and 'lock' of each ROOT protects the rest of it.
+ * The latter is never taken while holding the former, so reading a file blocks only the sources of the same file. */
+static lw_static_mutex_t shared_roots_lock = LW_STATIC_MUTEX_INITIALIZER;
+static shared_root_t    *shared_roots      = NULL;
+
+static int identify_file
 (
-    AVFormatContext          **p_format_ctx,
-    const char                *file_name,
-    lsmash_file_parameters_t  *file_param,
-    lsmash_movie_parameters_t *movie_param,
-    lw_log_handler_t          *lhp
+    const char      *file_name,
+    file_identity_t *identity
 )
 {
-    /* L-SMASH */
-    lsmash_root_t *root = lsmash_create_root();
-    if( !root )
+#ifdef _WIN32
+    struct _stat64 st;
+    if( _stat64( file_name, &st ) )
+        return -1;
+#else
+    struct stat st;
+    if( stat( file_name, &st ) )
+        return -1;
+#endif
+    identity->device            = (uint64_t)st.st_dev;
+    identity->serial_number     = (uint64_t)st.st_ino;
+    identity->size              = (uint64_t)st.st_size;
+    identity->modification_time = (int64_t)st.st_mtime;
+    return 0;
+}
+
+static int is_same_file
+(
+    shared_root_t   *shared,
+    const char      *file_name,
+    file_identity_t *identity
+)
+{
+    return shared->identity.device            == identity->device
+        && shared->identity.serial_number     == identity->serial_number
+        && shared->identity.size              == identity->size
+        && shared->identity.modification_time == identity->modification_time
+        && !strcmp( shared->file_name, file_name );
+}
+
+/* Note: the caller shall hold 'shared_roots_lock'. */
+static shared_root_t *find_shared_root
+(
+    lsmash_root_t *root
+)
+{
+    shared_root_t *shared;
+    for( shared = shared_roots; shared && shared->root != root; shared = shared->next );
+    return shared;
+}
+
+static shared_root_t *get_shared_root
+(
+    lsmash_root_t *root
+)
+{
+    lw_static_mutex_lock( &shared_roots_lock );
+    shared_root_t *shared = find_shared_root( root );
+    lw_static_mutex_unlock( &shared_roots_lock );
+    return shared;
+}
+
+static void close_shared_root
+(
+    shared_root_t *shared
+)
+{
+    while( shared->timelines )
+    {
+        shared_timeline_t *next = shared->timelines->next;
+        lw_free( shared->timelines->timeline );
+        lw_free( shared->timelines );
+        shared->timelines = next;
+    }
+    if( shared->root )
+    {
+        lsmash_close_file( &shared->file_param );
+        lsmash_destroy_root( shared->root );
+    }
+    lw_mutex_destroy( &shared->lock );
+    lw_free( shared->constructed );
+    lw_free( shared->file_name );
+    lw_free( shared );
+}
+
+/* Allocate a ROOT to be read by read_shared_root().
+ * The errors are not shown here but copied into 'error_string' since showing a log might not return. */
+static shared_root_t *create_shared_root
+(
+    const char *file_name,
+    char       *error_string
+)
+{
+    size_t file_name_length = strlen( file_name );
+    shared_root_t *shared = (shared_root_t *)lw_malloc_zero( sizeof(shared_root_t) );
+    if( !shared )
+    {
+        strcpy( error_string, "Failed to allocate memory for a ROOT.\n" );
         return NULL;
-    char error_string[96] = { 0 };
-    if( lsmash_open_file( file_name, 1, file_param ) < 0 )
+    }
+    if( lw_mutex_init( &shared->lock ) < 0 )
+    {
+        lw_free( shared );
+        strcpy( error_string, "Failed to initialize a mutex.\n" );
+        return NULL;
+    }
+    shared->file_name = (char *)lw_malloc_zero( file_name_length + 1 );
+    shared->root      = lsmash_create_root();
+    if( !shared->file_name || !shared->root )
+    {
+        close_shared_root( shared );
+        strcpy( error_string, "Failed to create a ROOT.\n" );
+        return NULL;
+    }
+    memcpy( shared->file_name, file_name, file_name_length );
+    shared->ref_count      = 1;
+    shared->box_user_count = 1;
+    return shared;
+}
+
+/* Note: the caller shall hold 'lock' of the ROOT but not 'shared_roots_lock'.
+ * Like create_shared_root(), the errors are copied into 'error_string'. */
+static int read_shared_root
+(
+    shared_root_t *shared,
+    char          *error_string
+)
+{
+    lsmash_file_t            *fh;
+    lsmash_movie_parameters_t movie_param;
+    if( lsmash_open_file( shared->file_name, 1, &shared->file_param ) < 0 )
     {
         strcpy( error_string, "Failed to open an input file.\n" );
         goto open_fail;
     }
-    lsmash_file_t *fh = lsmash_set_file( root, file_param );
+    fh = lsmash_set_file( shared->root, &shared->file_param );
     if( !fh )
     {
         strcpy( error_string, "Failed to add an input file into a ROOT.\n" );
         goto open_fail;
     }
-    if( lsmash_read_file( fh, file_param ) < 0 )
+    if( lsmash_read_file( fh, &shared->file_param ) < 0 )
     {
         strcpy( error_string, "Failed to read an input file\n" );
         goto open_fail;
     }
-    lsmash_initialize_movie_parameters( movie_param );
-    lsmash_get_movie_parameters( root, movie_param );
-    if( movie_param->number_of_tracks == 0 )
+    lsmash_initialize_movie_parameters( &movie_param );
+    lsmash_get_movie_parameters( shared->root, &movie_param );
+    if( movie_param.number_of_tracks == 0 )
     {
         strcpy( error_string, "The number of tracks equals 0.\n" );
         goto open_fail;
     }
-    /* libavformat */
+    shared->constructed = (uint8_t *)lw_malloc_zero( movie_param.number_of_tracks );
+    if( !shared->constructed )
+    {
+        strcpy( error_string, "Failed to allocate memory for the track states.\n" );
+        goto open_fail;
+    }
+    shared->track_count = movie_param.number_of_tracks;
+    /* libavformat is opened later only if needed. See setup_codec_context(). */
     av_register_all();
     avcodec_register_all();
-    if( avformat_open_input( p_format_ctx, file_name, NULL, NULL ) )
+    shared->opened = 1;
+    return 0;
+open_fail:
+    return -1;
+}
+
+/* Drop a reference to the ROOT and close it if it was the last one. */
+static void unref_shared_root
+(
+    shared_root_t *shared
+)
+{
+    lw_static_mutex_lock( &shared_roots_lock );
+    int last = (-- shared->ref_count == 0);
+    if( last )
     {
-        strcpy( error_string, "Failed to avformat_open_input.\n" );
-        goto open_fail;
+        shared_root_t **p;
+        for( p = &shared_roots; *p && *p != shared; p = &(*p)->next );
+        if( *p )
+            *p = shared->next;
     }
-    if( avformat_find_stream_info( *p_format_ctx, NULL ) < 0 )
+    lw_static_mutex_unlock( &shared_roots_lock );
+    if( last )
+        close_shared_root( shared );
+}
+
+lsmash_root_t *libavsmash_open_file
+(
+    const char                *file_name,
+    lsmash_movie_parameters_t *movie_param,
+    lw_log_handler_t          *lhp
+)
+{
+    char            error_string[96] = { 0 };
+    /* A file which cannot be identified is never shared. */
+    file_identity_t identity         = { 0 };
+    int             identified       = (identify_file( file_name, &identity ) == 0);
+    shared_root_t  *shared;
+    while( 1 )
     {
-        strcpy( error_string, "Failed to avformat_find_stream_info.\n" );
-        goto open_fail;
+        lw_static_mutex_lock( &shared_roots_lock );
+        for( shared = shared_roots; shared; shared = shared->next )
+            if( identified && shared->shareable && is_same_file( shared, file_name, &identity ) )
+                break;
+        if( shared )
+        {
+            ++ shared->ref_count;
+            ++ shared->box_user_count;
+            lw_static_mutex_unlock( &shared_roots_lock );
+            /* Wait for the source reading the file if any. */
+            lw_mutex_lock( &shared->lock );
+            if( shared->opened )
+                break;
+            /* Reading failed. Try it by itself to get its own error. */
+            lw_mutex_unlock( &shared->lock );
+            unref_shared_root( shared );
+            continue;
+        }
+        /* Publish the ROOT being read so that the sources of the same file wait for it
+         * while the sources of the other files are not blocked. */
+        shared = create_shared_root( file_name, error_string );
+        if( !shared )
+        {
+            lw_static_mutex_unlock( &shared_roots_lock );
+            goto fail;
+        }
+        /* Not contended since no one else knows this ROOT yet. */
+        lw_mutex_lock( &shared->lock );
+        shared->identity  = identity;
+        shared->shareable = identified;
+        shared->next      = shared_roots;
+        shared_roots      = shared;
+        lw_static_mutex_unlock( &shared_roots_lock );
+        if( read_shared_root( shared, error_string ) == 0 )
+            break;
+        lw_static_mutex_lock( &shared_roots_lock );
+        shared->shareable = 0;
+        lw_static_mutex_unlock( &shared_roots_lock );
+        lw_mutex_unlock( &shared->lock );
+        unref_shared_root( shared );
+        goto fail;
     }
-    return root;
-open_fail:
-    if( *p_format_ctx )
-        avformat_close_input( p_format_ctx );
-    lsmash_close_file( file_param );
-    lsmash_destroy_root( root );
+    lsmash_initialize_movie_parameters( movie_param );
+    lsmash_get_movie_parameters( shared->root, movie_param );
+    lw_mutex_unlock( &shared->lock );
+    return shared->root;
+fail:
+    /* Show the error after releasing all the locks. */
     lw_log_show( lhp, LW_LOG_FATAL, "%s", error_string );
     return NULL;
 }
 
+lsmash_root_t *libavsmash_ref_file
+(
+    lsmash_root_t *root
+)
+{
+    lw_static_mutex_lock( &shared_roots_lock );
+    shared_root_t *shared = root ? find_shared_root( root ) : NULL;
+    if( shared )
+    {
+        ++ shared->ref_count;
+        /* The discarded boxes are never needed again. */
+        if( shared->box_user_count )
+            ++ shared->box_user_count;
+    }
+    lw_static_mutex_unlock( &shared_roots_lock );
+    return shared ? root : NULL;
+}
+
+/* Return 1 if the boxes are to be discarded by discard_shared_boxes().
+ * Note: the caller shall hold 'shared_roots_lock'. */
+static int release_boxes
+(
+    shared_root_t *shared
+)
+{
+    if( shared->box_user_count == 0 || -- shared->box_user_count > 0 )
+        return 0;
+    /* No other source gets this ROOT any longer, but the sources sharing it still access the timelines. */
+    shared->shareable = 0;
+    return 1;
+}
+
+/* Note: the caller shall hold a reference to the ROOT but not 'shared_roots_lock'. */
+static void discard_shared_boxes
+(
+    shared_root_t *shared
+)
+{
+    lw_mutex_lock( &shared->lock );
+    lsmash_discard_boxes( shared->root );
+    lw_mutex_unlock( &shared->lock );
+}
+
+void libavsmash_close_file
+(
+    lsmash_root_t *root
+)
+{
+    if( !root )
+        return;
+    lw_static_mutex_lock( &shared_roots_lock );
+    shared_root_t *shared = find_shared_root( root );
+    /* The closing source might not have told that it no longer needs the boxes. */
+    int discard = shared
+               && shared->ref_count > 1
+               && shared->box_user_count >= shared->ref_count
+               && release_boxes( shared );
+    lw_static_mutex_unlock( &shared_roots_lock );
+    if( !shared )
+        return;
+    if( discard )
+        discard_shared_boxes( shared );
+    unref_shared_root( shared );
+}
+
+void libavsmash_discard_boxes
+(
+    lsmash_root_t *root
+)
+{
+    lw_static_mutex_lock( &shared_roots_lock );
+    shared_root_t *shared = find_shared_root( root );
+    int discard = shared && release_boxes( shared );
+    lw_static_mutex_unlock( &shared_roots_lock );
+    if( discard )
+        discard_shared_boxes( shared );
+}
+
+void libavsmash_lock_root
+(
+    lsmash_root_t *root
+)
+{
+    shared_root_t *shared = get_shared_root( root );
+    if( shared )
+        lw_mutex_lock( &shared->lock );
+}
+
+void libavsmash_unlock_root
+(
+    lsmash_root_t *root
+)
+{
+    shared_root_t *shared = get_shared_root( root );
+    if( shared )
+        lw_mutex_unlock( &shared->lock );
+}
+
+void lock_shared_root
+(
+    codec_configuration_t *config
+)
+{
+    if( config->shared_root )
+        lw_mutex_lock( &config->shared_root->lock );
+}
+
+void unlock_shared_root
+(
+    codec_configuration_t *config
+)
+{
+    if( config->shared_root )
+        lw_mutex_unlock( &config->shared_root->lock );
+}
+
 uint32_t libavsmash_get_track_by_media_type
 (
     lsmash_root_t    *root,
@@ -149,6 +502,8 @@ uint32_t libavsmash_get_track_by_media_type
     char *media_type_str = type == ISOM_MEDIA_HANDLER_TYPE_VIDEO_TRACK ? "video" : "audio";
     uint32_t track_id;
     lsmash_media_parameters_t media_param;
+    shared_root_t *shared;
+    int constructed;
     if( track_number == 0 )
     {
         /* Get the first track. */
@@ -181,6 +536,7 @@ uint32_t libavsmash_get_track_by_media_type
             sprintf( error_string, "Failed to find the first %s track.\n", media_type_str );
             goto fail;
         }
+        track_number = i;
     }
     else
     {
@@ -203,7 +559,20 @@ uint32_t libavsmash_get_track_by_media_type
             goto fail;
         }
     }
-    if( lsmash_construct_timeline( root, track_id ) < 0 )
+    /* The timeline may have been constructed by another source sharing the ROOT. */
+    shared = get_shared_root( root );
+    if( shared )
+    {
+        lw_mutex_lock( &shared->lock );
+        uint8_t *state = track_number <= shared->track_count ? &shared->constructed[track_number - 1] : NULL;
+        constructed = (state && *state) || lsmash_construct_timeline( root, track_id ) == 0;
+        if( constructed && state )
+            *state = 1;
+        lw_mutex_unlock( &shared->lock );
+    }
+    else
+        constructed = (lsmash_construct_timeline( root, track_id ) == 0);
+    if( !constructed )
     {
         sprintf( error_string, "Failed to get construct timeline of %s track.\n", media_type_str );
         goto fail;
@@ -222,6 +591,7 @@ int get_summaries
 )
 {
     char error_string[96] = { 0 };
+    config->shared_root = get_shared_root( root );
     uint32_t summary_count = lsmash_count_summary( root, track_ID );
     if( summary_count == 0 )
     {
@@ -468,6 +838,78 @@ static enum AVCodecID get_codec_id_from_description
 #undef ELSE_IF_GET_CODEC_ID_FROM_CODEC_TYPE
 }
 
+int setup_codec_context
+(
+    codec_configuration_t *config,
+    const char            *file_name,
+    enum AVMediaType       media_type
+)
+{
+    char     error_string[96] = { 0 };
+    uint32_t i;
+    for( i = 0; i < config->count; i++ )
+        if( !config->entries[i].summary
+         || get_codec_id_from_description( config->entries[i].summary ) == AV_CODEC_ID_NONE )
+            break;
+    if( config->count && i == config->count )
+    {
+        /* Every decoder configuration is built from the summaries in update_configuration().
+         * So, the file needs not to be parsed by libavformat again. */
+        config->ctx = avcodec_alloc_context3( NULL );
+        if( !config->ctx )
+        {
+            strcpy( error_string, "Failed to allocate a CODEC context.\n" );
+            goto fail;
+        }
+        config->ctx->codec_type = media_type;
+        return 0;
+    }
+    /* libavformat */
+    if( avformat_open_input( &config->format_ctx, file_name, NULL, NULL ) )
+    {
+        strcpy( error_string, "Failed to avformat_open_input.\n" );
+        goto fail;
+    }
+    if( avformat_find_stream_info( config->format_ctx, NULL ) < 0 )
+    {
+        strcpy( error_string, "Failed to avformat_find_stream_info.\n" );
+        goto fail;
+    }
+    for( i = 0; i < config->format_ctx->nb_streams && config->format_ctx->streams[i]->codec->codec_type != media_type; i++ );
+    if( i == config->format_ctx->nb_streams )
+    {
+        strcpy( error_string, "Failed to find stream by libavformat.\n" );
+        goto fail;
+    }
+    config->ctx = config->format_ctx->streams[i]->codec;
+    return 0;
+fail:
+    if( config->format_ctx )
+        avformat_close_input( &config->format_ctx );
+    lw_log_show( &config->lh, LW_LOG_FATAL, "%s", error_string );
+    return -1;
+}
+
+void close_codec_context
+(
+    codec_configuration_t *config
+)
+{
+    if( config->ctx )
+    {
+        if( config->format_ctx )
+        {
+            avcodec_close( config->ctx );
+            config->ctx = NULL;
+        }
+        else
+            /* The CODEC context is not owned by libavformat. */
+            avcodec_free_context( &config->ctx );
+    }
+    if( config->format_ctx )
+        avformat_close_input( &config->format_ctx );
+}
+
 AVCodec *libavsmash_find_decoder
 (
     codec_configuration_t *config
@@ -735,6 +1177,132 @@ fail:
     return -1;
 }
 
+/* Get the end of the range of the file read at one go together with the sample: the following samples of the track
+ * are included as long as they are laid out forward within the capacity, i.e. the rest of its chunk and the following
+ * chunks, unless skipping the data of the other tracks between the chunks costs more than the data of the track. */
+static int64_t get_read_ahead_end
+(
+    codec_configuration_t *config,
+    uint32_t               sample_number,
+    uint64_t               pos,
+    uint32_t               length,
+    uint32_t               capacity
+)
+{
+    uint64_t end     = pos + length;
+    uint64_t useful  = length;
+    uint64_t skipped = 0;
+    for( uint32_t i = sample_number + 1; ; i++ )
+    {
+        timeline_sample_t *next = get_timeline_sample( config, i );
+        if( !next
+         || next->pos < end
+         || next->pos + next->length - pos > capacity
+         || skipped + (next->pos - end) > useful + next->length )
+            break;
+        skipped += next->pos - end;
+        useful  += next->length;
+        end      = next->pos + next->length;
+    }
+    return (int64_t)end;
+}
+
+/* Request reading the chunks following the buffered ones in the background when the buffered ones are half consumed. */
+static void prefetch_sample_data
+(
+    codec_configuration_t *config,
+    uint32_t               sample_number
+)
+{
+    int64_t prefetch_pos = lw_read_ahead_get_prefetch_position( config->read_ahead );
+    if( prefetch_pos < 0 )
+        return;
+    for( uint32_t i = sample_number + 1; ; i++ )
+    {
+        timeline_sample_t *next = get_timeline_sample( config, i );
+        if( !next )
+            return;
+        if( (int64_t)next->pos >= prefetch_pos )
+        {
+            uint32_t capacity = lw_read_ahead_get_capacity( config->read_ahead );
+            if( next->length <= capacity )
+                lw_read_ahead_prefetch( config->read_ahead, (int64_t)next->pos,
+                                        get_read_ahead_end( config, i, next->pos, next->length, capacity ) );
+            return;
+        }
+    }
+}
+
+static int read_ahead_sample_data
+(
+    codec_configuration_t *config,
+    uint32_t               sample_number,
+    lsmash_sample_t       *sample
+)
+{
+    lw_read_ahead_t *ra = config->read_ahead;
+    if( lw_read_ahead_copy( ra, (int64_t)sample->pos, sample->length, config->input_buffer ) < 0 )
+    {
+        uint32_t capacity = lw_read_ahead_get_capacity( ra );
+        int64_t  end      = sample->length <= capacity
+                          ? get_read_ahead_end( config, sample_number, sample->pos, sample->length, capacity )
+                          : 0;
+        if( end == 0
+         || lw_read_ahead_fill( ra, (int64_t)sample->pos, end ) < 0
+         || lw_read_ahead_copy( ra, (int64_t)sample->pos, sample->length, config->input_buffer ) < 0 )
+        {
+            /* The background reading, if any, shares the sample reader. */
+            int64_t read_size = lw_read_ahead_read_through( ra, (int64_t)sample->pos, sample->length, config->input_buffer );
+            return read_size == (int64_t)sample->length ? 0 : -1;
+        }
+    }
+    prefetch_sample_data( config, sample_number );
+    return 0;
+}
+
+/* Read the data of a sample from the file directly into the input buffer.
+ * This avoids copying the data through the sample buffer of L-SMASH, which matters for high bitrate intra CODECs.
+ * Return 0 if successful, otherwise -1. */
+static int read_sample_data
+(
+    lsmash_root_t         *root,
+    uint32_t               track_ID,
+    uint32_t               sample_number,
+    codec_configuration_t *config,
+    lsmash_sample_t       *sample
+)
+{
+    if( config->readable_sample_count && sample_number > config->readable_sample_count )
+        return -1;
+    timeline_sample_t *cached = get_timeline_sample( config, sample_number );
+    int err = 0;
+    if( cached )
+    {
+        memset( &sample->prop, 0, sizeof(sample->prop) );
+        sample->cts           = cached->cts;
+        sample->dts           = cached->dts;
+        sample->pos           = cached->pos;
+        sample->length        = cached->length;
+        sample->index         = cached->index;
+        sample->prop.ra_flags = (lsmash_random_access_flag)cached->ra_flags;
+    }
+    else
+    {
+        lock_shared_root( config );
+        err = lsmash_get_sample_info_from_media_timeline( root, track_ID, sample_number, sample );
+        unlock_shared_root( config );
+    }
+    if( err || sample->length > config->input_buffer_size )
+        return -1;
+    if( config->read_ahead )
+        return read_ahead_sample_data( config, sample_number, sample );
+    AVIOContext *reader = config->sample_reader;
+    if( avio_seek( reader, (int64_t)sample->pos, SEEK_SET ) != (int64_t)sample->pos
+     || avio_read( reader, config->input_buffer, (int)sample->length ) != (int)sample->length )
+        return -1;
+    return 0;
+}
+
 int get_sample
 (
     lsmash_root_t         *root,
@@ -767,32 +1335,42 @@ int get_sample
         }
         return 0;
     }
-    lsmash_sample_t *sample = lsmash_get_sample_from_media_timeline( root, track_ID, sample_number );
-    if( !sample )
+    lsmash_sample_t sample;
+    if( !config->sample_reader || read_sample_data( root, track_ID, sample_number, config, &sample ) < 0 )
     {
-        /* Reached the end of this media timeline. */
-        pkt->data = NULL;
-        pkt->size = 0;
-        return 1;
+        /* Copy sample data from L-SMASH. */
+        lsmash_sample_t *copied_sample = NULL;
+        if( !config->readable_sample_count || sample_number <= config->readable_sample_count )
+        {
+            lock_shared_root( config );
+            copied_sample = lsmash_get_sample_from_media_timeline( root, track_ID, sample_number );
+            unlock_shared_root( config );
+        }
+        if( !copied_sample )
+        {
+            /* Reached the end of this media timeline. */
+            pkt->data = NULL;
+            pkt->size = 0;
+            return 1;
+        }
+        memcpy( config->input_buffer, copied_sample->data, copied_sample->length );
+        sample      = *copied_sample;
+        sample.data = NULL;
+        lsmash_delete_sample( copied_sample );
     }
-    pkt->flags = sample->prop.ra_flags;     /* Set proper flags when feeding this packet into the decoder. */
-    pkt->size  = sample->length;
+    pkt->flags = sample.prop.ra_flags;      /* Set proper flags when feeding this packet into the decoder. */
+    pkt->size  = sample.length;
     pkt->data  = config->input_buffer;
-    pkt->pts   = sample->cts;               /* Set composition timestamp to presentation timestamp field. */
-    pkt->dts   = sample->dts;
-    /* Copy sample data from L-SMASH.
-     * Set 0 to the end of the additional FF_INPUT_BUFFER_PADDING_SIZE bytes.
+    pkt->pts   = sample.cts;                /* Set composition timestamp to presentation timestamp field. */
+    pkt->dts   = sample.dts;
+    /* Set 0 to the end of the additional FF_INPUT_BUFFER_PADDING_SIZE bytes.
      * Without this, some decoders could cause wrong results. */
-    memcpy( pkt->data, sample->data, sample->length );
-    memset( pkt->data + sample->length, 0, FF_INPUT_BUFFER_PADDING_SIZE );
+    memset( pkt->data + sample.length, 0, FF_INPUT_BUFFER_PADDING_SIZE );
     /* TODO: add handling invalid indexes. */
-    if( sample->index != config->index )
+    if( sample.index != config->index )
     {
-        if( prepare_new_decoder_configuration( config, sample->index ) )
-        {
-            lsmash_delete_sample( sample );
+        if( prepare_new_decoder_configuration( config, sample.index ) )
             return -1;
-        }
         /* Queue the current packet and, instead of this, return NULL packet.
          * The current packet will be dequeued and returned after the corresponding decoder configuration is activated. */
         config->queue.sample_number = sample_number;
@@ -804,13 +1382,11 @@ int get_sample
             /* This NULL packet must not be sent to the decoder. */
             config->update_pending = 1;
             config->dequeue_packet = 1;
-            lsmash_delete_sample( sample );
             return 2;
         }
         else
             config->dequeue_packet = 0;
     }
-    lsmash_delete_sample( sample );
     return 0;
 }
 
@@ -870,6 +1446,8 @@ void update_configuration
     AVCodecContext *ctx = config->ctx;
     void *app_specific      = ctx->opaque;
     int   refcounted_frames = ctx->refcounted_frames;
+    int   slice_flags       = ctx->slice_flags;
+    void (*draw_horiz_band)( struct AVCodecContext *, const AVFrame *, int *, int, int, int ) = ctx->draw_horiz_band;
     avcodec_close( ctx );
     if( ctx->extradata )
     {
@@ -1009,7 +1587,10 @@ void update_configuration
                 else
                 {
                     uint32_t frame_length;
-                    if( lsmash_get_sample_delta_from_media_timeline( root, track_ID, i - 1, &frame_length ) )
+                    lock_shared_root( config );
+                    int err = lsmash_get_sample_delta_from_media_timeline( root, track_ID, i - 1, &frame_length );
+                    unlock_shared_root( config );
+                    if( err )
                         continue;
                     if( frame_length )
                         upsampling = picture->nb_samples / frame_length;
@@ -1029,6 +1610,8 @@ void update_configuration
     if( current_sample_number == config->queue.sample_number )
         config->dequeue_packet = 1;
     ctx->get_buffer2       = config->get_buffer;
+    ctx->draw_horiz_band   = draw_horiz_band;
+    ctx->slice_flags       = slice_flags;
     ctx->opaque            = app_specific;
     ctx->refcounted_frames = refcounted_frames;
     if( ctx->codec_type == AVMEDIA_TYPE_VIDEO )
@@ -1046,6 +1629,236 @@ fail:
     lw_log_show( &config->lh, LW_LOG_FATAL, "%sIt is recommended you reopen the file.", error_string );
 }
 
+#define READ_AHEAD_MAX_CAPACITY (4 << 20)   /* arbitrary */
+
+static int64_t read_file_data
+(
+    void     *priv,
+    uint8_t  *buf,
+    int64_t   pos,
+    uint32_t  size
+)
+{
+    AVIOContext *reader = (AVIOContext *)priv;
+    if( avio_seek( reader, pos, SEEK_SET ) != pos )
+        return -1;
+    return avio_read( reader, buf, (int)size );
+}
+
+void open_sample_reader
+(
+    lsmash_root_t         *root,
+    uint32_t               track_ID,
+    codec_configuration_t *config,
+    const char            *file_name
+)
+{
+    /* Sample data can be read from the file by its position only if all of it is in the file itself. */
+    uint32_t data_ref_count = lsmash_count_data_reference( root, track_ID );
+    for( uint32_t i = 1; i <= data_ref_count; i++ )
+    {
+        lsmash_data_reference_t data_ref = { 0 };
+        data_ref.index = i;
+        if( lsmash_get_data_reference( root, track_ID, &data_ref ) < 0 )
+            return;
+        int external = (data_ref.location != NULL);
+        lsmash_cleanup_data_reference( &data_ref );
+        if( external )
+            return;
+    }
+    if( avio_open( &config->sample_reader, file_name, AVIO_FLAG_READ ) < 0 )
+        config->sample_reader = NULL;
+}
+
+/* Get the size of the largest chunk of the track, i.e. of the longest run of its samples laid out back to back,
+ * up to READ_AHEAD_MAX_CAPACITY. Return 0 if every chunk has only one sample, where reading ahead gains nothing. */
+static uint32_t get_read_ahead_capacity
+(
+    codec_configuration_t *config
+)
+{
+    uint64_t largest   = 0;
+    uint64_t run       = 0;
+    uint64_t end       = 0;
+    int      coalesced = 0;
+    for( uint32_t i = 1; i <= config->timeline_sample_count; i++ )
+    {
+        timeline_sample_t *sample = get_timeline_sample( config, i );
+        if( !sample )
+        {
+            run = 0;
+            continue;
+        }
+        if( run && sample->pos == end )
+        {
+            run      += sample->length;
+            coalesced = 1;
+        }
+        else
+            run = sample->length;
+        end     = sample->pos + sample->length;
+        largest = MAX( largest, run );
+    }
+    return coalesced ? (uint32_t)MIN( largest, READ_AHEAD_MAX_CAPACITY ) : 0;
+}
+
+/* Coalesce the small reads of the samples into reads of chunks. Without the buffer, the samples are read one by one.
+ * The buffer is sized to the largest chunk since it is allocated for each decoder, and twice with the prefetch. */
+static void open_read_ahead
+(
+    codec_configuration_t *config
+)
+{
+    if( !config->sample_reader )
+        return;
+    uint32_t capacity = get_read_ahead_capacity( config );
+    if( capacity > 0 )
+        config->read_ahead = lw_read_ahead_create( read_file_data, config->sample_reader, capacity, config->prefetch );
+}
+
+static int is_sample_written
+(
+    lsmash_root_t         *root,
+    uint32_t               track_ID,
+    uint32_t               sample_number,
+    codec_configuration_t *config,
+    int64_t                file_size
+)
+{
+    lsmash_sample_t sample;
+    lock_shared_root( config );
+    int err = lsmash_get_sample_info_from_media_timeline( root, track_ID, sample_number, &sample );
+    unlock_shared_root( config );
+    return err == 0 && sample.pos + sample.length <= (uint64_t)file_size;
+}
+
+/* Exclude the trailing samples whose data is not entirely written in the file yet.
+ * A file under writing such as a fragmented MP4 under recording can have a fragment whose media data is incomplete.
+ * The data of the samples is supposed to be appended in decoding order there.
+ * Return the number of the remaining samples, and set the duration up to them to 'media_duration' if any is excluded. */
+uint32_t exclude_unwritten_samples
+(
+    lsmash_root_t         *root,
+    uint32_t               track_ID,
+    codec_configuration_t *config,
+    uint64_t              *media_duration
+)
+{
+    uint32_t sample_count = lsmash_get_sample_count_in_media_timeline( root, track_ID );
+    int64_t  file_size    = config->sample_reader ? avio_size( config->sample_reader ) : -1;
+    if( sample_count == 0 || file_size < 0 || is_sample_written( root, track_ID, sample_count, config, file_size ) )
+        return sample_count;
+    /* Find the last written sample by bisection. 'written' is always written and 'unwritten' is not. */
+    uint32_t written   = 0;
+    uint32_t unwritten = sample_count;
+    while( unwritten - written > 1 )
+    {
+        uint32_t middle = written + (unwritten - written) / 2;
+        if( is_sample_written( root, track_ID, middle, config, file_size ) )
+            written = middle;
+        else
+            unwritten = middle;
+    }
+    uint64_t dts;
+    lock_shared_root( config );
+    int err = written == 0 || lsmash_get_dts_from_media_timeline( root, track_ID, written + 1, &dts ) < 0;
+    unlock_shared_root( config );
+    if( err )
+        return sample_count;
+    config->readable_sample_count = written;
+    *media_duration = dts;
+    lw_log_show( &config->lh, LW_LOG_INFO, "Excluded %"PRIu32" sample(s) whose data is not written yet.", sample_count - written );
+    return written;
+}
+
+static int build_timeline_cache
+(
+    lsmash_root_t         *root,
+    uint32_t               track_ID,
+    codec_configuration_t *config
+)
+{
+    uint32_t sample_count = config->readable_sample_count
+                          ? config->readable_sample_count
+                          : lsmash_get_sample_count_in_media_timeline( root, track_ID );
+    config->timeline = (timeline_sample_t *)lw_malloc_zero( (sample_count + 1) * sizeof(timeline_sample_t) );
+    if( !config->timeline )
+        return -1;
+    config->timeline_sample_count = sample_count;
+    /* The duration of each sample is the difference from the DTS of the next sample except for the last one. */
+    for( uint32_t i = 1; i <= sample_count; i++ )
+    {
+        lsmash_sample_t info;
+        if( lsmash_get_sample_info_from_media_timeline( root, track_ID, i, &info ) )
+            continue;
+        timeline_sample_t *sample = &config->timeline[i];
+        sample->cts      = info.cts;
+        sample->dts      = info.dts;
+        sample->pos      = info.pos;
+        sample->length   = info.length;
+        sample->index    = info.index;
+        sample->ra_flags = (uint16_t)info.prop.ra_flags;
+        timeline_sample_t *prev = &config->timeline[i - 1];
+        if( i > 1 && prev->index && info.dts >= prev->dts )
+        {
+            prev->duration = (uint32_t)(info.dts - prev->dts);
+            prev->flags   |= TIMELINE_SAMPLE_FLAG_DURATION;
+        }
+    }
+    /* Ask L-SMASH for the durations the DTS of the next sample cannot tell, i.e. of the last sample
+     * and the ones followed by a sample whose information is unavailable. */
+    for( uint32_t i = 1; i <= sample_count; i++ )
+    {
+        timeline_sample_t *sample = &config->timeline[i];
+        if( sample->index
+         && !(sample->flags & TIMELINE_SAMPLE_FLAG_DURATION)
+         && lsmash_get_sample_delta_from_media_timeline( root, track_ID, i, &sample->duration ) == 0 )
+            sample->flags |= TIMELINE_SAMPLE_FLAG_DURATION;
+    }
+    return 0;
+}
+
+/* Note: the caller shall hold the lock of the shared ROOT. */
+static int create_timeline_cache
+(
+    lsmash_root_t         *root,
+    uint32_t               track_ID,
+    codec_configuration_t *config
+)
+{
+    shared_root_t *shared = config->shared_root;
+    if( shared )
+    {
+        /* Borrow the timeline of the same track created by another source sharing the ROOT. */
+        uint32_t sample_count = config->readable_sample_count
+                              ? config->readable_sample_count
+                              : lsmash_get_sample_count_in_media_timeline( root, track_ID );
+        for( shared_timeline_t *timeline = shared->timelines; timeline; timeline = timeline->next )
+            if( timeline->track_ID == track_ID && timeline->sample_count == sample_count )
+            {
+                config->timeline              = timeline->timeline;
+                config->timeline_sample_count = timeline->sample_count;
+                config->timeline_borrowed     = 1;
+                return 0;
+            }
+    }
+    if( build_timeline_cache( root, track_ID, config ) < 0 )
+        return -1;
+    if( !shared )
+        return 0;
+    /* Hand the timeline over to the ROOT so that the other sources of the same track can borrow it. */
+    shared_timeline_t *timeline = (shared_timeline_t *)lw_malloc_zero( sizeof(shared_timeline_t) );
+    if( !timeline )
+        return 0;
+    timeline->track_ID        = track_ID;
+    timeline->sample_count    = config->timeline_sample_count;
+    timeline->timeline        = config->timeline;
+    timeline->next            = shared->timelines;
+    shared->timelines         = timeline;
+    config->timeline_borrowed = 1;
+    return 0;
+}
+
 int initialize_decoder_configuration
 (
     lsmash_root_t         *root,
@@ -1054,12 +1867,21 @@ int initialize_decoder_configuration
 )
 {
     /* Note: the input buffer for libavcodec's decoders must be FF_INPUT_BUFFER_PADDING_SIZE larger than the actual read bytes. */
+    lock_shared_root( config );
     uint32_t input_buffer_size = lsmash_get_max_sample_size_in_media_timeline( root, track_ID );
+    unlock_shared_root( config );
     if( input_buffer_size == 0 )
         return -1;
     config->input_buffer = (uint8_t *)av_mallocz( input_buffer_size + FF_INPUT_BUFFER_PADDING_SIZE );
     if( !config->input_buffer )
         return -1;
+    config->input_buffer_size = input_buffer_size;
+    lock_shared_root( config );
+    int err = create_timeline_cache( root, track_ID, config );
+    unlock_shared_root( config );
+    if( err < 0 )
+        return -1;
+    open_read_ahead( config );
     config->get_buffer = avcodec_default_get_buffer2;
     /* Initialize decoder configuration at the first valid sample. */
     AVPacket dummy = { 0 };
@@ -1088,19 +1910,16 @@ int initialize_decoder_configuration
     uint32_t valid_index_count = (config->index && config->index <= config->count);
     if( valid_index_count )
         index_list[ config->index - 1 ] = 1;
-    uint32_t sample_count = lsmash_get_sample_count_in_media_timeline( root, track_ID );
-    for( uint32_t i = 2; i <= sample_count && valid_index_count < config->count; i++ )
+    for( uint32_t i = 2; i <= config->timeline_sample_count && valid_index_count < config->count; i++ )
     {
-        lsmash_sample_t sample;
-        if( lsmash_get_sample_info_from_media_timeline( root, track_ID, i, &sample ) )
-            continue;
-        if( sample.index == config->index || sample.index == 0 )
+        timeline_sample_t *sample = get_timeline_sample( config, i );
+        if( !sample || sample->index == config->index )
             continue;
-        if( sample.index <= config->count && !index_list[ sample.index - 1 ] )
+        if( sample->index <= config->count && !index_list[ sample->index - 1 ] )
         {
             for( uint32_t j = i; get_sample( root, track_ID, j, config, &dummy ) < 0; j++ );
             update_configuration( root, track_ID, config );
-            index_list[ sample.index - 1 ] = 1;
+            index_list[ sample->index - 1 ] = 1;
             if( config->ctx->width > config->prefer.width )
                 config->prefer.width = config->ctx->width;
             if( config->ctx->height > config->prefer.height )
@@ -1157,6 +1976,42 @@ int initialize_decoder_configuration
     return config->error ? -1 : 0;
 }
 
+int duplicate_decoder_configuration
+(
+    lsmash_root_t         *root,
+    uint32_t               track_ID,
+    codec_configuration_t *config,
+    codec_configuration_t *src,
+    const char            *file_name
+)
+{
+    /* The sample data is read from the file by its position only if so is the source configuration. */
+    if( src->sample_reader && avio_open( &config->sample_reader, file_name, AVIO_FLAG_READ ) < 0 )
+        config->sample_reader = NULL;
+    config->readable_sample_count = src->readable_sample_count;
+    config->input_buffer = (uint8_t *)av_mallocz( src->input_buffer_size + FF_INPUT_BUFFER_PADDING_SIZE );
+    if( !config->input_buffer )
+        return -1;
+    config->input_buffer_size = src->input_buffer_size;
+    /* The timeline is borrowed from the shared ROOT unless the source configuration failed to hand it over. */
+    lock_shared_root( config );
+    int err = create_timeline_cache( root, track_ID, config );
+    unlock_shared_root( config );
+    if( err < 0 )
+        return -1;
+    uint32_t capacity = src->read_ahead ? lw_read_ahead_get_capacity( src->read_ahead ) : 0;
+    if( config->sample_reader && capacity > 0 )
+        config->read_ahead = lw_read_ahead_create( read_file_data, config->sample_reader, capacity, config->prefetch );
+    config->get_buffer = avcodec_default_get_buffer2;
+    /* The other decoder configurations are already investigated by the source configuration. */
+    config->prefer = src->prefer;
+    /* Initialize decoder configuration at the first valid sample. */
+    AVPacket dummy = { 0 };
+    for( uint32_t i = 1; get_sample( root, track_ID, i, config, &dummy ) < 0; i++ );
+    update_configuration( root, track_ID, config );
+    return config->error ? -1 : 0;
+}
+
 void cleanup_configuration
 (
     codec_configuration_t *config
@@ -1172,6 +2027,21 @@ void cleanup_configuration
         av_free( config->queue.extradata );
     if( config->input_buffer )
         av_free( config->input_buffer );
-    if( config->ctx )
-        avcodec_close( config->ctx );
+    /* The background reading of the read-ahead buffer uses the sample reader. */
+    if( config->read_ahead )
+    {
+        lw_read_ahead_destroy( config->read_ahead );
+        config->read_ahead = NULL;
+    }
+    if( config->sample_reader )
+        avio_closep( &config->sample_reader );
+    if( config->timeline_borrowed )
+    {
+        /* The timeline is owned by the shared ROOT. */
+        config->timeline          = NULL;
+        config->timeline_borrowed = 0;
+    }
+    else
+        lw_freep( &config->timeline );
+    close_codec_context( config );
 }
@@ -38,6 +38,23 @@ typedef struct
     extended_summary_t extended;
 } libavsmash_summary_t;
 
+typedef struct shared_root_tag shared_root_t;
+
+/* Information of a sample cached in decoding order to avoid repeated lookups into the media timeline of L-SMASH. */
+typedef struct
+{
+    uint64_t cts;
+    uint64_t dts;
+    uint64_t pos;       /* position of the data in the file */
+    uint32_t duration;
+    uint32_t length;
+    uint32_t index;     /* index of the decoder configuration, 0 if unavailable */
+    uint16_t ra_flags;  /* lsmash_random_access_flag */
+    uint16_t flags;     /* TIMELINE_SAMPLE_FLAG_* */
+} timeline_sample_t;
+
+#define TIMELINE_SAMPLE_FLAG_DURATION 0x0001    /* 'duration' is valid; otherwise, the DTS of the next sample is unavailable */
+
 typedef struct
 {
     int                   error;
@@ -47,7 +64,17 @@ typedef struct
     uint32_t              index;    /* index of the current decoder configuration */
     uint32_t              delay_count;
     uint8_t              *input_buffer;
+    uint32_t              input_buffer_size;    /* excluding the padding */
+    AVIOContext          *sample_reader;        /* reader of sample data directly into the input buffer */
+    struct lw_read_ahead_tag *read_ahead;       /* buffer of the sample data read at one go from 'sample_reader' */
+    int                   prefetch;             /* whether to read the following sample data in the background */
+    uint32_t              readable_sample_count;    /* the number of samples whose data is present in the file, 0 if all */
+    uint32_t              timeline_sample_count;
+    timeline_sample_t    *timeline;                 /* 1-origin, indexed by the decoding sample number */
+    int                   timeline_borrowed;        /* whether the timeline is owned by the shared ROOT */
     AVCodecContext       *ctx;
+    AVFormatContext      *format_ctx;   /* opened only if L-SMASH cannot recognize the CODEC */
+    shared_root_t        *shared_root;  /* the ROOT shared with the other sources of the same file */
     const char          **preferred_decoder_names;
     libavsmash_summary_t *entries;
     extended_summary_t    prefer;
@@ -78,15 +105,70 @@ static inline uint32_t get_decoder_delay
     return ctx->has_b_frames + ((ctx->active_thread_type & FF_THREAD_FRAME) ? ctx->thread_count - 1 : 0);
 }
 
+/* Return NULL if the information of the sample is not available. */
+static inline timeline_sample_t *get_timeline_sample
+(
+    codec_configuration_t *config,
+    uint32_t               sample_number
+)
+{
+    if( sample_number == 0 || sample_number > config->timeline_sample_count )
+        return NULL;
+    timeline_sample_t *sample = &config->timeline[sample_number];
+    return sample->index ? sample : NULL;
+}
+
+/* Open the file, or get the ROOT of the same file already opened by another source.
+ * A ROOT is shared by all the sources of the same file until all of them call libavsmash_discard_boxes().
+ * Close it by libavsmash_close_file(). */
 lsmash_root_t *libavsmash_open_file
 (
-    AVFormatContext          **p_format_ctx,
     const char                *file_name,
-    lsmash_file_parameters_t  *file_param,
     lsmash_movie_parameters_t *movie_param,
     lw_log_handler_t          *lhp
 );
 
+void libavsmash_close_file
+(
+    lsmash_root_t *root
+);
+
+/* Get another reference to the ROOT opened by libavsmash_open_file() without reading the file again.
+ * The caller shall close it by libavsmash_close_file() and tell libavsmash_discard_boxes() as another source. */
+lsmash_root_t *libavsmash_ref_file
+(
+    lsmash_root_t *root
+);
+
+/* Tell that the caller no longer needs the boxes of the ROOT, e.g. on its first request after the script is evaluated.
+ * The boxes are discarded under the lock of the ROOT when none of the sources sharing it needs them. */
+void libavsmash_discard_boxes
+(
+    lsmash_root_t *root
+);
+
+/* Serialize the accesses to the timelines and the file through the ROOT shared by other sources.
+ * The former ones take the ROOT itself for the callers which have no decoder configuration yet. */
+void libavsmash_lock_root
+(
+    lsmash_root_t *root
+);
+
+void libavsmash_unlock_root
+(
+    lsmash_root_t *root
+);
+
+void lock_shared_root
+(
+    codec_configuration_t *config
+);
+
+void unlock_shared_root
+(
+    codec_configuration_t *config
+);
+
 uint32_t libavsmash_get_track_by_media_type
 (
     lsmash_root_t    *root,
@@ -102,11 +184,41 @@ int get_summaries
     codec_configuration_t *config
 );
 
+/* Set up the CODEC context of the decoder configuration.
+ * libavformat opens the file only if L-SMASH cannot recognize the CODEC of any summary. */
+int setup_codec_context
+(
+    codec_configuration_t *config,
+    const char            *file_name,
+    enum AVMediaType       media_type
+);
+
+void close_codec_context
+(
+    codec_configuration_t *config
+);
+
 AVCodec *libavsmash_find_decoder
 (
     codec_configuration_t *config
 );
 
+void open_sample_reader
+(
+    lsmash_root_t         *root,
+    uint32_t               track_ID,
+    codec_configuration_t *config,
+    const char            *file_name
+);
+
+uint32_t exclude_unwritten_samples
+(
+    lsmash_root_t         *root,
+    uint32_t               track_ID,
+    codec_configuration_t *config,
+    uint64_t              *media_duration
+);
+
 int initialize_decoder_configuration
 (
     lsmash_root_t         *root,
@@ -114,6 +226,17 @@ int initialize_decoder_configuration
     codec_configuration_t *config
 );
 
+/* Set up the decoder configuration of the same track as 'src' initialized by initialize_decoder_configuration()
+ * without investigating the track again. The CODEC context shall be set up in the same way as the one of 'src'. */
+int duplicate_decoder_configuration
+(
+    lsmash_root_t         *root,
+    uint32_t               track_ID,
+    codec_configuration_t *config,
+    codec_configuration_t *src,
+    const char            *file_name
+);
+
 int get_sample
 (
     lsmash_root_t         *root,
@@ -148,6 +148,15 @@ void libavsmash_audio_set_preferred_decoder_names
     adhp->config.preferred_decoder_names = preferred_decoder_names;
 }
 
+void libavsmash_audio_set_prefetch
+(
+    libavsmash_audio_decode_handler_t *adhp,
+    int                                prefetch
+)
+{
+    adhp->config.prefetch = prefetch;
+}
+
 void libavsmash_audio_set_codec_context
 (
     libavsmash_audio_decode_handler_t *adhp,
@@ -344,48 +353,46 @@ int libavsmash_audio_get_track
     if( track_id == 0 )
         return -1;
     libavsmash_audio_set_track_id( adhp, track_id );
+    libavsmash_lock_root( libavsmash_audio_get_root( adhp ) );
     (void)libavsmash_audio_fetch_sample_count   ( adhp );
     (void)libavsmash_audio_fetch_media_duration ( adhp );
     (void)libavsmash_audio_fetch_media_timescale( adhp );
     (void)libavsmash_audio_fetch_min_cts        ( adhp );
+    libavsmash_unlock_root( libavsmash_audio_get_root( adhp ) );
     return 0;
 }
 
 int libavsmash_audio_initialize_decoder_configuration
 (
     libavsmash_audio_decode_handler_t *adhp,
-    AVFormatContext                   *format_ctx,
+    const char                        *file_name,
     int                                threads
 )
 {
-    char error_string[128] = { 0 };
+    char            error_string[128] = { 0 };
+    AVCodecContext *ctx;
+    AVCodec        *codec;
     if( libavsmash_audio_get_summaries( adhp ) < 0 )
         return -1;
-    /* libavformat */
-    uint32_t type = AVMEDIA_TYPE_AUDIO;
-    uint32_t i;
-    for( i = 0; i < format_ctx->nb_streams && format_ctx->streams[i]->codec->codec_type != type; i++ );
-    if( i == format_ctx->nb_streams )
-    {
-        strcpy( error_string, "Failed to find stream by libavformat.\n" );
-        goto fail;
-    }
+    if( setup_codec_context( &adhp->config, file_name, AVMEDIA_TYPE_AUDIO ) < 0 )
+        return -1;
     /* libavcodec */
-    AVCodecContext *ctx = format_ctx->streams[i]->codec;
-    AVCodec        *codec;
-    libavsmash_audio_set_codec_context( adhp, ctx );
+    ctx   = adhp->config.ctx;
     codec = libavsmash_audio_find_decoder( adhp );
     if( !codec )
     {
-        sprintf( error_string, "Failed to find %s decoder.\n", codec->name );
+        strcpy( error_string, "Failed to find the decoder.\n" );
         goto fail;
     }
     ctx->thread_count = threads;
-    if( avcodec_open2( ctx, codec, NULL ) < 0 )
+    /* The CODEC context built without libavformat is opened by the first update of the decoder configuration. */
+    if( adhp->config.format_ctx && avcodec_open2( ctx, codec, NULL ) < 0 )
     {
         strcpy( error_string, "Failed to avcodec_open2.\n" );
         goto fail;
     }
+    open_sample_reader( adhp->root, adhp->track_id, &adhp->config, file_name );
+    adhp->frame_count = exclude_unwritten_samples( adhp->root, adhp->track_id, &adhp->config, &adhp->media_duration );
     return initialize_decoder_configuration( adhp->root, adhp->track_id, &adhp->config );
 fail:;
     lw_log_handler_t *lhp = libavsmash_audio_get_log_handler( adhp );
@@ -431,10 +438,9 @@ void libavsmash_audio_close_codec_context
     libavsmash_audio_decode_handler_t *adhp
 )
 {
-    if( !adhp || !adhp->config.ctx )
+    if( !adhp )
         return;
-    avcodec_close( adhp->config.ctx );
-    adhp->config.ctx = NULL;
+    close_codec_context( &adhp->config );
 }
 
 void libavsmash_audio_apply_delay
@@ -503,13 +509,13 @@ uint64_t libavsmash_audio_count_overall_pcm_samples
     for( uint32_t i = 1; i <= adhp->frame_count; i++ )
     {
         /* Get configuration index. */
-        lsmash_sample_t sample;
-        if( lsmash_get_sample_info_from_media_timeline( adhp->root, adhp->track_id, i, &sample ) )
+        timeline_sample_t *sample = get_timeline_sample( config, i );
+        if( !sample )
             continue;
-        if( current_index != sample.index )
+        if( current_index != sample->index )
         {
-            es = &config->entries[ sample.index - 1 ].extended;
-            current_index = sample.index;
+            es = &config->entries[ sample->index - 1 ].extended;
+            current_index = sample->index;
         }
         else if( !es )
             continue;
@@ -517,7 +523,9 @@ uint64_t libavsmash_audio_count_overall_pcm_samples
         uint32_t frame_length;
         if( es->frame_length )
             frame_length = es->frame_length;
-        else if( lsmash_get_sample_delta_from_media_timeline( adhp->root, adhp->track_id, i, &frame_length ) )
+        else if( sample->flags & TIMELINE_SAMPLE_FLAG_DURATION )
+            frame_length = sample->duration;
+        else
             continue;
         /* */
         if( (current_sample_rate != es->sample_rate && es->sample_rate > 0)
@@ -576,18 +584,18 @@ static inline int get_frame_length
     libavsmash_summary_t             **sp
 )
 {
-    lsmash_sample_t sample;
-    if( lsmash_get_sample_info_from_media_timeline( adhp->root, adhp->track_id, frame_number, &sample ) )
+    timeline_sample_t *sample = get_timeline_sample( &adhp->config, frame_number );
+    if( !sample )
         return -1;
-    *sp = &adhp->config.entries[ sample.index - 1 ];
+    *sp = &adhp->config.entries[ sample->index - 1 ];
     libavsmash_summary_t *s = *sp;
     if( s->extended.frame_length == 0 )
     {
         /* variable frame length
          * Guess the frame length from sample duration. */
-        if( lsmash_get_sample_delta_from_media_timeline( adhp->root, adhp->track_id, frame_number, frame_length ) )
+        if( !(sample->flags & TIMELINE_SAMPLE_FLAG_DURATION) )
             return -1;
-        *frame_length *= s->extended.upsampling;
+        *frame_length = sample->duration * s->extended.upsampling;
     }
     else
         /* constant frame length */
@@ -604,7 +612,10 @@ static uint32_t get_preroll_samples
 {
     /* Some audio CODEC requires pre-roll for correct composition. */
     lsmash_sample_property_t prop;
-    if( lsmash_get_sample_property_from_media_timeline( adhp->root, adhp->track_id, *frame_number, &prop ) )
+    lock_shared_root( &adhp->config );
+    int err = lsmash_get_sample_property_from_media_timeline( adhp->root, adhp->track_id, *frame_number, &prop );
+    unlock_shared_root( &adhp->config );
+    if( err )
         return 0;
     if( prop.pre_roll.distance == 0 )
     {
@@ -81,6 +81,13 @@ void libavsmash_audio_set_preferred_decoder_names
     const char                       **preferred_decoder_names
 );
 
+/* Read the sample data following the buffered ones on a background thread. */
+void libavsmash_audio_set_prefetch
+(
+    libavsmash_audio_decode_handler_t *adhp,
+    int                                prefetch
+);
+
 void libavsmash_audio_set_codec_context
 (
     libavsmash_audio_decode_handler_t *adhp,
@@ -173,7 +180,7 @@ int libavsmash_audio_get_track
 int libavsmash_audio_initialize_decoder_configuration
 (
     libavsmash_audio_decode_handler_t *adhp,
-    AVFormatContext                   *format_ctx,
+    const char                        *file_name,
     int                                threads
 );
 
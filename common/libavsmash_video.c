@@ -166,6 +166,15 @@ void libavsmash_video_set_preferred_decoder_names
     vdhp->config.preferred_decoder_names = preferred_decoder_names;
 }
 
+void libavsmash_video_set_prefetch
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    int                                prefetch
+)
+{
+    vdhp->config.prefetch = prefetch;
+}
+
 void libavsmash_video_set_log_handler
 (
     libavsmash_video_decode_handler_t *vdhp,
@@ -376,54 +385,108 @@ int libavsmash_video_get_track
     if( track_id == 0 )
         return -1;
     libavsmash_video_set_track_id( vdhp, track_id );
+    libavsmash_lock_root( libavsmash_video_get_root( vdhp ) );
     (void)libavsmash_video_fetch_sample_count   ( vdhp );
     (void)libavsmash_video_fetch_media_duration ( vdhp );
     (void)libavsmash_video_fetch_media_timescale( vdhp );
+    libavsmash_unlock_root( libavsmash_video_get_root( vdhp ) );
     return 0;
 }
 
-int libavsmash_video_initialize_decoder_configuration
+static int open_video_codec_context
 (
     libavsmash_video_decode_handler_t *vdhp,
-    AVFormatContext                   *format_ctx,
+    const char                        *file_name,
     int                                threads
 )
 {
-    char error_string[128] = { 0 };
+    char            error_string[128] = { 0 };
+    AVCodecContext *ctx;
+    AVCodec        *codec;
     if( libavsmash_video_get_summaries( vdhp ) < 0 )
         return -1;
-    /* libavformat */
-    uint32_t type = AVMEDIA_TYPE_VIDEO;
-    uint32_t i;
-    for( i = 0; i < format_ctx->nb_streams && format_ctx->streams[i]->codec->codec_type != type; i++ );
-    if( i == format_ctx->nb_streams )
-    {
-        strcpy( error_string, "Failed to find stream by libavformat.\n" );
-        goto fail;
-    }
+    if( setup_codec_context( &vdhp->config, file_name, AVMEDIA_TYPE_VIDEO ) < 0 )
+        return -1;
     /* libavcodec */
-    AVCodecContext *ctx = format_ctx->streams[i]->codec;
-    AVCodec        *codec;
-    libavsmash_video_set_codec_context( vdhp, ctx );
+    ctx   = vdhp->config.ctx;
     codec = libavsmash_video_find_decoder( vdhp );
     if( !codec )
     {
-        sprintf( error_string, "Failed to find %s decoder.\n", codec->name );
+        strcpy( error_string, "Failed to find the decoder.\n" );
         goto fail;
     }
     ctx->thread_count = threads;
-    if( avcodec_open2( ctx, codec, NULL ) < 0 )
+    /* The CODEC context built without libavformat is opened by the first update of the decoder configuration. */
+    if( vdhp->config.format_ctx && avcodec_open2( ctx, codec, NULL ) < 0 )
     {
         strcpy( error_string, "Failed to avcodec_open2.\n" );
         goto fail;
     }
-    return initialize_decoder_configuration( vdhp->root, vdhp->track_id, &vdhp->config );
+    return 0;
 fail:;
     lw_log_handler_t *lhp = libavsmash_video_get_log_handler( vdhp );
     lw_log_show( lhp, LW_LOG_FATAL, "%s", error_string );
     return -1;
 }
 
+int libavsmash_video_initialize_decoder_configuration
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    const char                        *file_name,
+    int                                threads
+)
+{
+    if( open_video_codec_context( vdhp, file_name, threads ) < 0 )
+        return -1;
+    open_sample_reader( vdhp->root, vdhp->track_id, &vdhp->config, file_name );
+    vdhp->sample_count = exclude_unwritten_samples( vdhp->root, vdhp->track_id, &vdhp->config, &vdhp->media_duration );
+    return initialize_decoder_configuration( vdhp->root, vdhp->track_id, &vdhp->config );
+}
+
+int libavsmash_video_duplicate_decoder_configuration
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    libavsmash_video_decode_handler_t *src,
+    const char                        *file_name,
+    int                                threads
+)
+{
+    vdhp->track_id        = src->track_id;
+    vdhp->sample_count    = src->sample_count;
+    vdhp->media_duration  = src->media_duration;
+    vdhp->media_timescale = src->media_timescale;
+    vdhp->min_cts         = src->min_cts;
+    if( open_video_codec_context( vdhp, file_name, threads ) < 0
+     || duplicate_decoder_configuration( vdhp->root, vdhp->track_id, &vdhp->config, &src->config, file_name ) < 0 )
+        return -1;
+    /* Take over what libavsmash_video_setup_timestamp_info() and libavsmash_video_find_first_valid_frame() got. */
+    vdhp->config.ctx->refcounted_frames = 1;
+    vdhp->first_valid_frame_number      = src->first_valid_frame_number;
+    if( src->first_valid_frame )
+    {
+        vdhp->first_valid_frame = av_frame_clone( src->first_valid_frame );
+        if( !vdhp->first_valid_frame )
+            return -1;
+    }
+    if( src->order_converter )
+    {
+        size_t size = (vdhp->sample_count + 1) * sizeof(order_converter_t);
+        vdhp->order_converter = (order_converter_t *)lw_malloc_zero( size );
+        if( !vdhp->order_converter )
+            return -1;
+        memcpy( vdhp->order_converter, src->order_converter, size );
+    }
+    if( src->keyframe_list )
+    {
+        size_t size = (vdhp->sample_count + 1) * sizeof(uint8_t);
+        vdhp->keyframe_list = (uint8_t *)lw_malloc_zero( size );
+        if( !vdhp->keyframe_list )
+            return -1;
+        memcpy( vdhp->keyframe_list, src->keyframe_list, size );
+    }
+    return 0;
+}
+
 int libavsmash_video_get_summaries
 (
     libavsmash_video_decode_handler_t *vdhp
@@ -476,7 +539,11 @@ int libavsmash_video_get_cts
     uint64_t                          *cts
 )
 {
-    return lsmash_get_cts_from_media_timeline( vdhp->root, vdhp->track_id, coded_sample_number, cts );
+    timeline_sample_t *sample = get_timeline_sample( &vdhp->config, coded_sample_number );
+    if( !sample )
+        return -1;
+    *cts = sample->cts;
+    return 0;
 }
 
 int libavsmash_video_get_sample_duration
@@ -486,7 +553,11 @@ int libavsmash_video_get_sample_duration
     uint32_t                          *sample_duration
 )
 {
-    return lsmash_get_sample_delta_from_media_timeline( vdhp->root, vdhp->track_id, coded_sample_number, sample_duration );
+    timeline_sample_t *sample = get_timeline_sample( &vdhp->config, coded_sample_number );
+    if( !sample || !(sample->flags & TIMELINE_SAMPLE_FLAG_DURATION) )
+        return -1;
+    *sample_duration = sample->duration;
+    return 0;
 }
 
 void libavsmash_video_clear_error
@@ -502,10 +573,9 @@ void libavsmash_video_close_codec_context
     libavsmash_video_decode_handler_t *vdhp
 )
 {
-    if( !vdhp || !vdhp->config.ctx )
+    if( !vdhp )
         return;
-    avcodec_close( vdhp->config.ctx );
-    vdhp->config.ctx = NULL;
+    close_codec_context( &vdhp->config );
 }
 
 int libavsmash_video_setup_timestamp_info
@@ -518,7 +588,7 @@ int libavsmash_video_setup_timestamp_info
 {
     int err = -1;
     uint64_t media_timescale = lsmash_get_media_timescale( vdhp->root, vdhp->track_id );
-    uint64_t media_duration  = lsmash_get_media_duration_from_media_timeline( vdhp->root, vdhp->track_id );
+    uint64_t media_duration  = vdhp->media_duration;
     if( media_duration == 0 )
         media_duration = INT32_MAX;
     if( vdhp->sample_count == 1 )
@@ -532,16 +602,22 @@ int libavsmash_video_setup_timestamp_info
     }
     lw_log_handler_t *lhp = &vdhp->config.lh;
     lsmash_media_ts_list_t ts_list;
+    lock_shared_root( &vdhp->config );
     if( lsmash_get_media_timestamps( vdhp->root, vdhp->track_id, &ts_list ) < 0 )
     {
+        unlock_shared_root( &vdhp->config );
         lw_log_show( lhp, LW_LOG_ERROR, "Failed to get timestamps." );
         goto setup_finish;
     }
-    if( ts_list.sample_count != vdhp->sample_count )
+    unlock_shared_root( &vdhp->config );
+    if( ts_list.sample_count < vdhp->sample_count )
     {
+        lsmash_delete_media_timestamps( &ts_list );
         lw_log_show( lhp, LW_LOG_ERROR, "Failed to count number of video samples." );
         goto setup_finish;
     }
+    /* Drop the timestamps of the excluded unwritten samples, which are the last ones in decoding order. */
+    ts_list.sample_count = vdhp->sample_count;
     uint32_t composition_sample_delay;
     if( lsmash_get_max_sample_delay( &ts_list, &composition_sample_delay ) < 0 )
     {
@@ -620,7 +696,9 @@ setup_finish:;
     else
         vohp->frame_count = libavsmash_video_get_sample_count( vdhp );
     uint32_t min_cts_sample_number = get_decoding_sample_number( vdhp->order_converter, 1 );
+    lock_shared_root( &vdhp->config );
     vdhp->config.error = lsmash_get_cts_from_media_timeline( vdhp->root, vdhp->track_id, min_cts_sample_number, &vdhp->min_cts );
+    unlock_shared_root( &vdhp->config );
     return err;
 }
 
@@ -669,10 +747,12 @@ static int find_random_accessible_point
     lsmash_random_access_flag ra_flags;
     uint32_t distance;  /* distance from the closest random accessible point to the previous. */
     uint32_t number_of_leadings;
+    lock_shared_root( &vdhp->config );
     if( lsmash_get_closest_random_accessible_point_detail_from_media_timeline( vdhp->root, vdhp->track_id,
                                                                                decoding_sample_number, rap_number,
                                                                                &ra_flags, &number_of_leadings, &distance ) < 0 )
         *rap_number = 1;
+    unlock_shared_root( &vdhp->config );
     int roll_recovery = !!(ra_flags & ISOM_SAMPLE_RANDOM_ACCESS_FLAG_GDR);
     int is_leading    = number_of_leadings && (decoding_sample_number - *rap_number <= number_of_leadings);
     if( (roll_recovery || is_leading) && *rap_number > distance )
@@ -681,27 +761,27 @@ static int find_random_accessible_point
     decoding_sample_number = get_decoding_sample_number( vdhp->order_converter, composition_sample_number );
     do
     {
-        lsmash_sample_t sample;
-        lsmash_sample_t rap_sample;
-        if( lsmash_get_sample_info_from_media_timeline( vdhp->root, vdhp->track_id, decoding_sample_number, &sample ) < 0
-         || lsmash_get_sample_info_from_media_timeline( vdhp->root, vdhp->track_id, *rap_number, &rap_sample ) < 0 )
+        timeline_sample_t *sample     = get_timeline_sample( &vdhp->config, decoding_sample_number );
+        timeline_sample_t *rap_sample = get_timeline_sample( &vdhp->config, *rap_number );
+        if( !sample || !rap_sample )
         {
             /* Fatal error. */
             *rap_number = vdhp->last_rap_number;
             return 0;
         }
-        if( sample.index == rap_sample.index )
+        if( sample->index == rap_sample->index )
             break;
-        uint32_t sample_index = sample.index;
+        uint32_t sample_index = sample->index;
         for( uint32_t i = decoding_sample_number - 1; i; i-- )
         {
-            if( lsmash_get_sample_info_from_media_timeline( vdhp->root, vdhp->track_id, i, &sample ) < 0 )
+            sample = get_timeline_sample( &vdhp->config, i );
+            if( !sample )
             {
                 /* Fatal error. */
                 *rap_number = vdhp->last_rap_number;
                 return 0;
             }
-            if( sample.index != sample_index )
+            if( sample->index != sample_index )
             {
                 if( distance )
                 {
@@ -845,11 +925,11 @@ static int get_requested_picture
     if( sample_number < vdhp->first_valid_frame_number || vdhp->sample_count == 1 )
     {
         /* Get the index of the decoder configuration. */
-        lsmash_sample_t sample;
         uint32_t decoding_sample_number = get_decoding_sample_number( vdhp->order_converter, vdhp->first_valid_frame_number );
-        if( lsmash_get_sample_info_from_media_timeline( vdhp->root, vdhp->track_id, decoding_sample_number, &sample ) < 0 )
+        timeline_sample_t *sample = get_timeline_sample( config, decoding_sample_number );
+        if( !sample )
             goto video_fail;
-        config_index = sample.index;
+        config_index = sample->index;
         /* Copy the first valid video frame data. */
         av_frame_unref( picture );
         if( av_frame_ref( picture, vdhp->first_valid_frame ) < 0 )
@@ -944,13 +1024,14 @@ static uint32_t libavsmash_vfr2cfr
     /* Convert VFR to CFR. */
     double target_pts  = (double)((uint64_t)(sample_number - 1) * vohp->cfr_den) / vohp->cfr_num;
     double current_pts = DBL_MAX;
-    lsmash_sample_t sample;
+    timeline_sample_t *sample;
     if( vdhp->last_sample_number <= vdhp->sample_count )
     {
         uint32_t last_decoding_sample_number = get_decoding_sample_number( vdhp->order_converter, vdhp->last_sample_number );
-        if( lsmash_get_sample_info_from_media_timeline( vdhp->root, vdhp->track_id, last_decoding_sample_number, &sample ) < 0 )
+        sample = get_timeline_sample( &vdhp->config, last_decoding_sample_number );
+        if( !sample )
             return 0;
-        current_pts = (double)(sample.cts - vdhp->min_cts) / vdhp->media_timescale;
+        current_pts = (double)(sample->cts - vdhp->min_cts) / vdhp->media_timescale;
         if( target_pts == current_pts )
             return vdhp->last_sample_number;
     }
@@ -962,9 +1043,10 @@ static uint32_t libavsmash_vfr2cfr
              composition_sample_number-- )
         {
             uint32_t decoding_sample_number = get_decoding_sample_number( vdhp->order_converter, composition_sample_number );
-            if( lsmash_get_sample_info_from_media_timeline( vdhp->root, vdhp->track_id, decoding_sample_number, &sample ) < 0 )
+            sample = get_timeline_sample( &vdhp->config, decoding_sample_number );
+            if( !sample )
                 return 0;
-            current_pts = (double)(sample.cts - vdhp->min_cts) / vdhp->media_timescale;
+            current_pts = (double)(sample->cts - vdhp->min_cts) / vdhp->media_timescale;
             if( current_pts <= target_pts )
             {
                 sample_number = composition_sample_number;
@@ -982,9 +1064,10 @@ static uint32_t libavsmash_vfr2cfr
              composition_sample_number++ )
         {
             uint32_t decoding_sample_number = get_decoding_sample_number( vdhp->order_converter, composition_sample_number );
-            if( lsmash_get_sample_info_from_media_timeline( vdhp->root, vdhp->track_id, decoding_sample_number, &sample ) < 0 )
+            sample = get_timeline_sample( &vdhp->config, decoding_sample_number );
+            if( !sample )
                 return 0;
-            current_pts = (double)(sample.cts - vdhp->min_cts) / vdhp->media_timescale;
+            current_pts = (double)(sample->cts - vdhp->min_cts) / vdhp->media_timescale;
             if( current_pts > target_pts )
             {
                 sample_number = composition_sample_number - 1;
@@ -1022,6 +1105,42 @@ int libavsmash_video_get_frame
     return 0;
 }
 
+uint32_t libavsmash_video_get_closest_random_accessible_point
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    uint32_t                           sample_number
+)
+{
+    uint32_t rap_number;
+    for( rap_number = get_decoding_sample_number( vdhp->order_converter, sample_number ); rap_number > 1; rap_number-- )
+    {
+        timeline_sample_t *sample = get_timeline_sample( &vdhp->config, rap_number );
+        if( !sample || sample->ra_flags != ISOM_SAMPLE_RANDOM_ACCESS_FLAG_NONE )
+            break;
+    }
+    return rap_number;
+}
+
+uint32_t libavsmash_video_estimate_decoding_cost
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    uint32_t                           sample_number,
+    uint32_t                           rap_number
+)
+{
+    if( sample_number == vdhp->last_sample_number )
+        return 0;
+    uint32_t decoding_sample_number = get_decoding_sample_number( vdhp->order_converter, sample_number );
+    /* Decoding continues from the last decoded sample in the same way as get_requested_picture(). */
+    if( sample_number > vdhp->last_sample_number
+     && vdhp->last_sample_number <= vdhp->sample_count
+     && (sample_number <= vdhp->last_sample_number + vdhp->forward_seek_threshold
+      || rap_number == vdhp->last_rap_number) )
+        return sample_number - vdhp->last_sample_number;
+    /* A seek flushes the decoder and then decodes from the random accessible sample. */
+    return decoding_sample_number - rap_number + vdhp->config.delay_count + 2;
+}
+
 int libavsmash_video_find_first_valid_frame
 (
     libavsmash_video_decode_handler_t *vdhp
@@ -1064,12 +1183,8 @@ int libavsmash_video_create_keyframe_list
     for( uint32_t composition_sample_number = 1; composition_sample_number <= vdhp->sample_count; composition_sample_number++ )
     {
         uint32_t decoding_sample_number = get_decoding_sample_number( vdhp->order_converter, composition_sample_number );
-        uint32_t rap_number;
-        if( lsmash_get_closest_random_accessible_point_from_media_timeline( vdhp->root,
-                                                                            vdhp->track_id,
-                                                                            decoding_sample_number, &rap_number ) < 0 )
-            continue;
-        if( decoding_sample_number == rap_number )
+        timeline_sample_t *sample = get_timeline_sample( &vdhp->config, decoding_sample_number );
+        if( sample && sample->ra_flags != ISOM_SAMPLE_RANDOM_ACCESS_FLAG_NONE )
             vdhp->keyframe_list[composition_sample_number] = 1;
     }
     return 0;
@@ -94,6 +94,13 @@ void libavsmash_video_set_preferred_decoder_names
     const char                       **preferred_decoder_names
 );
 
+/* Read the sample data following the buffered ones on a background thread. */
+void libavsmash_video_set_prefetch
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    int                                prefetch
+);
+
 void libavsmash_video_set_log_handler
 (
     libavsmash_video_decode_handler_t *vdhp,
@@ -202,7 +209,17 @@ int libavsmash_video_get_track
 int libavsmash_video_initialize_decoder_configuration
 (
     libavsmash_video_decode_handler_t *vdhp,
-    AVFormatContext                   *format_ctx,
+    const char                        *file_name,
+    int                                threads
+);
+
+/* Set up the decoder of the same track as 'src', which has got the timestamps and the first valid frame,
+ * without investigating the track again. The ROOT of 'vdhp' shall be the one of 'src' or a reference to it. */
+int libavsmash_video_duplicate_decoder_configuration
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    libavsmash_video_decode_handler_t *src,
+    const char                        *file_name,
     int                                threads
 );
 
@@ -269,6 +286,24 @@ int libavsmash_video_get_frame
     uint32_t                           sample_number
 );
 
+/* Get the number of the closest random accessible sample preceding the requested frame in decoding order.
+ * Only the timeline and the composition order are read, so this is available while the decoder is used by another thread. */
+uint32_t libavsmash_video_get_closest_random_accessible_point
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    uint32_t                           sample_number
+);
+
+/* Estimate the number of samples to be decoded to get the requested frame from the current state of the decoder.
+ * 'rap_number' is the one returned by libavsmash_video_get_closest_random_accessible_point() for the frame.
+ * Return 0 if the frame is the one at the last call. */
+uint32_t libavsmash_video_estimate_decoding_cost
+(
+    libavsmash_video_decode_handler_t *vdhp,
+    uint32_t                           sample_number,
+    uint32_t                           rap_number
+);
+
 int libavsmash_video_find_first_valid_frame
 (
     libavsmash_video_decode_handler_t *vdhp
@@ -41,11 +41,18 @@ extern "C"
 #include "lwlibav_dec.h"
 #include "lwlibav_video.h"
 #include "lwlibav_video_internal.h"
+#include "audio_prefetch.h"
+#include "audio_decode_pool.h"
+#include "shared_demuxer.h"
 #include "lwlibav_audio.h"
 #include "lwlibav_audio_internal.h"
 #include "progress.h"
 #include "lwindex.h"
 
+/* The active video stream index written into the index file created without video indexing.
+ * Such an index file is never completed later. It is re-created with video indexing if video is required. */
+#define VIDEO_NOT_INDEXED -2
+
 typedef struct
 {
     lwlibav_extradata_handler_t exh;
@@ -1831,6 +1838,13 @@ static void create_index
     vdhp->format       = format_ctx;
     adhp->format       = format_ctx;
     adhp->dv_in_avi    = !strcmp( lwhp->format_name, "avi" ) ? -1 : 0;
+    /* Audio in AVI might be stored in DV video packets, so it requires video indexing. */
+    int audio_only = opt->audio_only && !opt->av_sync && adhp->dv_in_avi == 0;
+    if( audio_only )
+        /* Let the demuxer skip video packets as much as possible. */
+        for( unsigned int stream_index = 0; stream_index < format_ctx->nb_streams; stream_index++ )
+            if( format_ctx->streams[stream_index]->codec->codec_type == AVMEDIA_TYPE_VIDEO )
+                format_ctx->streams[stream_index]->discard = AVDISCARD_ALL;
     int32_t video_index_pos = 0;
     int32_t audio_index_pos = 0;
     if( index )
@@ -1840,7 +1854,7 @@ static void create_index
         fprintf( index, "<InputFilePath>%s</InputFilePath>\n", lwhp->file_path );
         fprintf( index, "<LibavReaderIndex=0x%08x,%d,%s>\n", lwhp->format_flags, lwhp->raw_demuxer, lwhp->format_name );
         video_index_pos = ftell( index );
-        fprintf( index, "<ActiveVideoStreamIndex>%+011d</ActiveVideoStreamIndex>\n", -1 );
+        fprintf( index, "<ActiveVideoStreamIndex>%+011d</ActiveVideoStreamIndex>\n", audio_only ? VIDEO_NOT_INDEXED : -1 );
         audio_index_pos = ftell( index );
         fprintf( index, "<ActiveAudioStreamIndex>%+011d</ActiveAudioStreamIndex>\n", -1 );
     }
@@ -1870,6 +1884,12 @@ static void create_index
             continue;
         if( pkt_ctx->codec_id == AV_CODEC_ID_NONE )
             continue;
+        if( audio_only && pkt_ctx->codec_type == AVMEDIA_TYPE_VIDEO )
+        {
+            /* Some demuxers ignore the discard flag. */
+            av_packet_unref( &pkt );
+            continue;
+        }
         if( !av_codec_is_decoder( pkt_ctx->codec ) )
         {
             const char **preferred_decoder_names = pkt_ctx->codec_type == AVMEDIA_TYPE_VIDEO
@@ -2477,13 +2497,194 @@ fail_index:
     return;
 }
 
+typedef struct
+{
+    lwlibav_audio_decode_handler_t *adhp;
+    lwlibav_audio_output_handler_t *aohp;
+    audio_frame_info_t             *info;
+    uint32_t                        info_count;
+    uint32_t                        sample_count;
+    int                             sample_rate;
+    int                             constant_frame_length;
+    uint64_t                        duration;
+} audio_index_track_t;
+
+static int init_audio_index_track
+(
+    audio_index_track_t *track
+)
+{
+    track->info                  = NULL;
+    track->info_count            = 1 << 16;
+    track->sample_count          = 0;
+    track->sample_rate           = 0;
+    track->constant_frame_length = 1;
+    track->duration              = 0;
+    track->adhp->codec_id             = AV_CODEC_ID_NONE;
+    track->aohp->output_sample_format = AV_SAMPLE_FMT_NONE;
+    if( track->adhp->stream_index < 0 )
+        return 0;
+    track->info = (audio_frame_info_t *)lw_malloc_zero( track->info_count * sizeof(audio_frame_info_t) );
+    return track->info ? 0 : -1;
+}
+
+static audio_index_track_t *find_audio_index_track
+(
+    audio_index_track_t *tracks,
+    int                  track_count,
+    int                  stream_index
+)
+{
+    for( int i = 0; i < track_count; i++ )
+        if( tracks[i].adhp->stream_index == stream_index )
+            return &tracks[i];
+    return NULL;
+}
+
+/* Append a track with newly allocated handlers for the audio stream.
+ * The track is counted even on failure so that the caller frees what has been allocated. */
+static audio_index_track_t *add_audio_index_track
+(
+    audio_index_track_t **tracks,
+    int                  *track_count,
+    int                   stream_index
+)
+{
+    audio_index_track_t *temp = (audio_index_track_t *)realloc( *tracks, (*track_count + 1) * sizeof(audio_index_track_t) );
+    if( !temp )
+        return NULL;
+    *tracks = temp;
+    audio_index_track_t *track = &temp[ (*track_count)++ ];
+    memset( track, 0, sizeof(audio_index_track_t) );
+    track->adhp = lwlibav_audio_alloc_decode_handler();
+    track->aohp = lwlibav_audio_alloc_output_handler();
+    if( !track->adhp || !track->aohp )
+        return NULL;
+    track->adhp->stream_index = stream_index;
+    return track;
+}
+
+static void free_audio_index_tracks
+(
+    audio_index_track_t *tracks,
+    int                  track_count
+)
+{
+    for( int i = 0; i < track_count; i++ )
+    {
+        free( tracks[i].info );
+        lwlibav_audio_free_decode_handler( tracks[i].adhp );
+        lwlibav_audio_free_output_handler( tracks[i].aohp );
+    }
+    free( tracks );
+}
+
+static int compare_stream_index
+(
+    const audio_index_track_t *a,
+    const audio_index_track_t *b
+)
+{
+    int diff = a->adhp->stream_index - b->adhp->stream_index;
+    return diff > 0 ? 1 : (diff == 0 ? 0 : -1);
+}
+
+static int parse_audio_frame_info
+(
+    audio_index_track_t *track,
+    const char          *buf,
+    int                  codec_id,
+    AVRational           time_base,
+    int64_t              pos,
+    int64_t              pts,
+    int64_t              dts,
+    int                  extradata_index
+)
+{
+    lwlibav_audio_decode_handler_t *adhp = track->adhp;
+    lwlibav_audio_output_handler_t *aohp = track->aohp;
+    uint64_t layout;
+    int      channels;
+    int      sample_rate;
+    char     sample_fmt[64];
+    int      bits_per_sample;
+    int      frame_length;
+    if( sscanf( buf, "Channels=%d:0x%"SCNx64",Rate=%d,Format=%[^,],BPS=%d,Length=%d",
+                &channels, &layout, &sample_rate, sample_fmt, &bits_per_sample, &frame_length ) != 6 )
+        return -1;
+    if( adhp->codec_id == AV_CODEC_ID_NONE )
+        adhp->codec_id = (enum AVCodecID)codec_id;
+    if( (channels | layout | sample_rate | bits_per_sample) && track->duration <= INT32_MAX )
+    {
+        if( track->sample_rate == 0 )
+            track->sample_rate = sample_rate;
+        if( adhp->time_base.num == 0 || adhp->time_base.den == 0 )
+        {
+            adhp->time_base.num = time_base.num;
+            adhp->time_base.den = time_base.den;
+        }
+        if( layout == 0 )
+            layout = av_get_default_channel_layout( channels );
+        if( av_get_channel_layout_nb_channels( layout )
+          > av_get_channel_layout_nb_channels( aohp->output_channel_layout ) )
+            aohp->output_channel_layout = layout;
+        aohp->output_sample_format   = select_better_sample_format( aohp->output_sample_format,
+                                                                    av_get_sample_fmt( (const char *)sample_fmt ) );
+        aohp->output_sample_rate     = MAX( aohp->output_sample_rate, track->sample_rate );
+        aohp->output_bits_per_sample = MAX( aohp->output_bits_per_sample, bits_per_sample );
+        ++ track->sample_count;
+        audio_frame_info_t *info = &track->info[ track->sample_count ];
+        info->pts             = pts;
+        info->dts             = dts;
+        info->file_offset     = pos;
+        info->sample_number   = track->sample_count;
+        info->extradata_index = extradata_index;
+        info->sample_rate     = sample_rate;
+    }
+    else
+        for( uint32_t i = 1; i <= adhp->exh.delay_count; i++ )
+        {
+            uint32_t audio_frame_number = track->sample_count - adhp->exh.delay_count + i;
+            if( audio_frame_number > track->sample_count )
+                return -1;
+            track->info[audio_frame_number].length = frame_length;
+            if( audio_frame_number > 1 && track->info[audio_frame_number].length != track->info[audio_frame_number - 1].length )
+                track->constant_frame_length = 0;
+            track->duration += frame_length;
+        }
+    if( track->sample_count + 1 == track->info_count )
+    {
+        track->info_count <<= 1;
+        audio_frame_info_t *temp = (audio_frame_info_t *)realloc( track->info, track->info_count * sizeof(audio_frame_info_t) );
+        if( !temp )
+            return -1;
+        track->info = temp;
+    }
+    if( frame_length == -1 )
+        ++ adhp->exh.delay_count;
+    else if( track->sample_count > adhp->exh.delay_count )
+    {
+        uint32_t audio_frame_number = track->sample_count - adhp->exh.delay_count;
+        track->info[audio_frame_number].length = frame_length;
+        if( audio_frame_number > 1 && track->info[audio_frame_number].length != track->info[audio_frame_number - 1].length )
+            track->constant_frame_length = 0;
+        track->duration += frame_length;
+    }
+    return 0;
+}
+
+/* Parse the index file for the video stream and the audio streams of '*tracks'.
+ * The stream of the first track is decided by 'opt'. The other tracks shall have their stream indexes set.
+ * If 'take_all' is set, a track is appended to '*tracks' for every audio stream found in the index file
+ * and the tracks without any valid audio frame are dropped. */
 static int parse_index
 (
     lwlibav_file_handler_t         *lwhp,
     lwlibav_video_decode_handler_t *vdhp,
     lwlibav_video_output_handler_t *vohp,
-    lwlibav_audio_decode_handler_t *adhp,
-    lwlibav_audio_output_handler_t *aohp,
+    audio_index_track_t           **tracks,
+    int                            *track_count,
+    int                             take_all,
     lwlibav_option_t               *opt,
     FILE                           *index
 )
@@ -2512,40 +2713,44 @@ static int parse_index
     if( fscanf( index, "<ActiveVideoStreamIndex>%d</ActiveVideoStreamIndex>\n", &active_video_index ) != 1
      || fscanf( index, "<ActiveAudioStreamIndex>%d</ActiveAudioStreamIndex>\n", &active_audio_index ) != 1 )
         return -1;
+    /* The index file created in audio-only mode has no information about video streams.
+     * Then, the index file shall be re-created if video is required. */
+    int video_indexed = (active_video_index != VIDEO_NOT_INDEXED);
+    if( !video_indexed )
+    {
+        if( !opt->audio_only )
+            return -1;
+        active_video_index = -1;
+    }
+    /* The first track is the one of the stream decided by 'opt'.
+     * Audio in AVI stored in DV video packets is handled only for this track. */
+    lwlibav_audio_decode_handler_t *first_adhp = !take_all && *track_count > 0 ? (*tracks)[0].adhp : NULL;
     lwhp->format_name = format_name;
-    adhp->dv_in_avi = !strcmp( lwhp->format_name, "avi" ) ? -1 : 0;
     int video_present = (active_video_index >= 0);
     int audio_present = (active_audio_index >= 0);
     vdhp->stream_index = opt->force_video ? opt->force_video_index : active_video_index;
-    adhp->stream_index = opt->force_audio ? opt->force_audio_index : active_audio_index;
+    if( first_adhp )
+    {
+        first_adhp->dv_in_avi    = !strcmp( lwhp->format_name, "avi" ) ? -1 : 0;
+        first_adhp->stream_index = opt->force_audio ? opt->force_audio_index : active_audio_index;
+    }
     uint32_t video_info_count = 1 << 16;
-    uint32_t audio_info_count = 1 << 16;
     video_frame_info_t *video_info = NULL;
-    audio_frame_info_t *audio_info = NULL;
     if( vdhp->stream_index >= 0 )
     {
         video_info = (video_frame_info_t *)lw_malloc_zero( video_info_count * sizeof(video_frame_info_t) );
         if( !video_info )
             goto fail_parsing;
     }
-    if( adhp->stream_index >= 0 )
-    {
-        audio_info = (audio_frame_info_t *)lw_malloc_zero( audio_info_count * sizeof(audio_frame_info_t) );
-        if( !audio_info )
+    for( int i = 0; i < *track_count; i++ )
+        if( init_audio_index_track( &(*tracks)[i] ) < 0 )
             goto fail_parsing;
-    }
     vdhp->codec_id             = AV_CODEC_ID_NONE;
-    adhp->codec_id             = AV_CODEC_ID_NONE;
     vdhp->initial_pix_fmt      = AV_PIX_FMT_NONE;
     vdhp->initial_colorspace   = AVCOL_SPC_NB;
-    aohp->output_sample_format = AV_SAMPLE_FMT_NONE;
     uint32_t video_sample_count    = 0;
     uint32_t invisible_count       = 0;
     int64_t  last_keyframe_pts     = AV_NOPTS_VALUE;
-    uint32_t audio_sample_count    = 0;
-    int      audio_sample_rate     = 0;
-    int      constant_frame_length = 1;
-    uint64_t audio_duration        = 0;
     char buf[1024];
     while( fgets( buf, sizeof(buf), index ) )
     {
@@ -2564,9 +2769,9 @@ static int parse_index
         {
             if( !fgets( buf, sizeof(buf), index ) )
                 goto fail_parsing;
-            if( adhp->dv_in_avi == -1 && codec_id == AV_CODEC_ID_DVVIDEO && !opt->force_audio )
+            if( first_adhp && first_adhp->dv_in_avi == -1 && codec_id == AV_CODEC_ID_DVVIDEO && !opt->force_audio )
             {
-                adhp->dv_in_avi = 1;
+                first_adhp->dv_in_avi = 1;
                 if( vdhp->stream_index == -1 )
                 {
                     vdhp->stream_index = stream_index;
@@ -2661,83 +2866,42 @@ static int parse_index
         {
             if( !fgets( buf, sizeof(buf), index ) )
                 goto fail_parsing;
-            if( stream_index == adhp->stream_index )
+            audio_index_track_t *track = find_audio_index_track( *tracks, *track_count, stream_index );
+            if( !track && take_all )
             {
-                uint64_t layout;
-                int      channels;
-                int      sample_rate;
-                char     sample_fmt[64];
-                int      bits_per_sample;
-                int      frame_length;
-                if( sscanf( buf, "Channels=%d:0x%"SCNx64",Rate=%d,Format=%[^,],BPS=%d,Length=%d",
-                            &channels, &layout, &sample_rate, sample_fmt, &bits_per_sample, &frame_length ) != 6 )
+                track = add_audio_index_track( tracks, track_count, stream_index );
+                if( !track || init_audio_index_track( track ) < 0 )
                     goto fail_parsing;
-                if( adhp->codec_id == AV_CODEC_ID_NONE )
-                    adhp->codec_id = (enum AVCodecID)codec_id;
-                if( (channels | layout | sample_rate | bits_per_sample) && audio_duration <= INT32_MAX )
-                {
-                    if( audio_sample_rate == 0 )
-                        audio_sample_rate = sample_rate;
-                    if( adhp->time_base.num == 0 || adhp->time_base.den == 0 )
-                    {
-                        adhp->time_base.num = time_base.num;
-                        adhp->time_base.den = time_base.den;
-                    }
-                    if( layout == 0 )
-                        layout = av_get_default_channel_layout( channels );
-                    if( av_get_channel_layout_nb_channels( layout )
-                      > av_get_channel_layout_nb_channels( aohp->output_channel_layout ) )
-                        aohp->output_channel_layout = layout;
-                    aohp->output_sample_format   = select_better_sample_format( aohp->output_sample_format,
-                                                                                av_get_sample_fmt( (const char *)sample_fmt ) );
-                    aohp->output_sample_rate     = MAX( aohp->output_sample_rate, audio_sample_rate );
-                    aohp->output_bits_per_sample = MAX( aohp->output_bits_per_sample, bits_per_sample );
-                    ++audio_sample_count;
-                    audio_frame_info_t *info = &audio_info[audio_sample_count];
-                    info->pts             = pts;
-                    info->dts             = dts;
-                    info->file_offset     = pos;
-                    info->sample_number   = audio_sample_count;
-                    info->extradata_index = extradata_index;
-                    info->sample_rate     = sample_rate;
-                }
-                else
-                    for( uint32_t i = 1; i <= adhp->exh.delay_count; i++ )
-                    {
-                        uint32_t audio_frame_number = audio_sample_count - adhp->exh.delay_count + i;
-                        if( audio_frame_number > audio_sample_count )
-                            goto fail_parsing;
-                        audio_info[audio_frame_number].length = frame_length;
-                        if( audio_frame_number > 1 && audio_info[audio_frame_number].length != audio_info[audio_frame_number - 1].length )
-                            constant_frame_length = 0;
-                        audio_duration += frame_length;
-                    }
-                if( audio_sample_count + 1 == audio_info_count )
-                {
-                    audio_info_count <<= 1;
-                    audio_frame_info_t *temp = (audio_frame_info_t *)realloc( audio_info, audio_info_count * sizeof(audio_frame_info_t) );
-                    if( !temp )
-                        goto fail_parsing;
-                    audio_info = temp;
-                }
-                if( frame_length == -1 )
-                    ++ adhp->exh.delay_count;
-                else if( audio_sample_count > adhp->exh.delay_count )
-                {
-                    uint32_t audio_frame_number = audio_sample_count - adhp->exh.delay_count;
-                    audio_info[audio_frame_number].length = frame_length;
-                    if( audio_frame_number > 1 && audio_info[audio_frame_number].length != audio_info[audio_frame_number - 1].length )
-                        constant_frame_length = 0;
-                    audio_duration += frame_length;
-                }
             }
+            if( track && parse_audio_frame_info( track, buf, codec_id, time_base, pos, pts, dts, extradata_index ) < 0 )
+                goto fail_parsing;
         }
     }
     if( video_present && opt->force_video && opt->force_video_index != -1
      && (video_sample_count == 0 || vdhp->initial_pix_fmt == AV_PIX_FMT_NONE || vdhp->initial_width == 0 || vdhp->initial_height == 0) )
         goto fail_parsing;  /* Need to re-create the index file. */
-    if( audio_present && opt->force_audio && opt->force_audio_index != -1 && (audio_sample_count == 0 || audio_duration == 0) )
-        goto fail_parsing;  /* Need to re-create the index file. */
+    if( take_all )
+    {
+        /* Drop the streams without any valid audio frame. */
+        int valid_count = 0;
+        for( int i = 0; i < *track_count; i++ )
+        {
+            audio_index_track_t *track = &(*tracks)[i];
+            if( track->sample_count == 0 || track->duration == 0 )
+            {
+                free( track->info );
+                lwlibav_audio_free_decode_handler( track->adhp );
+                lwlibav_audio_free_output_handler( track->aohp );
+            }
+            else
+                (*tracks)[ valid_count++ ] = *track;
+        }
+        *track_count = valid_count;
+    }
+    else if( audio_present && opt->force_audio && opt->force_audio_index != -1 )
+        for( int i = 0; i < *track_count; i++ )
+            if( (*tracks)[i].sample_count == 0 || (*tracks)[i].duration == 0 )
+                goto fail_parsing;  /* Need to re-create the index file. */
     if( strncmp( buf, "</LibavReaderIndex>", strlen( "</LibavReaderIndex>" ) ) )
         goto fail_parsing;
     /* Parse stream durations. */
@@ -2765,6 +2929,9 @@ static int parse_index
             goto fail_parsing;
         if( !fgets( buf, sizeof(buf), index ) )
             goto fail_parsing;
+        audio_index_track_t *track = codec_type == AVMEDIA_TYPE_AUDIO
+                                   ? find_audio_index_track( *tracks, *track_count, stream_index )
+                                   : NULL;
         if( index_entries_count > 0 )
         {
             if( codec_type == AVMEDIA_TYPE_VIDEO && stream_index == vdhp->stream_index )
@@ -2788,13 +2955,13 @@ static int parse_index
                         goto fail_parsing;
                 }
             }
-            else if( codec_type == AVMEDIA_TYPE_AUDIO && stream_index == adhp->stream_index )
+            else if( track )
             {
-                adhp->index_entries_count = index_entries_count;
-                adhp->index_entries = (AVIndexEntry *)av_malloc( adhp->index_entries_count * sizeof(AVIndexEntry) );
-                if( !adhp->index_entries )
+                track->adhp->index_entries_count = index_entries_count;
+                track->adhp->index_entries = (AVIndexEntry *)av_malloc( track->adhp->index_entries_count * sizeof(AVIndexEntry) );
+                if( !track->adhp->index_entries )
                     goto fail_parsing;
-                for( int i = 0; i < adhp->index_entries_count; i++ )
+                for( int i = 0; i < track->adhp->index_entries_count; i++ )
                 {
                     AVIndexEntry ie;
                     int size;
@@ -2804,7 +2971,7 @@ static int parse_index
                         break;
                     ie.size  = size;
                     ie.flags = flags;
-                    adhp->index_entries[i] = ie;
+                    track->adhp->index_entries[i] = ie;
                     if( !fgets( buf, sizeof(buf), index ) )
                         goto fail_parsing;
                 }
@@ -2829,17 +2996,19 @@ static int parse_index
             goto fail_parsing;
         if( !fgets( buf, sizeof(buf), index ) )
             goto fail_parsing;
+        audio_index_track_t *track = codec_type == AVMEDIA_TYPE_AUDIO
+                                   ? find_audio_index_track( *tracks, *track_count, stream_index )
+                                   : NULL;
         if( entry_count > 0 )
         {
-            if( (codec_type == AVMEDIA_TYPE_VIDEO && stream_index == vdhp->stream_index)
-             || (codec_type == AVMEDIA_TYPE_AUDIO && stream_index == adhp->stream_index) )
+            if( (codec_type == AVMEDIA_TYPE_VIDEO && stream_index == vdhp->stream_index) || track )
             {
-                lwlibav_extradata_handler_t *exhp = codec_type == AVMEDIA_TYPE_VIDEO ? &vdhp->exh : &adhp->exh;
+                lwlibav_extradata_handler_t *exhp = codec_type == AVMEDIA_TYPE_VIDEO ? &vdhp->exh : &track->adhp->exh;
                 if( !alloc_extradata_entries( exhp, entry_count ) )
                     goto fail_parsing;
                 exhp->current_index = codec_type == AVMEDIA_TYPE_VIDEO
                                     ? video_info[1].extradata_index
-                                    : audio_info[1].extradata_index;
+                                    : track->info[1].extradata_index;
                 for( int i = 0; i < exhp->entry_count; i++ )
                 {
                     lwlibav_extradata_t *entry = &exhp->entries[i];
@@ -2923,20 +3092,24 @@ static int parse_index
             /* Exclude invisible frames from the output handler. */
             create_video_visible_frame_list( vdhp, vohp, invisible_count );
         }
-        if( adhp->stream_index >= 0 )
+        for( int i = 0; i < *track_count; i++ )
         {
+            audio_index_track_t            *track = &(*tracks)[i];
+            lwlibav_audio_decode_handler_t *adhp  = track->adhp;
+            if( adhp->stream_index < 0 )
+                continue;
             if( adhp->dv_in_avi == 1 && adhp->index_entries_count == 0 )
             {
                 /* DV in AVI Type-1 */
-                audio_sample_count = MIN( video_sample_count, audio_sample_count );
-                for( uint32_t i = 0; i <= audio_sample_count; i++ )
+                track->sample_count = MIN( video_sample_count, track->sample_count );
+                for( uint32_t j = 0; j <= track->sample_count; j++ )
                 {
-                    audio_info[i].keyframe        = !!(video_info[i].flags & LW_VFRAME_FLAG_KEY);
-                    audio_info[i].sample_number   = video_info[i].sample_number;
-                    audio_info[i].pts             = video_info[i].pts;
-                    audio_info[i].dts             = video_info[i].dts;
-                    audio_info[i].file_offset     = video_info[i].file_offset;
-                    audio_info[i].extradata_index = video_info[i].extradata_index;
+                    track->info[j].keyframe        = !!(video_info[j].flags & LW_VFRAME_FLAG_KEY);
+                    track->info[j].sample_number   = video_info[j].sample_number;
+                    track->info[j].pts             = video_info[j].pts;
+                    track->info[j].dts             = video_info[j].dts;
+                    track->info[j].file_offset     = video_info[j].file_offset;
+                    track->info[j].extradata_index = video_info[j].extradata_index;
                 }
             }
             else
@@ -2949,50 +3122,65 @@ static int parse_index
                 }
                 adhp->dv_in_avi = 0;
             }
-            adhp->frame_list   = audio_info;
-            adhp->frame_count  = audio_sample_count;
-            adhp->frame_length = constant_frame_length ? audio_info[1].length : 0;
-            decide_audio_seek_method( lwhp, adhp, audio_sample_count );
+            adhp->frame_list   = track->info;
+            adhp->frame_count  = track->sample_count;
+            adhp->frame_length = track->constant_frame_length ? track->info[1].length : 0;
+            decide_audio_seek_method( lwhp, adhp, track->sample_count );
             if( opt->av_sync && vdhp->stream_index >= 0 )
-                lwhp->av_gap = calculate_av_gap( vdhp, vohp, adhp, audio_sample_rate );
+                lwhp->av_gap = calculate_av_gap( vdhp, vohp, adhp, track->sample_rate );
         }
-        if( vdhp->stream_index != active_video_index || adhp->stream_index != active_audio_index )
+        if( vdhp->stream_index != active_video_index || (first_adhp && first_adhp->stream_index != active_audio_index) )
         {
             /* Update the active stream indexes when specifying different stream indexes. */
             fseek( index, active_index_pos, SEEK_SET );
-            fprintf( index, "<ActiveVideoStreamIndex>%+011d</ActiveVideoStreamIndex>\n", vdhp->stream_index );
-            fprintf( index, "<ActiveAudioStreamIndex>%+011d</ActiveAudioStreamIndex>\n", adhp->stream_index );
+            fprintf( index, "<ActiveVideoStreamIndex>%+011d</ActiveVideoStreamIndex>\n", video_indexed ? vdhp->stream_index : VIDEO_NOT_INDEXED );
+            fprintf( index, "<ActiveAudioStreamIndex>%+011d</ActiveAudioStreamIndex>\n", first_adhp ? first_adhp->stream_index : active_audio_index );
         }
         return 0;
     }
 fail_parsing:
     vdhp->frame_list = NULL;
-    adhp->frame_list = NULL;
     if( video_info )
         free( video_info );
-    if( audio_info )
-        free( audio_info );
+    for( int i = 0; i < *track_count; i++ )
+    {
+        audio_index_track_t *track = &(*tracks)[i];
+        if( track->adhp )
+            track->adhp->frame_list = NULL;
+        lw_freep( &track->info );
+    }
     return -1;
 }
 
-int lwlibav_construct_index
+/* Construct the index of the video stream and the audio stream by parsing the index file. */
+static int parse_single_index
 (
     lwlibav_file_handler_t         *lwhp,
     lwlibav_video_decode_handler_t *vdhp,
     lwlibav_video_output_handler_t *vohp,
     lwlibav_audio_decode_handler_t *adhp,
     lwlibav_audio_output_handler_t *aohp,
-    lw_log_handler_t               *lhp,
     lwlibav_option_t               *opt,
-    progress_indicator_t           *indicator,
-    progress_handler_t             *php
+    FILE                           *index
+)
+{
+    audio_index_track_t  track  = { adhp, aohp };
+    audio_index_track_t *tracks = &track;
+    int track_count = 1;
+    return parse_index( lwhp, vdhp, vohp, &tracks, &track_count, 0, opt, index );
+}
+
+/* Open the index file of 'opt->file_path' and check its version. */
+static FILE *open_index_file
+(
+    lwlibav_option_t *opt,
+    const char       *mode
 )
 {
-    /* Try to open the index file. */
     int file_path_length = strlen( opt->file_path );
     char *index_file_path = (char *)lw_malloc_zero(file_path_length + 5);
     if( !index_file_path )
-        return -1;
+        return NULL;
     memcpy( index_file_path, opt->file_path, file_path_length );
     const char *ext = file_path_length >= 5 ? &opt->file_path[file_path_length - 4] : NULL;
     int has_lwi_ext = ext && !strncmp( ext, ".lwi", strlen( ".lwi" ) );
@@ -3003,28 +3191,61 @@ int lwlibav_construct_index
         memcpy( index_file_path + file_path_length, ".lwi", strlen( ".lwi" ) );
         index_file_path[file_path_length + 4] = '\0';
     }
-    FILE *index = fopen( index_file_path, (opt->force_video || opt->force_audio) ? "r+b" : "rb" );
+    FILE *index = fopen( index_file_path, mode );
     free( index_file_path );
-    if( index )
+    if( !index )
+        return NULL;
+    int version = 0;
+    int ret = fscanf( index, "<LibavReaderIndexFile=%d>\n", &version );
+    if( ret != 1 || version != INDEX_FILE_VERSION )
     {
-        int version = 0;
-        int ret = fscanf( index, "<LibavReaderIndexFile=%d>\n", &version );
-        if( ret == 1
-         && version == INDEX_FILE_VERSION
-         && parse_index( lwhp, vdhp, vohp, adhp, aohp, opt, index ) == 0 )
-        {
-            /* Opening and parsing the index file succeeded. */
-            fclose( index );
-            av_register_all();
-            avcodec_register_all();
-            lwhp->threads = opt->threads;
-            return 0;
-        }
         fclose( index );
+        return NULL;
     }
+    return index;
+}
+
+static int get_audio_stream_indexes
+(
+    AVFormatContext *format_ctx,
+    int            **stream_indexes,
+    int             *stream_index_count
+)
+{
+    *stream_indexes     = (int *)lw_malloc_zero( format_ctx->nb_streams * sizeof(int) );
+    *stream_index_count = 0;
+    if( !*stream_indexes )
+        return -1;
+    for( unsigned int stream_index = 0; stream_index < format_ctx->nb_streams; stream_index++ )
+        if( format_ctx->streams[stream_index]->codec->codec_type == AVMEDIA_TYPE_AUDIO )
+            (*stream_indexes)[ (*stream_index_count)++ ] = stream_index;
+    return 0;
+}
+
+/* Create the index by demuxing the file. The index file is also written unless 'opt->no_create_index' is set.
+ * If 'audio_stream_indexes' is not NULL, the indexes of all the audio streams in the file are also returned,
+ * which the caller shall free with lw_free(). */
+static int create_index_from_file
+(
+    lwlibav_file_handler_t         *lwhp,
+    lwlibav_video_decode_handler_t *vdhp,
+    lwlibav_video_output_handler_t *vohp,
+    lwlibav_audio_decode_handler_t *adhp,
+    lwlibav_audio_output_handler_t *aohp,
+    lw_log_handler_t               *lhp,
+    lwlibav_option_t               *opt,
+    progress_indicator_t           *indicator,
+    progress_handler_t             *php,
+    int                           **audio_stream_indexes,
+    int                            *audio_stream_count
+)
+{
     /* Open file. */
     if( !lwhp->file_path )
     {
+        int file_path_length = strlen( opt->file_path );
+        const char *ext = file_path_length >= 5 ? &opt->file_path[file_path_length - 4] : NULL;
+        int has_lwi_ext = ext && !strncmp( ext, ".lwi", strlen( ".lwi" ) );
         lwhp->file_path = (char *)lw_malloc_zero( file_path_length + 1 );
         if( !lwhp->file_path )
             goto fail;
@@ -3041,6 +3262,12 @@ int lwlibav_construct_index
             lavf_close_file( &format_ctx );
         goto fail;
     }
+    /* Take the stream list from the format context opened here instead of probing the file again. */
+    if( audio_stream_indexes && get_audio_stream_indexes( format_ctx, audio_stream_indexes, audio_stream_count ) < 0 )
+    {
+        lavf_close_file( &format_ctx );
+        goto fail;
+    }
     lwhp->threads      = opt->threads;
     vdhp->stream_index = -1;
     adhp->stream_index = -1;
@@ -3058,6 +3285,177 @@ fail:
     return -1;
 }
 
+int lwlibav_construct_index
+(
+    lwlibav_file_handler_t         *lwhp,
+    lwlibav_video_decode_handler_t *vdhp,
+    lwlibav_video_output_handler_t *vohp,
+    lwlibav_audio_decode_handler_t *adhp,
+    lwlibav_audio_output_handler_t *aohp,
+    lw_log_handler_t               *lhp,
+    lwlibav_option_t               *opt,
+    progress_indicator_t           *indicator,
+    progress_handler_t             *php
+)
+{
+    /* Try to open the index file. */
+    FILE *index = open_index_file( opt, (opt->force_video || opt->force_audio) ? "r+b" : "rb" );
+    if( index )
+    {
+        if( parse_single_index( lwhp, vdhp, vohp, adhp, aohp, opt, index ) == 0 )
+        {
+            /* Opening and parsing the index file succeeded. */
+            fclose( index );
+            av_register_all();
+            avcodec_register_all();
+            lwhp->threads = opt->threads;
+            return 0;
+        }
+        fclose( index );
+    }
+    return create_index_from_file( lwhp, vdhp, vohp, adhp, aohp, lhp, opt, indicator, php, NULL, NULL );
+}
+
+/* Parse the index file for the audio streams of the tracks.
+ * The video stream is not constructed even if it is in the index file. */
+static int parse_audio_index_tracks
+(
+    lwlibav_file_handler_t *lwhp,
+    audio_index_track_t   **tracks,
+    int                    *track_count,
+    int                     take_all,
+    lwlibav_option_t       *opt
+)
+{
+    FILE *index = open_index_file( opt, "r+b" );
+    if( !index )
+        return -1;
+    lwlibav_option_t audio_opt = *opt;
+    audio_opt.force_audio       = !take_all;
+    audio_opt.force_audio_index = take_all ? -1 : (*tracks)[0].adhp->stream_index;
+    lwlibav_video_decode_handler_t *vdhp = lwlibav_video_alloc_decode_handler();
+    lwlibav_video_output_handler_t *vohp = lwlibav_video_alloc_output_handler();
+    int ret = vdhp && vohp ? parse_index( lwhp, vdhp, vohp, tracks, track_count, take_all, &audio_opt, index ) : -1;
+    lwlibav_video_free_decode_handler( vdhp );
+    lwlibav_video_free_output_handler( vohp );
+    fclose( index );
+    return ret;
+}
+
+/* Create the index of the audio stream of the track by demuxing the file. */
+static int create_audio_index_track
+(
+    lwlibav_file_handler_t *lwhp,
+    audio_index_track_t    *track,
+    lw_log_handler_t       *lhp,
+    lwlibav_option_t       *opt,
+    progress_indicator_t   *indicator,
+    progress_handler_t     *php,
+    int                   **audio_stream_indexes,
+    int                    *audio_stream_count
+)
+{
+    lwlibav_option_t audio_opt = *opt;
+    audio_opt.force_audio       = (track->adhp->stream_index >= 0);
+    audio_opt.force_audio_index = track->adhp->stream_index;
+    lwlibav_video_decode_handler_t *vdhp = lwlibav_video_alloc_decode_handler();
+    lwlibav_video_output_handler_t *vohp = lwlibav_video_alloc_output_handler();
+    int ret = vdhp && vohp
+            ? create_index_from_file( lwhp, vdhp, vohp, track->adhp, track->aohp, lhp, &audio_opt, indicator, php,
+                                      audio_stream_indexes, audio_stream_count )
+            : -1;
+    lwlibav_video_free_decode_handler( vdhp );
+    lwlibav_video_free_output_handler( vohp );
+    return ret == 0 && track->adhp->frame_list ? 0 : -1;
+}
+
+int lwlibav_construct_audio_indexes
+(
+    lwlibav_file_handler_t *lwhp,
+    lwlibav_audio_track_t **tracks,
+    const int              *stream_indexes,
+    int                     stream_index_count,
+    lw_log_handler_t       *lhp,
+    lwlibav_option_t       *opt,
+    progress_indicator_t   *indicator,
+    progress_handler_t     *php
+)
+{
+    int                  take_all      = (stream_index_count == 0);
+    audio_index_track_t *index_tracks  = NULL;
+    int                  track_count   = 0;
+    int                 *found_indexes = NULL;
+    *tracks = NULL;
+    av_register_all();
+    avcodec_register_all();
+    /* Try to parse the index file once for all the tracks. */
+    for( int i = 0; i < stream_index_count; i++ )
+        if( !add_audio_index_track( &index_tracks, &track_count, stream_indexes[i] ) )
+            goto fail;
+    if( parse_audio_index_tracks( lwhp, &index_tracks, &track_count, take_all, opt ) == 0 && track_count > 0 )
+        goto construct_done;
+    free_audio_index_tracks( index_tracks, track_count );
+    index_tracks = NULL;
+    track_count  = 0;
+    lw_freep( &lwhp->file_path );
+    /* Index the first stream by demuxing the file, which also creates the index file. */
+    if( !add_audio_index_track( &index_tracks, &track_count, take_all ? -1 : stream_indexes[0] )
+     || create_audio_index_track( lwhp, &index_tracks[0], lhp, opt, indicator, php,
+                                  take_all ? &found_indexes : NULL, take_all ? &stream_index_count : NULL ) < 0 )
+        goto fail;
+    if( take_all )
+        stream_indexes = found_indexes;
+    for( int i = 0; i < stream_index_count; i++ )
+        if( stream_indexes[i] != index_tracks[0].adhp->stream_index
+         && !add_audio_index_track( &index_tracks, &track_count, stream_indexes[i] ) )
+            goto fail;
+    if( track_count > 1 )
+    {
+        audio_index_track_t *other_tracks = &index_tracks[1];
+        int other_track_count = track_count - 1;
+        if( !opt->no_create_index )
+        {
+            /* Parse the index file just created once for the other streams. */
+            lwlibav_file_handler_t lwh = { 0 };
+            int ret = parse_audio_index_tracks( &lwh, &other_tracks, &other_track_count, 0, opt );
+            lw_free( lwh.file_path );
+            if( ret < 0 )
+                goto fail;
+        }
+        else
+            /* There is no index file. Index each of the other streams by demuxing the file. */
+            for( int i = 0; i < other_track_count; i++ )
+            {
+                lwlibav_file_handler_t lwh = { 0 };
+                int ret = create_audio_index_track( &lwh, &other_tracks[i], lhp, opt, indicator, php, NULL, NULL );
+                lw_free( lwh.file_path );
+                if( ret < 0 )
+                    goto fail;
+            }
+    }
+construct_done:
+    if( take_all )
+        qsort( index_tracks, track_count, sizeof(audio_index_track_t), (int(*)( const void *, const void * ))compare_stream_index );
+    *tracks = (lwlibav_audio_track_t *)lw_malloc_zero( track_count * sizeof(lwlibav_audio_track_t) );
+    if( !*tracks )
+        goto fail;
+    for( int i = 0; i < track_count; i++ )
+    {
+        (*tracks)[i].adhp = index_tracks[i].adhp;
+        (*tracks)[i].aohp = index_tracks[i].aohp;
+    }
+    /* The frame info lists are owned by the decode handlers now. */
+    lw_free( index_tracks );
+    lw_free( found_indexes );
+    lwhp->threads = opt->threads;
+    return track_count;
+fail:
+    free_audio_index_tracks( index_tracks, track_count );
+    lw_free( found_indexes );
+    lw_freep( &lwhp->file_path );
+    return -1;
+}
+
 int lwlibav_import_av_index_entry
 (
     lwlibav_decode_handler_t *dhp
@@ -20,7 +20,7 @@
 
 /* This file is available under an ISC license. */
 
-#define INDEX_FILE_VERSION 13
+#define INDEX_FILE_VERSION 14
 
 typedef struct
 {
@@ -32,6 +32,7 @@ typedef struct
     int         force_video_index;
     int         force_audio;
     int         force_audio_index;
+    int         audio_only;         /* Don't index video streams if no index file is available. */
     int         apply_repeat_flag;
     int         field_dominance;
     struct
@@ -55,6 +56,28 @@ int lwlibav_construct_index
     progress_handler_t             *php
 );
 
+typedef struct
+{
+    lwlibav_audio_decode_handler_t *adhp;
+    lwlibav_audio_output_handler_t *aohp;
+} lwlibav_audio_track_t;
+
+/* Construct the indexes of several audio streams of the same file, parsing the index file only once.
+ * If 'stream_index_count' is 0, every audio stream in the file is constructed in the order of the stream index.
+ * Return the number of the tracks set in '*tracks', or -1 on failure.
+ * The caller takes over the handlers of the tracks and shall free '*tracks' with lw_free(). */
+int lwlibav_construct_audio_indexes
+(
+    lwlibav_file_handler_t *lwhp,
+    lwlibav_audio_track_t **tracks,
+    const int              *stream_indexes,
+    int                     stream_index_count,
+    lw_log_handler_t       *lhp,
+    lwlibav_option_t       *opt,
+    progress_indicator_t   *indicator,
+    progress_handler_t     *php
+);
+
 int lwlibav_import_av_index_entry
 (
     lwlibav_decode_handler_t *dhp
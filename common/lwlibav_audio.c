@@ -38,6 +38,9 @@ extern "C"
 #include "utils.h"
 #include "audio_output.h"
 #include "resample.h"
+#include "audio_prefetch.h"
+#include "audio_decode_pool.h"
+#include "shared_demuxer.h"
 
 #include "lwlibav_dec.h"
 #include "lwlibav_audio.h"
@@ -71,6 +74,24 @@ lwlibav_audio_output_handler_t *lwlibav_audio_alloc_output_handler
     return (lwlibav_audio_output_handler_t *)lw_malloc_zero( sizeof(lwlibav_audio_output_handler_t) );
 }
 
+static void close_audio_demuxer
+(
+    lwlibav_audio_decode_handler_t *adhp
+)
+{
+    if( adhp->shared_demuxer )
+    {
+        /* Only the last track closes the shared demuxer. */
+        AVFormatContext *format_ctx = lw_shared_demuxer_detach( adhp->shared_demuxer, adhp->stream_index );
+        adhp->shared_demuxer = NULL;
+        adhp->format         = format_ctx;
+        if( !format_ctx )
+            return;
+    }
+    if( adhp->format )
+        lavf_close_file( &adhp->format );
+}
+
 void lwlibav_audio_free_decode_handler
 (
     lwlibav_audio_decode_handler_t *adhp
@@ -78,6 +99,8 @@ void lwlibav_audio_free_decode_handler
 {
     if( !adhp )
         return;
+    lwlibav_audio_stop_prefetch( adhp );
+    lwlibav_audio_stop_parallel_decoding( adhp );
     lwlibav_extradata_handler_t *exhp = &adhp->exh;
     if( exhp->entries )
     {
@@ -95,8 +118,7 @@ void lwlibav_audio_free_decode_handler
         avcodec_close( adhp->ctx );
         adhp->ctx = NULL;
     }
-    if( adhp->format )
-        lavf_close_file( &adhp->format );
+    close_audio_demuxer( adhp );
     lw_free( adhp );
 }
 
@@ -170,7 +192,10 @@ lw_log_handler_t *lwlibav_audio_get_log_handler
     lwlibav_audio_decode_handler_t *adhp
 )
 {
-    return adhp ? &adhp->lh : NULL;
+    if( !adhp )
+        return NULL;
+    /* While decoding ahead, the decoder side log handler is owned by the worker thread. */
+    return adhp->prefetcher ? &adhp->caller_lh : &adhp->lh;
 }
 
 AVCodecContext *lwlibav_audio_get_codec_context
@@ -184,13 +209,26 @@ AVCodecContext *lwlibav_audio_get_codec_context
 /*****************************************************************************
  * Others
  *****************************************************************************/
+static void reset_next_pcm_sample_number
+(
+    void *priv
+)
+{
+    lwlibav_audio_decode_handler_t *adhp = (lwlibav_audio_decode_handler_t *)priv;
+    adhp->next_pcm_sample_number = adhp->pcm_sample_count + 1;
+}
+
 void lwlibav_audio_force_seek
 (
     lwlibav_audio_decode_handler_t *adhp
 )
 {
-    /* Force seek before the next reading. */
-    adhp->next_pcm_sample_number = adhp->pcm_sample_count + 1;
+    /* Force seek before the next reading.
+     * While decoding ahead, the worker owns the decoder state, so reset it while the worker is idle. */
+    if( adhp->prefetcher )
+        lw_audio_prefetcher_invalidate( adhp->prefetcher, reset_next_pcm_sample_number );
+    else
+        reset_next_pcm_sample_number( adhp );
 }
 
 int lwlibav_audio_get_desired_track
@@ -200,16 +238,16 @@ int lwlibav_audio_get_desired_track
     int                             threads
 )
 {
+    /* The demuxer shared with another track is already opened. */
     int error = adhp->stream_index < 0
              || adhp->frame_count == 0
-             || lavf_open_file( &adhp->format, file_path, &adhp->lh );
+             || (!adhp->shared_demuxer && lavf_open_file( &adhp->format, file_path, &adhp->lh ));
     AVCodecContext *ctx = !error ? adhp->format->streams[ adhp->stream_index ]->codec : NULL;
     if( error || find_and_open_decoder( ctx, adhp->codec_id, adhp->preferred_decoder_names, threads ) )
     {
         av_freep( &adhp->index_entries );
         lw_freep( &adhp->frame_list );
-        if( adhp->format )
-            lavf_close_file( &adhp->format );
+        close_audio_demuxer( adhp );
         return -1;
     }
     adhp->ctx = ctx;
@@ -252,6 +290,82 @@ uint64_t lwlibav_audio_count_overall_pcm_samples
     return overall_pcm_sample_count;
 }
 
+/* Return the size in bytes of the main data of the smallest MPEG-1/2/2.5 Audio Layer III frame.
+ * The bit reservoir reaches up to 511 bytes back, so this decides how many frames back it can reach. */
+static int get_mp3_min_main_data_size
+(
+    int sample_rate,
+    int channels
+)
+{
+    /* The lowest bit rate is 32 kbps for MPEG-1 and 8 kbps for MPEG-2/2.5, which use sample rates below 32 kHz. */
+    int lsf        = (sample_rate < 32000);
+    int frame_size = lsf ? 72 * 8000 / sample_rate : 144 * 32000 / sample_rate;
+    int side_info  = lsf ? (channels == 1 ?  9 : 17)
+                         : (channels == 1 ? 17 : 32);
+    /* the 4-byte header and the optional 2-byte CRC */
+    return MAX( frame_size - 6 - side_info, 1 );
+}
+
+/* Return the number of samples to be decoded and discarded before the desired frame of lossy audio
+ * so that the decoder reaches the same state as the continuous decoding.
+ * At least one frame is always decoded before since lossy codecs overlap the adjacent frames.
+ * Return 0 if the codec has no known bound of its dependency. */
+static uint64_t get_audio_preroll_length
+(
+    enum AVCodecID codec_id,
+    int            sample_rate,
+    int            channels
+)
+{
+    switch( codec_id )
+    {
+        case AV_CODEC_ID_MP1 :
+        case AV_CODEC_ID_MP2 :
+            /* the delay of the polyphase synthesis filterbank */
+            return 481;
+        case AV_CODEC_ID_MP3 :
+        {
+            /* the frames the bit reservoir can reach with the smallest frames, plus one for the overlap of the hybrid filterbank */
+            if( sample_rate <= 0 )
+                sample_rate = 48000;    /* the highest, which gives the smallest MPEG-1 frame */
+            int min_main_data_size = get_mp3_min_main_data_size( sample_rate, channels );
+            uint64_t frame_count = (511 + min_main_data_size - 1) / min_main_data_size + 1;
+            return frame_count * (sample_rate < 32000 ? 576 : 1152);
+        }
+        case AV_CODEC_ID_OPUS :
+            /* 80 ms, recommended by RFC 7845 to converge the decoder state */
+            return 3840;
+        default :
+            /* just the overlap with the previous frame */
+            return 0;
+    }
+}
+
+/* Return the sample rate the decoder runs at with the configuration, not the output one. */
+static int get_audio_sample_rate
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    int                             extradata_index
+)
+{
+    int sample_rate = adhp->exh.entries[extradata_index].sample_rate;
+    return sample_rate > 0 ? sample_rate : adhp->ctx->sample_rate;
+}
+
+static int get_audio_channel_count
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    int                             extradata_index
+)
+{
+    int channels = av_get_channel_layout_nb_channels( adhp->exh.entries[extradata_index].channel_layout );
+    if( channels == 0 )
+        channels = adhp->ctx->channels;
+    /* Assume stereo if unknown, which has the larger side information. */
+    return channels > 0 ? channels : 2;
+}
+
 static int find_start_audio_frame
 (
     lwlibav_audio_decode_handler_t *adhp,
@@ -296,16 +410,62 @@ static int find_start_audio_frame
     if( frame_number > 1 )
     {
         /* Add pre-roll samples if needed.
-         * The condition is irresponsible. Patches welcome. */
-        enum AVCodecID codec_id = adhp->exh.entries[ frame_list[frame_number].extradata_index ].codec_id;
+         * Decoding from the first frame of the pre-roll gives the same output as the continuous decoding
+         * since the pre-roll never crosses a change of the decoder configuration.
+         * A seek of libavformat landing after the pre-roll is still retried from an earlier RAP. */
+        int extradata_index = frame_list[frame_number].extradata_index;
+        enum AVCodecID codec_id = adhp->exh.entries[extradata_index].codec_id;
         const AVCodecDescriptor *desc = avcodec_descriptor_get( codec_id );
-        if( (desc->props & AV_CODEC_PROP_LOSSY)
-         && frame_list[frame_number].extradata_index == frame_list[frame_number - 1].extradata_index )
-            *start_offset += (uint64_t)frame_list[--frame_number].length;
+        if( desc && (desc->props & AV_CODEC_PROP_LOSSY) )
+        {
+            uint64_t preroll_length = get_audio_preroll_length( codec_id, get_audio_sample_rate( adhp, extradata_index ),
+                                                                get_audio_channel_count( adhp, extradata_index ) );
+            uint64_t rolled_length  = 0;
+            while( frame_number > 1
+                && frame_list[frame_number - 1].extradata_index == extradata_index )
+            {
+                rolled_length += (uint64_t)frame_list[--frame_number].length;
+                if( rolled_length >= preroll_length )
+                    break;
+            }
+            *start_offset += rolled_length;
+        }
     }
     return frame_number;
 }
 
+static int get_audio_packet
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    uint32_t                        frame_number,
+    AVPacket                       *pkt
+)
+{
+    if( !adhp->shared_demuxer )
+        return lwlibav_get_av_frame( adhp->format, adhp->stream_index, frame_number, pkt );
+    av_packet_unref( pkt );
+    av_init_packet( pkt );
+    if( lw_shared_demuxer_read( adhp->shared_demuxer, adhp->stream_index, pkt ) == 0 )
+        return 0;
+    /* Return a null packet. */
+    pkt->data = NULL;
+    pkt->size = 0;
+    return 1;
+}
+
+static int seek_audio_stream
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    int                             stream_index,
+    int64_t                         timestamp,
+    int                             flags
+)
+{
+    if( !adhp->shared_demuxer )
+        return av_seek_frame( adhp->format, stream_index, timestamp, flags );
+    return lw_shared_demuxer_seek( adhp->shared_demuxer, stream_index, timestamp, flags );
+}
+
 static inline void make_null_packet
 (
     AVPacket *pkt
@@ -444,8 +604,8 @@ retry_seek:;
      * Note: av_seek_frame() for DV in AVI Type-1 requires stream_index = 0. */
     int flags = (adhp->lw_seek_flags & SEEK_POS_BASED) ? AVSEEK_FLAG_BYTE : adhp->lw_seek_flags == 0 ? AVSEEK_FLAG_FRAME : 0;
     int stream_index = adhp->dv_in_avi == 1 ? 0 : adhp->stream_index;
-    if( av_seek_frame( adhp->format, stream_index, rap_pos, flags | AVSEEK_FLAG_BACKWARD ) < 0 )
-        av_seek_frame( adhp->format, stream_index, rap_pos, flags | AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_ANY );
+    if( seek_audio_stream( adhp, stream_index, rap_pos, flags | AVSEEK_FLAG_BACKWARD ) < 0 )
+        seek_audio_stream( adhp, stream_index, rap_pos, flags | AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_ANY );
     /* Seek to the target audio frame and get it. */
     int match = 0;
     for( uint32_t i = rap_number; i <= frame_number; )
@@ -457,7 +617,7 @@ retry_seek:;
             make_decodable_packet( alter_pkt, pkt );
             no_output_audio_decoding( adhp->ctx, alter_pkt, picture );
         }
-        if( lwlibav_get_av_frame( adhp->format, adhp->stream_index, i, pkt ) )
+        if( get_audio_packet( adhp, i, pkt ) )
             break;
         if( !match && error_count <= MAX_ERROR_COUNT )
         {
@@ -496,7 +656,111 @@ retry_seek:;
 #undef MAX_ERROR_COUNT
 }
 
-uint64_t lwlibav_audio_get_pcm_samples
+static void discard_batch
+(
+    lwlibav_audio_decode_handler_t *adhp
+)
+{
+    for( int i = 0; i < adhp->batch_count; i++ )
+    {
+        av_packet_unref( &adhp->batch_packets[i] );
+        av_frame_unref( adhp->batch_frames[i] );
+    }
+    adhp->batch_count    = 0;
+    adhp->batch_position = 0;
+}
+
+static inline void move_packet
+(
+    AVPacket *dst,
+    AVPacket *src
+)
+{
+    *dst = *src;
+    av_init_packet( src );
+    src->data = NULL;
+    src->size = 0;
+}
+
+static int fill_batch
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    uint32_t                        frame_number
+)
+{
+    /* The workers' decoders are copies of the current one, so a batch never crosses a change of the extradata. */
+    int extradata_index = adhp->exh.current_index;
+    int count = 0;
+    int held  = 1;
+    while( held && count < adhp->batch_size )
+    {
+        uint32_t i = frame_number + count;
+        if( i > adhp->frame_count
+         || adhp->frame_list[i].extradata_index != extradata_index
+         || get_audio_packet( adhp, i, &adhp->packet ) )
+            break;
+        /* Hold the packet since the demuxer might reuse its data at the next reading. */
+        AVPacket *batch_pkt = &adhp->batch_packets[count++];
+        held = (av_packet_ref( batch_pkt, &adhp->packet ) == 0);
+        if( !held )
+            /* Take over the packet instead. It is valid until the next reading, which occurs after the batch. */
+            move_packet( batch_pkt, &adhp->packet );
+    }
+    if( count == 0 )
+        return -1;
+    adhp->batch_count       = count;
+    adhp->batch_position    = 0;
+    adhp->batch_first_frame = frame_number;
+    int decodable_count = held ? count : count - 1;
+    if( lw_audio_decode_pool_run( adhp->decode_pool, adhp->ctx, extradata_index, adhp->batch_packets,
+                                  adhp->batch_frames, adhp->batch_results, decodable_count ) < 0 )
+        decodable_count = 0;
+    /* Let the caller decode the rest on its own thread. */
+    for( int i = decodable_count; i < count; i++ )
+        adhp->batch_results[i] = -1;
+    return 0;
+}
+
+/* Get the frame from the batch decoded in parallel.
+ * Return 1 if the decoded frame is set to the frame buffer,
+ *        0 if the packet of the frame is set to 'pkt' since the caller shall decode it by itself,
+ *        -1 if the frame is not available in any batch. */
+static int get_batch_decoded_frame
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    uint32_t                        frame_number,
+    AVPacket                       *pkt
+)
+{
+    if( !adhp->decode_pool )
+        return -1;
+    /* All samples of the last frame have been sent to the resampler, so release the buffers if held. */
+    av_frame_unref( adhp->frame_buffer );
+    if( adhp->batch_position >= adhp->batch_count )
+    {
+        discard_batch( adhp );
+        if( fill_batch( adhp, frame_number ) < 0 )
+            return -1;
+    }
+    else if( frame_number != adhp->batch_first_frame + adhp->batch_position )
+    {
+        /* The demuxer is already beyond the batch, so the caller's reading would be wrong. Never happens. */
+        discard_batch( adhp );
+        return -1;
+    }
+    int i = adhp->batch_position++;
+    if( adhp->batch_results[i] == 0 )
+    {
+        av_frame_unref( adhp->frame_buffer );
+        av_frame_move_ref( adhp->frame_buffer, adhp->batch_frames[i] );
+        return 1;
+    }
+    av_packet_unref( pkt );
+    move_packet( pkt, &adhp->batch_packets[i] );
+    return 0;
+}
+
+static uint64_t get_pcm_samples
 (
     lwlibav_audio_decode_handler_t *adhp,
     lwlibav_audio_output_handler_t *aohp,
@@ -515,8 +779,10 @@ uint64_t lwlibav_audio_get_pcm_samples
     AVPacket              *pkt       = &adhp->packet;
     AVPacket              *alter_pkt = &adhp->alter_packet;
     int                    already_gotten;
+    int                    decoded;         /* 1: the frame is decoded in parallel, otherwise not */
     aohp->request_length = wanted_length;
-    if( start > 0 && start == adhp->next_pcm_sample_number )
+    if( start > 0 && start == adhp->next_pcm_sample_number
+     && (!adhp->shared_demuxer || lw_shared_demuxer_is_continuable( adhp->shared_demuxer, adhp->stream_index )) )
     {
         frame_number   = adhp->last_frame_number;
         output_length += output_pcm_samples_from_buffer( aohp, adhp->frame_buffer, (uint8_t **)&buf, &output_flags );
@@ -547,6 +813,7 @@ uint64_t lwlibav_audio_get_pcm_samples
         frame_number = find_start_audio_frame( adhp, aohp->output_sample_rate, start_frame_pos, &aohp->output_sample_offset );
 retry_seek:
         av_packet_unref( pkt );
+        discard_batch( adhp );
         /* Flush audio resampler buffers. */
         if( flush_resampler_buffers( aohp->avr_ctx ) < 0 )
         {
@@ -574,6 +841,7 @@ retry_seek:
         rap_number = seek_audio( adhp, frame_number, past_rap_number, pkt, output_flags != AUDIO_OUTPUT_NO_FLAGS ? adhp->frame_buffer : NULL );
         already_gotten = 1;
     }
+    decoded = -1;
     do
     {
         if( already_gotten )
@@ -598,12 +866,19 @@ retry_seek:
         else if( alter_pkt->size <= 0 )
         {
             /* Getting an audio packet must be after flushing all remaining samples in resampler's FIFO buffer. */
-            lwlibav_get_av_frame( adhp->format, adhp->stream_index, frame_number, pkt );
-            make_decodable_packet( alter_pkt, pkt );
+            decoded = get_batch_decoded_frame( adhp, frame_number, pkt );
+            if( decoded < 0 )
+                get_audio_packet( adhp, frame_number, pkt );
+            if( decoded <= 0 )
+                make_decodable_packet( alter_pkt, pkt );
         }
         /* Decode and output from an audio packet. */
-        output_flags   = AUDIO_OUTPUT_NO_FLAGS;
-        output_length += output_pcm_samples_from_packet( aohp, adhp->ctx, alter_pkt, adhp->frame_buffer, (uint8_t **)&buf, &output_flags );
+        output_flags = AUDIO_OUTPUT_NO_FLAGS;
+        if( decoded > 0 )
+            output_length += output_pcm_samples_from_frame( aohp, adhp->ctx, adhp->frame_buffer, (uint8_t **)&buf, &output_flags );
+        else
+            output_length += output_pcm_samples_from_packet( aohp, adhp->ctx, alter_pkt, adhp->frame_buffer, (uint8_t **)&buf, &output_flags );
+        decoded = -1;
         if( output_flags & AUDIO_DECODER_DELAY )
         {
             if( rap_number > 1 && (output_flags & AUDIO_DECODER_ERROR) )
@@ -638,6 +913,216 @@ audio_out:
     return output_length;
 }
 
+static void defer_log
+(
+    lw_log_handler_t *lhp,
+    lw_log_level      level,
+    const char       *message
+)
+{
+    /* Showing a log might throw an exception or touch the host on the worker thread. */
+    lwlibav_audio_decode_handler_t *adhp = (lwlibav_audio_decode_handler_t *)lhp->priv;
+    lw_audio_prefetcher_defer_log( adhp->prefetcher, level, message );
+}
+
+static uint64_t prefetch_pcm_samples
+(
+    void    *priv,
+    void    *buf,
+    int64_t  start,
+    int64_t  wanted_length
+)
+{
+    lwlibav_audio_decode_handler_t *adhp = (lwlibav_audio_decode_handler_t *)priv;
+    return get_pcm_samples( adhp, adhp->prefetch_aohp, buf, start, wanted_length );
+}
+
+int lwlibav_audio_start_prefetch
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    lwlibav_audio_output_handler_t *aohp,
+    uint32_t                        chunk_length,
+    uint32_t                        chunk_count
+)
+{
+    if( adhp->prefetcher )
+        return 0;
+    if( adhp->shared_demuxer )
+        /* The shared demuxer is not thread-safe. */
+        return -1;
+    adhp->caller_lh         = adhp->lh;
+    adhp->lh.priv           = adhp;
+    adhp->lh.show_log       = defer_log;
+    adhp->prefetch_aohp     = aohp;
+    adhp->prefetcher        = lw_audio_prefetcher_create( prefetch_pcm_samples, adhp, aohp->output_block_align,
+                                                          chunk_length, chunk_count );
+    if( !adhp->prefetcher )
+    {
+        adhp->lh            = adhp->caller_lh;
+        adhp->prefetch_aohp = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void lwlibav_audio_stop_prefetch
+(
+    lwlibav_audio_decode_handler_t *adhp
+)
+{
+    if( !adhp->prefetcher )
+        return;
+    lw_audio_prefetcher_destroy( adhp->prefetcher );
+    adhp->prefetcher    = NULL;
+    adhp->prefetch_aohp = NULL;
+    adhp->lh            = adhp->caller_lh;
+    /* The decoder state is unknown to the caller now. */
+    adhp->next_pcm_sample_number = adhp->pcm_sample_count + 1;
+}
+
+int lwlibav_audio_share_demuxer
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    lwlibav_audio_decode_handler_t *master
+)
+{
+    if( adhp->format
+     || adhp->shared_demuxer
+     || adhp->prefetcher
+     || adhp->stream_index < 0
+     || adhp->dv_in_avi == 1
+     || master->dv_in_avi == 1
+     || !master->format
+     || master->prefetcher )
+        return -1;
+    if( !master->shared_demuxer )
+    {
+        lw_shared_demuxer_t *sdp = lw_shared_demuxer_create( master->format );
+        if( !sdp )
+            return -1;
+        if( lw_shared_demuxer_attach( sdp, master->stream_index ) < 0 )
+        {
+            lw_shared_demuxer_detach( sdp, -1 );
+            return -1;
+        }
+        master->shared_demuxer = sdp;
+        lwlibav_audio_force_seek( master );
+    }
+    if( lw_shared_demuxer_attach( master->shared_demuxer, adhp->stream_index ) < 0 )
+        return -1;
+    adhp->shared_demuxer = master->shared_demuxer;
+    adhp->format         = master->format;
+    return 0;
+}
+
+static int is_intra_only_audio
+(
+    enum AVCodecID codec_id
+)
+{
+    /* Native PCM is output without decoding, so it is not listed here. */
+    switch( codec_id )
+    {
+        case AV_CODEC_ID_PCM_S16BE :
+        case AV_CODEC_ID_PCM_U16LE :
+        case AV_CODEC_ID_PCM_U16BE :
+        case AV_CODEC_ID_PCM_S8 :
+        case AV_CODEC_ID_PCM_S24LE :
+        case AV_CODEC_ID_PCM_S24BE :
+        case AV_CODEC_ID_PCM_S32BE :
+        case AV_CODEC_ID_PCM_F32BE :
+        case AV_CODEC_ID_PCM_F64BE :
+        case AV_CODEC_ID_PCM_DVD :
+        case AV_CODEC_ID_PCM_BLURAY :
+        case AV_CODEC_ID_FLAC :
+        case AV_CODEC_ID_ALAC :
+        case AV_CODEC_ID_TTA :
+        case AV_CODEC_ID_WAVPACK :
+            return 1;
+        default :
+            return 0;
+    }
+}
+
+int lwlibav_audio_start_parallel_decoding
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    int                             threads
+)
+{
+    if( adhp->decode_pool
+     || threads == 1
+     || adhp->dv_in_avi == 1
+     || !adhp->ctx
+     || !is_intra_only_audio( adhp->ctx->codec_id ) )
+        return 0;
+    adhp->decode_pool = lw_audio_decode_pool_create( threads );
+    if( !adhp->decode_pool )
+        return -1;
+    /* Give each worker several frames so that the workers rarely wait for the demuxer. */
+    int batch_size = 8 * lw_audio_decode_pool_get_thread_count( adhp->decode_pool );
+    adhp->batch_packets = (AVPacket *)lw_malloc_zero( batch_size * sizeof(AVPacket) );
+    adhp->batch_frames  = (AVFrame **)lw_malloc_zero( batch_size * sizeof(AVFrame *) );
+    adhp->batch_results = (int      *)lw_malloc_zero( batch_size * sizeof(int) );
+    if( !adhp->batch_packets || !adhp->batch_frames || !adhp->batch_results )
+        goto fail;
+    for( int i = 0; i < batch_size; i++ )
+    {
+        av_init_packet( &adhp->batch_packets[i] );
+        adhp->batch_packets[i].data = NULL;
+        adhp->batch_packets[i].size = 0;
+        adhp->batch_frames[i] = av_frame_alloc();
+        if( !adhp->batch_frames[i] )
+            goto fail;
+    }
+    adhp->batch_size = batch_size;
+    /* Decoding from the batch must start just after a seek. */
+    lwlibav_audio_force_seek( adhp );
+    return 0;
+fail:
+    adhp->batch_size = batch_size;
+    lwlibav_audio_stop_parallel_decoding( adhp );
+    return -1;
+}
+
+void lwlibav_audio_stop_parallel_decoding
+(
+    lwlibav_audio_decode_handler_t *adhp
+)
+{
+    if( !adhp->decode_pool )
+        return;
+    discard_batch( adhp );
+    lw_audio_decode_pool_destroy( adhp->decode_pool );
+    adhp->decode_pool = NULL;
+    if( adhp->batch_frames )
+        for( int i = 0; i < adhp->batch_size; i++ )
+            av_frame_free( &adhp->batch_frames[i] );
+    lw_freep( &adhp->batch_packets );
+    lw_freep( &adhp->batch_frames );
+    lw_freep( &adhp->batch_results );
+    adhp->batch_size = 0;
+    /* The demuxer might be beyond the frame the caller expects. */
+    adhp->next_pcm_sample_number = adhp->pcm_sample_count + 1;
+}
+
+uint64_t lwlibav_audio_get_pcm_samples
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    lwlibav_audio_output_handler_t *aohp,
+    void                           *buf,
+    int64_t                         start,
+    int64_t                         wanted_length
+)
+{
+    if( !adhp->prefetcher )
+        return get_pcm_samples( adhp, aohp, buf, start, wanted_length );
+    uint64_t output_length = lw_audio_prefetcher_read( adhp->prefetcher, buf, start, wanted_length );
+    if( adhp->caller_lh.priv )
+        lw_audio_prefetcher_show_deferred_logs( adhp->prefetcher, &adhp->caller_lh );
+    return output_length;
+}
+
 void set_audio_basic_settings
 (
     lwlibav_decode_handler_t *dhp,
@@ -688,7 +1173,7 @@ int try_decode_audio_frame
             seek_audio( adhp, frame_number, 0, pkt, NULL );
         else
         {
-            int ret = lwlibav_get_av_frame( format_ctx, stream_index, frame_number, pkt );
+            int ret = get_audio_packet( adhp, frame_number, pkt );
             if( ret > 0 )
                 break;
             else if( ret < 0 )
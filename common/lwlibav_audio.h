@@ -114,6 +114,44 @@ uint64_t lwlibav_audio_count_overall_pcm_samples
     int                             output_sample_rate
 );
 
+/* Start decoding ahead of the last reading on a worker thread.
+ * Decoded samples are buffered in a ring buffer of 'chunk_length' * 'chunk_count' samples.
+ * The output handler must not be touched nor freed until lwlibav_audio_stop_prefetch() is called. */
+int lwlibav_audio_start_prefetch
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    lwlibav_audio_output_handler_t *aohp,
+    uint32_t                        chunk_length,
+    uint32_t                        chunk_count
+);
+
+void lwlibav_audio_stop_prefetch
+(
+    lwlibav_audio_decode_handler_t *adhp
+);
+
+/* Let the track read packets through the demuxer of 'master', which is the track of the same file opened already.
+ * This shall be called before lwlibav_audio_get_desired_track() for 'adhp'.
+ * The tracks sharing a demuxer shall be accessed from a single thread and can't decode ahead. */
+int lwlibav_audio_share_demuxer
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    lwlibav_audio_decode_handler_t *master
+);
+
+/* Decode audio frames on 'threads' worker threads in parallel if every frame of the stream is decodable independently.
+ * Nothing is done for the other streams. 'threads' = 0 means the number of logical processors. */
+int lwlibav_audio_start_parallel_decoding
+(
+    lwlibav_audio_decode_handler_t *adhp,
+    int                             threads
+);
+
+void lwlibav_audio_stop_parallel_decoding
+(
+    lwlibav_audio_decode_handler_t *adhp
+);
+
 uint64_t lwlibav_audio_get_pcm_samples
 (
     lwlibav_audio_decode_handler_t *adhp,
@@ -59,4 +59,19 @@ struct lwlibav_audio_decode_handler_tag
     uint32_t            last_frame_number;
     uint64_t            pcm_sample_count;
     uint64_t            next_pcm_sample_number;
+    /* decode-ahead */
+    lw_audio_prefetcher_t          *prefetcher;
+    lwlibav_audio_output_handler_t *prefetch_aohp;
+    lw_log_handler_t                caller_lh;          /* the log handler used on the caller thread while decoding ahead */
+    /* parallel decoding for codecs whose every frame is independently decodable */
+    lw_audio_decode_pool_t         *decode_pool;
+    AVPacket                       *batch_packets;
+    AVFrame                       **batch_frames;
+    int                            *batch_results;
+    int                             batch_size;         /* the maximum number of frames decoded at a time */
+    int                             batch_count;        /* the number of frames in the current batch */
+    int                             batch_position;     /* the index of the next frame to output in the current batch */
+    uint32_t                        batch_first_frame;  /* the frame number of the first frame in the current batch */
+    /* the demuxer shared with other tracks of the same file */
+    lw_shared_demuxer_t            *shared_demuxer;
 };
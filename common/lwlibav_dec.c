@@ -127,6 +127,8 @@ void lwlibav_update_configuration
     }
     AVCodecContext *ctx = dhp->format->streams[ dhp->stream_index ]->codec;
     void *app_specific = ctx->opaque;
+    int   slice_flags  = ctx->slice_flags;
+    void (*draw_horiz_band)( struct AVCodecContext *, const AVFrame *, int *, int, int, int ) = ctx->draw_horiz_band;
     avcodec_close( ctx );
     if( ctx->extradata )
     {
@@ -192,11 +194,13 @@ void lwlibav_update_configuration
     int width  = ctx->width;
     int height = ctx->height;
     lwlibav_flush_buffers( dhp );
-    ctx->get_buffer2 = exhp->get_buffer ? exhp->get_buffer : avcodec_default_get_buffer2;
-    ctx->opaque      = app_specific;
+    ctx->get_buffer2     = exhp->get_buffer ? exhp->get_buffer : avcodec_default_get_buffer2;
+    ctx->draw_horiz_band = draw_horiz_band;
+    ctx->slice_flags     = slice_flags;
+    ctx->opaque          = app_specific;
     /* avcodec_open2() may have changed resolution unexpectedly. */
-    ctx->width       = width;
-    ctx->height      = height;
+    ctx->width           = width;
+    ctx->height          = height;
     return;
 fail:
     exhp->delay_count = 0;
@@ -1049,8 +1049,9 @@ static inline int copy_field
     int               line_offset
 )
 {
-    /* Check if the destination is writable. */
-    if( av_frame_is_writable( dst ) == 0 )
+    /* Check if the destination is writable.
+     * A frame rendered directly may be already exported to the host, so never overwrite it. */
+    if( av_frame_is_writable( dst ) == 0 || dst->opaque )
     {
         /* The destination is NOT writable, so allocate new buffers and copy the data. */
         av_frame_unref( dst );
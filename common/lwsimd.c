@@ -21,18 +21,30 @@
 /* This file is available under an ISC license. */
 
 #include <stdint.h>
+#include <stdlib.h>
 
 #ifdef __GNUC__
-static void __cpuid(int CPUInfo[4], int prm)
+static void __cpuidex(int CPUInfo[4], int prm, int subprm)
 {
-    __asm volatile ( "cpuid" :"=a"(CPUInfo[0]), "=b"(CPUInfo[1]), "=c"(CPUInfo[2]), "=d"(CPUInfo[3]) :"a"(prm) );
+    __asm volatile ( "cpuid" :"=a"(CPUInfo[0]), "=b"(CPUInfo[1]), "=c"(CPUInfo[2]), "=d"(CPUInfo[3]) :"a"(prm), "c"(subprm) );
     return;
 }
+
+static void __cpuid(int CPUInfo[4], int prm)
+{
+    __cpuidex( CPUInfo, prm, 0 );
+}
 #else
 #include <intrin.h>
 #endif /* __GNUC__ */
 
-static int check_xgetbv( void )
+#include "lwsimd.h"
+
+/* Check if the OS saves all of the register states given by 'mask' on context switches. */
+static int check_xgetbv
+(
+    uint32_t mask
+)
 {
 #if defined(_MSC_VER) && defined(_XCR_XFEATURE_ENABLED_MASK)
     uint64_t eax = _xgetbv( _XCR_XFEATURE_ENABLED_MASK );
@@ -43,7 +55,7 @@ static int check_xgetbv( void )
 #else
     uint32_t eax = 0;
 #endif
-    return (eax & 0x6) == 0x6;
+    return (eax & mask) == mask;
 }
 
 int lw_check_sse2()
@@ -71,10 +83,93 @@ int lw_check_avx2()
 {
     int CPUInfo[4];
     __cpuid( CPUInfo, 1 );
-    if( (CPUInfo[2] & 0x18000000) == 0x18000000 && check_xgetbv() )
+    if( (CPUInfo[2] & 0x18000000) == 0x18000000 && check_xgetbv( 0x6 ) )
     {
-        __cpuid( CPUInfo, 7 );
+        __cpuidex( CPUInfo, 7, 0 );
         return (CPUInfo[1] & 0x00000020) != 0;
     }
     return 0;
 }
+
+int lw_check_avx512bw()
+{
+    int CPUInfo[4];
+    __cpuid( CPUInfo, 1 );
+    /* The opmask and the whole ZMM registers are also required to be enabled. */
+    if( (CPUInfo[2] & 0x18000000) == 0x18000000 && check_xgetbv( 0xE6 ) )
+    {
+        __cpuidex( CPUInfo, 7, 0 );
+        /* AVX-512F and AVX-512BW */
+        return (CPUInfo[1] & 0x40010000) == 0x40010000;
+    }
+    return 0;
+}
+
+static uint32_t cpu_flags      = 0;
+static int      cpu_flags_init = 0;
+static uint32_t cpu_flags_mask = ~0U;
+static volatile uint32_t cpu_flags_revision = 1;
+
+static uint32_t detect_cpu_flags( void )
+{
+    /* Stop at the first level not available so that each level implies all of the lower ones. */
+    uint32_t flags = 0;
+    if( !lw_check_sse2() )
+        return flags;
+    flags |= LW_CPU_SSE2;
+    if( !lw_check_ssse3() )
+        return flags;
+    flags |= LW_CPU_SSSE3;
+    if( !lw_check_sse41() )
+        return flags;
+    flags |= LW_CPU_SSE41;
+    if( !lw_check_avx2() )
+        return flags;
+    flags |= LW_CPU_AVX2;
+    if( LW_HAVE_AVX512BW && lw_check_avx512bw() )
+        flags |= LW_CPU_AVX512BW;
+    return flags;
+}
+
+static uint32_t apply_cpu_flags_mask
+(
+    uint32_t flags,
+    uint32_t mask
+)
+{
+    flags &= mask;
+    /* Drop every level above the lowest one masked out. */
+    for( uint32_t level = LW_CPU_SSE2; level <= LW_CPU_AVX512BW; level <<= 1 )
+        if( !(flags & level) )
+            return flags & (level - 1);
+    return flags;
+}
+
+uint32_t lw_get_cpu_flags( void )
+{
+    if( !cpu_flags_init )
+    {
+        uint32_t flags = detect_cpu_flags();
+        const char *env_mask = getenv( "LSMASHWORKS_CPU_MASK" );
+        if( env_mask && *env_mask )
+            flags = apply_cpu_flags_mask( flags, (uint32_t)strtoul( env_mask, NULL, 16 ) );
+        cpu_flags      = flags;
+        cpu_flags_init = 1;
+    }
+    return apply_cpu_flags_mask( cpu_flags, cpu_flags_mask );
+}
+
+void lw_set_cpu_flags_mask
+(
+    uint32_t mask
+)
+{
+    cpu_flags_mask = mask;
+    if( ++cpu_flags_revision == 0 )
+        cpu_flags_revision = 1;
+}
+
+uint32_t lw_get_cpu_flags_revision( void )
+{
+    return cpu_flags_revision;
+}
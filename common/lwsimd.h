@@ -30,7 +30,42 @@
 #define LW_FORCEINLINE __forceinline
 #endif
 
+#include <stdint.h>
+
+/* AVX-512BW intrinsics need a recent compiler. */
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5) || (defined(_MSC_VER) && _MSC_VER >= 1911)
+#define LW_HAVE_AVX512BW 1
+#else
+#define LW_HAVE_AVX512BW 0
+#endif
+
+#define LW_CPU_SSE2     0x00000001
+#define LW_CPU_SSSE3    0x00000002
+#define LW_CPU_SSE41    0x00000004
+#define LW_CPU_AVX2     0x00000008
+#define LW_CPU_AVX512BW 0x00000010
+
 int lw_check_sse2();
 int lw_check_ssse3();
 int lw_check_sse41();
 int lw_check_avx2();
+int lw_check_avx512bw();
+
+/* Get the instruction set extensions available to the SIMD kernels as LW_CPU_* flags.
+ * The CPU is probed only once, and the result is limited by lw_set_cpu_flags_mask() and
+ * the environment variable LSMASHWORKS_CPU_MASK given as a hexadecimal set of LW_CPU_* flags.
+ * Each flag is set only if all of the lower ones are set too, so masking a level out also disables the levels above it. */
+uint32_t lw_get_cpu_flags( void );
+
+/* Limit the instruction set extensions used by the SIMD kernels to 'mask', e.g. for forcing lower levels in tests.
+ * The kernel tables of the common converters are rebuilt at their next use.
+ * Kernels chosen when a conversion is set up, e.g. of tone mapping, are kept until it is set up again. */
+void lw_set_cpu_flags_mask
+(
+    uint32_t mask
+);
+
+/* Return a number that changes whenever lw_set_cpu_flags_mask() is called.
+ * A kernel table built for lw_get_cpu_flags() shall be rebuilt when this differs from the value at the build.
+ * This never returns 0, so 0 can mark a table not built yet. */
+uint32_t lw_get_cpu_flags_revision( void );
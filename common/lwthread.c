@@ -0,0 +1,146 @@
+/*****************************************************************************
+ * lwthread.c / lwthread.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "lwthread.h"
+
+#ifdef _WIN32
+typedef struct
+{
+    lw_thread_func_t func;
+    void            *arg;
+} thread_start_t;
+
+static unsigned __stdcall thread_entry( void *arg )
+{
+    thread_start_t start = *(thread_start_t *)arg;
+    free( arg );
+    start.func( start.arg );
+    return 0;
+}
+
+int lw_thread_create
+(
+    lw_thread_t     *thread,
+    lw_thread_func_t func,
+    void            *arg
+)
+{
+    thread_start_t *start = (thread_start_t *)malloc( sizeof(thread_start_t) );
+    if( !start )
+        return -1;
+    start->func = func;
+    start->arg  = arg;
+    *thread = (HANDLE)_beginthreadex( NULL, 0, thread_entry, start, 0, NULL );
+    if( *thread == 0 )
+    {
+        free( start );
+        return -1;
+    }
+    return 0;
+}
+
+void lw_thread_join
+(
+    lw_thread_t thread
+)
+{
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+}
+
+int lw_get_cpu_count
+(
+    void
+)
+{
+    SYSTEM_INFO si;
+    GetSystemInfo( &si );
+    return si.dwNumberOfProcessors > 0 ? (int)si.dwNumberOfProcessors : 1;
+}
+
+int  lw_mutex_init   ( lw_mutex_t *mutex ) { InitializeCriticalSection( mutex ); return 0; }
+void lw_mutex_destroy( lw_mutex_t *mutex ) { DeleteCriticalSection( mutex ); }
+void lw_mutex_lock   ( lw_mutex_t *mutex ) { EnterCriticalSection( mutex ); }
+void lw_mutex_unlock ( lw_mutex_t *mutex ) { LeaveCriticalSection( mutex ); }
+
+void lw_static_mutex_lock  ( lw_static_mutex_t *mutex ) { AcquireSRWLockExclusive( mutex ); }
+void lw_static_mutex_unlock( lw_static_mutex_t *mutex ) { ReleaseSRWLockExclusive( mutex ); }
+
+int  lw_cond_init     ( lw_cond_t *cond )                    { InitializeConditionVariable( cond ); return 0; }
+void lw_cond_destroy  ( lw_cond_t *cond )                    { (void)cond; }
+void lw_cond_wait     ( lw_cond_t *cond, lw_mutex_t *mutex ) { SleepConditionVariableCS( cond, mutex, INFINITE ); }
+void lw_cond_signal   ( lw_cond_t *cond )                    { WakeConditionVariable( cond ); }
+void lw_cond_broadcast( lw_cond_t *cond )                    { WakeAllConditionVariable( cond ); }
+#else
+int lw_thread_create
+(
+    lw_thread_t     *thread,
+    lw_thread_func_t func,
+    void            *arg
+)
+{
+    return pthread_create( thread, NULL, func, arg ) ? -1 : 0;
+}
+
+void lw_thread_join
+(
+    lw_thread_t thread
+)
+{
+    pthread_join( thread, NULL );
+}
+
+int lw_get_cpu_count
+(
+    void
+)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf( _SC_NPROCESSORS_ONLN );
+    return count > 0 ? (int)count : 1;
+#else
+    return 1;
+#endif
+}
+
+int  lw_mutex_init   ( lw_mutex_t *mutex ) { return pthread_mutex_init( mutex, NULL ) ? -1 : 0; }
+void lw_mutex_destroy( lw_mutex_t *mutex ) { pthread_mutex_destroy( mutex ); }
+void lw_mutex_lock   ( lw_mutex_t *mutex ) { pthread_mutex_lock( mutex ); }
+void lw_mutex_unlock ( lw_mutex_t *mutex ) { pthread_mutex_unlock( mutex ); }
+
+void lw_static_mutex_lock  ( lw_static_mutex_t *mutex ) { pthread_mutex_lock( mutex ); }
+void lw_static_mutex_unlock( lw_static_mutex_t *mutex ) { pthread_mutex_unlock( mutex ); }
+
+int  lw_cond_init     ( lw_cond_t *cond )                    { return pthread_cond_init( cond, NULL ) ? -1 : 0; }
+void lw_cond_destroy  ( lw_cond_t *cond )                    { pthread_cond_destroy( cond ); }
+void lw_cond_wait     ( lw_cond_t *cond, lw_mutex_t *mutex ) { pthread_cond_wait( cond, mutex ); }
+void lw_cond_signal   ( lw_cond_t *cond )                    { pthread_cond_signal( cond ); }
+void lw_cond_broadcast( lw_cond_t *cond )                    { pthread_cond_broadcast( cond ); }
+#endif
@@ -0,0 +1,106 @@
+/*****************************************************************************
+ * lwthread.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#ifndef LW_THREAD_H
+#define LW_THREAD_H
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE             lw_thread_t;
+typedef CRITICAL_SECTION   lw_mutex_t;
+typedef CONDITION_VARIABLE lw_cond_t;
+typedef SRWLOCK            lw_static_mutex_t;
+#define LW_STATIC_MUTEX_INITIALIZER SRWLOCK_INIT
+#else
+#include <pthread.h>
+typedef pthread_t          lw_thread_t;
+typedef pthread_mutex_t    lw_mutex_t;
+typedef pthread_cond_t     lw_cond_t;
+typedef pthread_mutex_t    lw_static_mutex_t;
+#define LW_STATIC_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
+
+typedef void *(*lw_thread_func_t)( void * );
+
+int lw_thread_create
+(
+    lw_thread_t     *thread,
+    lw_thread_func_t func,
+    void            *arg
+);
+
+void lw_thread_join
+(
+    lw_thread_t thread
+);
+
+int lw_get_cpu_count
+(
+    void
+);
+
+int  lw_mutex_init   ( lw_mutex_t *mutex );
+void lw_mutex_destroy( lw_mutex_t *mutex );
+void lw_mutex_lock   ( lw_mutex_t *mutex );
+void lw_mutex_unlock ( lw_mutex_t *mutex );
+
+/* A mutex initialized statically by LW_STATIC_MUTEX_INITIALIZER, which guards process-wide data. */
+void lw_static_mutex_lock  ( lw_static_mutex_t *mutex );
+void lw_static_mutex_unlock( lw_static_mutex_t *mutex );
+
+int  lw_cond_init     ( lw_cond_t *cond );
+void lw_cond_destroy  ( lw_cond_t *cond );
+void lw_cond_wait     ( lw_cond_t *cond, lw_mutex_t *mutex );
+void lw_cond_signal   ( lw_cond_t *cond );
+void lw_cond_broadcast( lw_cond_t *cond );
+
+/* Sequentially consistent accessors for a 32-bit variable shared between threads.
+ * These are enough to build single-producer/single-consumer queues without any lock. */
+static inline uint32_t lw_atomic_load( volatile uint32_t *p )
+{
+#ifdef _WIN32
+    return (uint32_t)InterlockedCompareExchange( (volatile LONG *)p, 0, 0 );
+#else
+    return __atomic_load_n( p, __ATOMIC_SEQ_CST );
+#endif
+}
+
+static inline void lw_atomic_store( volatile uint32_t *p, uint32_t value )
+{
+#ifdef _WIN32
+    InterlockedExchange( (volatile LONG *)p, (LONG)value );
+#else
+    __atomic_store_n( p, value, __ATOMIC_SEQ_CST );
+#endif
+}
+
+static inline uint32_t lw_atomic_add( volatile uint32_t *p, uint32_t value )
+{
+    /* Return the value after addition. */
+#ifdef _WIN32
+    return (uint32_t)InterlockedExchangeAdd( (volatile LONG *)p, (LONG)value ) + value;
+#else
+    return __atomic_add_fetch( p, value, __ATOMIC_SEQ_CST );
+#endif
+}
+
+#endif  /* LW_THREAD_H */
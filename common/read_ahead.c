@@ -0,0 +1,295 @@
+/*****************************************************************************
+ * read_ahead.c
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#include <string.h>
+
+#include "utils.h"
+#include "lwthread.h"
+#include "read_ahead.h"
+
+typedef struct
+{
+    uint8_t *data;
+    int64_t  pos;
+    uint32_t size;      /* the number of the buffered bytes, 0 if empty */
+} read_ahead_window_t;
+
+/* The caller owns the current window. The worker owns the spare one while reading is requested. */
+struct lw_read_ahead_tag
+{
+    lw_read_func_t      read;
+    void               *priv;
+    uint32_t            capacity;
+    read_ahead_window_t windows[2];
+    int                 current;
+    int64_t             consumed_end;   /* the end of the data copied last from the current window */
+    int                 background;
+    /* protected by the mutex */
+    lw_thread_t         thread;
+    lw_mutex_t          mutex;
+    lw_cond_t           worker_cond;
+    lw_cond_t           caller_cond;
+    int                 quit;
+    int                 requested;
+    int64_t             request_pos;
+    uint32_t            request_size;
+};
+
+static inline int window_covers
+(
+    read_ahead_window_t *window,
+    int64_t              pos,
+    uint32_t             size
+)
+{
+    return window->size
+        && pos >= window->pos
+        && pos + size <= window->pos + window->size;
+}
+
+static void read_into_window
+(
+    lw_read_ahead_t     *ra,
+    read_ahead_window_t *window,
+    int64_t              pos,
+    uint32_t             size
+)
+{
+    int64_t read_size = ra->read( ra->priv, window->data, pos, size );
+    window->pos  = pos;
+    window->size = read_size > 0 ? (uint32_t)read_size : 0;
+}
+
+static void *read_ahead_worker( void *arg )
+{
+    lw_read_ahead_t *ra = (lw_read_ahead_t *)arg;
+    lw_mutex_lock( &ra->mutex );
+    while( !ra->quit )
+    {
+        if( !ra->requested )
+        {
+            lw_cond_wait( &ra->worker_cond, &ra->mutex );
+            continue;
+        }
+        read_ahead_window_t *spare = &ra->windows[ ra->current ^ 1 ];
+        int64_t  pos  = ra->request_pos;
+        uint32_t size = ra->request_size;
+        lw_mutex_unlock( &ra->mutex );
+        read_into_window( ra, spare, pos, size );
+        lw_mutex_lock( &ra->mutex );
+        ra->requested = 0;
+        lw_cond_broadcast( &ra->caller_cond );
+    }
+    lw_mutex_unlock( &ra->mutex );
+    return NULL;
+}
+
+/* Wait for the worker idling so that the caller can touch the both windows and read the file by itself. */
+static void wait_worker
+(
+    lw_read_ahead_t *ra
+)
+{
+    if( !ra->background )
+        return;
+    lw_mutex_lock( &ra->mutex );
+    while( ra->requested )
+        lw_cond_wait( &ra->caller_cond, &ra->mutex );
+    lw_mutex_unlock( &ra->mutex );
+}
+
+lw_read_ahead_t *lw_read_ahead_create
+(
+    lw_read_func_t read,
+    void          *priv,
+    uint32_t       capacity,
+    int            background
+)
+{
+    if( !read || capacity == 0 )
+        return NULL;
+    lw_read_ahead_t *ra = (lw_read_ahead_t *)lw_malloc_zero( sizeof(lw_read_ahead_t) );
+    if( !ra )
+        return NULL;
+    ra->read       = read;
+    ra->priv       = priv;
+    ra->capacity   = capacity;
+    ra->background = background;
+    ra->windows[0].data = (uint8_t *)lw_malloc_zero( capacity );
+    if( !ra->windows[0].data )
+        goto fail_window;
+    if( !background )
+        return ra;
+    /* Only the background reading needs the spare window. */
+    ra->windows[1].data = (uint8_t *)lw_malloc_zero( capacity );
+    if( !ra->windows[1].data )
+        goto fail_window;
+    if( lw_mutex_init( &ra->mutex ) < 0 )
+        goto fail_window;
+    if( lw_cond_init( &ra->worker_cond ) < 0 )
+        goto fail_worker_cond;
+    if( lw_cond_init( &ra->caller_cond ) < 0 )
+        goto fail_caller_cond;
+    if( lw_thread_create( &ra->thread, read_ahead_worker, ra ) < 0 )
+        goto fail_thread;
+    return ra;
+fail_thread:
+    lw_cond_destroy( &ra->caller_cond );
+fail_caller_cond:
+    lw_cond_destroy( &ra->worker_cond );
+fail_worker_cond:
+    lw_mutex_destroy( &ra->mutex );
+fail_window:
+    lw_free( ra->windows[1].data );
+    lw_free( ra->windows[0].data );
+    lw_free( ra );
+    return NULL;
+}
+
+void lw_read_ahead_destroy
+(
+    lw_read_ahead_t *ra
+)
+{
+    if( !ra )
+        return;
+    if( ra->background )
+    {
+        lw_mutex_lock( &ra->mutex );
+        ra->quit = 1;
+        lw_cond_signal( &ra->worker_cond );
+        lw_mutex_unlock( &ra->mutex );
+        lw_thread_join( ra->thread );
+        lw_cond_destroy( &ra->caller_cond );
+        lw_cond_destroy( &ra->worker_cond );
+        lw_mutex_destroy( &ra->mutex );
+    }
+    lw_free( ra->windows[1].data );
+    lw_free( ra->windows[0].data );
+    lw_free( ra );
+}
+
+uint32_t lw_read_ahead_get_capacity
+(
+    lw_read_ahead_t *ra
+)
+{
+    return ra->capacity;
+}
+
+int lw_read_ahead_copy
+(
+    lw_read_ahead_t *ra,
+    int64_t          pos,
+    uint32_t         size,
+    uint8_t         *dst
+)
+{
+    read_ahead_window_t *window = &ra->windows[ ra->current ];
+    if( !window_covers( window, pos, size ) )
+    {
+        if( !ra->background )
+            return -1;
+        /* Wait for the background reading only if it provides the data. */
+        lw_mutex_lock( &ra->mutex );
+        int wait = ra->requested
+                && pos >= ra->request_pos
+                && pos + size <= ra->request_pos + ra->request_size;
+        while( wait && ra->requested )
+            lw_cond_wait( &ra->caller_cond, &ra->mutex );
+        int idle = !ra->requested;
+        lw_mutex_unlock( &ra->mutex );
+        window = &ra->windows[ ra->current ^ 1 ];
+        if( !idle || !window_covers( window, pos, size ) )
+            return -1;
+        ra->current ^= 1;
+    }
+    memcpy( dst, window->data + (pos - window->pos), size );
+    ra->consumed_end = pos + size;
+    return 0;
+}
+
+int lw_read_ahead_fill
+(
+    lw_read_ahead_t *ra,
+    int64_t          pos,
+    int64_t          end
+)
+{
+    if( end <= pos )
+        return -1;
+    wait_worker( ra );
+    read_ahead_window_t *window = &ra->windows[ ra->current ];
+    read_into_window( ra, window, pos, (uint32_t)MIN( end - pos, (int64_t)ra->capacity ) );
+    ra->consumed_end = pos;
+    return window->size ? 0 : -1;
+}
+
+int64_t lw_read_ahead_read_through
+(
+    lw_read_ahead_t *ra,
+    int64_t          pos,
+    uint32_t         size,
+    uint8_t         *dst
+)
+{
+    wait_worker( ra );
+    return ra->read( ra->priv, dst, pos, size );
+}
+
+int64_t lw_read_ahead_get_prefetch_position
+(
+    lw_read_ahead_t *ra
+)
+{
+    read_ahead_window_t *window = &ra->windows[ ra->current ];
+    if( !ra->background || window->size == 0
+     || ra->consumed_end - window->pos < window->size / 2 )
+        return -1;
+    int64_t window_end = window->pos + window->size;
+    lw_mutex_lock( &ra->mutex );
+    read_ahead_window_t *spare = &ra->windows[ ra->current ^ 1 ];
+    int ready = !ra->requested && !(spare->size && spare->pos >= window_end);
+    lw_mutex_unlock( &ra->mutex );
+    return ready ? window_end : -1;
+}
+
+void lw_read_ahead_prefetch
+(
+    lw_read_ahead_t *ra,
+    int64_t          pos,
+    int64_t          end
+)
+{
+    if( !ra->background || end <= pos )
+        return;
+    lw_mutex_lock( &ra->mutex );
+    if( !ra->requested )
+    {
+        ra->request_pos  = pos;
+        ra->request_size = (uint32_t)MIN( end - pos, (int64_t)ra->capacity );
+        ra->requested    = 1;
+        lw_cond_signal( &ra->worker_cond );
+    }
+    lw_mutex_unlock( &ra->mutex );
+}
@@ -0,0 +1,106 @@
+/*****************************************************************************
+ * read_ahead.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+
+/* This file is available under an ISC license. */
+
+#ifndef LW_READ_AHEAD_H
+#define LW_READ_AHEAD_H
+
+#include <stdint.h>
+
+/* The read-ahead buffer calls this function to read 'size' bytes at 'pos' of the file into 'buf',
+ * on the background thread if any. It shall return the number of read bytes, or a negative value on failure. */
+typedef int64_t (*lw_read_func_t)
+(
+    void     *priv,
+    uint8_t  *buf,
+    int64_t   pos,
+    uint32_t  size
+);
+
+/* A buffer serving small reads of a file from memory, filled by large reads covering many of them.
+ * If 'background' is set, a worker thread fills the spare buffer with the data requested by lw_read_ahead_prefetch().
+ * The reading function is never called on two threads at a time. */
+typedef struct lw_read_ahead_tag lw_read_ahead_t;
+
+lw_read_ahead_t *lw_read_ahead_create
+(
+    lw_read_func_t read,
+    void          *priv,
+    uint32_t       capacity,
+    int            background
+);
+
+void lw_read_ahead_destroy
+(
+    lw_read_ahead_t *ra
+);
+
+uint32_t lw_read_ahead_get_capacity
+(
+    lw_read_ahead_t *ra
+);
+
+/* Copy 'size' bytes at 'pos' of the file into 'dst' if they are buffered.
+ * Return 0 if copied, otherwise a negative value. */
+int lw_read_ahead_copy
+(
+    lw_read_ahead_t *ra,
+    int64_t          pos,
+    uint32_t         size,
+    uint8_t         *dst
+);
+
+/* Read the range from 'pos' to 'end' of the file into the buffer at one go.
+ * The range is clipped to the capacity. */
+int lw_read_ahead_fill
+(
+    lw_read_ahead_t *ra,
+    int64_t          pos,
+    int64_t          end
+);
+
+/* Read 'size' bytes at 'pos' of the file into 'dst' bypassing the buffer, e.g. for data larger than the capacity.
+ * Return the number of read bytes, or a negative value on failure. */
+int64_t lw_read_ahead_read_through
+(
+    lw_read_ahead_t *ra,
+    int64_t          pos,
+    uint32_t         size,
+    uint8_t         *dst
+);
+
+/* Return the end of the buffered data if it is time to request reading the following data in the background,
+ * i.e. more than half of the buffered data has been consumed and no reading is requested.
+ * Return a negative value otherwise. */
+int64_t lw_read_ahead_get_prefetch_position
+(
+    lw_read_ahead_t *ra
+);
+
+/* Request reading the range from 'pos' to 'end' of the file in the background.
+ * The range is clipped to the capacity. */
+void lw_read_ahead_prefetch
+(
+    lw_read_ahead_t *ra,
+    int64_t          pos,
+    int64_t          end
+);
+
+#endif /* LW_READ_AHEAD_H */
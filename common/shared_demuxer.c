@@ -0,0 +1,288 @@
+/*****************************************************************************
+ * shared_demuxer.c / shared_demuxer.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  /* __cplusplus */
+#include <libavformat/avformat.h>       /* Demuxer */
+#include <libavutil/mem.h>
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#include "utils.h"
+#include "shared_demuxer.h"
+
+#define MAX_QUEUED_PACKETS 4096     /* arbitrary */
+
+typedef struct
+{
+    int           attached;
+    AVPacketList *head;
+    AVPacketList *tail;
+    int           count;
+    int           lost;             /* Queued packets have been discarded due to overflow. Seek is required. */
+    uint32_t      generation;       /* the generation of the demuxer position the stream follows */
+    int           skip_consumed;    /* Skip packets already returned before the last seek by another stream. */
+    int64_t       last_pos;         /* the file position of the last returned packet */
+    int64_t       last_dts;         /* the DTS of the last returned packet */
+} shared_stream_t;
+
+struct lw_shared_demuxer_tag
+{
+    AVFormatContext *format;
+    shared_stream_t *streams;
+    int              stream_count;
+    int              ref_count;
+    uint32_t         generation;    /* incremented every seek */
+    int              resume_known;
+    int64_t          resume_pos;    /* the file position of the first packet read after the last seek */
+};
+
+static void flush_queue
+(
+    shared_stream_t *stream
+)
+{
+    while( stream->head )
+    {
+        AVPacketList *node = stream->head;
+        stream->head = node->next;
+        av_packet_unref( &node->pkt );
+        av_free( node );
+    }
+    stream->tail  = NULL;
+    stream->count = 0;
+}
+
+static int demux_packet
+(
+    lw_shared_demuxer_t *sdp,
+    AVPacket            *pkt
+)
+{
+    int ret;
+    do
+        ret = av_read_frame( sdp->format, pkt );
+    while( ret == AVERROR( EAGAIN ) );
+    if( ret < 0 )
+        return ret;
+    if( !sdp->resume_known )
+    {
+        sdp->resume_known = 1;
+        sdp->resume_pos   = pkt->pos;
+    }
+    return 0;
+}
+
+static void queue_packet
+(
+    lw_shared_demuxer_t *sdp,
+    AVPacket            *pkt
+)
+{
+    shared_stream_t *stream = pkt->stream_index < sdp->stream_count ? &sdp->streams[ pkt->stream_index ] : NULL;
+    if( !stream || !stream->attached || stream->lost )
+    {
+        av_packet_unref( pkt );
+        return;
+    }
+    AVPacketList *node = (AVPacketList *)av_mallocz( sizeof(AVPacketList) );
+    if( !node
+     || stream->count >= MAX_QUEUED_PACKETS
+     || av_packet_ref( &node->pkt, pkt ) < 0 )
+    {
+        /* The stream shall seek at the next reading. */
+        av_free( node );
+        av_packet_unref( pkt );
+        flush_queue( stream );
+        stream->lost = 1;
+        return;
+    }
+    av_packet_unref( pkt );
+    if( stream->tail )
+        stream->tail->next = node;
+    else
+        stream->head = node;
+    stream->tail = node;
+    ++ stream->count;
+}
+
+lw_shared_demuxer_t *lw_shared_demuxer_create
+(
+    AVFormatContext *format_ctx
+)
+{
+    lw_shared_demuxer_t *sdp = (lw_shared_demuxer_t *)lw_malloc_zero( sizeof(lw_shared_demuxer_t) );
+    if( !sdp )
+        return NULL;
+    sdp->streams = (shared_stream_t *)lw_malloc_zero( format_ctx->nb_streams * sizeof(shared_stream_t) );
+    if( !sdp->streams )
+    {
+        lw_free( sdp );
+        return NULL;
+    }
+    sdp->format       = format_ctx;
+    sdp->stream_count = format_ctx->nb_streams;
+    return sdp;
+}
+
+int lw_shared_demuxer_attach
+(
+    lw_shared_demuxer_t *sdp,
+    int                  stream_index
+)
+{
+    if( stream_index < 0 || stream_index >= sdp->stream_count || sdp->streams[stream_index].attached )
+        return -1;
+    shared_stream_t *stream = &sdp->streams[stream_index];
+    stream->attached = 1;
+    stream->lost     = 1;   /* Seek at the first reading. */
+    stream->last_pos = -1;
+    stream->last_dts = AV_NOPTS_VALUE;
+    ++ sdp->ref_count;
+    return 0;
+}
+
+AVFormatContext *lw_shared_demuxer_detach
+(
+    lw_shared_demuxer_t *sdp,
+    int                  stream_index
+)
+{
+    if( stream_index >= 0 && stream_index < sdp->stream_count && sdp->streams[stream_index].attached )
+    {
+        flush_queue( &sdp->streams[stream_index] );
+        sdp->streams[stream_index].attached = 0;
+        -- sdp->ref_count;
+    }
+    if( sdp->ref_count > 0 )
+        return NULL;
+    AVFormatContext *format_ctx = sdp->format;
+    lw_free( sdp->streams );
+    lw_free( sdp );
+    return format_ctx;
+}
+
+int lw_shared_demuxer_read
+(
+    lw_shared_demuxer_t *sdp,
+    int                  stream_index,
+    AVPacket            *pkt
+)
+{
+    shared_stream_t *stream = &sdp->streams[stream_index];
+    while( 1 )
+    {
+        if( stream->head )
+        {
+            AVPacketList *node = stream->head;
+            stream->head = node->next;
+            if( !stream->head )
+                stream->tail = NULL;
+            -- stream->count;
+            *pkt = node->pkt;
+            av_free( node );
+        }
+        else
+        {
+            if( demux_packet( sdp, pkt ) < 0 )
+                return -1;
+            if( pkt->stream_index != stream_index )
+            {
+                queue_packet( sdp, pkt );
+                continue;
+            }
+        }
+        if( stream->skip_consumed )
+        {
+            /* Packets laced in the same block might share the file position. */
+            if( pkt->pos >= 0
+             && (pkt->pos < stream->last_pos
+              || (pkt->pos == stream->last_pos && (pkt->dts == AV_NOPTS_VALUE || pkt->dts <= stream->last_dts))) )
+            {
+                av_packet_unref( pkt );
+                continue;
+            }
+            stream->skip_consumed = 0;
+        }
+        stream->last_pos = pkt->pos;
+        stream->last_dts = pkt->dts;
+        return 0;
+    }
+}
+
+int lw_shared_demuxer_seek
+(
+    lw_shared_demuxer_t *sdp,
+    int                  stream_index,
+    int64_t              timestamp,
+    int                  flags
+)
+{
+    for( int i = 0; i < sdp->stream_count; i++ )
+        flush_queue( &sdp->streams[i] );
+    int ret = av_seek_frame( sdp->format, stream_index, timestamp, flags );
+    ++ sdp->generation;
+    sdp->resume_known = 0;
+    shared_stream_t *stream = &sdp->streams[stream_index];
+    stream->generation    = sdp->generation;
+    stream->lost          = 0;
+    stream->skip_consumed = 0;
+    stream->last_pos      = -1;
+    stream->last_dts      = AV_NOPTS_VALUE;
+    return ret;
+}
+
+int lw_shared_demuxer_is_continuable
+(
+    lw_shared_demuxer_t *sdp,
+    int                  stream_index
+)
+{
+    shared_stream_t *stream = &sdp->streams[stream_index];
+    if( stream->lost )
+        return 0;
+    if( stream->generation == sdp->generation )
+        return 1;
+    /* Another stream has sought. */
+    if( stream->last_pos < 0 || stream->last_dts == AV_NOPTS_VALUE )
+        return 0;
+    if( !sdp->resume_known )
+    {
+        /* Peek the first packet after the seek. */
+        AVPacket pkt;
+        av_init_packet( &pkt );
+        pkt.data = NULL;
+        pkt.size = 0;
+        if( demux_packet( sdp, &pkt ) < 0 )
+            return 0;
+        queue_packet( sdp, &pkt );
+    }
+    if( sdp->resume_pos < 0 || sdp->resume_pos > stream->last_pos )
+        return 0;
+    /* The packets following the last returned one will come again. */
+    stream->generation    = sdp->generation;
+    stream->skip_consumed = 1;
+    return 1;
+}
@@ -0,0 +1,72 @@
+/*****************************************************************************
+ * shared_demuxer.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+/* A demuxer shared by several audio tracks of the same file.
+ * Packets of the other attached streams read while looking for a track's packet are queued for them
+ * instead of being discarded, so the whole file is demuxed only once when the tracks are read in lockstep.
+ * This is not thread-safe. All the tracks sharing a demuxer shall be accessed from a single thread. */
+typedef struct lw_shared_demuxer_tag lw_shared_demuxer_t;
+
+/* The shared demuxer takes over 'format_ctx'. See lw_shared_demuxer_detach(). */
+lw_shared_demuxer_t *lw_shared_demuxer_create
+(
+    AVFormatContext *format_ctx
+);
+
+int lw_shared_demuxer_attach
+(
+    lw_shared_demuxer_t *sdp,
+    int                  stream_index
+);
+
+/* Return the format context if no stream is attached any longer, otherwise NULL.
+ * The caller shall close the returned format context. */
+AVFormatContext *lw_shared_demuxer_detach
+(
+    lw_shared_demuxer_t *sdp,
+    int                  stream_index
+);
+
+/* Get the next packet of the stream.
+ * Return 0 on success, a negative value at the end of the file or on an error. */
+int lw_shared_demuxer_read
+(
+    lw_shared_demuxer_t *sdp,
+    int                  stream_index,
+    AVPacket            *pkt
+);
+
+/* Seek the demuxer on behalf of the stream in the same manner as av_seek_frame().
+ * All the queued packets are discarded. */
+int lw_shared_demuxer_seek
+(
+    lw_shared_demuxer_t *sdp,
+    int                  stream_index,
+    int64_t              timestamp,
+    int                  flags
+);
+
+/* Return 1 if the stream can continue reading from the last returned packet, otherwise 0.
+ * Other streams' seeks make this return 0 unless the demuxer is positioned at or before the next packet. */
+int lw_shared_demuxer_is_continuable
+(
+    lw_shared_demuxer_t *sdp,
+    int                  stream_index
+);
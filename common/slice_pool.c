@@ -0,0 +1,181 @@
+/*****************************************************************************
+ * slice_pool.c / slice_pool.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#include "utils.h"
+#include "lwthread.h"
+#include "slice_pool.h"
+
+typedef struct
+{
+    lw_slice_pool_t *pool;
+    lw_thread_t      thread;
+} slice_worker_t;
+
+struct lw_slice_pool_tag
+{
+    int             worker_count;
+    int             started_count;
+    slice_worker_t *workers;
+    /* protected by the mutex */
+    lw_mutex_t      mutex;
+    lw_cond_t       worker_cond;
+    lw_cond_t       caller_cond;
+    int             quit;
+    uint32_t        generation;     /* incremented every time a new job is posted */
+    lw_slice_func_t func;
+    void           *arg;
+    int             slice_count;
+    int             next_slice;
+    int             done_count;
+};
+
+/* Run slices of the current job until none is left. Called with the mutex locked. */
+static void run_slices
+(
+    lw_slice_pool_t *pool
+)
+{
+    while( pool->next_slice < pool->slice_count )
+    {
+        int i = pool->next_slice++;
+        lw_mutex_unlock( &pool->mutex );
+        pool->func( pool->arg, i );
+        lw_mutex_lock( &pool->mutex );
+        if( ++ pool->done_count == pool->slice_count )
+            lw_cond_signal( &pool->caller_cond );
+    }
+}
+
+static void *slice_worker( void *arg )
+{
+    slice_worker_t  *worker = (slice_worker_t *)arg;
+    lw_slice_pool_t *pool   = worker->pool;
+    uint32_t generation = 0;
+    lw_mutex_lock( &pool->mutex );
+    while( 1 )
+    {
+        while( !pool->quit && generation == pool->generation )
+            lw_cond_wait( &pool->worker_cond, &pool->mutex );
+        if( pool->quit )
+            break;
+        generation = pool->generation;
+        run_slices( pool );
+    }
+    lw_mutex_unlock( &pool->mutex );
+    return NULL;
+}
+
+lw_slice_pool_t *lw_slice_pool_create
+(
+    int thread_count
+)
+{
+    if( thread_count <= 0 )
+        thread_count = lw_get_cpu_count();
+    lw_slice_pool_t *pool = (lw_slice_pool_t *)lw_malloc_zero( sizeof(lw_slice_pool_t) );
+    if( !pool )
+        return NULL;
+    pool->worker_count = thread_count - 1;
+    if( pool->worker_count > 0 )
+    {
+        pool->workers = (slice_worker_t *)lw_malloc_zero( pool->worker_count * sizeof(slice_worker_t) );
+        if( !pool->workers )
+            goto fail_workers;
+    }
+    if( lw_mutex_init( &pool->mutex ) < 0 )
+        goto fail_mutex;
+    if( lw_cond_init( &pool->worker_cond ) < 0 )
+        goto fail_worker_cond;
+    if( lw_cond_init( &pool->caller_cond ) < 0 )
+        goto fail_caller_cond;
+    for( ; pool->started_count < pool->worker_count; pool->started_count++ )
+    {
+        slice_worker_t *worker = &pool->workers[ pool->started_count ];
+        worker->pool = pool;
+        if( lw_thread_create( &worker->thread, slice_worker, worker ) < 0 )
+        {
+            lw_slice_pool_destroy( pool );
+            return NULL;
+        }
+    }
+    return pool;
+fail_caller_cond:
+    lw_cond_destroy( &pool->worker_cond );
+fail_worker_cond:
+    lw_mutex_destroy( &pool->mutex );
+fail_mutex:
+    lw_free( pool->workers );
+fail_workers:
+    lw_free( pool );
+    return NULL;
+}
+
+void lw_slice_pool_destroy
+(
+    lw_slice_pool_t *pool
+)
+{
+    if( !pool )
+        return;
+    lw_mutex_lock( &pool->mutex );
+    pool->quit = 1;
+    lw_cond_broadcast( &pool->worker_cond );
+    lw_mutex_unlock( &pool->mutex );
+    for( int i = 0; i < pool->started_count; i++ )
+        lw_thread_join( pool->workers[i].thread );
+    lw_cond_destroy( &pool->caller_cond );
+    lw_cond_destroy( &pool->worker_cond );
+    lw_mutex_destroy( &pool->mutex );
+    lw_free( pool->workers );
+    lw_free( pool );
+}
+
+void lw_slice_pool_run
+(
+    lw_slice_pool_t *pool,
+    lw_slice_func_t  func,
+    void            *arg,
+    int              slice_count
+)
+{
+    if( slice_count <= 0 )
+        return;
+    if( pool->worker_count <= 0 || slice_count == 1 )
+    {
+        for( int i = 0; i < slice_count; i++ )
+            func( arg, i );
+        return;
+    }
+    lw_mutex_lock( &pool->mutex );
+    pool->func        = func;
+    pool->arg         = arg;
+    pool->slice_count = slice_count;
+    pool->next_slice  = 0;
+    pool->done_count  = 0;
+    ++ pool->generation;
+    lw_cond_broadcast( &pool->worker_cond );
+    run_slices( pool );
+    while( pool->done_count < pool->slice_count )
+        lw_cond_wait( &pool->caller_cond, &pool->mutex );
+    pool->slice_count = 0;
+    lw_mutex_unlock( &pool->mutex );
+}
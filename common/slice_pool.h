@@ -0,0 +1,44 @@
+/*****************************************************************************
+ * slice_pool.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+/* A pool of worker threads running the same job over a set of independent slices.
+ * The calling thread takes part in the work, so a pool for N threads has N - 1 workers. */
+typedef struct lw_slice_pool_tag lw_slice_pool_t;
+
+typedef void (*lw_slice_func_t)( void *arg, int slice_index );
+
+lw_slice_pool_t *lw_slice_pool_create
+(
+    int thread_count
+);
+
+void lw_slice_pool_destroy
+(
+    lw_slice_pool_t *pool
+);
+
+/* Call 'func( arg, i )' for each i in [0, 'slice_count') and return when all of them finished. */
+void lw_slice_pool_run
+(
+    lw_slice_pool_t *pool,
+    lw_slice_func_t  func,
+    void            *arg,
+    int              slice_count
+);
@@ -22,19 +22,60 @@
 
 #include "cpp_compat.h"
 
+#include <string.h>
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif  /* __cplusplus */
 #include <libavutil/opt.h>
 #include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libswscale/swscale.h>
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
 
 #include "utils.h"
+#include "lwthread.h"
+#include "slice_pool.h"
 #include "video_output.h"
+#include "video_tonemap.h"
+
+/* Slices start at multiples of this number of rows.
+ * This keeps both the chroma subsampling and the 8-row period of the ordered dither of swscale. */
+#define SLICE_ALIGNMENT    16
+#define MIN_SLICE_HEIGHT   64
+#define MAX_SLICE_THREADS  16
+
+typedef struct
+{
+    struct SwsContext *sws_ctx;
+    int                y;               /* the first row written into the output */
+    int                height;          /* the number of rows written into the output */
+    int                context_y;       /* the first row converted by this slice */
+    int                context_height;  /* the number of rows converted by this slice */
+    uint8_t           *scratch_data    [4];
+    int                scratch_linesize[4];
+    int                result;
+} lw_video_scaler_slice_t;
+
+struct lw_video_scaler_slices_tag
+{
+    int                      count;
+    lw_video_scaler_slice_t *slice;
+    int                      input_planes;
+    int                      input_chroma_shift;
+    int                      output_planes;
+    int                      output_chroma_shift;
+    int                      output_row_size[4];
+    /* the picture being converted */
+    const uint8_t * const   *src_data;
+    const int               *src_linesize;
+    uint8_t * const         *dst_data;
+    const int               *dst_linesize;
+};
 
 /* If YUV is treated as full range, return 1.
  * Otherwise, return 0. */
@@ -79,6 +120,8 @@ static void initialize_scaler_handler
     vshp->output_pixel_format = output_pixel_format;
     vshp->input_colorspace    = AVCOL_SPC_UNSPECIFIED;
     vshp->input_yuv_range     = AVCOL_RANGE_UNSPECIFIED;
+    vshp->input_color_trc       = AVCOL_TRC_UNSPECIFIED;
+    vshp->input_color_primaries = AVCOL_PRI_UNSPECIFIED;
 }
 
 void setup_video_rendering
@@ -149,6 +192,235 @@ static struct SwsContext *update_scaler_configuration
     return sws_ctx;
 }
 
+static void free_scaler_slices
+(
+    lw_video_scaler_slices_t *slices
+)
+{
+    if( !slices )
+        return;
+    if( slices->slice )
+        for( int i = 0; i < slices->count; i++ )
+        {
+            if( slices->slice[i].sws_ctx )
+                sws_freeContext( slices->slice[i].sws_ctx );
+            av_freep( &slices->slice[i].scratch_data[0] );
+        }
+    lw_free( slices->slice );
+    lw_free( slices );
+}
+
+/* Return the number of rows a slice needs above and below its own rows
+ * so that the vertical chroma filter of swscale sees the same input as for the whole picture.
+ * Return 0 if every output row depends only on the input row at the same position. */
+static int get_slice_margin
+(
+    int                       flags,
+    const AVPixFmtDescriptor *input_desc,
+    const AVPixFmtDescriptor *output_desc
+)
+{
+    if( input_desc->log2_chroma_h == output_desc->log2_chroma_h )
+        return 0;
+    /* the filter sizes used by swscale relative to the scaling ratio */
+    int size_factor;
+    if( flags & (SWS_FAST_BILINEAR | SWS_BILINEAR | SWS_BICUBLIN) )
+        size_factor = 4;
+    else if( flags & (SWS_POINT | SWS_AREA) )
+        size_factor = 2;
+    else if( flags & (SWS_BICUBIC | SWS_LANCZOS) )
+        size_factor = 6;
+    else
+        size_factor = 20;   /* X, GAUSS, SINC, SPLINE and unknown ones */
+    int shift = MAX( input_desc->log2_chroma_h, output_desc->log2_chroma_h );
+    int margin = (size_factor / 2 + 2) << shift;
+    return (margin + SLICE_ALIGNMENT - 1) & ~(SLICE_ALIGNMENT - 1);
+}
+
+static int get_slice_thread_count
+(
+    lw_video_scaler_handler_t *vshp
+)
+{
+    int thread_count = vshp->thread_count > 0 ? vshp->thread_count : lw_get_cpu_count();
+    return MIN( thread_count, MAX_SLICE_THREADS );
+}
+
+/* Split the conversion into slices if it is worth it and can be done bit-exactly.
+ * Return NULL if not split. Then the conversion is done by the scaler context for the whole picture. */
+static lw_video_scaler_slices_t *create_scaler_slices
+(
+    lw_video_scaler_handler_t *vshp,
+    int                        width,
+    int                        height,
+    enum AVPixelFormat         input_pixel_format,
+    enum AVColorSpace          colorspace,
+    int                        yuv_range
+)
+{
+    int slice_count = MIN( get_slice_thread_count( vshp ), height / MIN_SLICE_HEIGHT );
+    if( slice_count < 2 )
+        return NULL;
+    const AVPixFmtDescriptor *input_desc  = av_pix_fmt_desc_get( input_pixel_format );
+    const AVPixFmtDescriptor *output_desc = av_pix_fmt_desc_get( vshp->output_pixel_format );
+    if( !input_desc || !output_desc
+     || (input_desc->flags  & AV_PIX_FMT_FLAG_HWACCEL)
+     || (output_desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL)) )
+        return NULL;
+    /* Low depth RGB output is dithered by error diffusion, which carries the error over rows. */
+    if( (output_desc->flags & AV_PIX_FMT_FLAG_RGB) && av_get_bits_per_pixel( output_desc ) <= 8 )
+        return NULL;
+    int margin = get_slice_margin( vshp->scaler_flags, input_desc, output_desc );
+    /* The vertical chroma step is exact only if the whole chroma rows are covered. */
+    int chroma_alignment = 1 << MAX( input_desc->log2_chroma_h, output_desc->log2_chroma_h );
+    if( margin && (height & (chroma_alignment - 1)) )
+        return NULL;
+    if( !vshp->slice_pool )
+    {
+        vshp->slice_pool = lw_slice_pool_create( get_slice_thread_count( vshp ) );
+        if( !vshp->slice_pool )
+            return NULL;
+    }
+    lw_video_scaler_slices_t *slices = (lw_video_scaler_slices_t *)lw_malloc_zero( sizeof(lw_video_scaler_slices_t) );
+    if( !slices )
+        return NULL;
+    int slice_height = (height + slice_count - 1) / slice_count;
+    slice_height = (slice_height + SLICE_ALIGNMENT - 1) & ~(SLICE_ALIGNMENT - 1);
+    slice_count  = (height + slice_height - 1) / slice_height;
+    slices->slice = (lw_video_scaler_slice_t *)lw_malloc_zero( slice_count * sizeof(lw_video_scaler_slice_t) );
+    if( !slices->slice )
+        goto fail;
+    slices->count               = slice_count;
+    slices->input_planes        = av_pix_fmt_count_planes( input_pixel_format );
+    slices->input_chroma_shift  = input_desc->log2_chroma_h;
+    slices->output_planes       = av_pix_fmt_count_planes( vshp->output_pixel_format );
+    slices->output_chroma_shift = output_desc->log2_chroma_h;
+    if( av_image_fill_linesizes( slices->output_row_size, vshp->output_pixel_format, width ) < 0 )
+        goto fail;
+    for( int i = 0; i < slice_count; i++ )
+    {
+        lw_video_scaler_slice_t *slice = &slices->slice[i];
+        slice->y              = i * slice_height;
+        slice->height         = MIN( slice_height, height - slice->y );
+        slice->context_y      = MAX( slice->y - margin, 0 );
+        slice->context_height = MIN( slice->y + slice->height + margin, height ) - slice->context_y;
+        slice->sws_ctx = update_scaler_configuration( NULL, vshp->scaler_flags,
+                                                      width, slice->context_height,
+                                                      input_pixel_format, vshp->output_pixel_format,
+                                                      colorspace, yuv_range );
+        if( !slice->sws_ctx )
+            goto fail;
+        /* Rows converted only to feed the chroma filter must not reach the output shared with the other slices. */
+        if( margin
+         && av_image_alloc( slice->scratch_data, slice->scratch_linesize,
+                            width, slice->context_height, vshp->output_pixel_format, 32 ) < 0 )
+            goto fail;
+    }
+    return slices;
+fail:
+    free_scaler_slices( slices );
+    return NULL;
+}
+
+static void clear_scaler_cache_entry
+(
+    lw_video_scaler_cache_t *entry
+)
+{
+    if( entry->sws_ctx )
+        sws_freeContext( entry->sws_ctx );
+    free_scaler_slices( entry->slices );
+    entry->sws_ctx = NULL;
+    entry->slices  = NULL;
+}
+
+/* Return the entry of the cache for the given configuration.
+ * If the configuration is not cached yet, initialize it in place of the least recently used entry.
+ * Return NULL on failure. */
+static lw_video_scaler_cache_t *get_scaler_cache_entry
+(
+    lw_video_scaler_handler_t *vshp,
+    int                        width,
+    int                        height,
+    enum AVPixelFormat         input_pixel_format,
+    enum AVColorSpace          colorspace,
+    int                        yuv_range
+)
+{
+    lw_video_scaler_cache_t *entry = NULL;
+    for( int i = 0; i < LW_VIDEO_SCALER_CACHE_NUM; i++ )
+    {
+        lw_video_scaler_cache_t *cache = &vshp->cache[i];
+        if( cache->sws_ctx
+         && cache->width               == width
+         && cache->height              == height
+         && cache->input_pixel_format  == input_pixel_format
+         && cache->output_pixel_format == vshp->output_pixel_format
+         && cache->colorspace          == colorspace
+         && cache->yuv_range           == yuv_range
+         && cache->flags               == vshp->scaler_flags )
+        {
+            cache->last_used = ++ vshp->cache_clock;
+            return cache;
+        }
+        if( !entry
+         || (entry->sws_ctx && (!cache->sws_ctx || cache->last_used < entry->last_used)) )
+            entry = cache;
+    }
+    clear_scaler_cache_entry( entry );
+    entry->sws_ctx = update_scaler_configuration( NULL, vshp->scaler_flags,
+                                                  width, height,
+                                                  input_pixel_format, vshp->output_pixel_format,
+                                                  colorspace, yuv_range );
+    if( !entry->sws_ctx )
+        return NULL;
+    entry->slices              = create_scaler_slices( vshp, width, height, input_pixel_format, colorspace, yuv_range );
+    entry->width               = width;
+    entry->height              = height;
+    entry->input_pixel_format  = input_pixel_format;
+    entry->output_pixel_format = vshp->output_pixel_format;
+    entry->colorspace          = colorspace;
+    entry->yuv_range           = yuv_range;
+    entry->flags               = vshp->scaler_flags;
+    entry->last_used           = ++ vshp->cache_clock;
+    return entry;
+}
+
+/* Replace the pixel format of full range YUV by the limited one and return whether YUV is treated as full range. */
+static int get_input_yuv_range
+(
+    enum AVPixelFormat *input_pixel_format,
+    enum AVColorRange   color_range
+)
+{
+    int yuv_range = avoid_yuv_scale_conversion( input_pixel_format );
+    if( color_range == AVCOL_RANGE_MPEG
+     || color_range == AVCOL_RANGE_JPEG )
+        yuv_range = (color_range == AVCOL_RANGE_JPEG);
+    return yuv_range;
+}
+
+/* Set up the tone mapping of the frame if requested and it is HDR.
+ * Return a negative value if the tone mapping is required but not available. */
+static int update_tonemap_configuration
+(
+    lw_video_scaler_handler_t *vshp,
+    const AVFrame             *av_frame,
+    enum AVPixelFormat         input_pixel_format,
+    int                        yuv_range
+)
+{
+    lw_free_video_tonemap( vshp->tonemapper );
+    vshp->tonemapper = NULL;
+    if( !vshp->tonemap
+     || !lw_video_tonemap_is_hdr( av_frame->color_trc, av_frame->color_primaries, av_frame->colorspace ) )
+        return 0;
+    vshp->tonemapper = lw_create_video_tonemap( input_pixel_format, vshp->output_pixel_format,
+                                                av_frame->color_trc, yuv_range,
+                                                av_frame->width, get_slice_thread_count( vshp ) );
+    return vshp->tonemapper ? 0 : -1;
+}
+
 int update_scaler_configuration_if_needed
 (
     lw_video_scaler_handler_t *vshp,
@@ -157,38 +429,382 @@ int update_scaler_configuration_if_needed
 )
 {
     enum AVPixelFormat *input_pixel_format = (enum AVPixelFormat *)&av_frame->format;
-    int yuv_range = avoid_yuv_scale_conversion( input_pixel_format );
-    if( av_frame->color_range == AVCOL_RANGE_MPEG
-     || av_frame->color_range == AVCOL_RANGE_JPEG )
-        yuv_range = (av_frame->color_range == AVCOL_RANGE_JPEG);
+    int yuv_range = get_input_yuv_range( input_pixel_format, av_frame->color_range );
     vshp->frame_prop_change_flags
-        = (vshp->input_width        != av_frame->width      ? LW_FRAME_PROP_CHANGE_FLAG_WIDTH        : 0)
-        | (vshp->input_height       != av_frame->height     ? LW_FRAME_PROP_CHANGE_FLAG_HEIGHT       : 0)
-        | (vshp->input_pixel_format != *input_pixel_format  ? LW_FRAME_PROP_CHANGE_FLAG_PIXEL_FORMAT : 0)
-        | (vshp->input_colorspace   != av_frame->colorspace ? LW_FRAME_PROP_CHANGE_FLAG_COLORSPACE   : 0)
-        | (vshp->input_yuv_range    != yuv_range            ? LW_FRAME_PROP_CHANGE_FLAG_YUV_RANGE    : 0);
+        = (vshp->input_width           != av_frame->width           ? LW_FRAME_PROP_CHANGE_FLAG_WIDTH        : 0)
+        | (vshp->input_height          != av_frame->height          ? LW_FRAME_PROP_CHANGE_FLAG_HEIGHT       : 0)
+        | (vshp->input_pixel_format    != *input_pixel_format       ? LW_FRAME_PROP_CHANGE_FLAG_PIXEL_FORMAT : 0)
+        | (vshp->input_colorspace      != av_frame->colorspace      ? LW_FRAME_PROP_CHANGE_FLAG_COLORSPACE   : 0)
+        | (vshp->input_yuv_range       != yuv_range                 ? LW_FRAME_PROP_CHANGE_FLAG_YUV_RANGE    : 0)
+        | (vshp->input_color_trc       != av_frame->color_trc       ? LW_FRAME_PROP_CHANGE_FLAG_TRANSFER     : 0)
+        | (vshp->input_color_primaries != av_frame->color_primaries ? LW_FRAME_PROP_CHANGE_FLAG_PRIMARIES    : 0);
     if( !vshp->sws_ctx || vshp->frame_prop_change_flags )
     {
         /* Update scaler. */
-        vshp->sws_ctx = update_scaler_configuration( vshp->sws_ctx, vshp->scaler_flags,
-                                                     av_frame->width, av_frame->height,
-                                                     *input_pixel_format, vshp->output_pixel_format,
-                                                     av_frame->colorspace, yuv_range );
-        if( !vshp->sws_ctx )
+        lw_video_scaler_cache_t *entry = get_scaler_cache_entry( vshp, av_frame->width, av_frame->height,
+                                                                 *input_pixel_format, av_frame->colorspace, yuv_range );
+        if( !entry )
         {
+            vshp->sws_ctx = NULL;
+            vshp->slices  = NULL;
+            vshp->repack  = NULL;
+            lw_free_video_tonemap( vshp->tonemapper );
+            vshp->tonemapper = NULL;
             lw_log_show( lhp, LW_LOG_WARNING, "Failed to update video scaler configuration." );
             return -1;
         }
-        vshp->input_width        = av_frame->width;
-        vshp->input_height       = av_frame->height;
-        vshp->input_pixel_format = *input_pixel_format;
-        vshp->input_colorspace   = av_frame->colorspace;
-        vshp->input_yuv_range    = yuv_range;
+        vshp->sws_ctx               = entry->sws_ctx;
+        vshp->slices                = entry->slices;
+        vshp->repack                = lw_get_video_repack( *input_pixel_format, vshp->output_pixel_format );
+        vshp->input_width           = av_frame->width;
+        vshp->input_height          = av_frame->height;
+        vshp->input_pixel_format    = *input_pixel_format;
+        vshp->input_colorspace      = av_frame->colorspace;
+        vshp->input_yuv_range       = yuv_range;
+        vshp->input_color_trc       = av_frame->color_trc;
+        vshp->input_color_primaries = av_frame->color_primaries;
+        if( update_tonemap_configuration( vshp, av_frame, *input_pixel_format, yuv_range ) < 0 )
+            lw_log_show( lhp, LW_LOG_WARNING, "Tone mapping is not available for %s into %s. HDR is output as it is.",
+                         av_get_pix_fmt_name( *input_pixel_format ), av_get_pix_fmt_name( vshp->output_pixel_format ) );
         return 1;
     }
     return 0;
 }
 
+static int get_plane_row
+(
+    int plane,
+    int y,
+    int chroma_shift
+)
+{
+    return (plane == 1 || plane == 2) ? (y >> chroma_shift) : y;
+}
+
+static void scale_slice
+(
+    void *arg,
+    int   slice_index
+)
+{
+    lw_video_scaler_slices_t *slices = (lw_video_scaler_slices_t *)arg;
+    lw_video_scaler_slice_t  *slice  = &slices->slice[slice_index];
+    const uint8_t *src_data[4];
+    uint8_t       *dst_data[4];
+    int            dst_linesize[4];
+    for( int i = 0; i < 4; i++ )
+    {
+        /* Planes not counted are left as they are, e.g. the palette of PAL8. */
+        src_data[i] = slices->src_data[i];
+        if( src_data[i] && i < slices->input_planes )
+            src_data[i] += (ptrdiff_t)get_plane_row( i, slice->context_y, slices->input_chroma_shift ) * slices->src_linesize[i];
+        if( slice->scratch_data[0] )
+        {
+            dst_data    [i] = slice->scratch_data    [i];
+            dst_linesize[i] = slice->scratch_linesize[i];
+        }
+        else
+        {
+            dst_data    [i] = slices->dst_data    [i];
+            dst_linesize[i] = slices->dst_linesize[i];
+            if( dst_data[i] && i < slices->output_planes )
+                dst_data[i] += (ptrdiff_t)get_plane_row( i, slice->y, slices->output_chroma_shift ) * dst_linesize[i];
+        }
+    }
+    slice->result = sws_scale( slice->sws_ctx, src_data, slices->src_linesize,
+                               0, slice->context_height, dst_data, dst_linesize );
+    if( slice->result <= 0 || !slice->scratch_data[0] )
+        return;
+    /* Copy the rows this slice is responsible for. */
+    for( int i = 0; i < slices->output_planes; i++ )
+    {
+        int shift  = (i == 1 || i == 2) ? slices->output_chroma_shift : 0;
+        int offset = (slice->y - slice->context_y) >> shift;
+        int y      = slice->y >> shift;
+        int end    = -((-(slice->y + slice->height)) >> shift);    /* Round up the last chroma row. */
+        av_image_copy_plane( slices->dst_data[i] + (ptrdiff_t)y * slices->dst_linesize[i], slices->dst_linesize[i],
+                             slice->scratch_data[i] + (ptrdiff_t)offset * slice->scratch_linesize[i], slice->scratch_linesize[i],
+                             slices->output_row_size[i], end - y );
+    }
+}
+
+typedef struct
+{
+    lw_video_tonemap_t    *tonemapper;
+    int                    slice_height;
+    int                    height;
+    const uint8_t * const *src_data;
+    const int             *src_linesize;
+    uint8_t * const       *dst_data;
+    const int             *dst_linesize;
+} lw_video_tonemap_job_t;
+
+static void tonemap_slice
+(
+    void *arg,
+    int   slice_index
+)
+{
+    lw_video_tonemap_job_t *job = (lw_video_tonemap_job_t *)arg;
+    int y = slice_index * job->slice_height;
+    lw_video_tonemap( job->tonemapper, slice_index,
+                      job->dst_data, job->dst_linesize,
+                      job->src_data, job->src_linesize,
+                      y, MIN( job->slice_height, job->height - y ) );
+}
+
+/* Tone-map the picture in slices processed in parallel. */
+static int tonemap_picture
+(
+    lw_video_scaler_handler_t *vshp,
+    const uint8_t * const     *src_data,
+    const int                 *src_linesize,
+    int                        height,
+    uint8_t * const           *dst_data,
+    const int                 *dst_linesize
+)
+{
+    lw_video_tonemap_job_t job;
+    job.tonemapper   = vshp->tonemapper;
+    job.height       = height;
+    job.src_data     = src_data;
+    job.src_linesize = src_linesize;
+    job.dst_data     = dst_data;
+    job.dst_linesize = dst_linesize;
+    int slice_count = MIN( get_slice_thread_count( vshp ), height / MIN_SLICE_HEIGHT );
+    if( slice_count >= 2 && !vshp->slice_pool )
+        vshp->slice_pool = lw_slice_pool_create( get_slice_thread_count( vshp ) );
+    if( slice_count < 2 || !vshp->slice_pool )
+    {
+        job.slice_height = height;
+        tonemap_slice( &job, 0 );
+        return height;
+    }
+    job.slice_height = (height + slice_count - 1) / slice_count;
+    job.slice_height = (job.slice_height + SLICE_ALIGNMENT - 1) & ~(SLICE_ALIGNMENT - 1);
+    slice_count      = (height + job.slice_height - 1) / job.slice_height;
+    lw_slice_pool_run( vshp->slice_pool, tonemap_slice, &job, slice_count );
+    return height;
+}
+
+int lw_video_scale_picture
+(
+    lw_video_scaler_handler_t *vshp,
+    const uint8_t * const     *src_data,
+    const int                 *src_linesize,
+    int                        height,
+    uint8_t * const           *dst_data,
+    const int                 *dst_linesize
+)
+{
+    if( vshp->tonemapper && height > 0 && height <= vshp->input_height )
+        return tonemap_picture( vshp, src_data, src_linesize, height, dst_data, dst_linesize );
+    if( vshp->repack )
+    {
+        lw_video_repack( vshp->repack, dst_data, dst_linesize, src_data, src_linesize, vshp->input_width, height );
+        return height;
+    }
+    lw_video_scaler_slices_t *slices = vshp->slices;
+    if( !slices || height != vshp->input_height )
+    {
+        int ret = sws_scale( vshp->sws_ctx, src_data, src_linesize, 0, height, dst_data, dst_linesize );
+        return ret > 0 ? ret : -1;
+    }
+    slices->src_data     = src_data;
+    slices->src_linesize = src_linesize;
+    slices->dst_data     = dst_data;
+    slices->dst_linesize = dst_linesize;
+    lw_slice_pool_run( vshp->slice_pool, scale_slice, slices, slices->count );
+    for( int i = 0; i < slices->count; i++ )
+        if( slices->slice[i].result <= 0 )
+            return -1;
+    return height;
+}
+
+int lw_video_band_conversion_available
+(
+    const AVCodecContext *ctx
+)
+{
+    return ctx->codec && (ctx->codec->capabilities & CODEC_CAP_DRAW_HORIZ_BAND);
+}
+
+void lw_video_setup_band_conversion
+(
+    lw_video_output_handler_t *vohp,
+    AVCodecContext            *ctx,
+    int  (*get_buffer)( struct AVCodecContext *, AVFrame *, int ),
+    void (*draw_horiz_band)( struct AVCodecContext *, const AVFrame *, int *, int, int, int )
+)
+{
+    ctx->get_buffer2     = get_buffer;
+    ctx->draw_horiz_band = draw_horiz_band;
+    ctx->slice_flags     = SLICE_FLAG_CODED_ORDER;
+    ctx->opaque          = vohp;
+}
+
+int lw_video_band_frame_available
+(
+    const lw_video_scaler_handler_t *vshp,
+    const AVCodecContext            *ctx,
+    const AVFrame                   *av_frame
+)
+{
+    enum AVPixelFormat input_pixel_format = (enum AVPixelFormat)av_frame->format;
+    avoid_yuv_scale_conversion( &input_pixel_format );
+    /* The output pixel format may depend on the input one, which is determined with the first frame of it. */
+    return !(ctx->active_thread_type & (FF_THREAD_FRAME | FF_THREAD_SLICE))
+        && input_pixel_format == vshp->input_pixel_format
+        && !vshp->tonemapper;
+}
+
+void lw_video_band_frame_init
+(
+    lw_video_band_frame_t     *band,
+    lw_video_scaler_handler_t *vshp,
+    const AVCodecContext      *ctx,
+    const AVFrame             *av_frame,
+    uint8_t * const           *dst_data,
+    const int                 *dst_linesize
+)
+{
+    memset( band, 0, sizeof(lw_video_band_frame_t) );
+    if( !lw_video_band_frame_available( vshp, ctx, av_frame ) )
+        return;
+    enum AVPixelFormat input_pixel_format = (enum AVPixelFormat)av_frame->format;
+    int yuv_range = get_input_yuv_range( &input_pixel_format, ctx->color_range );
+    /* The frame given to get_buffer2() may have the coded dimensions, while the bands cover the displayed ones. */
+    band->active              = 1;
+    band->width               = ctx->width;
+    band->height              = ctx->height;
+    band->input_pixel_format  = input_pixel_format;
+    band->output_pixel_format = vshp->output_pixel_format;
+    band->colorspace          = ctx->colorspace;
+    band->yuv_range           = yuv_range;
+    for( int i = 0; i < 4; i++ )
+    {
+        band->data    [i] = dst_data    [i];
+        band->linesize[i] = dst_linesize[i];
+    }
+}
+
+/* Get the scaler context for the conversion of the frame 'band' starting from its first band. */
+static struct SwsContext *get_band_scaler
+(
+    lw_video_scaler_handler_t   *vshp,
+    const lw_video_band_frame_t *band
+)
+{
+    lw_video_band_converter_t *converter = &vshp->band;
+    if( converter->sws_ctx
+     && converter->width               == band->width
+     && converter->height              == band->height
+     && converter->input_pixel_format  == band->input_pixel_format
+     && converter->output_pixel_format == band->output_pixel_format
+     && converter->colorspace          == band->colorspace
+     && converter->yuv_range           == band->yuv_range
+     && converter->flags               == vshp->scaler_flags )
+        return converter->sws_ctx;
+    converter->sws_ctx = update_scaler_configuration( converter->sws_ctx, vshp->scaler_flags,
+                                                      band->width, band->height,
+                                                      band->input_pixel_format, band->output_pixel_format,
+                                                      band->colorspace, band->yuv_range );
+    converter->width               = band->width;
+    converter->height              = band->height;
+    converter->input_pixel_format  = band->input_pixel_format;
+    converter->output_pixel_format = band->output_pixel_format;
+    converter->colorspace          = band->colorspace;
+    converter->yuv_range           = band->yuv_range;
+    converter->flags               = vshp->scaler_flags;
+    return converter->sws_ctx;
+}
+
+int lw_video_scale_band
+(
+    lw_video_scaler_handler_t *vshp,
+    lw_video_band_frame_t     *band,
+    const AVFrame             *src,
+    const int                 *offset,
+    int                        y,
+    int                        height
+)
+{
+    if( !band->active || band->converted_height < 0 )
+        return -1;
+    /* Any band out of order, e.g. rows reported twice on errors, leaves the frame to the conversion after decoding. */
+    if( y != band->received_height || height <= 0 || y + height > band->height )
+    {
+        band->converted_height = -1;
+        return -1;
+    }
+    band->received_height += height;
+    const AVPixFmtDescriptor *input_desc  = av_pix_fmt_desc_get( band->input_pixel_format );
+    const AVPixFmtDescriptor *output_desc = av_pix_fmt_desc_get( band->output_pixel_format );
+    const lw_video_repack_t  *repack      = lw_get_video_repack( band->input_pixel_format, band->output_pixel_format );
+    /* swscale refuses slices splitting a row of input chroma samples except the last one,
+     * and repacking converts whole rows of both input and output chroma samples. */
+    int chroma_shift = repack ? MAX( input_desc->log2_chroma_h, output_desc->log2_chroma_h ) : input_desc->log2_chroma_h;
+    int start_y      = band->converted_height;
+    int end_y        = band->received_height == band->height
+                     ? band->height
+                     : band->received_height & ~((1 << chroma_shift) - 1);
+    if( end_y <= start_y )
+        /* Wait for the rest of the chroma row. The rows kept stay untouched in the frame being decoded. */
+        return band->converted_height;
+    /* 'offset' points to the row 'y', so go back to the first row kept. */
+    const uint8_t *src_data[4];
+    for( int i = 0; i < 4; i++ )
+    {
+        int kept_rows = get_plane_row( i, y,       input_desc->log2_chroma_h )
+                      - get_plane_row( i, start_y, input_desc->log2_chroma_h );
+        src_data[i] = src->data[i] ? src->data[i] + offset[i] - (ptrdiff_t)kept_rows * src->linesize[i] : NULL;
+    }
+    if( repack )
+    {
+        /* Rows of repacking are independent of each other, so the rows go to the same rows of the output. */
+        uint8_t *dst_data[4];
+        for( int i = 0; i < 4; i++ )
+            dst_data[i] = band->data[i]
+                        ? band->data[i] + (ptrdiff_t)get_plane_row( i, start_y, output_desc->log2_chroma_h ) * band->linesize[i]
+                        : NULL;
+        lw_video_repack( repack, dst_data, band->linesize, src_data, src->linesize, band->width, end_y - start_y );
+        band->output_height += end_y - start_y;
+    }
+    else
+    {
+        struct SwsContext *sws_ctx = start_y == 0 ? get_band_scaler( vshp, band ) : vshp->band.sws_ctx;
+        if( !sws_ctx )
+            goto fail;
+        /* swscale keeps the rows the vertical filter needs, so the output may lag behind the input. */
+        int ret = sws_scale( sws_ctx, src_data, src->linesize, start_y, end_y - start_y, band->data, band->linesize );
+        if( ret < 0 )
+            goto fail;
+        band->output_height += ret;
+    }
+    band->converted_height = end_y;
+    return band->converted_height;
+fail:
+    band->converted_height = -1;
+    return -1;
+}
+
+int lw_video_band_frame_is_complete
+(
+    const lw_video_band_frame_t     *band,
+    const lw_video_scaler_handler_t *vshp
+)
+{
+    return band->active
+        && band->converted_height    == band->height
+        && band->output_height       == band->height
+        && band->width               == vshp->input_width
+        && band->height              == vshp->input_height
+        && band->input_pixel_format  == vshp->input_pixel_format
+        && band->output_pixel_format == vshp->output_pixel_format
+        && band->colorspace          == vshp->input_colorspace
+        && band->yuv_range           == vshp->input_yuv_range;
+}
+
 void lw_cleanup_video_output_handler
 (
     lw_video_output_handler_t *vohp
@@ -200,9 +816,95 @@ void lw_cleanup_video_output_handler
     lw_freep( &vohp->frame_order_list );
     for( int i = 0; i < REPEAT_CONTROL_CACHE_NUM; i++ )
         av_frame_free( &vohp->frame_cache_buffers[i] );
-    if( vohp->scaler.sws_ctx )
+    lw_video_scaler_handler_t *vshp = &vohp->scaler;
+    for( int i = 0; i < LW_VIDEO_SCALER_CACHE_NUM; i++ )
+        clear_scaler_cache_entry( &vshp->cache[i] );
+    vshp->sws_ctx = NULL;
+    vshp->slices  = NULL;
+    vshp->repack  = NULL;
+    lw_slice_pool_destroy( vshp->slice_pool );
+    vshp->slice_pool = NULL;
+    if( vshp->band.sws_ctx )
+        sws_freeContext( vshp->band.sws_ctx );
+    vshp->band.sws_ctx = NULL;
+    lw_free_video_tonemap( vshp->tonemapper );
+    vshp->tonemapper = NULL;
+}
+
+int lw_setup_video_background_plane
+(
+    lw_video_background_t *bgp,
+    int                    plane,
+    int                    width,
+    int                    height,
+    int                    sub_width,
+    int                    sub_height,
+    int                    sample_size,
+    const uint8_t         *pattern,
+    int                    pattern_size
+)
+{
+    if( plane < 0 || plane >= 4 || width <= 0 || height <= 0 || pattern_size <= 0 )
+        return -1;
+    lw_video_background_plane_t *bgpp = &bgp->plane[plane];
+    lw_freep( &bgpp->line );
+    /* One more period of the pattern lets a copy start at any phase. */
+    bgpp->line = (uint8_t *)lw_malloc_zero( width + pattern_size );
+    if( !bgpp->line )
+        return -1;
+    for( int i = 0; i < width + pattern_size; i++ )
+        bgpp->line[i] = pattern[i % pattern_size];
+    bgpp->width        = width;
+    bgpp->height       = height;
+    bgpp->sub_width    = sub_width;
+    bgpp->sub_height   = sub_height;
+    bgpp->sample_size  = sample_size;
+    bgpp->pattern_size = pattern_size;
+    bgp->plane_count   = MAX( bgp->plane_count, plane + 1 );
+    return 0;
+}
+
+void lw_fill_video_background
+(
+    const lw_video_background_t *bgp,
+    uint8_t * const             *data,
+    const int                   *linesize,
+    int                          picture_width,
+    int                          picture_height
+)
+{
+    for( int i = 0; i < bgp->plane_count; i++ )
     {
-        sws_freeContext( vohp->scaler.sws_ctx );
-        vohp->scaler.sws_ctx = NULL;
+        const lw_video_background_plane_t *bgpp = &bgp->plane[i];
+        if( !bgpp->line || !data[i] )
+            continue;
+        /* Round up the picture size of subsampled planes since the picture covers any partial sample. */
+        int covered_width  = ((picture_width  + (1 << bgpp->sub_width ) - 1) >> bgpp->sub_width) * bgpp->sample_size;
+        int covered_height =  (picture_height + (1 << bgpp->sub_height) - 1) >> bgpp->sub_height;
+        covered_width  = MIN( MAX( covered_width,  0 ), bgpp->width  );
+        covered_height = MIN( MAX( covered_height, 0 ), bgpp->height );
+        uint8_t *row = data[i];
+        int y = 0;
+        if( covered_width < bgpp->width )
+        {
+            const uint8_t *src  = bgpp->line + covered_width % bgpp->pattern_size;
+            int            size = bgpp->width - covered_width;
+            for( ; y < covered_height; y++, row += linesize[i] )
+                memcpy( row + covered_width, src, size );
+        }
+        else
+            row += (ptrdiff_t)covered_height * linesize[i];
+        for( y = covered_height; y < bgpp->height; y++, row += linesize[i] )
+            memcpy( row, bgpp->line, bgpp->width );
     }
 }
+
+void lw_cleanup_video_background
+(
+    lw_video_background_t *bgp
+)
+{
+    for( int i = 0; i < 4; i++ )
+        lw_freep( &bgp->plane[i].line );
+    bgp->plane_count = 0;
+}
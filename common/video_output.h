@@ -20,6 +20,8 @@
 
 /* This file is available under an ISC license. */
 
+#include "video_repack.h"
+
 #define REPEAT_CONTROL_CACHE_NUM 2
 
 #define LW_FRAME_PROP_CHANGE_FLAG_WIDTH        (1<<0)
@@ -27,21 +29,112 @@
 #define LW_FRAME_PROP_CHANGE_FLAG_PIXEL_FORMAT (1<<2)
 #define LW_FRAME_PROP_CHANGE_FLAG_COLORSPACE   (1<<3)
 #define LW_FRAME_PROP_CHANGE_FLAG_YUV_RANGE    (1<<4)
+#define LW_FRAME_PROP_CHANGE_FLAG_TRANSFER     (1<<5)
+#define LW_FRAME_PROP_CHANGE_FLAG_PRIMARIES    (1<<6)
+
+#define LW_VIDEO_SCALER_CACHE_NUM 4
+
+typedef struct lw_video_scaler_slices_tag lw_video_scaler_slices_t;
+
+/* An initialized scaler configuration kept for reuse */
+typedef struct
+{
+    int                       width;
+    int                       height;
+    enum AVPixelFormat        input_pixel_format;
+    enum AVPixelFormat        output_pixel_format;
+    enum AVColorSpace         colorspace;
+    int                       yuv_range;
+    int                       flags;
+    uint32_t                  last_used;
+    struct SwsContext        *sws_ctx;          /* NULL if this entry is unused */
+    lw_video_scaler_slices_t *slices;
+} lw_video_scaler_cache_t;
+
+/* The scaler context dedicated to the conversion band by band while decoding
+ * It is not shared with the conversion of whole pictures since swscale keeps the state of the picture being converted. */
+typedef struct
+{
+    int                       width;
+    int                       height;
+    enum AVPixelFormat        input_pixel_format;
+    enum AVPixelFormat        output_pixel_format;
+    enum AVColorSpace         colorspace;
+    int                       yuv_range;
+    int                       flags;
+    struct SwsContext        *sws_ctx;
+} lw_video_band_converter_t;
 
 typedef struct
 {
-    int                enabled;
-    int                scaler_flags;
-    int                frame_prop_change_flags;
-    int                input_width;
-    int                input_height;
-    enum AVPixelFormat input_pixel_format;
-    enum AVPixelFormat output_pixel_format;
-    enum AVColorSpace  input_colorspace;
-    int                input_yuv_range;
-    struct SwsContext *sws_ctx;
+    int                       enabled;
+    int                       scaler_flags;
+    int                       frame_prop_change_flags;
+    int                       input_width;
+    int                       input_height;
+    enum AVPixelFormat        input_pixel_format;
+    enum AVPixelFormat        output_pixel_format;
+    enum AVColorSpace         input_colorspace;
+    int                       input_yuv_range;
+    struct SwsContext        *sws_ctx;          /* owned by 'cache' */
+    const lw_video_repack_t  *repack;           /* lossless fast path used instead of swscale if not NULL */
+    /* Slice threading
+     * The picture is split into horizontal bands converted by their own scaler contexts in parallel. */
+    int                       thread_count;     /* 0 means the number of logical processors */
+    lw_video_scaler_slices_t *slices;           /* NULL if the conversion is not split; owned by 'cache' */
+    struct lw_slice_pool_tag *slice_pool;       /* shared by all the cached configurations */
+    /* Configurations seen recently
+     * Switching back to one of them, e.g. between SD and HD parts of a broadcast, requires no scaler initialization. */
+    lw_video_scaler_cache_t   cache[LW_VIDEO_SCALER_CACHE_NUM];
+    uint32_t                  cache_clock;
+    lw_video_band_converter_t band;
+    /* HDR to SDR conversion
+     * If 'tonemap' is nonzero, PQ and HLG pictures are tone-mapped into SDR BT.709 instead of converted by swscale.
+     * Then direct rendering and the conversion band by band shall not be used since they bypass it. */
+    int                       tonemap;
+    enum AVColorTransferCharacteristic input_color_trc;
+    enum AVColorPrimaries     input_color_primaries;
+    struct lw_video_tonemap_tag *tonemapper;    /* NULL if the current configuration is not tone-mapped */
 } lw_video_scaler_handler_t;
 
+/* The state of a decoded frame converted band by band into its output frame
+ * Each band of rows is converted as soon as the decoder reports it finished via draw_horiz_band(),
+ * i.e. while it is still in the cache, instead of by another pass over the whole picture after decoding. */
+typedef struct
+{
+    int                       active;           /* nonzero if the frame is converted band by band */
+    int                       width;
+    int                       height;
+    enum AVPixelFormat        input_pixel_format;
+    enum AVPixelFormat        output_pixel_format;
+    enum AVColorSpace         colorspace;
+    int                       yuv_range;
+    int                       received_height;  /* the number of input rows reported by the decoder */
+    int                       converted_height; /* the number of input rows converted, or a negative value on failure */
+    int                       output_height;    /* the number of output rows written */
+    uint8_t                  *data    [4];      /* the output picture */
+    int                       linesize[4];
+} lw_video_band_frame_t;
+
+/* The black background of a plane
+ * Only the area the picture does not cover is filled, from a line prefilled with the pattern of black. */
+typedef struct
+{
+    int      width;             /* in bytes */
+    int      height;
+    int      sub_width;         /* log2 of the horizontal subsampling against the picture */
+    int      sub_height;        /* log2 of the vertical subsampling against the picture */
+    int      sample_size;       /* bytes per sample */
+    int      pattern_size;      /* bytes per period of the pattern; 1, 2 or 4 */
+    uint8_t *line;              /* 'width + pattern_size' bytes of the pattern */
+} lw_video_background_plane_t;
+
+typedef struct
+{
+    int                         plane_count;
+    lw_video_background_plane_t plane[4];
+} lw_video_background_t;
+
 typedef struct
 {
     uint32_t top;
@@ -94,7 +187,121 @@ int update_scaler_configuration_if_needed
     const AVFrame             *av_frame
 );
 
+/* Convert a whole picture of the current scaler configuration into 'dst_data'.
+ * HDR is tone-mapped if requested and supported for the output pixel format.
+ * A pure repacking such as NV12 to YUV420P is done by the SIMD kernels of video_repack.
+ * Otherwise, the conversion is split into slices processed in parallel if possible.
+ * The result is bit-identical to the one of a single sws_scale() call with 'vshp->sws_ctx' except for tone mapping.
+ * Return the height of the output picture, or a negative value on failure. */
+int lw_video_scale_picture
+(
+    lw_video_scaler_handler_t *vshp,
+    const uint8_t * const     *src_data,
+    const int                 *src_linesize,
+    int                        height,
+    uint8_t * const           *dst_data,
+    const int                 *dst_linesize
+);
+
+/* Return 1 if the decoder can report the bands of rows it has finished so that frames can be converted band by band.
+ * Otherwise, return 0. */
+int lw_video_band_conversion_available
+(
+    const struct AVCodecContext *ctx
+);
+
+/* Install 'get_buffer' and 'draw_horiz_band' into the decoder for the conversion band by band.
+ * Unlike direct rendering, the output dimensions are not aligned since the decoder keeps its own buffers.
+ * The bands are requested in coded order, so that they belong to the frame being decoded
+ * rather than to a reference frame decoded earlier. */
+void lw_video_setup_band_conversion
+(
+    lw_video_output_handler_t *vohp,
+    struct AVCodecContext     *ctx,
+    int  (*get_buffer)( struct AVCodecContext *, AVFrame *, int ),
+    void (*draw_horiz_band)( struct AVCodecContext *, const AVFrame *, int *, int, int, int )
+);
+
+/* Return 1 if the frame 'av_frame' just allocated by get_buffer2() can be converted band by band.
+ * It cannot if the decoder runs threads, which could report bands concurrently,
+ * or if its pixel format differs from the current configuration of the scaler.
+ * Then the whole picture is converted after decoding as usual, and no output frame needs to be allocated in advance. */
+int lw_video_band_frame_available
+(
+    const lw_video_scaler_handler_t *vshp,
+    const struct AVCodecContext     *ctx,
+    const AVFrame                   *av_frame
+);
+
+/* Start the conversion band by band of the frame 'av_frame' just allocated by get_buffer2() into the picture 'dst_data'.
+ * The frame is left inactive unless lw_video_band_frame_available() returns 1. */
+void lw_video_band_frame_init
+(
+    lw_video_band_frame_t       *band,
+    lw_video_scaler_handler_t   *vshp,
+    const struct AVCodecContext *ctx,
+    const AVFrame               *av_frame,
+    uint8_t * const             *dst_data,
+    const int                   *dst_linesize
+);
+
+/* Convert the band of 'height' rows from the row 'y' reported by draw_horiz_band().
+ * Bands must come in order from the top. Otherwise, the frame is marked failed.
+ * The rows are kept until they reach a row of chroma samples or the bottom of the picture,
+ * so a band ending in the middle of a chroma row is converted together with the next one.
+ * Return the number of input rows converted so far, or a negative value on failure. */
+int lw_video_scale_band
+(
+    lw_video_scaler_handler_t *vshp,
+    lw_video_band_frame_t     *band,
+    const AVFrame             *src,
+    const int                 *offset,
+    int                        y,
+    int                        height
+);
+
+/* Return 1 if the whole picture has been converted band by band with the current configuration of the scaler.
+ * Otherwise, return 0. Then the picture shall be converted as usual. */
+int lw_video_band_frame_is_complete
+(
+    const lw_video_band_frame_t     *band,
+    const lw_video_scaler_handler_t *vshp
+);
+
 void lw_cleanup_video_output_handler
 (
     lw_video_output_handler_t *vohp
 );
+
+/* Set up the black background of the plane 'plane' of the output frames.
+ * 'pattern' is 'pattern_size' bytes of black repeated over the plane, e.g. { 0x80, 0x00 } for U of YUY2.
+ * Return 0 if successful, or a negative value otherwise. */
+int lw_setup_video_background_plane
+(
+    lw_video_background_t *bgp,
+    int                    plane,
+    int                    width,
+    int                    height,
+    int                    sub_width,
+    int                    sub_height,
+    int                    sample_size,
+    const uint8_t         *pattern,
+    int                    pattern_size
+);
+
+/* Fill the area of the output frame not covered by the picture of 'picture_width' x 'picture_height' samples
+ * placed at the top-left corner. A negative linesize, e.g. for bottom-up RGB, is allowed.
+ * Nothing is written if the picture covers the whole frame. */
+void lw_fill_video_background
+(
+    const lw_video_background_t *bgp,
+    uint8_t * const             *data,
+    const int                   *linesize,
+    int                          picture_width,
+    int                          picture_height
+);
+
+void lw_cleanup_video_background
+(
+    lw_video_background_t *bgp
+);
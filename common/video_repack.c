@@ -0,0 +1,410 @@
+/*****************************************************************************
+ * video_repack.c / video_repack.cpp
+ *****************************************************************************
+ * Copyright (C) 2012-2026 L-SMASH Works project
+ *
+ * Authors: Yusuke Nakamura <muken.the.vfrmaniac@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  /* __cplusplus */
+#include <libavutil/pixfmt.h>
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#include "lwsimd.h"
+#include "lwthread.h"
+#include "video_repack.h"
+#include "video_repack_simd.h"
+
+typedef enum
+{
+    REPACK_SEMIPLANAR  = 0,     /* NV12, P010 and the like */
+    REPACK_PACKED      = 1,     /* packed RGB */
+    REPACK_PACKED_422  = 2,     /* packed YUV 4:2:2 */
+} repack_type;
+
+struct lw_video_repack_tag
+{
+    enum AVPixelFormat input_pixel_format;
+    enum AVPixelFormat output_pixel_format;
+    repack_type        type;
+    int                components;          /* the number of values per pixel of the packed plane */
+    int                component_size;      /* the number of bytes per value */
+    int                shift;
+    int                offsets[3];          /* the positions of the values written into each output plane */
+};
+
+/* All 16-bit formats are little-endian. */
+static const lw_video_repack_t repack_table[] =
+    {
+        { AV_PIX_FMT_NV12,     AV_PIX_FMT_YUV420P,     REPACK_SEMIPLANAR, 2, 1, 0, { 0, 1, 0 } },
+        { AV_PIX_FMT_NV21,     AV_PIX_FMT_YUV420P,     REPACK_SEMIPLANAR, 2, 1, 0, { 1, 0, 0 } },
+#ifdef AV_PIX_FMT_P010
+        { AV_PIX_FMT_P010LE,   AV_PIX_FMT_YUV420P10LE, REPACK_SEMIPLANAR, 2, 2, 6, { 0, 1, 0 } },
+#endif
+#ifdef AV_PIX_FMT_P016
+        { AV_PIX_FMT_P016LE,   AV_PIX_FMT_YUV420P16LE, REPACK_SEMIPLANAR, 2, 2, 0, { 0, 1, 0 } },
+#endif
+        { AV_PIX_FMT_YUYV422,  AV_PIX_FMT_YUV422P,     REPACK_PACKED_422, 2, 1, 0, { 0, 0, 0 } },
+        { AV_PIX_FMT_UYVY422,  AV_PIX_FMT_YUV422P,     REPACK_PACKED_422, 2, 1, 0, { 1, 0, 0 } },
+        /* Planar RGB is stored in the order of G, B and R. */
+        { AV_PIX_FMT_RGB24,    AV_PIX_FMT_GBRP,        REPACK_PACKED,     3, 1, 0, { 1, 2, 0 } },
+        { AV_PIX_FMT_BGR24,    AV_PIX_FMT_GBRP,        REPACK_PACKED,     3, 1, 0, { 1, 0, 2 } },
+        { AV_PIX_FMT_RGBA,     AV_PIX_FMT_GBRP,        REPACK_PACKED,     4, 1, 0, { 1, 2, 0 } },
+        { AV_PIX_FMT_BGRA,     AV_PIX_FMT_GBRP,        REPACK_PACKED,     4, 1, 0, { 1, 0, 2 } },
+        { AV_PIX_FMT_ARGB,     AV_PIX_FMT_GBRP,        REPACK_PACKED,     4, 1, 0, { 2, 3, 1 } },
+        { AV_PIX_FMT_ABGR,     AV_PIX_FMT_GBRP,        REPACK_PACKED,     4, 1, 0, { 2, 1, 3 } },
+        { AV_PIX_FMT_RGB48LE,  AV_PIX_FMT_GBRP16LE,    REPACK_PACKED,     3, 2, 0, { 1, 2, 0 } },
+        { AV_PIX_FMT_BGR48LE,  AV_PIX_FMT_GBRP16LE,    REPACK_PACKED,     3, 2, 0, { 1, 0, 2 } },
+        { AV_PIX_FMT_NONE,     AV_PIX_FMT_NONE,        REPACK_SEMIPLANAR, 0, 0, 0, { 0, 0, 0 } }
+    };
+
+static int deinterleave_c
+(
+    uint8_t       *dst0,
+    uint8_t       *dst1,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    for( int i = 0; i < width; i++ )
+    {
+        dst0[i] = src[2 * i    ];
+        dst1[i] = src[2 * i + 1];
+    }
+    return width;
+}
+
+static int deinterleave_16bit_c
+(
+    uint8_t       *dst0,
+    uint8_t       *dst1,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    const uint16_t *in = (const uint16_t *)src;
+    for( int i = 0; i < width; i++ )
+    {
+        ((uint16_t *)dst0)[i] = in[2 * i    ] >> shift;
+        ((uint16_t *)dst1)[i] = in[2 * i + 1] >> shift;
+    }
+    return width;
+}
+
+static int shift_16bit_c
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    for( int i = 0; i < width; i++ )
+        ((uint16_t *)dst)[i] = ((const uint16_t *)src)[i] >> shift;
+    return width;
+}
+
+static int unpack_packed_c
+(
+    uint8_t *const *dst,
+    const uint8_t  *src,
+    int             width,
+    int             components,
+    int             component_size,
+    const int      *offsets
+)
+{
+    for( int k = 0; k < 3; k++ )
+    {
+        const uint8_t *in  = src + offsets[k] * component_size;
+        uint8_t       *out = dst[k];
+        if( component_size == 2 )
+            for( int i = 0; i < width; i++, in += 2 * components )
+                ((uint16_t *)out)[i] = *(const uint16_t *)in;
+        else
+            for( int i = 0; i < width; i++, in += components )
+                out[i] = *in;
+    }
+    return width;
+}
+
+static int unpack_yuv422_c
+(
+    uint8_t       *dst_y,
+    uint8_t       *dst_u,
+    uint8_t       *dst_v,
+    const uint8_t *src,
+    int            width,
+    int            luma_offset
+)
+{
+    const uint8_t *chroma = src + 1 - luma_offset;
+    for( int i = 0; i < width; i++ )
+        dst_y[i] = src[2 * i + luma_offset];
+    /* An odd width has the last pair of chroma as well. */
+    for( int i = 0; i < (width + 1) / 2; i++ )
+    {
+        dst_u[i] = chroma[4 * i    ];
+        dst_v[i] = chroma[4 * i + 2];
+    }
+    return width;
+}
+
+const lw_video_repack_t *lw_get_video_repack
+(
+    enum AVPixelFormat input_pixel_format,
+    enum AVPixelFormat output_pixel_format
+)
+{
+    for( int i = 0; repack_table[i].input_pixel_format != AV_PIX_FMT_NONE; i++ )
+        if( repack_table[i].input_pixel_format  == input_pixel_format
+         && repack_table[i].output_pixel_format == output_pixel_format )
+            return &repack_table[i];
+    return NULL;
+}
+
+/* The SIMD kernels picked for the running CPU, NULL if none is usable.
+ * The table is rebuilt at the next use after lw_set_cpu_flags_mask() changes the usable instruction sets. */
+typedef struct
+{
+    func_video_deinterleave  *deinterleave_8bit;
+    func_video_deinterleave  *deinterleave_16bit;
+    func_video_deinterleave  *split_16bit;
+    func_video_shift         *shift_16bit;
+    func_video_unpack        *unpack_packed;
+    func_video_unpack_yuv422 *unpack_yuv422;
+} repack_kernels_t;
+
+static repack_kernels_t  kernels;
+static volatile uint32_t kernels_revision;
+static lw_static_mutex_t kernels_mutex = LW_STATIC_MUTEX_INITIALIZER;
+
+static void build_kernels( void )
+{
+    repack_kernels_t table;
+    uint32_t flags = lw_get_cpu_flags();
+    table.deinterleave_8bit = (flags & LW_CPU_SSE2) ? deinterleave_8bit_sse2 : NULL;
+    if( flags & LW_CPU_SSE41 )
+    {
+        table.deinterleave_16bit = deinterleave_16bit_sse41;
+        table.shift_16bit        = shift_16bit_sse41;
+        table.unpack_packed      = unpack_packed_sse41;
+        table.unpack_yuv422      = unpack_yuv422_sse41;
+    }
+    else
+    {
+        table.deinterleave_16bit = NULL;
+        table.shift_16bit        = NULL;
+        table.unpack_packed      = NULL;
+        table.unpack_yuv422      = NULL;
+    }
+    if( flags & LW_CPU_AVX2 )
+    {
+        table.deinterleave_8bit  = deinterleave_8bit_avx2;
+        table.deinterleave_16bit = deinterleave_16bit_avx2;
+        table.shift_16bit        = shift_16bit_avx2;
+        table.unpack_packed      = unpack_packed_avx2;
+    }
+#if LW_HAVE_AVX512BW
+    if( flags & LW_CPU_AVX512BW )
+    {
+        table.deinterleave_8bit  = deinterleave_8bit_avx512bw;
+        table.deinterleave_16bit = deinterleave_16bit_avx512bw;
+        table.shift_16bit        = shift_16bit_avx512bw;
+    }
+#endif
+    /* Splitting little-endian 16-bit values is deinterleaving their bytes. */
+    table.split_16bit = table.deinterleave_8bit;
+    kernels = table;
+    lw_atomic_store( &kernels_revision, lw_get_cpu_flags_revision() );
+}
+
+static void get_kernels
+(
+    repack_kernels_t *dst
+)
+{
+    /* Only a stale table takes the lock. A reading racing with a rebuild might mix the entries
+     * of the old and new tables, which are all usable on the running CPU. */
+    if( lw_atomic_load( &kernels_revision ) != lw_get_cpu_flags_revision() )
+    {
+        lw_static_mutex_lock( &kernels_mutex );
+        if( kernels_revision != lw_get_cpu_flags_revision() )
+            build_kernels();
+        lw_static_mutex_unlock( &kernels_mutex );
+    }
+    *dst = kernels;
+}
+
+static void repack_semiplanar
+(
+    const lw_video_repack_t *repack,
+    uint8_t * const         *dst_data,
+    const int               *dst_linesize,
+    const uint8_t * const   *src_data,
+    const int               *src_linesize,
+    int                      width,
+    int                      height
+)
+{
+    repack_kernels_t simd;
+    get_kernels( &simd );
+    int size = repack->component_size;
+    func_video_deinterleave *deinterleave_simd = size == 2 ? simd.deinterleave_16bit : simd.deinterleave_8bit;
+    func_video_deinterleave *deinterleave_tail = size == 2 ? deinterleave_16bit_c     : deinterleave_c;
+    func_video_shift        *shift_simd        = simd.shift_16bit;
+    /* luma */
+    for( int y = 0; y < height; y++ )
+    {
+        const uint8_t *src = src_data[0] + (ptrdiff_t)y * src_linesize[0];
+        uint8_t       *dst = dst_data[0] + (ptrdiff_t)y * dst_linesize[0];
+        if( repack->shift == 0 )
+        {
+            memcpy( dst, src, width * size );
+            continue;
+        }
+        int i = shift_simd ? shift_simd( dst, src, width, repack->shift ) : 0;
+        shift_16bit_c( dst + 2 * i, src + 2 * i, width - i, repack->shift );
+    }
+    /* chroma: 4:2:0 */
+    int chroma_width  = (width  + 1) >> 1;
+    int chroma_height = (height + 1) >> 1;
+    for( int y = 0; y < chroma_height; y++ )
+    {
+        const uint8_t *src  = src_data[1] + (ptrdiff_t)y * src_linesize[1];
+        uint8_t       *dst0 = dst_data[1 + repack->offsets[0]] + (ptrdiff_t)y * dst_linesize[1 + repack->offsets[0]];
+        uint8_t       *dst1 = dst_data[1 + repack->offsets[1]] + (ptrdiff_t)y * dst_linesize[1 + repack->offsets[1]];
+        int i = deinterleave_simd ? deinterleave_simd( dst0, dst1, src, chroma_width, repack->shift ) : 0;
+        deinterleave_tail( dst0 + i * size, dst1 + i * size, src + 2 * i * size, chroma_width - i, repack->shift );
+    }
+}
+
+static void repack_packed
+(
+    const lw_video_repack_t *repack,
+    uint8_t * const         *dst_data,
+    const int               *dst_linesize,
+    const uint8_t * const   *src_data,
+    const int               *src_linesize,
+    int                      width,
+    int                      height
+)
+{
+    repack_kernels_t simd;
+    get_kernels( &simd );
+    func_video_unpack *unpack_simd = simd.unpack_packed;
+    int pixel_size = repack->components * repack->component_size;
+    for( int y = 0; y < height; y++ )
+    {
+        const uint8_t *src = src_data[0] + (ptrdiff_t)y * src_linesize[0];
+        uint8_t *dst[3];
+        for( int k = 0; k < 3; k++ )
+            dst[k] = dst_data[k] + (ptrdiff_t)y * dst_linesize[k];
+        int i = unpack_simd ? unpack_simd( dst, src, width, repack->components, repack->component_size, repack->offsets ) : 0;
+        for( int k = 0; k < 3; k++ )
+            dst[k] += i * repack->component_size;
+        unpack_packed_c( dst, src + i * pixel_size, width - i, repack->components, repack->component_size, repack->offsets );
+    }
+}
+
+static void repack_packed_422
+(
+    const lw_video_repack_t *repack,
+    uint8_t * const         *dst_data,
+    const int               *dst_linesize,
+    const uint8_t * const   *src_data,
+    const int               *src_linesize,
+    int                      width,
+    int                      height
+)
+{
+    repack_kernels_t simd;
+    get_kernels( &simd );
+    func_video_unpack_yuv422 *unpack_simd = simd.unpack_yuv422;
+    int luma_offset = repack->offsets[0];
+    for( int y = 0; y < height; y++ )
+    {
+        const uint8_t *src   = src_data[0] + (ptrdiff_t)y * src_linesize[0];
+        uint8_t       *dst_y = dst_data[0] + (ptrdiff_t)y * dst_linesize[0];
+        uint8_t       *dst_u = dst_data[1] + (ptrdiff_t)y * dst_linesize[1];
+        uint8_t       *dst_v = dst_data[2] + (ptrdiff_t)y * dst_linesize[2];
+        int i = unpack_simd ? unpack_simd( dst_y, dst_u, dst_v, src, width, luma_offset ) : 0;
+        /* 'i' is always even. */
+        unpack_yuv422_c( dst_y + i, dst_u + i / 2, dst_v + i / 2, src + 2 * i, width - i, luma_offset );
+    }
+}
+
+void lw_video_repack
+(
+    const lw_video_repack_t *repack,
+    uint8_t * const         *dst_data,
+    const int               *dst_linesize,
+    const uint8_t * const   *src_data,
+    const int               *src_linesize,
+    int                      width,
+    int                      height
+)
+{
+    switch( repack->type )
+    {
+        case REPACK_SEMIPLANAR :
+            repack_semiplanar( repack, dst_data, dst_linesize, src_data, src_linesize, width, height );
+            break;
+        case REPACK_PACKED :
+            repack_packed( repack, dst_data, dst_linesize, src_data, src_linesize, width, height );
+            break;
+        case REPACK_PACKED_422 :
+            repack_packed_422( repack, dst_data, dst_linesize, src_data, src_linesize, width, height );
+            break;
+    }
+}
+
+void lw_video_split_16bit
+(
+    uint8_t       *dst_msb,
+    uint8_t       *dst_lsb,
+    int            dst_linesize,
+    const uint8_t *src,
+    int            src_linesize,
+    int            width,
+    int            height
+)
+{
+    repack_kernels_t simd;
+    get_kernels( &simd );
+    func_video_deinterleave *split_simd = simd.split_16bit;
+    for( int y = 0; y < height; y++ )
+    {
+        const uint8_t *in  = src     + (ptrdiff_t)y * src_linesize;
+        uint8_t       *msb = dst_msb + (ptrdiff_t)y * dst_linesize;
+        uint8_t       *lsb = dst_lsb + (ptrdiff_t)y * dst_linesize;
+        int i = split_simd ? split_simd( lsb, msb, in, width, 0 ) : 0;
+        deinterleave_c( lsb + i, msb + i, in + 2 * i, width - i, 0 );
+    }
+}
@@ -0,0 +1,64 @@
+/*****************************************************************************
+ * video_repack.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#ifndef LW_VIDEO_REPACK_H
+#define LW_VIDEO_REPACK_H
+
+#include <stdint.h>
+
+/* Lossless conversions which only rearrange or shift the values of pixels.
+ * These give the same result as swscale for the supported pairs of pixel formats, but much faster. */
+typedef struct lw_video_repack_tag lw_video_repack_t;
+
+/* Return the repacker from 'input_pixel_format' into 'output_pixel_format'.
+ * Return NULL if not supported. */
+const lw_video_repack_t *lw_get_video_repack
+(
+    enum AVPixelFormat input_pixel_format,
+    enum AVPixelFormat output_pixel_format
+);
+
+/* Convert a whole picture.
+ * The planes of 'dst_data' are in the order of the output pixel format, e.g. G, B and R for AV_PIX_FMT_GBRP. */
+void lw_video_repack
+(
+    const lw_video_repack_t *repack,
+    uint8_t * const         *dst_data,
+    const int               *dst_linesize,
+    const uint8_t * const   *src_data,
+    const int               *src_linesize,
+    int                      width,
+    int                      height
+);
+
+/* Split 16-bit little-endian values into the plane of their MSBs and the plane of their LSBs,
+ * e.g. into the stacked format of AviSynth. */
+void lw_video_split_16bit
+(
+    uint8_t       *dst_msb,
+    uint8_t       *dst_lsb,
+    int            dst_linesize,
+    const uint8_t *src,
+    int            src_linesize,
+    int            width,
+    int            height
+);
+
+#endif  /* LW_VIDEO_REPACK_H */
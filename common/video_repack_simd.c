@@ -0,0 +1,375 @@
+/*****************************************************************************
+ * video_repack_simd.c / video_repack_simd.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include <stdint.h>
+
+#include "lwsimd.h"
+#include "video_repack_simd.h"
+
+/* Build the byte shuffles gathering each of the three components out of 16-byte chunks of packed pixels.
+ * 'masks[k][j]' picks the bytes of the k-th component from the j-th chunk. */
+static void build_unpack_masks
+(
+    uint8_t    masks[3][4][16],
+    int        components,
+    int        component_size,
+    const int *offsets
+)
+{
+    for( int k = 0; k < 3; k++ )
+        for( int j = 0; j < components; j++ )
+            for( int q = 0; q < 16; q++ )
+            {
+                int i = q / component_size;
+                int s = (components * i + offsets[k]) * component_size + q % component_size - 16 * j;
+                masks[k][j][q] = (s >= 0 && s < 16) ? s : 0x80;
+            }
+}
+
+#ifdef __GNUC__
+#pragma GCC target ("sse2")
+#endif
+#include <emmintrin.h>
+
+int LW_FUNC_ALIGN deinterleave_8bit_sse2
+(
+    uint8_t       *dst0,
+    uint8_t       *dst1,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    const __m128i mask = _mm_set1_epi16( 0x00FF );
+    int i = 0;
+    for( ; i <= width - 16; i += 16 )
+    {
+        __m128i x0 = _mm_loadu_si128( (const __m128i *)(src + 2 * i     ) );
+        __m128i x1 = _mm_loadu_si128( (const __m128i *)(src + 2 * i + 16) );
+        _mm_storeu_si128( (__m128i *)(dst0 + i), _mm_packus_epi16( _mm_and_si128( x0, mask ), _mm_and_si128( x1, mask ) ) );
+        _mm_storeu_si128( (__m128i *)(dst1 + i), _mm_packus_epi16( _mm_srli_epi16( x0, 8 ), _mm_srli_epi16( x1, 8 ) ) );
+    }
+    return i;
+}
+
+#ifdef __GNUC__
+#pragma GCC target ("sse4.1")
+#endif
+#include <smmintrin.h>
+
+int LW_FUNC_ALIGN deinterleave_16bit_sse41
+(
+    uint8_t       *dst0,
+    uint8_t       *dst1,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    const __m128i mask  = _mm_set1_epi32( 0x0000FFFF );
+    const __m128i count = _mm_cvtsi32_si128( shift );
+    int i = 0;
+    for( ; i <= width - 8; i += 8 )
+    {
+        __m128i x0 = _mm_loadu_si128( (const __m128i *)(src + 4 * i     ) );
+        __m128i x1 = _mm_loadu_si128( (const __m128i *)(src + 4 * i + 16) );
+        __m128i y0 = _mm_packus_epi32( _mm_and_si128( x0, mask ), _mm_and_si128( x1, mask ) );
+        __m128i y1 = _mm_packus_epi32( _mm_srli_epi32( x0, 16 ), _mm_srli_epi32( x1, 16 ) );
+        _mm_storeu_si128( (__m128i *)(dst0 + 2 * i), _mm_srl_epi16( y0, count ) );
+        _mm_storeu_si128( (__m128i *)(dst1 + 2 * i), _mm_srl_epi16( y1, count ) );
+    }
+    return i;
+}
+
+int LW_FUNC_ALIGN shift_16bit_sse41
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    const __m128i count = _mm_cvtsi32_si128( shift );
+    int i = 0;
+    for( ; i <= width - 8; i += 8 )
+    {
+        __m128i x = _mm_loadu_si128( (const __m128i *)(src + 2 * i) );
+        _mm_storeu_si128( (__m128i *)(dst + 2 * i), _mm_srl_epi16( x, count ) );
+    }
+    return i;
+}
+
+int LW_FUNC_ALIGN unpack_packed_sse41
+(
+    uint8_t *const *dst,
+    const uint8_t  *src,
+    int             width,
+    int             components,
+    int             component_size,
+    const int      *offsets
+)
+{
+    /* Every 16 bytes of each output plane come from 'components' chunks of 16 bytes of the input. */
+    uint8_t LW_ALIGN(16) masks[3][4][16];
+    build_unpack_masks( masks, components, component_size, offsets );
+    const int step = 16 / component_size;
+    int i = 0;
+    for( ; i <= width - step; i += step )
+    {
+        const uint8_t *in = src + i * components * component_size;
+        __m128i x[4];
+        for( int j = 0; j < components; j++ )
+            x[j] = _mm_loadu_si128( (const __m128i *)(in + 16 * j) );
+        for( int k = 0; k < 3; k++ )
+        {
+            __m128i y = _mm_shuffle_epi8( x[0], _mm_load_si128( (const __m128i *)masks[k][0] ) );
+            for( int j = 1; j < components; j++ )
+                y = _mm_or_si128( y, _mm_shuffle_epi8( x[j], _mm_load_si128( (const __m128i *)masks[k][j] ) ) );
+            _mm_storeu_si128( (__m128i *)(dst[k] + i * component_size), y );
+        }
+    }
+    return i;
+}
+
+int LW_FUNC_ALIGN unpack_yuv422_sse41
+(
+    uint8_t       *dst_y,
+    uint8_t       *dst_u,
+    uint8_t       *dst_v,
+    const uint8_t *src,
+    int            width,
+    int            luma_offset
+)
+{
+    const __m128i mask = _mm_set1_epi16( 0x00FF );
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for( ; i <= width - 16; i += 16 )
+    {
+        __m128i x0 = _mm_loadu_si128( (const __m128i *)(src + 2 * i     ) );
+        __m128i x1 = _mm_loadu_si128( (const __m128i *)(src + 2 * i + 16) );
+        __m128i lo = _mm_packus_epi16( _mm_and_si128( x0, mask ), _mm_and_si128( x1, mask ) );
+        __m128i hi = _mm_packus_epi16( _mm_srli_epi16( x0, 8 ), _mm_srli_epi16( x1, 8 ) );
+        __m128i y  = luma_offset ? hi : lo;
+        __m128i c  = luma_offset ? lo : hi;     /* U0 V0 U1 V1 ... */
+        _mm_storeu_si128( (__m128i *)(dst_y + i), y );
+        _mm_storel_epi64( (__m128i *)(dst_u + i / 2), _mm_packus_epi16( _mm_and_si128( c, mask ), zero ) );
+        _mm_storel_epi64( (__m128i *)(dst_v + i / 2), _mm_packus_epi16( _mm_srli_epi16( c, 8 ), zero ) );
+    }
+    return i;
+}
+
+#ifdef __GNUC__
+#pragma GCC target ("avx2")
+#endif
+#include <immintrin.h>
+
+/* Packing works within each 128-bit lane, so the middle lanes are swapped afterwards. */
+
+int LW_FUNC_ALIGN deinterleave_8bit_avx2
+(
+    uint8_t       *dst0,
+    uint8_t       *dst1,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    const __m256i mask = _mm256_set1_epi16( 0x00FF );
+    int i = 0;
+    for( ; i <= width - 32; i += 32 )
+    {
+        __m256i x0 = _mm256_loadu_si256( (const __m256i *)(src + 2 * i     ) );
+        __m256i x1 = _mm256_loadu_si256( (const __m256i *)(src + 2 * i + 32) );
+        __m256i y0 = _mm256_packus_epi16( _mm256_and_si256( x0, mask ), _mm256_and_si256( x1, mask ) );
+        __m256i y1 = _mm256_packus_epi16( _mm256_srli_epi16( x0, 8 ), _mm256_srli_epi16( x1, 8 ) );
+        _mm256_storeu_si256( (__m256i *)(dst0 + i), _mm256_permute4x64_epi64( y0, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+        _mm256_storeu_si256( (__m256i *)(dst1 + i), _mm256_permute4x64_epi64( y1, _MM_SHUFFLE( 3, 1, 2, 0 ) ) );
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+int LW_FUNC_ALIGN deinterleave_16bit_avx2
+(
+    uint8_t       *dst0,
+    uint8_t       *dst1,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    const __m256i mask  = _mm256_set1_epi32( 0x0000FFFF );
+    const __m128i count = _mm_cvtsi32_si128( shift );
+    int i = 0;
+    for( ; i <= width - 16; i += 16 )
+    {
+        __m256i x0 = _mm256_loadu_si256( (const __m256i *)(src + 4 * i     ) );
+        __m256i x1 = _mm256_loadu_si256( (const __m256i *)(src + 4 * i + 32) );
+        __m256i y0 = _mm256_packus_epi32( _mm256_and_si256( x0, mask ), _mm256_and_si256( x1, mask ) );
+        __m256i y1 = _mm256_packus_epi32( _mm256_srli_epi32( x0, 16 ), _mm256_srli_epi32( x1, 16 ) );
+        y0 = _mm256_srl_epi16( _mm256_permute4x64_epi64( y0, _MM_SHUFFLE( 3, 1, 2, 0 ) ), count );
+        y1 = _mm256_srl_epi16( _mm256_permute4x64_epi64( y1, _MM_SHUFFLE( 3, 1, 2, 0 ) ), count );
+        _mm256_storeu_si256( (__m256i *)(dst0 + 2 * i), y0 );
+        _mm256_storeu_si256( (__m256i *)(dst1 + 2 * i), y1 );
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+int LW_FUNC_ALIGN shift_16bit_avx2
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    const __m128i count = _mm_cvtsi32_si128( shift );
+    int i = 0;
+    for( ; i <= width - 16; i += 16 )
+    {
+        __m256i x = _mm256_loadu_si256( (const __m256i *)(src + 2 * i) );
+        _mm256_storeu_si256( (__m256i *)(dst + 2 * i), _mm256_srl_epi16( x, count ) );
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+/* Each 128-bit lane unpacks its own group of pixels exactly like the SSE4.1 version,
+ * and the second group is loaded into the upper lanes, so no shuffle crosses lanes. */
+int LW_FUNC_ALIGN unpack_packed_avx2
+(
+    uint8_t *const *dst,
+    const uint8_t  *src,
+    int             width,
+    int             components,
+    int             component_size,
+    const int      *offsets
+)
+{
+    uint8_t LW_ALIGN(16) masks[3][4][16];
+    build_unpack_masks( masks, components, component_size, offsets );
+    __m256i shuffle[3][4];
+    for( int k = 0; k < 3; k++ )
+        for( int j = 0; j < components; j++ )
+            shuffle[k][j] = _mm256_broadcastsi128_si256( _mm_load_si128( (const __m128i *)masks[k][j] ) );
+    const int step      = 32 / component_size;
+    const int half_size = 16 * components;
+    int i = 0;
+    for( ; i <= width - step; i += step )
+    {
+        const uint8_t *in = src + i * components * component_size;
+        __m256i x[4];
+        for( int j = 0; j < components; j++ )
+            x[j] = _mm256_inserti128_si256( _mm256_castsi128_si256( _mm_loadu_si128( (const __m128i *)(in + 16 * j) ) ),
+                                            _mm_loadu_si128( (const __m128i *)(in + half_size + 16 * j) ), 1 );
+        for( int k = 0; k < 3; k++ )
+        {
+            __m256i y = _mm256_shuffle_epi8( x[0], shuffle[k][0] );
+            for( int j = 1; j < components; j++ )
+                y = _mm256_or_si256( y, _mm256_shuffle_epi8( x[j], shuffle[k][j] ) );
+            _mm256_storeu_si256( (__m256i *)(dst[k] + i * component_size), y );
+        }
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+#if LW_HAVE_AVX512BW
+#ifdef __GNUC__
+#pragma GCC target ("avx512bw")
+#endif
+#include <immintrin.h>
+
+/* Packing works within each 128-bit lane, so the 64-bit halves of the lanes are gathered afterwards. */
+
+int LW_FUNC_ALIGN deinterleave_8bit_avx512bw
+(
+    uint8_t       *dst0,
+    uint8_t       *dst1,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    const __m512i mask  = _mm512_set1_epi16( 0x00FF );
+    const __m512i order = _mm512_set_epi64( 7, 5, 3, 1, 6, 4, 2, 0 );
+    int i = 0;
+    for( ; i <= width - 64; i += 64 )
+    {
+        __m512i x0 = _mm512_loadu_si512( (const void *)(src + 2 * i     ) );
+        __m512i x1 = _mm512_loadu_si512( (const void *)(src + 2 * i + 64) );
+        __m512i y0 = _mm512_packus_epi16( _mm512_and_si512( x0, mask ), _mm512_and_si512( x1, mask ) );
+        __m512i y1 = _mm512_packus_epi16( _mm512_srli_epi16( x0, 8 ), _mm512_srli_epi16( x1, 8 ) );
+        _mm512_storeu_si512( (void *)(dst0 + i), _mm512_permutexvar_epi64( order, y0 ) );
+        _mm512_storeu_si512( (void *)(dst1 + i), _mm512_permutexvar_epi64( order, y1 ) );
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+int LW_FUNC_ALIGN deinterleave_16bit_avx512bw
+(
+    uint8_t       *dst0,
+    uint8_t       *dst1,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    const __m512i mask  = _mm512_set1_epi32( 0x0000FFFF );
+    const __m512i order = _mm512_set_epi64( 7, 5, 3, 1, 6, 4, 2, 0 );
+    const __m128i count = _mm_cvtsi32_si128( shift );
+    int i = 0;
+    for( ; i <= width - 32; i += 32 )
+    {
+        __m512i x0 = _mm512_loadu_si512( (const void *)(src + 4 * i     ) );
+        __m512i x1 = _mm512_loadu_si512( (const void *)(src + 4 * i + 64) );
+        __m512i y0 = _mm512_packus_epi32( _mm512_and_si512( x0, mask ), _mm512_and_si512( x1, mask ) );
+        __m512i y1 = _mm512_packus_epi32( _mm512_srli_epi32( x0, 16 ), _mm512_srli_epi32( x1, 16 ) );
+        y0 = _mm512_srl_epi16( _mm512_permutexvar_epi64( order, y0 ), count );
+        y1 = _mm512_srl_epi16( _mm512_permutexvar_epi64( order, y1 ), count );
+        _mm512_storeu_si512( (void *)(dst0 + 2 * i), y0 );
+        _mm512_storeu_si512( (void *)(dst1 + 2 * i), y1 );
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+int LW_FUNC_ALIGN shift_16bit_avx512bw
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            width,
+    int            shift
+)
+{
+    const __m128i count = _mm_cvtsi32_si128( shift );
+    int i = 0;
+    for( ; i <= width - 32; i += 32 )
+    {
+        __m512i x = _mm512_loadu_si512( (const void *)(src + 2 * i) );
+        _mm512_storeu_si512( (void *)(dst + 2 * i), _mm512_srl_epi16( x, count ) );
+    }
+    _mm256_zeroupper();
+    return i;
+}
+#endif
@@ -0,0 +1,78 @@
+/*****************************************************************************
+ * video_repack_simd.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+/* Each function processes a leading part of a row and returns the number of pixels done.
+ * The caller finishes the rest of the row. */
+
+/* Split interleaved pairs of 'size'-byte values into two planes, shifting each value right by 'shift'. */
+typedef int func_video_deinterleave
+(
+    uint8_t       *dst0,
+    uint8_t       *dst1,
+    const uint8_t *src,
+    int            width,
+    int            shift
+);
+
+/* Shift 16-bit values right by 'shift'. */
+typedef int func_video_shift
+(
+    uint8_t       *dst,
+    const uint8_t *src,
+    int            width,
+    int            shift
+);
+
+/* Split three components at 'offsets' of each pixel of 'components' values of 'component_size' bytes into 'dst'. */
+typedef int func_video_unpack
+(
+    uint8_t *const *dst,
+    const uint8_t  *src,
+    int             width,
+    int             components,
+    int             component_size,
+    const int      *offsets
+);
+
+/* Split packed YUV 4:2:2, of which luma is at 'luma_offset' of each 16-bit pair, into three planes. */
+typedef int func_video_unpack_yuv422
+(
+    uint8_t       *dst_y,
+    uint8_t       *dst_u,
+    uint8_t       *dst_v,
+    const uint8_t *src,
+    int            width,
+    int            luma_offset
+);
+
+func_video_deinterleave  deinterleave_8bit_sse2;
+func_video_deinterleave  deinterleave_16bit_sse41;
+func_video_shift         shift_16bit_sse41;
+func_video_unpack        unpack_packed_sse41;
+func_video_unpack_yuv422 unpack_yuv422_sse41;
+func_video_deinterleave  deinterleave_8bit_avx2;
+func_video_deinterleave  deinterleave_16bit_avx2;
+func_video_shift         shift_16bit_avx2;
+func_video_unpack        unpack_packed_avx2;
+#if LW_HAVE_AVX512BW
+func_video_deinterleave  deinterleave_8bit_avx512bw;
+func_video_deinterleave  deinterleave_16bit_avx512bw;
+func_video_shift         shift_16bit_avx512bw;
+#endif
@@ -0,0 +1,534 @@
+/*****************************************************************************
+ * video_tonemap.c / video_tonemap.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include "cpp_compat.h"
+
+#include <stddef.h>
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif  /* __cplusplus */
+#include <libavutil/pixfmt.h>
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
+#include "utils.h"
+#include "lwsimd.h"
+#include "video_tonemap.h"
+#include "video_tonemap_simd.h"
+
+/* The code points of ISO/IEC 23001-8 used by libavutil, which older versions do not name yet */
+#define TONEMAP_TRC_SMPTE2084    16
+#define TONEMAP_TRC_ARIB_STD_B67 18
+#define TONEMAP_PRI_BT2020       9
+#define TONEMAP_SPC_BT2020_NCL   9
+
+/* The luminance of the reference white of SDR in HDR, as recommended by ITU-R BT.2408 */
+#define REFERENCE_WHITE  203.0
+/* The peak luminance mapped to the peak of SDR
+ * This is the nominal peak of HLG and the mastering peak of most PQ content. */
+#define PEAK_LUMINANCE   1000.0
+/* Linear light below this is left as it is, and brighter light is compressed towards the peak. */
+#define KNEE             0.3
+
+typedef struct
+{
+    enum AVPixelFormat pixel_format;
+    int                bit_depth;
+    int                chroma_w_shift;
+    int                chroma_h_shift;
+    int                rgb;             /* planar RGB in the order of G, B and R */
+} tonemap_format_t;
+
+/* All 16-bit formats are little-endian. */
+static const tonemap_format_t input_formats[] =
+    {
+        { AV_PIX_FMT_YUV420P10LE, 10, 1, 1, 0 },
+        { AV_PIX_FMT_YUV422P10LE, 10, 1, 0, 0 },
+        { AV_PIX_FMT_YUV444P10LE, 10, 0, 0, 0 },
+        { AV_PIX_FMT_YUV420P12LE, 12, 1, 1, 0 },
+        { AV_PIX_FMT_YUV422P12LE, 12, 1, 0, 0 },
+        { AV_PIX_FMT_YUV444P12LE, 12, 0, 0, 0 },
+        { AV_PIX_FMT_YUV420P14LE, 14, 1, 1, 0 },
+        { AV_PIX_FMT_YUV422P14LE, 14, 1, 0, 0 },
+        { AV_PIX_FMT_YUV444P14LE, 14, 0, 0, 0 },
+        { AV_PIX_FMT_YUV420P16LE, 16, 1, 1, 0 },
+        { AV_PIX_FMT_YUV422P16LE, 16, 1, 0, 0 },
+        { AV_PIX_FMT_YUV444P16LE, 16, 0, 0, 0 },
+        { AV_PIX_FMT_NONE,         0, 0, 0, 0 }
+    };
+
+static const tonemap_format_t output_formats[] =
+    {
+        { AV_PIX_FMT_YUV420P,      8, 1, 1, 0 },
+        { AV_PIX_FMT_YUV422P,      8, 1, 0, 0 },
+        { AV_PIX_FMT_YUV444P,      8, 0, 0, 0 },
+        { AV_PIX_FMT_YUV420P9LE,   9, 1, 1, 0 },
+        { AV_PIX_FMT_YUV422P9LE,   9, 1, 0, 0 },
+        { AV_PIX_FMT_YUV444P9LE,   9, 0, 0, 0 },
+        { AV_PIX_FMT_YUV420P10LE, 10, 1, 1, 0 },
+        { AV_PIX_FMT_YUV422P10LE, 10, 1, 0, 0 },
+        { AV_PIX_FMT_YUV444P10LE, 10, 0, 0, 0 },
+        { AV_PIX_FMT_YUV420P12LE, 12, 1, 1, 0 },
+        { AV_PIX_FMT_YUV422P12LE, 12, 1, 0, 0 },
+        { AV_PIX_FMT_YUV444P12LE, 12, 0, 0, 0 },
+        { AV_PIX_FMT_YUV420P14LE, 14, 1, 1, 0 },
+        { AV_PIX_FMT_YUV422P14LE, 14, 1, 0, 0 },
+        { AV_PIX_FMT_YUV444P14LE, 14, 0, 0, 0 },
+        { AV_PIX_FMT_YUV420P16LE, 16, 1, 1, 0 },
+        { AV_PIX_FMT_YUV422P16LE, 16, 1, 0, 0 },
+        { AV_PIX_FMT_YUV444P16LE, 16, 0, 0, 0 },
+        { AV_PIX_FMT_GBRP,         8, 0, 0, 1 },
+        { AV_PIX_FMT_GBRP9LE,      9, 0, 0, 1 },
+        { AV_PIX_FMT_GBRP10LE,    10, 0, 0, 1 },
+        { AV_PIX_FMT_GBRP16LE,    16, 0, 0, 1 },
+        { AV_PIX_FMT_NONE,         0, 0, 0, 0 }
+    };
+
+typedef struct
+{
+    uint16_t *cb;               /* the chroma of a row upsampled to the luma width */
+    uint16_t *cr;
+    float    *rgb[2][3];        /* R'G'B' of the output of each row of a chroma row */
+} tonemap_scratch_t;
+
+struct lw_video_tonemap_tag
+{
+    const tonemap_format_t     *input;
+    const tonemap_format_t     *output;
+    int                         width;
+    lw_video_tonemap_params_t   params;
+    func_video_tonemap_pixels  *tonemap_pixels;     /* SIMD kernel, or NULL */
+    int                         scratch_count;
+    tonemap_scratch_t          *scratch;
+    float                       eotf[LW_TONEMAP_LUT_SIZE + 1];
+    float                       oetf[LW_TONEMAP_LUT_SIZE + 1];
+};
+
+static const tonemap_format_t *find_format
+(
+    const tonemap_format_t *table,
+    enum AVPixelFormat      pixel_format
+)
+{
+    for( int i = 0; table[i].pixel_format != AV_PIX_FMT_NONE; i++ )
+        if( table[i].pixel_format == pixel_format )
+            return &table[i];
+    return NULL;
+}
+
+int lw_video_tonemap_is_hdr
+(
+    enum AVColorTransferCharacteristic color_trc,
+    enum AVColorPrimaries              color_primaries,
+    enum AVColorSpace                  colorspace
+)
+{
+    /* Unspecified primaries and matrix are taken as BT.2020, which both PQ and HLG are used with. */
+    return ((int)color_trc == TONEMAP_TRC_SMPTE2084 || (int)color_trc == TONEMAP_TRC_ARIB_STD_B67)
+        && ((int)color_primaries == TONEMAP_PRI_BT2020   || color_primaries == AVCOL_PRI_UNSPECIFIED)
+        && ((int)colorspace      == TONEMAP_SPC_BT2020_NCL || colorspace    == AVCOL_SPC_UNSPECIFIED);
+}
+
+/* SMPTE ST 2084 into luminance in cd/m^2 */
+static double pq_eotf
+(
+    double e
+)
+{
+    const double m1 = 2610.0 / 16384;
+    const double m2 = 2523.0 / 4096 * 128;
+    const double c1 = 3424.0 / 4096;
+    const double c2 = 2413.0 / 4096 * 32;
+    const double c3 = 2392.0 / 4096 * 32;
+    double p = pow( e, 1 / m2 );
+    return 10000 * pow( MAX( p - c1, 0 ) / (c2 - c3 * p), 1 / m1 );
+}
+
+/* ARIB STD-B67 into luminance in cd/m^2 on the nominal display
+ * The OOTF of the system gamma 1.2 is applied to each component rather than to the luminance,
+ * which lets the whole conversion stay within per-component lookup tables. */
+static double hlg_eotf
+(
+    double e
+)
+{
+    const double a = 0.17883277;
+    const double b = 0.28466892;
+    const double c = 0.55991073;
+    double scene = e <= 0.5 ? e * e / 3 : (exp( (e - c) / a ) + b) / 12;
+    return PEAK_LUMINANCE * pow( scene, 1.2 );
+}
+
+static void setup_params
+(
+    lw_video_tonemap_t                *tm,
+    enum AVColorTransferCharacteristic color_trc,
+    int                                yuv_range
+)
+{
+    lw_video_tonemap_params_t *p = &tm->params;
+    double depth_scale = 1 << (tm->input->bit_depth - 8);
+    double max_value   = (1 << tm->input->bit_depth) - 1;
+    if( yuv_range )
+    {
+        p->y_scale  = (float)(1 / max_value);
+        p->y_offset = 0.0f;
+        p->c_scale  = (float)(1 / max_value);
+        p->c_offset = (float)(-128 * depth_scale / max_value);
+    }
+    else
+    {
+        p->y_scale  = (float)(1 / (219 * depth_scale));
+        p->y_offset = (float)(-16.0 / 219);
+        p->c_scale  = (float)(1 / (224 * depth_scale));
+        p->c_offset = (float)(-128.0 / 224);
+    }
+    /* Kr = 0.2627 and Kb = 0.0593 */
+    const double kr = 0.2627;
+    const double kb = 0.0593;
+    const double kg = 1 - kr - kb;
+    p->cr_r = (float)(2 * (1 - kr));
+    p->cb_g = (float)(-2 * kb * (1 - kb) / kg);
+    p->cr_g = (float)(-2 * kr * (1 - kr) / kg);
+    p->cb_b = (float)(2 * (1 - kb));
+    /* The Mobius curve is continuous with the identity at the knee and reaches 1.0 at the peak. */
+    const double peak = PEAK_LUMINANCE / REFERENCE_WHITE;
+    const double j    = KNEE;
+    const double a    = -j * j * (peak - 1) / (j * j - 2 * j + peak);
+    const double b    = (j * j - 2 * j * peak + peak) / (peak - 1);
+    p->knee        = (float)j;
+    p->curve_a     = (float)a;
+    p->curve_b     = (float)b;
+    p->curve_scale = (float)((b * b + 2 * b * j + j * j) / (b - a));
+    /* ITU-R BT.2087 */
+    static const float gamut[3][3] =
+        {
+            {  1.660491f, -0.587641f, -0.072850f },
+            { -0.124550f,  1.132900f, -0.008349f },
+            { -0.018151f, -0.100579f,  1.118730f }
+        };
+    for( int i = 0; i < 3; i++ )
+        for( int k = 0; k < 3; k++ )
+            p->gamut[i][k] = gamut[i][k];
+    /* The output is encoded by the inverse of the EOTF of ITU-R BT.1886 with the black level of 0. */
+    for( int i = 0; i <= LW_TONEMAP_LUT_SIZE; i++ )
+    {
+        double e = (double)i / LW_TONEMAP_LUT_SIZE;
+        double l = (int)color_trc == TONEMAP_TRC_SMPTE2084 ? pq_eotf( e ) : hlg_eotf( e );
+        tm->eotf[i] = (float)(l / REFERENCE_WHITE);
+        tm->oetf[i] = (float)pow( e, 2 / 2.4 );
+    }
+    p->eotf = tm->eotf;
+    p->oetf = tm->oetf;
+}
+
+static void free_scratch
+(
+    lw_video_tonemap_t *tm
+)
+{
+    if( !tm->scratch )
+        return;
+    for( int i = 0; i < tm->scratch_count; i++ )
+    {
+        tonemap_scratch_t *scratch = &tm->scratch[i];
+        lw_free( scratch->cb );
+        lw_free( scratch->cr );
+        lw_free( scratch->rgb[0][0] );
+    }
+    lw_freep( &tm->scratch );
+}
+
+static int alloc_scratch
+(
+    lw_video_tonemap_t *tm,
+    int                 scratch_count
+)
+{
+    tm->scratch = (tonemap_scratch_t *)lw_malloc_zero( scratch_count * sizeof(tonemap_scratch_t) );
+    if( !tm->scratch )
+        return -1;
+    tm->scratch_count = scratch_count;
+    for( int i = 0; i < scratch_count; i++ )
+    {
+        tonemap_scratch_t *scratch = &tm->scratch[i];
+        scratch->cb = (uint16_t *)lw_malloc_zero( tm->width * sizeof(uint16_t) );
+        scratch->cr = (uint16_t *)lw_malloc_zero( tm->width * sizeof(uint16_t) );
+        float *rgb = (float *)lw_malloc_zero( 6 * tm->width * sizeof(float) );
+        if( !scratch->cb || !scratch->cr || !rgb )
+        {
+            lw_free( rgb );
+            return -1;
+        }
+        for( int k = 0; k < 6; k++ )
+            scratch->rgb[k / 3][k % 3] = rgb + k * tm->width;
+    }
+    return 0;
+}
+
+lw_video_tonemap_t *lw_create_video_tonemap
+(
+    enum AVPixelFormat                 input_pixel_format,
+    enum AVPixelFormat                 output_pixel_format,
+    enum AVColorTransferCharacteristic color_trc,
+    int                                yuv_range,
+    int                                width,
+    int                                scratch_count
+)
+{
+    if( width <= 0 || scratch_count <= 0 )
+        return NULL;
+    const tonemap_format_t *input  = find_format( input_formats,  input_pixel_format );
+    const tonemap_format_t *output = find_format( output_formats, output_pixel_format );
+    if( !input || !output
+     || (!output->rgb && (output->chroma_w_shift != input->chroma_w_shift
+                       || output->chroma_h_shift != input->chroma_h_shift))
+     || ((int)color_trc != TONEMAP_TRC_SMPTE2084 && (int)color_trc != TONEMAP_TRC_ARIB_STD_B67) )
+        return NULL;
+    lw_video_tonemap_t *tm = (lw_video_tonemap_t *)lw_malloc_zero( sizeof(lw_video_tonemap_t) );
+    if( !tm )
+        return NULL;
+    tm->input  = input;
+    tm->output = output;
+    tm->width  = width;
+    if( alloc_scratch( tm, scratch_count ) < 0 )
+    {
+        lw_free_video_tonemap( tm );
+        return NULL;
+    }
+    setup_params( tm, color_trc, yuv_range );
+    tm->tonemap_pixels = (lw_get_cpu_flags() & LW_CPU_AVX2) ? tonemap_pixels_avx2 : NULL;
+    return tm;
+}
+
+void lw_free_video_tonemap
+(
+    lw_video_tonemap_t *tm
+)
+{
+    if( !tm )
+        return;
+    free_scratch( tm );
+    lw_free( tm );
+}
+
+static LW_FORCEINLINE float clip_unit
+(
+    float x
+)
+{
+    return x < 0.0f ? 0.0f : x > 1.0f ? 1.0f : x;
+}
+
+static LW_FORCEINLINE float lookup
+(
+    const float *lut,
+    float        x
+)
+{
+    return lut[(int)(clip_unit( x ) * LW_TONEMAP_LUT_SIZE + 0.5f)];
+}
+
+/* The reference of the SIMD kernels, which do the same operations in the same order */
+static int tonemap_pixels_c
+(
+    const lw_video_tonemap_params_t *p,
+    float                           *r,
+    float                           *g,
+    float                           *b,
+    const uint16_t                  *y,
+    const uint16_t                  *cb,
+    const uint16_t                  *cr,
+    int                              width
+)
+{
+    for( int i = 0; i < width; i++ )
+    {
+        float luma = y [i] * p->y_scale + p->y_offset;
+        float u    = cb[i] * p->c_scale + p->c_offset;
+        float v    = cr[i] * p->c_scale + p->c_offset;
+        float c[3];
+        c[0] = lookup( p->eotf, luma + p->cr_r * v );
+        c[1] = lookup( p->eotf, luma + p->cb_g * u + p->cr_g * v );
+        c[2] = lookup( p->eotf, luma + p->cb_b * u );
+        float peak = MAX( MAX( c[0], c[1] ), c[2] );
+        if( peak > p->knee )
+        {
+            float scale = p->curve_scale * (peak + p->curve_a) / ((peak + p->curve_b) * peak);
+            c[0] *= scale;
+            c[1] *= scale;
+            c[2] *= scale;
+        }
+        float o[3];
+        for( int k = 0; k < 3; k++ )
+        {
+            o[k] = p->gamut[k][0] * c[0] + p->gamut[k][1] * c[1] + p->gamut[k][2] * c[2];
+            o[k] = lookup( p->oetf, sqrtf( clip_unit( o[k] ) ) );
+        }
+        r[i] = o[0];
+        g[i] = o[1];
+        b[i] = o[2];
+    }
+    return width;
+}
+
+static LW_FORCEINLINE void store_sample
+(
+    uint8_t *row,
+    int      x,
+    int      bit_depth,
+    float    value,
+    float    scale,
+    float    offset
+)
+{
+    int max_value = (1 << bit_depth) - 1;
+    int sample    = (int)(value * scale + offset + 0.5f);
+    sample = MIN( MAX( sample, 0 ), max_value );
+    if( bit_depth > 8 )
+        ((uint16_t *)row)[x] = sample;
+    else
+        row[x] = sample;
+}
+
+/* BT.709 R'G'B' into Y'CbCr */
+#define BT709_KR 0.2126f
+#define BT709_KG 0.7152f
+#define BT709_KB 0.0722f
+#define BT709_CB (2 * (1 - BT709_KB))
+#define BT709_CR (2 * (1 - BT709_KR))
+
+static void store_rows
+(
+    const lw_video_tonemap_t *tm,
+    tonemap_scratch_t        *scratch,
+    uint8_t * const          *dst_data,
+    const int                *dst_linesize,
+    int                       y,
+    int                       rows
+)
+{
+    const tonemap_format_t *output = tm->output;
+    int   bit_depth = output->bit_depth;
+    float unit      = (float)(1 << (bit_depth - 8));
+    int   width     = tm->width;
+    if( output->rgb )
+    {
+        /* Full range in the order of G, B and R */
+        static const int order[3] = { 1, 2, 0 };
+        float scale = (float)((1 << bit_depth) - 1);
+        for( int k = 0; k < rows; k++ )
+            for( int i = 0; i < 3; i++ )
+            {
+                uint8_t     *row = dst_data[i] + (ptrdiff_t)(y + k) * dst_linesize[i];
+                const float *src = scratch->rgb[k][ order[i] ];
+                for( int x = 0; x < width; x++ )
+                    store_sample( row, x, bit_depth, src[x], scale, 0.0f );
+            }
+        return;
+    }
+    /* Limited range */
+    float y_scale  = 219 * unit;
+    float y_offset = 16  * unit;
+    float c_scale  = 224 * unit;
+    float c_offset = 128 * unit;
+    for( int k = 0; k < rows; k++ )
+    {
+        uint8_t     *row = dst_data[0] + (ptrdiff_t)(y + k) * dst_linesize[0];
+        const float *r   = scratch->rgb[k][0];
+        const float *g   = scratch->rgb[k][1];
+        const float *b   = scratch->rgb[k][2];
+        for( int x = 0; x < width; x++ )
+            store_sample( row, x, bit_depth, BT709_KR * r[x] + BT709_KG * g[x] + BT709_KB * b[x], y_scale, y_offset );
+    }
+    /* Chroma is taken from the average of R'G'B' over the luma samples it covers. */
+    int      w_shift    = output->chroma_w_shift;
+    int      chroma_y   = y >> output->chroma_h_shift;
+    int      chroma_w   = (width + (1 << w_shift) - 1) >> w_shift;
+    uint8_t *cb_row     = dst_data[1] + (ptrdiff_t)chroma_y * dst_linesize[1];
+    uint8_t *cr_row     = dst_data[2] + (ptrdiff_t)chroma_y * dst_linesize[2];
+    for( int cx = 0; cx < chroma_w; cx++ )
+    {
+        int   x0 = cx << w_shift;
+        int   x1 = MIN( x0 + (1 << w_shift), width );
+        float sum[3] = { 0.0f, 0.0f, 0.0f };
+        for( int k = 0; k < rows; k++ )
+            for( int x = x0; x < x1; x++ )
+                for( int i = 0; i < 3; i++ )
+                    sum[i] += scratch->rgb[k][i][x];
+        float weight = 1.0f / (rows * (x1 - x0));
+        float r    = sum[0] * weight;
+        float g    = sum[1] * weight;
+        float b    = sum[2] * weight;
+        float luma = BT709_KR * r + BT709_KG * g + BT709_KB * b;
+        store_sample( cb_row, cx, bit_depth, (b - luma) / BT709_CB, c_scale, c_offset );
+        store_sample( cr_row, cx, bit_depth, (r - luma) / BT709_CR, c_scale, c_offset );
+    }
+}
+
+void lw_video_tonemap
+(
+    lw_video_tonemap_t    *tm,
+    int                    scratch_index,
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    y,
+    int                    height
+)
+{
+    tonemap_scratch_t *scratch = &tm->scratch[scratch_index];
+    int h_shift = tm->input->chroma_h_shift;
+    int w_shift = tm->input->chroma_w_shift;
+    int width   = tm->width;
+    for( int row = y; row < y + height; row += 1 << h_shift )
+    {
+        /* Process the luma rows sharing a chroma row together. */
+        int rows     = MIN( 1 << h_shift, y + height - row );
+        int chroma_y = row >> h_shift;
+        const uint16_t *cb = (const uint16_t *)(src_data[1] + (ptrdiff_t)chroma_y * src_linesize[1]);
+        const uint16_t *cr = (const uint16_t *)(src_data[2] + (ptrdiff_t)chroma_y * src_linesize[2]);
+        if( w_shift )
+        {
+            for( int x = 0; x < width; x++ )
+            {
+                scratch->cb[x] = cb[x >> w_shift];
+                scratch->cr[x] = cr[x >> w_shift];
+            }
+            cb = scratch->cb;
+            cr = scratch->cr;
+        }
+        for( int k = 0; k < rows; k++ )
+        {
+            const uint16_t *luma = (const uint16_t *)(src_data[0] + (ptrdiff_t)(row + k) * src_linesize[0]);
+            float *r = scratch->rgb[k][0];
+            float *g = scratch->rgb[k][1];
+            float *b = scratch->rgb[k][2];
+            int done = tm->tonemap_pixels ? tm->tonemap_pixels( &tm->params, r, g, b, luma, cb, cr, width ) : 0;
+            tonemap_pixels_c( &tm->params, r + done, g + done, b + done, luma + done, cb + done, cr + done, width - done );
+        }
+        store_rows( tm, scratch, dst_data, dst_linesize, row, rows );
+    }
+}
@@ -0,0 +1,76 @@
+/*****************************************************************************
+ * video_tonemap.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#ifndef LW_VIDEO_TONEMAP_H
+#define LW_VIDEO_TONEMAP_H
+
+#include <stdint.h>
+
+/* Tone mapping of HDR, i.e. PQ or HLG with BT.2020, into SDR BT.709
+ * Decoded pictures are converted straight into the output through lookup tables of the transfer functions,
+ * so no separate pass of tone mapping over the output is required.
+ * Highlights are compressed by the ratio of the brightest component, which keeps hue and saturation. */
+typedef struct lw_video_tonemap_tag lw_video_tonemap_t;
+
+/* Return 1 if the pictures of these properties are HDR which can be tone-mapped.
+ * Otherwise, return 0. */
+int lw_video_tonemap_is_hdr
+(
+    enum AVColorTransferCharacteristic color_trc,
+    enum AVColorPrimaries              color_primaries,
+    enum AVColorSpace                  colorspace
+);
+
+/* Create the tone mapper of pictures of 'width' from 'input_pixel_format' of 'color_trc' into 'output_pixel_format'.
+ * The input is planar YUV of 10 bits or more, and the output is planar YUV of the same chroma subsampling
+ * or planar RGB in the order of G, B and R. The output YUV is limited range BT.709.
+ * 'scratch_count' is the number of calls of lw_video_tonemap() allowed to run concurrently.
+ * Return NULL if not supported or on failure. */
+lw_video_tonemap_t *lw_create_video_tonemap
+(
+    enum AVPixelFormat                 input_pixel_format,
+    enum AVPixelFormat                 output_pixel_format,
+    enum AVColorTransferCharacteristic color_trc,
+    int                                yuv_range,
+    int                                width,
+    int                                scratch_count
+);
+
+void lw_free_video_tonemap
+(
+    lw_video_tonemap_t *tm
+);
+
+/* Tone-map 'height' rows from the row 'y' of the picture.
+ * 'y' shall be a multiple of the vertical chroma subsampling.
+ * Concurrent calls shall use different 'scratch_index' less than 'scratch_count'. */
+void lw_video_tonemap
+(
+    lw_video_tonemap_t    *tm,
+    int                    scratch_index,
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    y,
+    int                    height
+);
+
+#endif  /* LW_VIDEO_TONEMAP_H */
@@ -0,0 +1,109 @@
+/*****************************************************************************
+ * video_tonemap_simd.c / video_tonemap_simd.cpp
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include <stdint.h>
+
+#include "lwsimd.h"
+#include "video_tonemap_simd.h"
+
+#ifdef __GNUC__
+#pragma GCC target ("avx2")
+#endif
+#include <immintrin.h>
+
+/* FMA is not used so that the results match the ones of the C code. */
+
+static LW_FORCEINLINE __m256 load_16bit_avx2
+(
+    const uint16_t *src
+)
+{
+    return _mm256_cvtepi32_ps( _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i *)src ) ) );
+}
+
+static LW_FORCEINLINE __m256 lookup_avx2
+(
+    const float *lut,
+    __m256       x
+)
+{
+    x = _mm256_min_ps( _mm256_max_ps( x, _mm256_setzero_ps() ), _mm256_set1_ps( 1.0f ) );
+    x = _mm256_add_ps( _mm256_mul_ps( x, _mm256_set1_ps( (float)LW_TONEMAP_LUT_SIZE ) ), _mm256_set1_ps( 0.5f ) );
+    return _mm256_i32gather_ps( lut, _mm256_cvttps_epi32( x ), 4 );
+}
+
+int LW_FUNC_ALIGN tonemap_pixels_avx2
+(
+    const lw_video_tonemap_params_t *p,
+    float                           *r,
+    float                           *g,
+    float                           *b,
+    const uint16_t                  *y,
+    const uint16_t                  *cb,
+    const uint16_t                  *cr,
+    int                              width
+)
+{
+    const __m256 y_scale     = _mm256_set1_ps( p->y_scale );
+    const __m256 y_offset    = _mm256_set1_ps( p->y_offset );
+    const __m256 c_scale     = _mm256_set1_ps( p->c_scale );
+    const __m256 c_offset    = _mm256_set1_ps( p->c_offset );
+    const __m256 cr_r        = _mm256_set1_ps( p->cr_r );
+    const __m256 cb_g        = _mm256_set1_ps( p->cb_g );
+    const __m256 cr_g        = _mm256_set1_ps( p->cr_g );
+    const __m256 cb_b        = _mm256_set1_ps( p->cb_b );
+    const __m256 knee        = _mm256_set1_ps( p->knee );
+    const __m256 curve_a     = _mm256_set1_ps( p->curve_a );
+    const __m256 curve_b     = _mm256_set1_ps( p->curve_b );
+    const __m256 curve_scale = _mm256_set1_ps( p->curve_scale );
+    const __m256 one         = _mm256_set1_ps( 1.0f );
+    __m256 gamut[3][3];
+    for( int k = 0; k < 3; k++ )
+        for( int j = 0; j < 3; j++ )
+            gamut[k][j] = _mm256_set1_ps( p->gamut[k][j] );
+    float *dst[3] = { r, g, b };
+    int i = 0;
+    for( ; i <= width - 8; i += 8 )
+    {
+        __m256 luma = _mm256_add_ps( _mm256_mul_ps( load_16bit_avx2( y  + i ), y_scale ), y_offset );
+        __m256 u    = _mm256_add_ps( _mm256_mul_ps( load_16bit_avx2( cb + i ), c_scale ), c_offset );
+        __m256 v    = _mm256_add_ps( _mm256_mul_ps( load_16bit_avx2( cr + i ), c_scale ), c_offset );
+        __m256 c[3];
+        c[0] = lookup_avx2( p->eotf, _mm256_add_ps( luma, _mm256_mul_ps( cr_r, v ) ) );
+        c[1] = lookup_avx2( p->eotf, _mm256_add_ps( _mm256_add_ps( luma, _mm256_mul_ps( cb_g, u ) ), _mm256_mul_ps( cr_g, v ) ) );
+        c[2] = lookup_avx2( p->eotf, _mm256_add_ps( luma, _mm256_mul_ps( cb_b, u ) ) );
+        /* Lanes at or below the knee take the scale of 1, so their division by zero does not matter. */
+        __m256 peak  = _mm256_max_ps( _mm256_max_ps( c[0], c[1] ), c[2] );
+        __m256 scale = _mm256_div_ps( _mm256_mul_ps( curve_scale, _mm256_add_ps( peak, curve_a ) ),
+                                      _mm256_mul_ps( _mm256_add_ps( peak, curve_b ), peak ) );
+        scale = _mm256_blendv_ps( one, scale, _mm256_cmp_ps( peak, knee, _CMP_GT_OQ ) );
+        for( int k = 0; k < 3; k++ )
+            c[k] = _mm256_mul_ps( c[k], scale );
+        for( int k = 0; k < 3; k++ )
+        {
+            __m256 o = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( gamut[k][0], c[0] ),
+                                                     _mm256_mul_ps( gamut[k][1], c[1] ) ),
+                                                     _mm256_mul_ps( gamut[k][2], c[2] ) );
+            o = _mm256_min_ps( _mm256_max_ps( o, _mm256_setzero_ps() ), one );
+            _mm256_storeu_ps( dst[k] + i, lookup_avx2( p->oetf, _mm256_sqrt_ps( o ) ) );
+        }
+    }
+    return i;
+}
@@ -0,0 +1,66 @@
+/*****************************************************************************
+ * video_tonemap_simd.h
+ *****************************************************************************
+ * Copyright (C) 2026 L-SMASH Works project
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+/* The number of intervals of the lookup tables of the transfer functions */
+#define LW_TONEMAP_LUT_SIZE 16384
+
+typedef struct
+{
+    /* Normalization of the input samples into Y' in [0, 1] and Cb/Cr in [-0.5, 0.5] */
+    float        y_scale;
+    float        y_offset;
+    float        c_scale;
+    float        c_offset;
+    /* BT.2020 Y'CbCr into R'G'B' */
+    float        cr_r;
+    float        cb_g;
+    float        cr_g;
+    float        cb_b;
+    /* The highlight compression above 'knee': scale * (x + a) / (x + b) */
+    float        knee;
+    float        curve_a;
+    float        curve_b;
+    float        curve_scale;
+    /* BT.2020 into BT.709 primaries in linear light */
+    float        gamut[3][3];
+    /* Nonlinear R'G'B' of the input into linear light, where 1.0 is the reference white of SDR */
+    const float *eotf;
+    /* Square root of linear light into nonlinear R'G'B' of the output
+     * Indexing by the square root keeps the steep dark part of the curve fine enough. */
+    const float *oetf;
+} lw_video_tonemap_params_t;
+
+/* Each function processes a leading part of a row and returns the number of pixels done.
+ * The caller finishes the rest of the row. */
+
+/* Tone-map the samples of Y, Cb and Cr at the same positions into R'G'B' of BT.709 in [0, 1]. */
+typedef int func_video_tonemap_pixels
+(
+    const lw_video_tonemap_params_t *params,
+    float                           *r,
+    float                           *g,
+    float                           *b,
+    const uint16_t                  *y,
+    const uint16_t                  *cb,
+    const uint16_t                  *cr,
+    int                              width
+);
+
+func_video_tonemap_pixels tonemap_pixels_avx2;
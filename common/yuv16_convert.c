@@ -0,0 +1,383 @@
+/*****************************************************************************
+ * yuv16_convert.c / yuv16_convert.cpp
+ *****************************************************************************
+ * Copyright (C) 2011-2015 L-SMASH Works project
+ *
+ * Authors: Yusuke Nakamura <muken.the.vfrmaniac@gmail.com>
+ *          Oka Motofumi <chikuzen.mo@gmail.com>
+ *          rigaya <rigaya34589@live.jp>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lwsimd.h"
+#include "lwthread.h"
+#include "yuv16_convert.h"
+#include "yuv16_convert_simd.h"
+
+#define YUV48_SIZE 6
+
+static LW_FORCEINLINE void convert_yuv420ple_i_to_yuv444p16le_c
+(
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    const int              bit_depth
+)
+{
+    const int lshft = 16 - bit_depth;
+    /* copy luma */
+    {
+        const uint16_t *ptr_src_line = (const uint16_t *)src_data[0];
+        uint16_t       *ptr_dst_line = (uint16_t *)dst_data[0];
+        const int dst_line_len = dst_linesize[0] / sizeof(uint16_t);
+        const int src_line_len = src_linesize[0] / sizeof(uint16_t);
+        const int luma_width = width;
+        for( int y = 0; y < height; y++ )
+            for( int x = 0; x < luma_width; x++ )
+                ptr_dst_line[y*dst_line_len+x] = ptr_src_line[y*src_line_len+x] << lshft;
+    }
+    /* chroma upsampling for interlaced yuv420 */
+    const int src_chroma_width = width / 2;
+    for( int i_color = 1; i_color < 3; i_color++ )
+    {
+        const uint16_t *ptr_src_line = (const uint16_t *)src_data[i_color];
+        uint16_t       *ptr_dst_line = (uint16_t *)dst_data[i_color];
+        const int dst_line_len = dst_linesize[i_color] / sizeof(uint16_t);
+        const int src_line_len = src_linesize[i_color] / sizeof(uint16_t);
+        /* first 2 lines */
+        int x;
+        uint16_t tmp[2][4];
+
+    /* this inner loop branch should be deleted by forced inline expansion and "lshft" constant propagation. */
+#define INTERPOLATE_CHROMA( k, x ) \
+    { \
+        int chroma0 = (5 * ptr_src_line[0 * src_line_len + x] + 3 * ptr_src_line[2 * src_line_len + x]); \
+        int chroma1 = (7 * ptr_src_line[1 * src_line_len + x] + 1 * ptr_src_line[3 * src_line_len + x]); \
+        int chroma2 = (1 * ptr_src_line[0 * src_line_len + x] + 7 * ptr_src_line[2 * src_line_len + x]); \
+        int chroma3 = (3 * ptr_src_line[1 * src_line_len + x] + 5 * ptr_src_line[3 * src_line_len + x]); \
+        if( lshft - 3 < 0 ) \
+        { \
+            tmp[k][0] = (chroma0 + (1<<(2-lshft))) >> (3-lshft); \
+            tmp[k][1] = (chroma1 + (1<<(2-lshft))) >> (3-lshft); \
+            tmp[k][2] = (chroma2 + (1<<(2-lshft))) >> (3-lshft); \
+            tmp[k][3] = (chroma3 + (1<<(2-lshft))) >> (3-lshft); \
+        } \
+        else if( lshft - 3 > 0 ) \
+        { \
+            tmp[k][0] = chroma0 << (lshft-3); \
+            tmp[k][1] = chroma1 << (lshft-3); \
+            tmp[k][2] = chroma2 << (lshft-3); \
+            tmp[k][3] = chroma3 << (lshft-3); \
+        } \
+        else \
+        { \
+            tmp[k][0] = chroma0; \
+            tmp[k][1] = chroma1; \
+            tmp[k][2] = chroma2; \
+            tmp[k][3] = chroma3; \
+        } \
+    }
+#define PUT_CHROMA( x, line ) \
+    { \
+        ptr_dst_line[dst_line_len * line + 2 * x + 0] = tmp[0][line]; \
+        ptr_dst_line[dst_line_len * line + 2 * x + 1] = (tmp[0][line] + tmp[1][line] + 1) >> 1; \
+    }
+#define PUT_LAST_CHROMA( x, line ) \
+    { \
+        ptr_dst_line[dst_line_len * line + 2 * x + 0] = tmp[0][line]; \
+        ptr_dst_line[dst_line_len * line + 2 * x + 1] = tmp[0][line]; \
+    }
+#define NEXT_CHROMA( lines ) \
+    { \
+        for( int i = 0; i < lines; i++ ) \
+            tmp[0][i] = tmp[1][i]; \
+    }
+
+        tmp[0][0] = ptr_src_line[0] << lshft;
+        tmp[0][1] = ptr_src_line[src_line_len] << lshft;
+        for( x = 0; x < src_chroma_width - 1; x++ )
+        {
+            tmp[1][0] = ptr_src_line[x+1] << lshft;
+            tmp[1][1] = ptr_src_line[x+1 + src_line_len] << lshft;
+            for( int i = 0; i < 2; i++ )
+                PUT_CHROMA( x, i );
+            NEXT_CHROMA( 2 );
+        }
+        for( int i = 0; i < 2; i++ )
+            PUT_LAST_CHROMA( x, i );
+        ptr_dst_line += (dst_line_len << 1);
+
+        /* 5,3,7,1 - interlaced yuv420 to yuv422 interpolation with 1,1 - yuv422 to yuv444 interpolation. */
+        for( int y = 2; y < height - 2; y += 4, ptr_dst_line += (dst_line_len << 2), ptr_src_line += (src_line_len << 1) )
+        {
+            INTERPOLATE_CHROMA( 0, 0 );
+            for( x = 0; x < src_chroma_width - 1; x++ )
+            {
+                INTERPOLATE_CHROMA( 1, x+1 );
+                for( int i = 0; i < 4; i++ )
+                    PUT_CHROMA( x, i );
+                NEXT_CHROMA( 4 );
+            }
+            for( int i = 0; i < 4; i++ )
+                PUT_LAST_CHROMA( x, i );
+        }
+
+        /* last 2 lines */
+        tmp[0][0] = ptr_src_line[0] << lshft;
+        tmp[0][1] = ptr_src_line[src_line_len] << lshft;
+        for( x = 0; x < src_chroma_width - 1; x++ )
+        {
+            tmp[1][0] = ptr_src_line[x+1] << lshft;
+            tmp[1][1] = ptr_src_line[x+1 + src_line_len] << lshft;
+            for( int i = 0; i < 2; i++ )
+                PUT_CHROMA( x, i );
+            NEXT_CHROMA( 2 );
+        }
+        for( int i = 0; i < 2; i++ )
+            PUT_LAST_CHROMA( x, i );
+#undef INTERPOLATE_CHROMA
+#undef PUT_CHROMA
+#undef PUT_LAST_CHROMA
+#undef NEXT_CHROMA
+    }
+}
+
+/* The SIMD kernels picked for the running CPU, NULL if none is usable.
+ * The table is rebuilt at the next use after lw_set_cpu_flags_mask() changes the usable instruction sets. */
+typedef struct
+{
+    func_yuv16_upsample *upsample[3];   /* 9, 10 and 16-bit */
+    func_yuv16_pack     *pack_lw48;
+    func_yuv16_pack     *pack_yc48;
+} yuv16_kernels_t;
+
+static yuv16_kernels_t   kernels;
+static volatile uint32_t kernels_revision;
+static lw_static_mutex_t kernels_mutex = LW_STATIC_MUTEX_INITIALIZER;
+
+static void build_kernels( void )
+{
+    yuv16_kernels_t table;
+    uint32_t flags = lw_get_cpu_flags();
+    int      sse41 = !!(flags & LW_CPU_SSE41);
+    table.upsample[0] = sse41 ? convert_yuv420p9le_i_to_yuv444p16le_sse41  : NULL;
+    table.upsample[1] = sse41 ? convert_yuv420p10le_i_to_yuv444p16le_sse41 : NULL;
+    table.upsample[2] = sse41 ? convert_yuv420p16le_i_to_yuv444p16le_sse41 : NULL;
+    table.pack_lw48 = (flags & LW_CPU_AVX2)  ? pack_lw48_avx2
+                      : (flags & LW_CPU_SSE41) ? pack_lw48_sse41
+                      :                          NULL;
+    table.pack_yc48 = (flags & LW_CPU_AVX2)  ? pack_yc48_avx2
+                      : (flags & LW_CPU_SSE41) ? pack_yc48_sse41
+                      : (flags & LW_CPU_SSE2)  ? pack_yc48_sse2
+                      :                          NULL;
+    kernels = table;
+    lw_atomic_store( &kernels_revision, lw_get_cpu_flags_revision() );
+}
+
+static void get_kernels
+(
+    yuv16_kernels_t *dst
+)
+{
+    /* Only a stale table takes the lock. A reading racing with a rebuild might mix the entries
+     * of the old and new tables, which are all usable on the running CPU. */
+    if( lw_atomic_load( &kernels_revision ) != lw_get_cpu_flags_revision() )
+    {
+        lw_static_mutex_lock( &kernels_mutex );
+        if( kernels_revision != lw_get_cpu_flags_revision() )
+            build_kernels();
+        lw_static_mutex_unlock( &kernels_mutex );
+    }
+    *dst = kernels;
+}
+
+static void convert_yuv420p9le_i_to_yuv444p16le_c
+(
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+)
+{
+    convert_yuv420ple_i_to_yuv444p16le_c( dst_data, dst_linesize, src_data, src_linesize, width, height, 9 );
+}
+
+static void convert_yuv420p10le_i_to_yuv444p16le_c
+(
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+)
+{
+    convert_yuv420ple_i_to_yuv444p16le_c( dst_data, dst_linesize, src_data, src_linesize, width, height, 10 );
+}
+
+static void convert_yuv420p16le_i_to_yuv444p16le_c
+(
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+)
+{
+    convert_yuv420ple_i_to_yuv444p16le_c( dst_data, dst_linesize, src_data, src_linesize, width, height, 16 );
+}
+
+void lw_convert_yuv420ple_i_to_yuv444p16le
+(
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    bit_depth
+)
+{
+    static func_yuv16_upsample *const upsample_c[3] =
+        {
+            convert_yuv420p9le_i_to_yuv444p16le_c,
+            convert_yuv420p10le_i_to_yuv444p16le_c,
+            convert_yuv420p16le_i_to_yuv444p16le_c
+        };
+    yuv16_kernels_t simd;
+    get_kernels( &simd );
+    int index = bit_depth == 9 ? 0 : bit_depth == 10 ? 1 : 2;
+    /* The SIMD version needs a chroma row of 8 samples at least. */
+    if( simd.upsample[index] && width >= 16 )
+        simd.upsample[index]( dst_data, dst_linesize, src_data, src_linesize, width, height );
+    else
+        upsample_c[index]( dst_data, dst_linesize, src_data, src_linesize, width, height );
+}
+
+static int pack_lw48_c
+(
+    uint8_t               *dst,
+    const uint8_t * const *src,
+    int                    width,
+    int                    full_range
+)
+{
+    for( int i = 0; i < width; i++ )
+    {
+        dst[0] = src[0][2 * i    ];
+        dst[1] = src[0][2 * i + 1];
+        dst[2] = src[1][2 * i    ];
+        dst[3] = src[1][2 * i + 1];
+        dst[4] = src[2][2 * i    ];
+        dst[5] = src[2][2 * i + 1];
+        dst += YUV48_SIZE;
+    }
+    return width;
+}
+
+static int pack_yc48_c
+(
+    uint8_t               *dst,
+    const uint8_t * const *src,
+    int                    width,
+    int                    full_range
+)
+{
+    static const uint32_t y_coef   [2] = {  1197,   4770 };
+    static const uint32_t y_shift  [2] = {    14,     16 };
+    static const uint32_t uv_coef  [2] = {  4682,   4662 };
+    static const uint32_t uv_offset[2] = { 32768, 589824 };
+    for( int i = 0; i < width; i++ )
+    {
+        uint16_t y  = (((int32_t)((src[0][2 * i] | (src[0][2 * i + 1] << 8)) * y_coef[full_range])) >> y_shift[full_range]) - 299;
+        uint16_t cb = ((int32_t)(((src[1][2 * i] | (src[1][2 * i + 1] << 8)) - 32768) * uv_coef[full_range] + uv_offset[full_range])) >> 16;
+        uint16_t cr = ((int32_t)(((src[2][2 * i] | (src[2][2 * i + 1] << 8)) - 32768) * uv_coef[full_range] + uv_offset[full_range])) >> 16;
+        dst[0] = y;
+        dst[1] = y >> 8;
+        dst[2] = cb;
+        dst[3] = cb >> 8;
+        dst[4] = cr;
+        dst[5] = cr >> 8;
+        dst += YUV48_SIZE;
+    }
+    return width;
+}
+
+static void pack_yuv444p16le
+(
+    func_yuv16_pack       *pack_simd,
+    func_yuv16_pack       *pack_c,
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    full_range
+)
+{
+    for( int y = 0; y < height; y++ )
+    {
+        const uint8_t *src[3];
+        for( int k = 0; k < 3; k++ )
+            src[k] = src_data[k] + (ptrdiff_t)y * src_linesize[k];
+        int i = pack_simd ? pack_simd( dst, src, width, full_range ) : 0;
+        for( int k = 0; k < 3; k++ )
+            src[k] += 2 * i;
+        pack_c( dst + i * YUV48_SIZE, src, width - i, full_range );
+        dst += dst_linesize;
+    }
+}
+
+void lw_pack_yuv444p16le_to_lw48
+(
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+)
+{
+    yuv16_kernels_t simd;
+    get_kernels( &simd );
+    pack_yuv444p16le( simd.pack_lw48, pack_lw48_c, dst, dst_linesize, src_data, src_linesize, width, height, 0 );
+}
+
+void lw_pack_yuv444p16le_to_yc48
+(
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    full_range
+)
+{
+    yuv16_kernels_t simd;
+    get_kernels( &simd );
+    pack_yuv444p16le( simd.pack_yc48, pack_yc48_c, dst, dst_linesize, src_data, src_linesize, width, height, !!full_range );
+}
@@ -0,0 +1,71 @@
+/*****************************************************************************
+ * yuv16_convert.h
+ *****************************************************************************
+ * Copyright (C) 2011-2015 L-SMASH Works project
+ *
+ * Authors: Yusuke Nakamura <muken.the.vfrmaniac@gmail.com>
+ *          rigaya <rigaya34589@live.jp>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#ifndef LW_YUV16_CONVERT_H
+#define LW_YUV16_CONVERT_H
+
+#include <stdint.h>
+
+/* Conversions of high bit-depth YUV through planar YUV 4:4:4 16-bit little-endian.
+ * None of them requires any alignment of the buffers. */
+
+/* Upsample interlaced planar YUV 4:2:0 of 'bit_depth' bits little-endian into planar YUV 4:4:4 16-bit little-endian.
+ * Chroma is interpolated within each field as suggested in the MPEG-2 spec.
+ * 'bit_depth' shall be 9, 10 or 16. */
+void lw_convert_yuv420ple_i_to_yuv444p16le
+(
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    bit_depth
+);
+
+/* Pack planar YUV 4:4:4 16-bit little-endian into LW48, i.e. packed 16Y 16Cb 16Cr little-endian. */
+void lw_pack_yuv444p16le_to_lw48
+(
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+);
+
+/* Pack planar YUV 4:4:4 16-bit little-endian into YC48 of AviUtl, i.e. packed 16Y 16Cb 16Cr scaled to
+ * 0 - 4096 for luma and -2048 - 2048 for chroma.
+ * 'full_range' specifies whether the input is full range or limited range. */
+void lw_pack_yuv444p16le_to_yc48
+(
+    uint8_t               *dst,
+    int                    dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    int                    full_range
+);
+
+#endif /* LW_YUV16_CONVERT_H */
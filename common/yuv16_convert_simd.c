@@ -0,0 +1,625 @@
+/*****************************************************************************
+ * yuv16_convert_simd.c
+ *****************************************************************************
+ * Copyright (C) 2012-2015 L-SMASH Works project
+ *
+ * Authors: rigaya <rigaya34589@live.jp>
+ *          Yusuke Nakamura <muken.the.vfrmaniac@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lwsimd.h"
+#include "yuv16_convert_simd.h"
+
+#define YC48_Y_COEF         4788
+#define YC48_Y_COEF_FULL    4770
+#define YC48_UV_COEF        4682
+#define YC48_UV_COEF_FULL   4662
+#define YC48_Y_OFFSET       ((-299)+((YC48_Y_COEF)>>1))
+#define YC48_Y_OFFSET_FULL  ((-299)+((YC48_Y_COEF_FULL)>>1))
+#define YC48_UV_OFFSET      32768
+#define YC48_UV_OFFSET_FULL 589824
+
+/*  Y = ((( y - 32768 ) * coef)           >> 16 ) + (coef/2 - 299) */
+/* UV = (( uv - 32768 ) * coef + offset ) >> 16 */
+static const int     yc48_y_coef   [2] = { YC48_Y_COEF,    YC48_Y_COEF_FULL    };
+static const int     yc48_uv_coef  [2] = { YC48_UV_COEF,   YC48_UV_COEF_FULL   };
+static const int16_t yc48_y_offset [2] = { YC48_Y_OFFSET,  YC48_Y_OFFSET_FULL  };
+static const int     yc48_uv_offset[2] = { YC48_UV_OFFSET, YC48_UV_OFFSET_FULL };
+
+/* Byte shuffle applied before the blends interleaving 8 values of each of three planes into 48-bit pixels. */
+static const uint8_t LW_ALIGN(16) yuv48_shuffle[16] = {
+    0x00, 0x01, 0x06, 0x07, 0x0C, 0x0D, 0x02, 0x03, 0x08, 0x09, 0x0E, 0x0F, 0x04, 0x05, 0x0A, 0x0B
+};
+
+#ifdef __GNUC__
+#pragma GCC target ("sse4.1")
+#endif
+#include <smmintrin.h>
+
+/* the inner loop branch should be deleted by forced inline expansion and "use_sse41" and "yc48" constant propagation. */
+static LW_FORCEINLINE int LW_FUNC_ALIGN pack_yuv48_sse
+(
+    uint8_t               *dst,
+    const uint8_t * const *src,
+    int                    width,
+    int                    full_range,
+    const int              use_sse41,
+    const int              yc48
+)
+{
+    __m128i x0, x1, x2, x3, x4;
+    const __m128i sign      = _mm_set1_epi16( (int16_t)0x8000 );
+    const __m128i y_coef    = _mm_set1_epi32( yc48_y_coef   [full_range] );
+    const __m128i uv_coef   = _mm_set1_epi32( yc48_uv_coef  [full_range] );
+    const __m128i y_offset  = _mm_set1_epi16( yc48_y_offset [full_range] );
+    const __m128i uv_offset = _mm_set1_epi32( yc48_uv_offset[full_range] );
+    const int aligned_output = ((size_t)dst & 15) == 0;
+    int i = 0;
+    for( ; i + 8 <= width; i += 8, dst += 48 )
+    {
+        /* load */
+        x0 = _mm_loadu_si128((const __m128i *)(src[0] + 2 * i));
+        x1 = _mm_loadu_si128((const __m128i *)(src[1] + 2 * i));
+        x2 = _mm_loadu_si128((const __m128i *)(src[2] + 2 * i));
+        if( yc48 )
+        {
+            /* change uint16 to int16 in order to use _mm_madd_epi16()
+             * range 0 - 65535 to -32768 - 32767 */
+            x0 = _mm_add_epi16(x0, sign);
+            x1 = _mm_add_epi16(x1, sign);
+            x2 = _mm_add_epi16(x2, sign);
+            /* calc Y */
+            x3 = _mm_unpackhi_epi16(x0, x0);
+            x0 = _mm_unpacklo_epi16(x0, x0);
+            x3 = _mm_srai_epi32(_mm_madd_epi16(x3, y_coef), 16);
+            x0 = _mm_srai_epi32(_mm_madd_epi16(x0, y_coef), 16);
+            x0 = _mm_add_epi16(_mm_packs_epi32(x0, x3), y_offset);
+            /* calc U */
+            x3 = _mm_unpackhi_epi16(x1, x1);
+            x1 = _mm_unpacklo_epi16(x1, x1);
+            x3 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(x3, uv_coef), uv_offset), 16);
+            x1 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(x1, uv_coef), uv_offset), 16);
+            x1 = _mm_packs_epi32(x1, x3);
+            /* calc V */
+            x3 = _mm_unpackhi_epi16(x2, x2);
+            x2 = _mm_unpacklo_epi16(x2, x2);
+            x3 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(x3, uv_coef), uv_offset), 16);
+            x2 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(x2, uv_coef), uv_offset), 16);
+            x2 = _mm_packs_epi32(x2, x3);
+        }
+        if( use_sse41 )
+        {
+            x4 = _mm_load_si128((const __m128i *)yuv48_shuffle);
+            x0 = _mm_shuffle_epi8(x0, x4);
+            x1 = _mm_shuffle_epi8(x1, _mm_alignr_epi8(x4, x4, 14));
+            x2 = _mm_shuffle_epi8(x2, _mm_alignr_epi8(x4, x4, 12));
+
+            x3 = _mm_blend_epi16(x0, x1, 0x80 + 0x10 + 0x02);
+            x3 = _mm_blend_epi16(x3, x2, 0x20 + 0x04       );
+            x2 = _mm_blend_epi16(x2, x1, 0x20 + 0x04       );
+            x4 = x2;
+            x1 = _mm_blend_epi16(x1, x0, 0x20 + 0x04       );
+            x2 = _mm_blend_epi16(x2, x0, 0x80 + 0x10 + 0x02);
+            x1 = _mm_blend_epi16(x1, x4, 0x80 + 0x10 + 0x02);
+            x0 = x3;
+        }
+        else
+        {
+            /* shuffle order 7,6,5,4,3,2,1,0 to 7,3,5,1,6,2,4,0 */
+            x0 = _mm_shufflelo_epi16(x0, _MM_SHUFFLE(3,1,2,0)); /* 7,6,5,4,3,1,2,0 */
+            x0 = _mm_shufflehi_epi16(x0, _MM_SHUFFLE(3,1,2,0)); /* 7,5,6,4,3,1,2,0 */
+            x0 = _mm_shuffle_epi32(  x0, _MM_SHUFFLE(3,1,2,0)); /* 7,5,3,1,6,4,2,0 */
+            x0 = _mm_shufflelo_epi16(x0, _MM_SHUFFLE(3,1,2,0)); /* 7,5,3,1,6,2,4,0 */
+            x0 = _mm_shufflehi_epi16(x0, _MM_SHUFFLE(3,1,2,0)); /* 7,3,5,1,6,2,4,0 */
+
+            x1 = _mm_shufflelo_epi16(x1, _MM_SHUFFLE(3,1,2,0));
+            x1 = _mm_shufflehi_epi16(x1, _MM_SHUFFLE(3,1,2,0));
+            x1 = _mm_shuffle_epi32(  x1, _MM_SHUFFLE(3,1,2,0));
+            x1 = _mm_shufflelo_epi16(x1, _MM_SHUFFLE(3,1,2,0));
+            x1 = _mm_shufflehi_epi16(x1, _MM_SHUFFLE(3,1,2,0));
+
+            x2 = _mm_shufflelo_epi16(x2, _MM_SHUFFLE(3,1,2,0));
+            x2 = _mm_shufflehi_epi16(x2, _MM_SHUFFLE(3,1,2,0));
+            x2 = _mm_shuffle_epi32(  x2, _MM_SHUFFLE(3,1,2,0));
+            x2 = _mm_shufflelo_epi16(x2, _MM_SHUFFLE(3,1,2,0));
+            x2 = _mm_shufflehi_epi16(x2, _MM_SHUFFLE(3,1,2,0));
+
+            /* shuffle to 48-bit pixels */
+            x3 = _mm_shuffle_epi32(x0, _MM_SHUFFLE(3,2,3,2));
+            x0 = _mm_unpacklo_epi16(x0, x1);
+            x1 = _mm_unpackhi_epi16(x1, x2);
+            x2 = _mm_unpacklo_epi16(x2, x3);
+
+            x3 = _mm_shuffle_epi32(x0, _MM_SHUFFLE(3,2,3,2));
+            x0 = _mm_unpacklo_epi32(x0, x2);
+            x2 = _mm_unpackhi_epi32(x2, x1);
+            x1 = _mm_unpacklo_epi32(x1, x3);
+
+            x3 = _mm_shuffle_epi32(x0, _MM_SHUFFLE(3,2,3,2));
+            x0 = _mm_unpacklo_epi64(x0, x1);
+            x1 = _mm_unpackhi_epi64(x1, x2);
+            x2 = _mm_unpacklo_epi64(x2, x3);
+        }
+        /* store */
+        if( aligned_output )
+        {
+            _mm_stream_si128((__m128i *)(dst +  0), x0);
+            _mm_stream_si128((__m128i *)(dst + 16), x2);
+            _mm_stream_si128((__m128i *)(dst + 32), x1);
+        }
+        else
+        {
+            _mm_storeu_si128((__m128i *)(dst +  0), x0);
+            _mm_storeu_si128((__m128i *)(dst + 16), x2);
+            _mm_storeu_si128((__m128i *)(dst + 32), x1);
+        }
+    }
+    return i;
+}
+
+int LW_FUNC_ALIGN pack_yc48_sse2
+(
+    uint8_t               *dst,
+    const uint8_t * const *src,
+    int                    width,
+    int                    full_range
+)
+{
+    return pack_yuv48_sse( dst, src, width, full_range, 0, 1 );
+}
+
+int LW_FUNC_ALIGN pack_yc48_sse41
+(
+    uint8_t               *dst,
+    const uint8_t * const *src,
+    int                    width,
+    int                    full_range
+)
+{
+    return pack_yuv48_sse( dst, src, width, full_range, 1, 1 );
+}
+
+int LW_FUNC_ALIGN pack_lw48_sse41
+(
+    uint8_t               *dst,
+    const uint8_t * const *src,
+    int                    width,
+    int                    full_range
+)
+{
+    return pack_yuv48_sse( dst, src, width, 0, 1, 0 );
+}
+
+/* the inner loop branch should be deleted by forced inline expansion and "bit_depth" constant propagation. */
+static LW_FORCEINLINE void LW_FUNC_ALIGN convert_yuv420ple_i_to_yuv444p16le_sse41
+(
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height,
+    const int              bit_depth
+)
+{
+    const int lshft = 16 - bit_depth;
+    /* copy luma */
+    {
+        const uint16_t *ptr_src_line = (const uint16_t *)src_data[0];
+        uint16_t *ptr_dst_line = (uint16_t *)dst_data[0];
+        const int dst_line_len = dst_linesize[0] / sizeof(uint16_t);
+        const int src_line_len = src_linesize[0] / sizeof(uint16_t);
+        const int luma_width = width;
+        for( int y = 0; y < height; y++ )
+        {
+            uint16_t *ptr_dst = ptr_dst_line + y * dst_line_len;
+            const uint16_t *ptr_src = ptr_src_line + y * src_line_len;
+            const uint16_t *ptr_src_fin = ptr_src + (luma_width & ~15);
+            for( ; ptr_src < ptr_src_fin; ptr_dst += 16, ptr_src += 16 )
+            {
+                __m128i x0 = _mm_loadu_si128((const __m128i*)(ptr_src + 0));
+                __m128i x1 = _mm_loadu_si128((const __m128i*)(ptr_src + 8));
+                if( lshft )
+                {
+                    x0 = _mm_slli_epi16(x0, lshft);
+                    x1 = _mm_slli_epi16(x1, lshft);
+                }
+                _mm_storeu_si128((__m128i*)(ptr_dst + 0), x0);
+                _mm_storeu_si128((__m128i*)(ptr_dst + 8), x1);
+            }
+            ptr_src_fin += (luma_width & 15);
+            for( ; ptr_src < ptr_src_fin; ptr_dst += 2, ptr_src += 2 )
+            {
+                ptr_dst[0] = ptr_src[0] << lshft;
+                ptr_dst[1] = ptr_src[1] << lshft;
+            }
+        }
+    }
+
+    static const uint16_t LW_ALIGN(16) Array_5371[4][8] = {
+        { 5, 3, 5, 3, 5, 3, 5, 3 }, { 7, 1, 7, 1, 7, 1, 7, 1 },
+        { 1, 7, 1, 7, 1, 7, 1, 7 }, { 3, 5, 3, 5, 3, 5, 3, 5 },
+    };
+    const __m128i x_add = _mm_set1_epi32(1<<(2-lshft));
+    /* chroma upsampling for interlaced yuv420 */
+    const int src_chroma_width = width / 2;
+    for( int i_color = 1; i_color < 3; i_color++ )
+    {
+        __m128i x0, x1, x3, x4, x5;
+        __m128i x2 = _mm_setzero_si128();
+        const uint16_t *ptr_src_line = (const uint16_t *)src_data[i_color];
+        uint16_t *ptr_dst_line = (uint16_t *)dst_data[i_color];
+        const int dst_line_len = dst_linesize[i_color] / sizeof(uint16_t);
+        const int src_line_len = src_linesize[i_color] / sizeof(uint16_t);
+        /* first 2 lines */
+        for (int i = 0; i < 2; i++)
+        {
+            uint16_t *ptr_dst = ptr_dst_line + i * dst_line_len;
+            const uint16_t *ptr_src = ptr_src_line + i * src_line_len;
+            const uint16_t *ptr_src_fin = ptr_src + (src_chroma_width & ~7) - (((src_chroma_width & 7) == 0) << 3);
+
+            x0 = _mm_loadu_si128((const __m128i*)ptr_src);
+            if( lshft )
+                x0 = _mm_slli_epi16(x0, lshft);
+
+            for( ; ptr_src < ptr_src_fin; ptr_src += 8, ptr_dst += 16 )
+            {
+                x1 = _mm_loadu_si128((const __m128i*)(ptr_src + 8));
+                if( lshft )
+                    x1 = _mm_slli_epi16(x1, lshft);
+
+                x2 = _mm_alignr_epi8(x1, x0, 2);
+                x2 = _mm_avg_epu16(x2, x0);
+
+                _mm_storeu_si128((__m128i*)(ptr_dst + 0), _mm_unpacklo_epi16(x0, x2));
+                _mm_storeu_si128((__m128i*)(ptr_dst + 8), _mm_unpackhi_epi16(x0, x2));
+                x0 = x1;
+            }
+            ptr_src -= (8 - (src_chroma_width & 7) - (((src_chroma_width & 7) == 0) << 3));
+            ptr_dst -= (8 - (src_chroma_width & 7) - (((src_chroma_width & 7) == 0) << 3)) << 1;
+
+            x0 = _mm_loadu_si128((const __m128i*)ptr_src);
+            if( lshft )
+                x0 = _mm_slli_epi16(x0, lshft);
+            x2 = _mm_srli_si128(x0, 2);
+
+            x2 = _mm_blend_epi16(x2, x0, 0x80);
+            x2 = _mm_avg_epu16(x2, x0);
+
+            _mm_storeu_si128((__m128i*)(ptr_dst + 0), _mm_unpacklo_epi16(x0, x2));
+            _mm_storeu_si128((__m128i*)(ptr_dst + 8), _mm_unpackhi_epi16(x0, x2));
+        }
+        ptr_dst_line += (dst_line_len << 1);
+
+        /* 5,3,7,1 - interlaced yuv420 to yuv422 interpolation with 1,1 - yuv422 to yuv444 interpolation. */
+        for( int y = 2; y < height - 2; y += 4, ptr_dst_line += (dst_line_len << 2), ptr_src_line += (src_line_len << 1) )
+        {
+            for( int i = 0; i < 4; i++ )
+            {
+                const uint16_t *ptr_src = ptr_src_line + src_line_len * (i & 0x01);
+                uint16_t *ptr_dst = ptr_dst_line + dst_line_len * i;
+                const uint16_t *ptr_src_fin = ptr_src + (src_chroma_width & ~7) - (((src_chroma_width & 7) == 0) << 3);
+
+                x2 = _mm_cmpeq_epi16(x2, x2);
+                x2 = _mm_slli_epi16(x2, 15);
+
+                x1 = _mm_loadu_si128((const __m128i*)(ptr_src                      ));
+                x3 = _mm_loadu_si128((const __m128i*)(ptr_src + (src_line_len << 1)));
+
+                x4 = _mm_unpacklo_epi16(x1, x3);
+                x5 = _mm_unpackhi_epi16(x1, x3);
+
+                x4 = _mm_sub_epi16(x4, x2);
+                x5 = _mm_sub_epi16(x5, x2);
+
+                x4 = _mm_madd_epi16(x4, _mm_load_si128((__m128i*)Array_5371[i]));
+                x5 = _mm_madd_epi16(x5, _mm_load_si128((__m128i*)Array_5371[i]));
+
+                x2 = _mm_cvtepu16_epi32(x2);
+                x2 = _mm_slli_epi32(x2, 3);
+
+                x4 = _mm_add_epi32(x4, x2);
+                x5 = _mm_add_epi32(x5, x2);
+
+                if (lshft - 3 < 0) {
+                    x4 = _mm_add_epi32(x4, x_add);
+                    x5 = _mm_add_epi32(x5, x_add);
+                    x4 = _mm_srai_epi32(x4, 3-lshft);
+                    x5 = _mm_srai_epi32(x5, 3-lshft);
+                } else if (lshft - 3 > 0) {
+                    x4 = _mm_slli_epi32(x4, lshft-3);
+                    x5 = _mm_slli_epi32(x5, lshft-3);
+                }
+
+                x0 = _mm_packus_epi32(x4, x5);
+
+                for( ; ptr_src < ptr_src_fin; ptr_src += 8, ptr_dst += 16 )
+                {
+                    x2 = _mm_cmpeq_epi16(x2, x2);
+                    x2 = _mm_slli_epi16(x2, 15);
+
+                    x1 = _mm_loadu_si128((const __m128i*)(ptr_src                       + 8));
+                    x3 = _mm_loadu_si128((const __m128i*)(ptr_src + (src_line_len << 1) + 8));
+
+                    x4 = _mm_unpacklo_epi16(x1, x3);
+                    x5 = _mm_unpackhi_epi16(x1, x3);
+
+                    x4 = _mm_sub_epi16(x4, x2);
+                    x5 = _mm_sub_epi16(x5, x2);
+
+                    x4 = _mm_madd_epi16(x4, _mm_load_si128((__m128i*)Array_5371[i]));
+                    x5 = _mm_madd_epi16(x5, _mm_load_si128((__m128i*)Array_5371[i]));
+
+                    x2 = _mm_cvtepu16_epi32(x2);
+                    x2 = _mm_slli_epi32(x2, 3);
+
+                    x4 = _mm_add_epi32(x4, x2);
+                    x5 = _mm_add_epi32(x5, x2);
+
+                    if (lshft - 3 < 0) {
+                        x4 = _mm_add_epi32(x4, x_add);
+                        x5 = _mm_add_epi32(x5, x_add);
+                        x4 = _mm_srai_epi32(x4, 3-lshft);
+                        x5 = _mm_srai_epi32(x5, 3-lshft);
+                    } else if (lshft - 3 > 0) {
+                        x4 = _mm_slli_epi32(x4, lshft-3);
+                        x5 = _mm_slli_epi32(x5, lshft-3);
+                    }
+
+                    x1 = _mm_packus_epi32(x4, x5);
+
+                    x2 = _mm_alignr_epi8(x1, x0, 2);
+                    x2 = _mm_avg_epu16(x2, x0);
+                    _mm_storeu_si128((__m128i*)(ptr_dst + 0), _mm_unpacklo_epi16(x0, x2));
+                    _mm_storeu_si128((__m128i*)(ptr_dst + 8), _mm_unpackhi_epi16(x0, x2));
+
+                    x0 = x1;
+                }
+                ptr_src -= (8 - (src_chroma_width & 7) - (((src_chroma_width & 7) == 0) << 3));
+                ptr_dst -= (8 - (src_chroma_width & 7) - (((src_chroma_width & 7) == 0) << 3)) << 1;
+
+                x1 = _mm_loadu_si128((const __m128i*)(ptr_src                      ));
+                x3 = _mm_loadu_si128((const __m128i*)(ptr_src + (src_line_len << 1)));
+
+                x2 = _mm_cmpeq_epi16(x2, x2);
+                x2 = _mm_slli_epi16(x2, 15);
+
+                x4 = _mm_unpacklo_epi16(x1, x3);
+                x5 = _mm_unpackhi_epi16(x1, x3);
+
+                x4 = _mm_sub_epi16(x4, x2);
+                x5 = _mm_sub_epi16(x5, x2);
+
+                x4 = _mm_madd_epi16(x4, _mm_load_si128((__m128i*)Array_5371[i]));
+                x5 = _mm_madd_epi16(x5, _mm_load_si128((__m128i*)Array_5371[i]));
+
+                x2 = _mm_cvtepu16_epi32(x2);
+                x2 = _mm_slli_epi32(x2, 3);
+
+                x4 = _mm_add_epi32(x4, x2);
+                x5 = _mm_add_epi32(x5, x2);
+
+                if (lshft - 3 < 0) {
+                    x4 = _mm_add_epi32(x4, x_add);
+                    x5 = _mm_add_epi32(x5, x_add);
+                    x4 = _mm_srai_epi32(x4, 3-lshft);
+                    x5 = _mm_srai_epi32(x5, 3-lshft);
+                } else if (lshft - 3 > 0) {
+                    x4 = _mm_slli_epi32(x4, lshft-3);
+                    x5 = _mm_slli_epi32(x5, lshft-3);
+                }
+
+                x0 = _mm_packus_epi32(x4, x5);
+
+                x2 = _mm_srli_si128(x0, 2);
+                x2 = _mm_blend_epi16(x2, x0, 0x80);
+                x2 = _mm_avg_epu16(x2, x0);
+
+                _mm_storeu_si128((__m128i*)(ptr_dst + 0), _mm_unpacklo_epi16(x0, x2));
+                _mm_storeu_si128((__m128i*)(ptr_dst + 8), _mm_unpackhi_epi16(x0, x2));
+            }
+        }
+
+        /* last 2 lines */
+        for (int i = 0; i < 2; i++)
+        {
+            uint16_t *ptr_dst = ptr_dst_line + i * dst_line_len;
+            const uint16_t *ptr_src = ptr_src_line + i * src_line_len;
+            const uint16_t *ptr_src_fin = ptr_src + (src_chroma_width & ~7) - (((src_chroma_width & 7) == 0) << 3);
+
+            x0 = _mm_loadu_si128((const __m128i*)ptr_src);
+            if( lshft )
+                x0 = _mm_slli_epi16(x0, lshft);
+
+            for( ; ptr_src < ptr_src_fin; ptr_src += 8, ptr_dst += 16 )
+            {
+                x1 = _mm_loadu_si128((const __m128i*)(ptr_src + 8));
+                if( lshft )
+                    x1 = _mm_slli_epi16(x1, lshft);
+
+                x2 = _mm_alignr_epi8(x1, x0, 2);
+                x2 = _mm_avg_epu16(x2, x0);
+
+                _mm_storeu_si128((__m128i*)(ptr_dst + 0), _mm_unpacklo_epi16(x0, x2));
+                _mm_storeu_si128((__m128i*)(ptr_dst + 8), _mm_unpackhi_epi16(x0, x2));
+                x0 = x1;
+            }
+            ptr_src -= (8 - (src_chroma_width & 7) - (((src_chroma_width & 7) == 0) << 3));
+            ptr_dst -= (8 - (src_chroma_width & 7) - (((src_chroma_width & 7) == 0) << 3)) << 1;
+
+            x0 = _mm_loadu_si128((const __m128i*)ptr_src);
+            if( lshft )
+                x0 = _mm_slli_epi16(x0, lshft);
+            x2 = _mm_srli_si128(x0, 2);
+
+            x2 = _mm_blend_epi16(x2, x0, 0x80);
+            x2 = _mm_avg_epu16(x2, x0);
+
+            _mm_storeu_si128((__m128i*)(ptr_dst + 0), _mm_unpacklo_epi16(x0, x2));
+            _mm_storeu_si128((__m128i*)(ptr_dst + 8), _mm_unpackhi_epi16(x0, x2));
+        }
+    }
+}
+
+void LW_FUNC_ALIGN convert_yuv420p9le_i_to_yuv444p16le_sse41
+(
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+)
+{
+    convert_yuv420ple_i_to_yuv444p16le_sse41( dst_data, dst_linesize, src_data, src_linesize, width, height, 9 );
+}
+
+void LW_FUNC_ALIGN convert_yuv420p10le_i_to_yuv444p16le_sse41
+(
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+)
+{
+    convert_yuv420ple_i_to_yuv444p16le_sse41( dst_data, dst_linesize, src_data, src_linesize, width, height, 10 );
+}
+
+void LW_FUNC_ALIGN convert_yuv420p16le_i_to_yuv444p16le_sse41
+(
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+)
+{
+    convert_yuv420ple_i_to_yuv444p16le_sse41( dst_data, dst_linesize, src_data, src_linesize, width, height, 16 );
+}
+
+#ifdef __GNUC__
+#pragma GCC target ("avx2")
+#endif
+#include <immintrin.h>
+
+/* Same as the SSE4.1 version within each 128-bit lane, so the three 32-byte outputs are gathered from both lanes afterwards. */
+static LW_FORCEINLINE int LW_FUNC_ALIGN pack_yuv48_avx2
+(
+    uint8_t               *dst,
+    const uint8_t * const *src,
+    int                    width,
+    int                    full_range,
+    const int              yc48
+)
+{
+    __m256i y0, y1, y2, y3, y4;
+    const __m256i sign      = _mm256_set1_epi16( (int16_t)0x8000 );
+    const __m256i y_coef    = _mm256_set1_epi32( yc48_y_coef   [full_range] );
+    const __m256i uv_coef   = _mm256_set1_epi32( yc48_uv_coef  [full_range] );
+    const __m256i y_offset  = _mm256_set1_epi16( yc48_y_offset [full_range] );
+    const __m256i uv_offset = _mm256_set1_epi32( yc48_uv_offset[full_range] );
+    const __m256i shuffle   = _mm256_broadcastsi128_si256( _mm_load_si128((const __m128i *)yuv48_shuffle) );
+    const int aligned_output = ((size_t)dst & 31) == 0;
+    int i = 0;
+    for( ; i + 16 <= width; i += 16, dst += 96 )
+    {
+        y0 = _mm256_loadu_si256((const __m256i *)(src[0] + 2 * i));
+        y1 = _mm256_loadu_si256((const __m256i *)(src[1] + 2 * i));
+        y2 = _mm256_loadu_si256((const __m256i *)(src[2] + 2 * i));
+        if( yc48 )
+        {
+            y0 = _mm256_add_epi16(y0, sign);
+            y1 = _mm256_add_epi16(y1, sign);
+            y2 = _mm256_add_epi16(y2, sign);
+            /* calc Y */
+            y3 = _mm256_unpackhi_epi16(y0, y0);
+            y0 = _mm256_unpacklo_epi16(y0, y0);
+            y3 = _mm256_srai_epi32(_mm256_madd_epi16(y3, y_coef), 16);
+            y0 = _mm256_srai_epi32(_mm256_madd_epi16(y0, y_coef), 16);
+            y0 = _mm256_add_epi16(_mm256_packs_epi32(y0, y3), y_offset);
+            /* calc U */
+            y3 = _mm256_unpackhi_epi16(y1, y1);
+            y1 = _mm256_unpacklo_epi16(y1, y1);
+            y3 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(y3, uv_coef), uv_offset), 16);
+            y1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(y1, uv_coef), uv_offset), 16);
+            y1 = _mm256_packs_epi32(y1, y3);
+            /* calc V */
+            y3 = _mm256_unpackhi_epi16(y2, y2);
+            y2 = _mm256_unpacklo_epi16(y2, y2);
+            y3 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(y3, uv_coef), uv_offset), 16);
+            y2 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(y2, uv_coef), uv_offset), 16);
+            y2 = _mm256_packs_epi32(y2, y3);
+        }
+        y0 = _mm256_shuffle_epi8(y0, shuffle);
+        y1 = _mm256_shuffle_epi8(y1, _mm256_alignr_epi8(shuffle, shuffle, 14));
+        y2 = _mm256_shuffle_epi8(y2, _mm256_alignr_epi8(shuffle, shuffle, 12));
+
+        y3 = _mm256_blend_epi16(y0, y1, 0x80 + 0x10 + 0x02);
+        y3 = _mm256_blend_epi16(y3, y2, 0x20 + 0x04       );
+        y2 = _mm256_blend_epi16(y2, y1, 0x20 + 0x04       );
+        y4 = y2;
+        y1 = _mm256_blend_epi16(y1, y0, 0x20 + 0x04       );
+        y2 = _mm256_blend_epi16(y2, y0, 0x80 + 0x10 + 0x02);
+        y1 = _mm256_blend_epi16(y1, y4, 0x80 + 0x10 + 0x02);
+        /* Each lane holds its 8 pixels in y3, y2 and y1 in this order. */
+        y0 = _mm256_permute2x128_si256(y3, y2, 0x20);
+        y4 = _mm256_permute2x128_si256(y1, y3, 0x30);
+        y2 = _mm256_permute2x128_si256(y2, y1, 0x31);
+        if( aligned_output )
+        {
+            _mm256_stream_si256((__m256i *)(dst +  0), y0);
+            _mm256_stream_si256((__m256i *)(dst + 32), y4);
+            _mm256_stream_si256((__m256i *)(dst + 64), y2);
+        }
+        else
+        {
+            _mm256_storeu_si256((__m256i *)(dst +  0), y0);
+            _mm256_storeu_si256((__m256i *)(dst + 32), y4);
+            _mm256_storeu_si256((__m256i *)(dst + 64), y2);
+        }
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+int LW_FUNC_ALIGN pack_yc48_avx2
+(
+    uint8_t               *dst,
+    const uint8_t * const *src,
+    int                    width,
+    int                    full_range
+)
+{
+    return pack_yuv48_avx2( dst, src, width, full_range, 1 );
+}
+
+int LW_FUNC_ALIGN pack_lw48_avx2
+(
+    uint8_t               *dst,
+    const uint8_t * const *src,
+    int                    width,
+    int                    full_range
+)
+{
+    return pack_yuv48_avx2( dst, src, width, 0, 0 );
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ * yuv16_convert_simd.h
+ *****************************************************************************
+ * Copyright (C) 2012-2015 L-SMASH Works project
+ *
+ * Authors: rigaya <rigaya34589@live.jp>
+ *          Yusuke Nakamura <muken.the.vfrmaniac@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *****************************************************************************/
+
+/* This file is available under an ISC license. */
+
+typedef void func_yuv16_upsample
+(
+    uint8_t * const       *dst_data,
+    const int             *dst_linesize,
+    const uint8_t * const *src_data,
+    const int             *src_linesize,
+    int                    width,
+    int                    height
+);
+
+/* Pack a leading part of a row of three 16-bit planes into 48-bit pixels and return the number of pixels done.
+ * The caller finishes the rest of the row. */
+typedef int func_yuv16_pack
+(
+    uint8_t               *dst,
+    const uint8_t * const *src,
+    int                    width,
+    int                    full_range
+);
+
+/* These require 'width' of 16 at least. */
+func_yuv16_upsample convert_yuv420p9le_i_to_yuv444p16le_sse41;
+func_yuv16_upsample convert_yuv420p10le_i_to_yuv444p16le_sse41;
+func_yuv16_upsample convert_yuv420p16le_i_to_yuv444p16le_sse41;
+
+func_yuv16_pack pack_yc48_sse2;
+func_yuv16_pack pack_yc48_sse41;
+func_yuv16_pack pack_lw48_sse41;
+func_yuv16_pack pack_yc48_avx2;
+func_yuv16_pack pack_lw48_avx2;